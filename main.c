@@ -7,15 +7,30 @@
 
 //the main
 int main(int argc, C_STR argv[]) {
-	if (argc == 1) {
-		repl();
+	C_STR path = NULL;
+
+	for (int i = 1; i < argc; ++i) {
+		if (strncmp(argv[i], "--", 2) == 0) {
+			if (!setOption(argv[i])) {
+				fprintf(stderr, "Unknown option '%s'.\n", argv[i]);
+				printUsage();
+				exit(64);
+			}
+		}
+		else if (path == NULL) {
+			path = argv[i];
+		}
+		else {
+			printUsage();
+			exit(64);
+		}
 	}
-	else if (argc == 2) {
-		runFile(argv[1]);
+
+	if (path == NULL) {
+		repl();
 	}
 	else {
-		fprintf(stderr, "Usage: [path]\n");
-		exit(64);
+		runFile(path);
 	}
 	return 0;
 }
\ No newline at end of file
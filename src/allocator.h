@@ -8,5 +8,6 @@
 
 #define mem_alloc mi_malloc
 #define mem_realloc mi_realloc
+#define mem_alloc_aligned mi_malloc_aligned
 #define mem_free mi_free
 #define mem_print_stats mi_stats_print
\ No newline at end of file
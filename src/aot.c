@@ -0,0 +1,509 @@
+/*
+ * MIT License
+ * Copyright (c) 2025 IMSDcrueoft (https://github.com/IMSDcrueoft)
+ * See LICENSE file in the root directory for full license text.
+*/
+#include "aot.h"
+#include "hash.h"
+
+// ==================== emit ====================
+
+#define READ_SHORT(at)	((uint32_t)(at)[0] | ((uint32_t)(at)[1] << 8))
+#define READ_24bits(at)	((uint32_t)(at)[0] | ((uint32_t)(at)[1] << 8) | ((uint32_t)(at)[2] << 16))
+#define READ_CONSTANT(at) (vm.constants.values[READ_24bits(at)])
+
+//number_xxx of value.h,int32 is kept like the interpreter
+static C_STR arithmeticOps[] = { "number_add", "number_subtract", "number_multiply", "number_divide", "number_modulus" };
+static C_STR compareOps[] = { "==", ">", "<", "!=", "<=", ">=" };
+
+//C expression of the constant,numbers are written as literals
+static void constantText(STR buffer, uint32_t index) {
+	Value constant = vm.constants.values[index];
+	if (IS_INT(constant)) {
+		sprintf(buffer, "INT_VAL(%d)", AS_INT(constant));
+	}
+	else if (IS_NUMBER(constant) && isfinite(AS_NUMBER(constant))) {
+		sprintf(buffer, "NUMBER_VAL(%a)", AS_NUMBER(constant));
+	}
+	else {
+		sprintf(buffer, "AOT_CONSTANT(%u)", index);
+	}
+}
+
+//target = left op right,the interpreter runs it if not numbers
+static void emitArithmetic(uint32_t op, uint32_t offset, C_STR target, C_STR left, C_STR right) {
+	printf("\tif (!IS_NUMBER(%s) || !IS_NUMBER(%s)) AOT_EXIT(%u);\n", left, right, offset);
+	printf("\t%s = %s(%s, %s);\n", target, arithmeticOps[op], left, right);
+}
+
+//the bool of left op right in buffer,the guard is printed
+static void emitCompare(STR buffer, CompareType type, uint32_t offset, C_STR left, C_STR right) {
+	if (COMPARE_IS_EQUALITY(type)) {
+		sprintf(buffer, "%svaluesEqual(%s, %s)", (type == COMPARE_EQUAL) ? "" : "!", left, right);
+		return;
+	}
+	printf("\tif (!IS_NUMBER(%s) || !IS_NUMBER(%s)) AOT_EXIT(%u);\n", left, right, offset);
+	sprintf(buffer, "NUMBER_COMPARE(%s, %s, %s)", left, compareOps[type], right);
+}
+
+//jit_call and jit_invoke,the callee may run in C too
+static void emitCallStatus(C_STR call) {
+	printf("\tvm.stackTop = stackTop;\n");
+	printf("\t{ JitStatus status = %s; if (status != JIT_OK) return status; }\n", call);
+	printf("\tAOT_RELOAD();\n");
+}
+
+//false if the commond is left to the interpreter
+static bool emitCommond(ObjFunction* function, uint32_t offset) {
+	uint8_t* code = function->chunk.code + offset;
+	uint8_t* operands = code + 1;
+	uint32_t next = offset + chunk_commondLength(code);
+	char buffer[2][64];
+	char call[160];
+
+	switch (code[0]) {
+	case OP_CONSTANT:
+		constantText(buffer[0], READ_24bits(operands));
+		printf("\tAOT_PUSH(%s);\n", buffer[0]);
+		return true;
+	case OP_CLOSURE:
+		//only the shared closure,it's made again when the source is compiled at startup
+		if (AS_FUNCTION(READ_CONSTANT(operands))->closure == NULL) return false;
+		printf("\tAOT_PUSH(OBJ_VAL(AS_FUNCTION(AOT_CONSTANT(%u))->closure));\n", READ_24bits(operands));
+		return true;
+	case OP_NIL:
+		printf("\tAOT_PUSH(NIL_VAL);\n");
+		return true;
+	case OP_TRUE:
+		printf("\tAOT_PUSH(TRUE_VAL);\n");
+		return true;
+	case OP_FALSE:
+		printf("\tAOT_PUSH(FALSE_VAL);\n");
+		return true;
+	case OP_MODULE_BUILTIN:
+		printf("\tAOT_PUSH(OBJ_VAL(&vm.builtins[%u]));\n", operands[0]);
+		return true;
+
+	case OP_GET_LOCAL:
+		printf("\tAOT_PUSH(slots[%u]);\n", READ_SHORT(operands));
+		return true;
+	case OP_SET_LOCAL:
+		printf("\tslots[%u] = stackTop[-1];\n", READ_SHORT(operands));
+		return true;
+	case OP_GET_UPVALUE:
+		printf("\tAOT_PUSH(*AOT_UPVALUE(%u));\n", operands[0]);
+		return true;
+	case OP_SET_UPVALUE:
+		printf("\taot_upvalueSet(CLOSURE_UPVALUES(frame->closure)[%u], stackTop[-1]);\n", operands[0]);
+		return true;
+	case OP_GET_CAPTURE:
+		printf("\tAOT_PUSH(AOT_CAPTURE(%u));\n", operands[0]);
+		return true;
+	case OP_GET_GLOBAL:
+	case OP_SET_GLOBAL:
+		printf("\t{\n\t\tValue* global = aot_globalRef(%u);\n", READ_24bits(operands));
+		printf("\t\tif (global == NULL) AOT_EXIT(%u);\n", offset);
+		printf((code[0] == OP_GET_GLOBAL) ? "\t\tAOT_PUSH(*global);\n\t}\n" : "\t\t*global = stackTop[-1];\n\t}\n");
+		return true;
+
+	case OP_POP:
+		printf("\tstackTop--;\n");
+		return true;
+	case OP_POP_N:
+		printf("\tstackTop -= %u;\n", READ_SHORT(operands));
+		return true;
+	case OP_DUP:
+		printf("\tstackTop[0] = stackTop[-1];\n\tstackTop++;\n");
+		return true;
+	case OP_DUP2:
+		printf("\tstackTop[0] = stackTop[-2];\n\tstackTop[1] = stackTop[-1];\n\tstackTop += 2;\n");
+		return true;
+	case OP_CLOSE_UPVALUE:
+		printf("\tjit_closeUpvalues(stackTop - 1);\n");
+		printf("\tstackTop--;\n");
+		return true;
+
+	case OP_ADD:
+	case OP_ADD_NUMBER:
+	case OP_SUBTRACT:
+	case OP_MULTIPLY:
+	case OP_DIVIDE:
+	case OP_MODULUS:
+		emitArithmetic((code[0] == OP_ADD_NUMBER) ? 0 : code[0] - OP_ADD, offset, "stackTop[-2]", "stackTop[-2]", "stackTop[-1]");
+		printf("\tstackTop--;\n");
+		return true;
+
+	case OP_NOT:
+		printf("\tstackTop[-1] = BOOL_VAL(aot_isFalsey(stackTop[-1]));\n");
+		return true;
+	case OP_NOT_LOCAL:
+		printf("\tAOT_PUSH(BOOL_VAL(aot_isFalsey(slots[%u])));\n", READ_SHORT(operands));
+		return true;
+	case OP_NEGATE:
+		printf("\tif (!IS_NUMBER(stackTop[-1])) AOT_EXIT(%u);\n", offset);
+		printf("\tstackTop[-1] = number_negate(stackTop[-1]);\n");
+		return true;
+	case OP_NEGATE_LOCAL:
+		printf("\tif (!IS_NUMBER(slots[%u])) AOT_EXIT(%u);\n", READ_SHORT(operands), offset);
+		printf("\tAOT_PUSH(number_negate(slots[%u]));\n", READ_SHORT(operands));
+		return true;
+
+	case OP_EQUAL:
+	case OP_GREATER:
+	case OP_LESS:
+	case OP_NOT_EQUAL:
+	case OP_LESS_EQUAL:
+	case OP_GREATER_EQUAL:
+		emitCompare(call, (CompareType)(code[0] - OP_EQUAL), offset, "stackTop[-2]", "stackTop[-1]");
+		printf("\tstackTop[-2] = BOOL_VAL(%s);\n", call);
+		printf("\tstackTop--;\n");
+		return true;
+
+	case OP_JUMP:
+		printf("\tgoto L%u;\n", next + READ_SHORT(operands));
+		return true;
+	case OP_LOOP:
+		printf("\tgoto L%u;\n", next - READ_SHORT(operands));
+		return true;
+	case OP_JUMP_IF_FALSE:
+		printf("\tif (aot_isFalsey(stackTop[-1])) goto L%u;\n", next + READ_SHORT(operands));
+		return true;
+	case OP_JUMP_IF_FALSE_POP:
+		printf("\tif (aot_isFalsey(*--stackTop)) goto L%u;\n", next + READ_SHORT(operands));
+		return true;
+	case OP_JUMP_IF_TRUE:
+		printf("\tif (!aot_isFalsey(stackTop[-1])) goto L%u;\n", next + READ_SHORT(operands));
+		return true;
+
+	case OP_CALL:
+		sprintf(call, "jit_call(frame, code + %u, %u)", next, operands[0]);
+		emitCallStatus(call);
+		return true;
+	case OP_CALL_NATIVE_NUMBER: {
+		uint32_t argCount = operands[0];
+		if (argCount == 1) {
+			printf("\tif (IS_NATIVE(stackTop[-2]) && AS_NATIVE_OBJ(stackTop[-2])->fastArity == 1 && IS_NUMBER(stackTop[-1])) {\n");
+			printf("\t\tstackTop[-2] = NUMBER_VAL_FIT(AS_NATIVE_OBJ(stackTop[-2])->unary(AS_NUMBER(stackTop[-1])));\n");
+			printf("\t\tstackTop--;\n");
+			printf("\t\tgoto L%u;\n\t}\n", next);
+		}
+		else if (argCount == 2) {
+			printf("\tif (IS_NATIVE(stackTop[-3]) && AS_NATIVE_OBJ(stackTop[-3])->fastArity == 2 && IS_NUMBER(stackTop[-2]) && IS_NUMBER(stackTop[-1])) {\n");
+			printf("\t\tstackTop[-3] = NUMBER_VAL_FIT(AS_NATIVE_OBJ(stackTop[-3])->binary(AS_NUMBER(stackTop[-2]), AS_NUMBER(stackTop[-1])));\n");
+			printf("\t\tstackTop -= 2;\n");
+			printf("\t\tgoto L%u;\n\t}\n", next);
+		}
+		//guard missed,call as usual
+		sprintf(call, "jit_call(frame, code + %u, %u)", next, argCount);
+		emitCallStatus(call);
+		return true;
+	}
+	case OP_INVOKE:
+		sprintf(call, "jit_invoke(frame, code + %u, AS_STRING(AOT_CONSTANT(%u)), %u, &frame->closure->function->invokeCaches[%u])",
+			next, READ_24bits(operands), operands[3], READ_SHORT(operands + 4));
+		emitCallStatus(call);
+		return true;
+	case OP_RETURN:
+		//the script returns in the interpreter
+		printf("\tif (vm.frameCount == 1) AOT_EXIT(%u);\n", offset);
+		if (function->closesUpvalues) printf("\tjit_closeUpvalues(slots);\n");
+		printf("\tvm.frameCount--;\n");
+		printf("\tslots[0] = stackTop[-1];\n");
+		printf("\tvm.stackTop = slots + 1;\n");
+		printf("\treturn JIT_OK;\n");
+		return true;
+
+	case OP_PRINT:
+		printf("\tjit_print(*--stackTop);\n");
+		return true;
+
+	case OP_GET_SUBSCRIPT:
+	case OP_GET_SUBSCRIPT_ARRAY:
+	case OP_GET_SUBSCRIPT_F64:
+		printf("\tif (!aot_isArray(stackTop[-2]) || !IS_NUMBER(stackTop[-1])) AOT_EXIT(%u);\n", offset);
+		printf("\tstackTop[-2] = aot_arrayGet(stackTop[-2], stackTop[-1]);\n");
+		printf("\tstackTop--;\n");
+		return true;
+	case OP_SET_SUBSCRIPT:
+	case OP_SET_SUBSCRIPT_ARRAY:
+	case OP_SET_SUBSCRIPT_F64:
+		printf("\tif (!aot_isArray(stackTop[-3]) || !IS_NUMBER(stackTop[-2]) || !aot_arraySet(stackTop[-3], stackTop[-2], stackTop[-1])) AOT_EXIT(%u);\n", offset);
+		printf("\tstackTop[-3] = stackTop[-1];\n");
+		printf("\tstackTop -= 2;\n");
+		return true;
+	case OP_GET_INDEX:
+	case OP_GET_INDEX_ARRAY:
+	case OP_GET_INDEX_F64: {
+		Value constant = READ_CONSTANT(operands);
+		if (!IS_NUMBER(constant) || !isfinite(AS_NUMBER(constant))) return false;
+
+		char index[64];
+		constantText(index, READ_24bits(operands));
+		printf("\tif (!aot_isArray(stackTop[-1])) AOT_EXIT(%u);\n", offset);
+		printf("\tstackTop[-1] = aot_arrayGet(stackTop[-1], %s);\n", index);
+		return true;
+	}
+	case OP_SET_INDEX:
+	case OP_SET_INDEX_ARRAY:
+	case OP_SET_INDEX_F64: {
+		Value constant = READ_CONSTANT(operands);
+		if (!IS_NUMBER(constant) || !isfinite(AS_NUMBER(constant))) return false;
+
+		char index[64];
+		constantText(index, READ_24bits(operands));
+		printf("\tif (!aot_isArray(stackTop[-2]) || !aot_arraySet(stackTop[-2], %s, stackTop[-1])) AOT_EXIT(%u);\n", index, offset);
+		printf("\tstackTop[-2] = stackTop[-1];\n");
+		printf("\tstackTop--;\n");
+		return true;
+	}
+
+	case OP_JUMP_IF_IN_ARRAY_LL:
+		printf("\tif (isArrayLoopIndex(slots[%u], slots[%u])) goto L%u;\n", READ_SHORT(operands + 2), READ_SHORT(operands), next + READ_SHORT(operands + 4));
+		return true;
+	case OP_GET_ELEMENT_LL:
+		printf("\tAOT_PUSH(aot_elementGet(slots[%u], slots[%u]));\n", READ_SHORT(operands), READ_SHORT(operands + 2));
+		return true;
+	case OP_SET_ELEMENT_LL:
+		printf("\taot_elementSet(slots[%u], slots[%u], stackTop[-1]);\n", READ_SHORT(operands), READ_SHORT(operands + 2));
+		return true;
+
+	case OP_REG_MOVE:
+		printf("\tslots[%u] = slots[%u];\n", READ_SHORT(operands), READ_SHORT(operands + 2));
+		return true;
+	case OP_REG_LOAD_CONST:
+		constantText(buffer[0], READ_24bits(operands + 2));
+		printf("\tslots[%u] = %s;\n", READ_SHORT(operands), buffer[0]);
+		return true;
+	}
+
+	//families of super commonds
+	if (code[0] >= OP_ADD_CONST && code[0] <= OP_MODULUS_CONST) {
+		constantText(buffer[0], READ_24bits(operands));
+		emitArithmetic(code[0] - OP_ADD_CONST, offset, "stackTop[-1]", "stackTop[-1]", buffer[0]);
+		return true;
+	}
+	if (code[0] >= OP_EQUAL_CONST && code[0] <= OP_GREATER_EQUAL_CONST) {
+		constantText(buffer[0], READ_24bits(operands));
+		emitCompare(call, (CompareType)(code[0] - OP_EQUAL_CONST), offset, "stackTop[-1]", buffer[0]);
+		printf("\tstackTop[-1] = BOOL_VAL(%s);\n", call);
+		return true;
+	}
+	if (code[0] >= OP_ADD_LOCAL && code[0] <= OP_MODULUS_LOCAL) {
+		sprintf(buffer[0], "slots[%u]", READ_SHORT(operands));
+		emitArithmetic(code[0] - OP_ADD_LOCAL, offset, "stackTop[-1]", "stackTop[-1]", buffer[0]);
+		return true;
+	}
+	if (code[0] >= OP_EQUAL_LOCAL && code[0] <= OP_GREATER_EQUAL_LOCAL) {
+		sprintf(buffer[0], "slots[%u]", READ_SHORT(operands));
+		emitCompare(call, (CompareType)(code[0] - OP_EQUAL_LOCAL), offset, "stackTop[-1]", buffer[0]);
+		printf("\tstackTop[-1] = BOOL_VAL(%s);\n", call);
+		return true;
+	}
+	if (code[0] >= OP_JUMP_IF_FALSE_EQUAL_LC && code[0] <= OP_JUMP_IF_FALSE_GREATER_EQUAL_LC) {
+		sprintf(buffer[0], "slots[%u]", READ_SHORT(operands));
+		constantText(buffer[1], READ_24bits(operands + 2));
+		emitCompare(call, (CompareType)(code[0] - OP_JUMP_IF_FALSE_EQUAL_LC), offset, buffer[0], buffer[1]);
+		printf("\tif (!(%s)) goto L%u;\n", call, next + READ_SHORT(operands + 5));
+		return true;
+	}
+	if (code[0] >= OP_JUMP_IF_FALSE_EQUAL_LL && code[0] <= OP_JUMP_IF_FALSE_GREATER_EQUAL_LL) {
+		sprintf(buffer[0], "slots[%u]", READ_SHORT(operands));
+		sprintf(buffer[1], "slots[%u]", READ_SHORT(operands + 2));
+		emitCompare(call, (CompareType)(code[0] - OP_JUMP_IF_FALSE_EQUAL_LL), offset, buffer[0], buffer[1]);
+		printf("\tif (!(%s)) goto L%u;\n", call, next + READ_SHORT(operands + 4));
+		return true;
+	}
+	//strings are added by the interpreter
+	if (code[0] >= OP_INPLACE_ADD_LC && code[0] <= OP_INPLACE_DIVIDE_LC) {
+		sprintf(buffer[0], "slots[%u]", READ_SHORT(operands));
+		constantText(buffer[1], READ_24bits(operands + 2));
+		emitArithmetic(code[0] - OP_INPLACE_ADD_LC, offset, buffer[0], buffer[0], buffer[1]);
+		return true;
+	}
+	if (code[0] >= OP_INPLACE_ADD_LL && code[0] <= OP_INPLACE_DIVIDE_LL) {
+		sprintf(buffer[0], "slots[%u]", READ_SHORT(operands));
+		sprintf(buffer[1], "slots[%u]", READ_SHORT(operands + 2));
+		emitArithmetic(code[0] - OP_INPLACE_ADD_LL, offset, buffer[0], buffer[0], buffer[1]);
+		return true;
+	}
+	if (code[0] >= OP_INPLACE_ADD_UC && code[0] <= OP_INPLACE_DIVIDE_UC) {
+		sprintf(buffer[0], "*AOT_UPVALUE(%u)", operands[0]);
+		constantText(buffer[1], READ_24bits(operands + 1));
+		emitArithmetic(code[0] - OP_INPLACE_ADD_UC, offset, buffer[0], buffer[0], buffer[1]);
+		return true;
+	}
+	if (code[0] >= OP_INPLACE_ADD_GC && code[0] <= OP_INPLACE_DIVIDE_GC) {
+		printf("\t{\n\t\tValue* global = aot_globalRef(%u);\n", READ_24bits(operands));
+		printf("\t\tif (global == NULL) AOT_EXIT(%u);\n", offset);
+		constantText(buffer[1], READ_24bits(operands + 3));
+		emitArithmetic(code[0] - OP_INPLACE_ADD_GC, offset, "*global", "*global", buffer[1]);
+		printf("\t}\n");
+		return true;
+	}
+	if (code[0] >= OP_REG_ADD_LL && code[0] <= OP_REG_MODULUS_LL) {
+		sprintf(call, "slots[%u]", READ_SHORT(operands));
+		sprintf(buffer[0], "slots[%u]", READ_SHORT(operands + 2));
+		sprintf(buffer[1], "slots[%u]", READ_SHORT(operands + 4));
+		emitArithmetic(code[0] - OP_REG_ADD_LL, offset, call, buffer[0], buffer[1]);
+		return true;
+	}
+	if (code[0] >= OP_REG_ADD_LC && code[0] <= OP_REG_MODULUS_LC) {
+		sprintf(call, "slots[%u]", READ_SHORT(operands));
+		sprintf(buffer[0], "slots[%u]", READ_SHORT(operands + 2));
+		constantText(buffer[1], READ_24bits(operands + 4));
+		emitArithmetic(code[0] - OP_REG_ADD_LC, offset, call, buffer[0], buffer[1]);
+		return true;
+	}
+
+	return false;
+}
+
+//static JitStatus function_<index>(CallFrame* frame, uint8_t* ip)
+static void emitFunction(ObjFunction* function, uint32_t index) {
+	Chunk* chunk = &function->chunk;
+
+	printf("//%s\n", (function->name != NULL) ? function->name->chars : "<script>");
+	printf("static JitStatus function_%u(CallFrame* frame, uint8_t* ip) {\n", index);
+	printf("\tuint8_t* code = frame->closure->function->chunk.code;\n");
+	printf("\tValue* slots = frame->slots;\n");
+	printf("\tValue* stackTop = vm.stackTop;\n");
+	printf("\t(void)slots;\n\n");
+
+	//entered at any commond
+	printf("\tswitch (ip - code) {\n");
+	for (uint32_t offset = 0; offset < chunk->count; offset += chunk_commondLength(chunk->code + offset)) {
+		printf("\tcase %u: goto L%u;\n", offset, offset);
+	}
+	printf("\t}\n");
+	printf("\treturn JIT_EXIT;\n\n");
+
+	for (uint32_t offset = 0; offset < chunk->count; offset += chunk_commondLength(chunk->code + offset)) {
+		printf("L%u:\n", offset);
+		if (!emitCommond(function, offset)) {
+			printf("\tAOT_EXIT(%u);\n", offset);
+		}
+	}
+	printf("}\n\n");
+}
+
+//the source as C string literals,one for each line
+static void emitSource(C_STR source) {
+	printf("static const char source[] =\n\t\"");
+	for (C_STR c = source; *c != '\0'; ++c) {
+		switch (*c) {
+		case '\n':
+			printf((c[1] != '\0') ? "\\n\"\n\t\"" : "\\n");
+			break;
+		case '\\':
+			printf("\\\\");
+			break;
+		case '"':
+			printf("\\\"");
+			break;
+		case '\t':
+			printf("\\t");
+			break;
+		case '\r':
+			printf("\\r");
+			break;
+		default:
+			if ((uint8_t)*c < 0x20 || (uint8_t)*c >= 0x7f || *c == '?') {
+				printf("\\%03o", (uint8_t)*c);
+			}
+			else {
+				putchar(*c);
+			}
+			break;
+		}
+	}
+	printf("\";\n\n");
+}
+
+InterpretResult aot_emit(C_STR source) {
+	ObjFunction* script = compile(source, TYPE_SCRIPT);
+	if (script == NULL) return INTERPRET_COMPILE_ERROR;
+
+	printf("//generated by loxflux --emit-c,runs the script with the runtime of loxflux.\n");
+	printf("//build it with src/*.c,src/*.cpp and xxhash.c but main.c,the same options.h is needed\n");
+	printf("#include \"aot.h\"\n\n");
+
+	//the script,then the functions in the order of constants
+	uint32_t functionCount = 0;
+	emitFunction(script, functionCount++);
+	for (uint32_t i = 0; i < vm.constants.count; ++i) {
+		if (IS_FUNCTION(vm.constants.values[i])) {
+			emitFunction(AS_FUNCTION(vm.constants.values[i]), functionCount++);
+		}
+	}
+
+	printf("static const AotFunction functions[%u] = {\n", functionCount);
+	functionCount = 0;
+	printf("\t{ function_%u, 0x%016llxull },\n", functionCount++, (unsigned long long)HASH_64bits(script->chunk.code, script->chunk.count));
+	for (uint32_t i = 0; i < vm.constants.count; ++i) {
+		if (IS_FUNCTION(vm.constants.values[i])) {
+			Chunk* chunk = &AS_FUNCTION(vm.constants.values[i])->chunk;
+			printf("\t{ function_%u, 0x%016llxull },\n", functionCount++, (unsigned long long)HASH_64bits(chunk->code, chunk->count));
+		}
+	}
+	printf("};\n\n");
+
+	emitSource(source);
+
+	printf("int main() {\n");
+	printf("\tAotProgram program = {\n");
+	printf("\t\t.source = source,\n");
+	printf("\t\t.registerMode = %s,\n", vm.config.registerMode ? "true" : "false");
+	printf("\t\t.functionCount = %u,\n", functionCount);
+	printf("\t\t.functions = functions,\n");
+	printf("\t};\n");
+	printf("\treturn aot_main(&program);\n");
+	printf("}\n");
+	return INTERPRET_OK;
+}
+
+#undef READ_SHORT
+#undef READ_24bits
+#undef READ_CONSTANT
+
+// ==================== run ====================
+
+//the C code is used only if the function is compiled to the same bytecode
+static void attach(ObjFunction* function, const AotFunction* aot) {
+	if (aot->checksum == HASH_64bits(function->chunk.code, function->chunk.count)) {
+		function->aot = aot;
+	}
+}
+
+int aot_main(const AotProgram* program) {
+	vm.config.registerMode = program->registerMode;
+	vm.config.aot = true;
+	vm_init();
+
+	ObjFunction* script = compile(program->source, TYPE_SCRIPT);
+	if (script == NULL) return 65;
+
+	uint32_t index = 0;
+	attach(script, &program->functions[index++]);
+	for (uint32_t i = 0; i < vm.constants.count && index < program->functionCount; ++i) {
+		if (IS_FUNCTION(vm.constants.values[i])) {
+			attach(AS_FUNCTION(vm.constants.values[i]), &program->functions[index++]);
+		}
+	}
+
+	InterpretResult result = interpret_function(script);
+	if (result == INTERPRET_RUNTIME_ERROR) return 70;
+
+	vm_free();
+	return 0;
+}
+
+JitStatus aot_run(CallFrame* frame) {
+	while (true) {
+		JitStatus status = aot_enter(frame);
+		if (status != JIT_OK) return status;
+
+		//the frame returned,go on if the caller has C code
+		frame = &vm.frames[vm.frameCount - 1];
+		if (frame->closure->function->aot == NULL) return JIT_EXIT;
+	}
+}
@@ -0,0 +1,117 @@
+/*
+ * MIT License
+ * Copyright (c) 2025 IMSDcrueoft (https://github.com/IMSDcrueoft)
+ * See LICENSE file in the root directory for full license text.
+*/
+#pragma once
+#include "common.h"
+#include "object.h"
+#include "vm.h"
+#include "gc.h"
+#include "jit.h"
+
+//C code of a function printed by --emit-c,entered and left at commond boundaries like the jit.
+//commonds it doesn't have and the slow paths are left to the interpreter
+struct AotFunction {
+	JitStatus(*run)(CallFrame* frame, uint8_t* ip);
+	uint64_t checksum;	//hash of the bytecode it is emitted from
+};
+
+//the program printed by --emit-c,the source is compiled again when it starts
+typedef struct {
+	C_STR source;
+	bool registerMode;
+	uint32_t functionCount;
+	const AotFunction* functions;	//the script,then the functions in the order of constants
+} AotProgram;
+
+//print the script as a C program,link it with the runtime sources except main.c
+InterpretResult aot_emit(C_STR source);
+//main of the printed program
+int aot_main(const AotProgram* program);
+
+//run the C code of frame from frame->ip,it goes on with the callers that have C code too.
+//never JIT_OK,vm.stackTop and the top frame's ip are fresh after it
+JitStatus aot_run(CallFrame* frame);
+
+//run the C code of frame from frame->ip until it returns
+static inline JitStatus aot_enter(CallFrame* frame) {
+	return frame->closure->function->aot->run(frame, frame->ip);
+}
+
+// ==================== for the printed code ====================
+
+//go on in the interpreter at the commond,it runs the commond again
+#define AOT_EXIT(offset)						\
+	do {										\
+		frame->ip = code + (offset);			\
+		vm.stackTop = stackTop;					\
+		return JIT_EXIT;						\
+	} while (false)
+
+//same as PUSH() of the interpreter,the frame is checked by call()
+#define AOT_PUSH(value) (*stackTop++ = (value))
+
+//the top and the frame may be changed by a call
+#define AOT_RELOAD() (stackTop = vm.stackTop, slots = frame->slots)
+#define AOT_CONSTANT(index) (vm.constants.values[(index)])
+#define AOT_UPVALUE(index) (CLOSURE_UPVALUES(frame->closure)[(index)]->location)
+#define AOT_CAPTURE(index) (frame->closure->captures[(index)])
+
+static inline void aot_upvalueSet(ObjUpvalue* upvalue, Value value) {
+	*upvalue->location = value;
+	gc_writeBarrier(&upvalue->obj, value);
+}
+
+static inline bool aot_isFalsey(Value value) {
+	return IS_NIL(value) || (IS_BOOL(value) && !AS_BOOL(value));
+}
+
+//NULL if undefined,the slots are the same when the source is compiled again
+static inline Value* aot_globalRef(uint32_t slot) {
+	Value* global = &vm.globalValues[slot];
+	return IS_UNDEFINED(*global) ? NULL : global;
+}
+
+static inline bool aot_isArray(Value value) {
+	return isObjType(value, OBJ_ARRAY) || isObjType(value, OBJ_ARRAY_F64);
+}
+
+//the element or nil,array is OBJ_ARRAY or OBJ_ARRAY_F64 and index is a number
+static inline Value aot_arrayGet(Value target, Value index) {
+	ObjArray* array = AS_ARRAY(target);
+	if (!ARRAY_VALUE_IN_RANGE(array, index)) return NIL_VAL;
+	return OBJ_IS_TYPE(array, OBJ_ARRAY) ? ARRAY_ELEMENT(array, Value, ARRAY_VALUE_INDEX(index)) : NUMBER_VAL(ARRAY_ELEMENT(array, double, ARRAY_VALUE_INDEX(index)));
+}
+
+//false if the interpreter must run it,out of range throws and f64 converts others
+static inline bool aot_arraySet(Value target, Value index, Value value) {
+	ObjArray* array = AS_ARRAY(target);
+	if (!ARRAY_VALUE_IN_RANGE(array, index)) return false;
+
+	if (OBJ_IS_TYPE(array, OBJ_ARRAY)) {
+		ARRAY_ELEMENT(array, Value, ARRAY_VALUE_INDEX(index)) = value;
+		gc_writeBarrier(&array->obj, value);
+		return true;
+	}
+	if (!IS_NUMBER(value)) return false;
+	ARRAY_ELEMENT(array, double, ARRAY_VALUE_INDEX(index)) = AS_NUMBER(value);
+	return true;
+}
+
+//the body of array loops,isArrayLoopIndex is checked by the guard
+static inline Value aot_elementGet(Value target, Value index) {
+	ObjArray* array = AS_ARRAY(target);
+	return OBJ_IS_TYPE(array, OBJ_ARRAY) ? ARRAY_ELEMENT(array, Value, ARRAY_VALUE_INDEX(index)) : NUMBER_VAL(ARRAY_ELEMENT(array, double, ARRAY_VALUE_INDEX(index)));
+}
+
+static inline void aot_elementSet(Value target, Value index, Value value) {
+	ObjArray* array = AS_ARRAY(target);
+	if (OBJ_IS_TYPE(array, OBJ_ARRAY)) {
+		ARRAY_ELEMENT(array, Value, ARRAY_VALUE_INDEX(index)) = value;
+		gc_writeBarrier(&array->obj, value);
+	}
+	else {
+		setTypedArrayElement(array, ARRAY_VALUE_INDEX(index), value);
+	}
+}
@@ -4,6 +4,7 @@
  * See LICENSE file in the root directory for full license text.
 */
 #include "chunk.h"
+#include "vm.h"
 
 void chunk_init(Chunk* chunk) {
 	chunk->count = 0u;
@@ -110,4 +111,206 @@ void opStack_free(OPStack* stack)
 {
 	FREE_ARRAY_NO_GC(uint8_t, stack->code, stack->capacity);
 	opStack_init(stack);
-}
\ No newline at end of file
+}
+
+uint32_t chunk_commondLength(uint8_t* code) {
+	switch (code[0]) {
+	case OP_BITWISE:
+	case OP_CALL:
+	case OP_TAIL_CALL:
+	case OP_GET_UPVALUE:
+	case OP_SET_UPVALUE:
+	case OP_GET_CAPTURE:
+	case OP_MODULE_BUILTIN:
+	case OP_CALL_NATIVE_NUMBER:
+		return 2;
+	case OP_GET_LOCAL:
+	case OP_SET_LOCAL:
+	case OP_JUMP:
+	case OP_LOOP:
+	case OP_JUMP_IF_FALSE:
+	case OP_JUMP_IF_FALSE_POP:
+	case OP_JUMP_IF_TRUE:
+	case OP_POP_N:
+	case OP_NEW_ARRAY:
+	case OP_NOT_LOCAL:
+	case OP_NEGATE_LOCAL:
+		return 3;
+	case OP_CONSTANT:
+	case OP_DEFINE_GLOBAL:
+	case OP_GET_GLOBAL:
+	case OP_SET_GLOBAL:
+	case OP_CLASS:
+	case OP_METHOD:
+	case OP_GET_SUPER:
+	case OP_GET_INDEX:
+	case OP_SET_INDEX:
+	case OP_GET_INDEX_ARRAY:
+	case OP_GET_INDEX_F64:
+	case OP_SET_INDEX_ARRAY:
+	case OP_SET_INDEX_F64:
+	case OP_NEW_PROPERTY:
+		return 4;
+	case OP_REG_MOVE:
+	case OP_REG_NEGATE:
+	case OP_GET_ELEMENT_LL:
+	case OP_SET_ELEMENT_LL:
+		return 5;
+	case OP_GET_PROPERTY:
+	case OP_SET_PROPERTY:
+	case OP_REG_LOAD_CONST:
+		return 6;
+	case OP_INVOKE:
+	case OP_SUPER_INVOKE:
+	case OP_JUMP_IF_IN_ARRAY_LL:
+		return 7;
+	case OP_CLOSURE: {
+		ObjFunction* function = AS_FUNCTION(vm.constants.values[(uint32_t)code[1] | ((uint32_t)code[2] << 8) | ((uint32_t)code[3] << 16)]);
+		return 4 + 3 * (function->upvalueCount + function->captureCount);
+	}
+	}
+
+	if (code[0] >= OP_ADD_CONST && code[0] <= OP_GREATER_EQUAL_CONST) return 4;
+	if (code[0] >= OP_ADD_LOCAL && code[0] <= OP_GREATER_EQUAL_LOCAL) return 3;
+	if (code[0] >= OP_JUMP_IF_FALSE_EQUAL_LC && code[0] <= OP_JUMP_IF_FALSE_GREATER_EQUAL_LC) return 8;
+	if (code[0] >= OP_JUMP_IF_FALSE_EQUAL_LL && code[0] <= OP_JUMP_IF_FALSE_GREATER_EQUAL_LL) return 7;
+	if (code[0] >= OP_INPLACE_ADD_LC && code[0] <= OP_INPLACE_DIVIDE_LC) return 6;
+	if (code[0] >= OP_INPLACE_ADD_LL && code[0] <= OP_INPLACE_DIVIDE_UC) return 5;
+	if (code[0] >= OP_INPLACE_ADD_GC && code[0] <= OP_INPLACE_DIVIDE_GC) return 7;
+	if (code[0] >= OP_REG_ADD_LL && code[0] <= OP_REG_MODULUS_LL) return 7;
+	if (code[0] >= OP_REG_ADD_LC && code[0] <= OP_REG_MODULUS_LC) return 8;
+	return 1;
+}
+
+//values pushed minus values popped,a call leaves its result in the slot of the callee
+static int32_t commondStackEffect(uint8_t* code) {
+	switch (code[0]) {
+	case OP_CONSTANT:
+	case OP_GET_LOCAL:
+	case OP_NIL:
+	case OP_TRUE:
+	case OP_FALSE:
+	case OP_GET_GLOBAL:
+	case OP_CLOSURE:
+	case OP_GET_UPVALUE:
+	case OP_GET_CAPTURE:
+	case OP_NEW_OBJECT:
+	case OP_CLASS:
+	case OP_MODULE_BUILTIN:
+	case OP_NOT_LOCAL:
+	case OP_NEGATE_LOCAL:
+	case OP_GET_ELEMENT_LL:
+	case OP_DUP:
+		return 1;
+	case OP_DUP2:
+		return 2;
+	case OP_ADD:
+	case OP_SUBTRACT:
+	case OP_MULTIPLY:
+	case OP_DIVIDE:
+	case OP_MODULUS:
+	case OP_EQUAL:
+	case OP_GREATER:
+	case OP_LESS:
+	case OP_NOT_EQUAL:
+	case OP_LESS_EQUAL:
+	case OP_GREATER_EQUAL:
+	case OP_JUMP_IF_FALSE_POP:
+	case OP_POP:
+	case OP_SET_PROPERTY:
+	case OP_SET_INDEX:
+	case OP_SET_INDEX_ARRAY:
+	case OP_SET_INDEX_F64:
+	case OP_GET_SUPER:
+	case OP_DEFINE_GLOBAL:
+	case OP_GET_SUBSCRIPT:
+	case OP_GET_SUBSCRIPT_ARRAY:
+	case OP_GET_SUBSCRIPT_F64:
+	case OP_CLOSE_UPVALUE:
+	case OP_NEW_PROPERTY:
+	case OP_INSTANCE_OF:
+	case OP_INHERIT:
+	case OP_METHOD:
+	case OP_PRINT:
+	case OP_THROW:
+	case OP_ADD_NUMBER:
+		return -1;
+	case OP_SET_SUBSCRIPT:
+	case OP_SET_SUBSCRIPT_ARRAY:
+	case OP_SET_SUBSCRIPT_F64:
+		return -2;
+	case OP_POP_N:
+		return -(int32_t)((uint32_t)code[1] | ((uint32_t)code[2] << 8));
+	case OP_NEW_ARRAY:
+		return 1 - (int32_t)((uint32_t)code[1] | ((uint32_t)code[2] << 8));
+	case OP_BITWISE:
+		return (code[1] == BIT_OP_NOT) ? 0 : -1;
+	case OP_CALL:
+	case OP_TAIL_CALL:
+	case OP_CALL_NATIVE_NUMBER:
+		return -(int32_t)code[1];
+	case OP_INVOKE:
+		return -(int32_t)code[4];
+	case OP_SUPER_INVOKE:
+		return -(int32_t)code[4] - 1;
+	}
+
+	//the others work on the top or on the locals
+	return 0;
+}
+
+//the offset a jump goes to,UINT32_MAX if the commond doesn't jump
+static uint32_t commondJumpTarget(uint8_t* code, uint32_t offset, uint32_t length) {
+	switch (code[0]) {
+	case OP_JUMP:
+	case OP_JUMP_IF_FALSE:
+	case OP_JUMP_IF_FALSE_POP:
+	case OP_JUMP_IF_TRUE:
+	case OP_JUMP_IF_IN_ARRAY_LL:
+		break;
+	case OP_LOOP:
+		return offset + length - ((uint32_t)code[length - 2] | ((uint32_t)code[length - 1] << 8));
+	default:
+		if (code[0] >= OP_JUMP_IF_FALSE_EQUAL_LC && code[0] <= OP_JUMP_IF_FALSE_GREATER_EQUAL_LL) break;
+		return UINT32_MAX;
+	}
+	return offset + length + ((uint32_t)code[length - 2] | ((uint32_t)code[length - 1] << 8));
+}
+
+uint32_t chunk_maxStack(Chunk* chunk, uint32_t entryDepth) {
+	//depth at the commonds jumped to,-1 if no jump reaches it yet
+	int32_t* targets = ALLOCATE_NO_GC(int32_t, chunk->count + 1);
+	for (uint32_t i = 0; i <= chunk->count; ++i) {
+		targets[i] = -1;
+	}
+
+	int32_t depth = (int32_t)entryDepth;
+	int32_t maxDepth = depth;
+	bool isReachable = true;
+
+	uint32_t offset = 0;
+	while (offset < chunk->count) {
+		//code after an unconditional jump is only reached by jumps
+		if (targets[offset] >= 0 && (!isReachable || targets[offset] > depth)) {
+			depth = targets[offset];
+		}
+
+		uint8_t* code = chunk->code + offset;
+		uint32_t length = chunk_commondLength(code);
+
+		depth += commondStackEffect(code);
+		if (depth < 0) depth = 0;
+		if (depth > maxDepth) maxDepth = depth;
+
+		uint32_t target = commondJumpTarget(code, offset, length);
+		if (target <= chunk->count && targets[target] < depth) {
+			targets[target] = depth;
+		}
+
+		isReachable = (code[0] != OP_JUMP && code[0] != OP_LOOP && code[0] != OP_RETURN && code[0] != OP_THROW);
+		offset += length;
+	}
+
+	FREE_ARRAY_NO_GC(int32_t, targets, chunk->count + 1);
+	return (uint32_t)maxDepth;
+}
@@ -41,8 +41,11 @@ typedef enum {
 	OP_JUMP_IF_TRUE,    // condition jump if true
 	OP_POP,				// pop stack
 	OP_POP_N,			// pop multiple stack
+	OP_DUP,				// copy the top,the receiver of 'a.b op= c'
+	OP_DUP2,			// copy the top two,the array and index of 'a[i] op= c'
 	OP_BITWISE,			//& | ~ ^ << >> >>>
 	OP_CALL,			// callFn
+	OP_TAIL_CALL,		// callFn in tail position, reuse the frame
 	OP_INVOKE,			// call with xxx.()
 	OP_SUPER_INVOKE,	// call with super.()
 	OP_RETURN,          // ret
@@ -62,6 +65,7 @@ typedef enum {
 	OP_GET_UPVALUE,		//up value
 	OP_SET_UPVALUE,
 	OP_CLOSE_UPVALUE,   // close upvalue
+	OP_GET_CAPTURE,		// variable copied into the closure,never assigned
 	OP_NEW_ARRAY,		// array literal
 	OP_NEW_OBJECT,		// object literal
 	OP_NEW_PROPERTY,	// set property but no pop
@@ -106,8 +110,85 @@ typedef enum {
 
 	OP_NOT_LOCAL,
 	OP_NEGATE_LOCAL,
+
+	//fused compare and branch, jump if (local op k) or (local op local) is false
+	OP_JUMP_IF_FALSE_EQUAL_LC,
+	OP_JUMP_IF_FALSE_GREATER_LC,
+	OP_JUMP_IF_FALSE_LESS_LC,
+	OP_JUMP_IF_FALSE_NOT_EQUAL_LC,
+	OP_JUMP_IF_FALSE_LESS_EQUAL_LC,
+	OP_JUMP_IF_FALSE_GREATER_EQUAL_LC,
+	OP_JUMP_IF_FALSE_EQUAL_LL,
+	OP_JUMP_IF_FALSE_GREATER_LL,
+	OP_JUMP_IF_FALSE_LESS_LL,
+	OP_JUMP_IF_FALSE_NOT_EQUAL_LL,
+	OP_JUMP_IF_FALSE_LESS_EQUAL_LL,
+	OP_JUMP_IF_FALSE_GREATER_EQUAL_LL,
+
+	//in-place commond for 'a = a op b;', no push
+	OP_INPLACE_ADD_LC,		// local += k
+	OP_INPLACE_SUBTRACT_LC,
+	OP_INPLACE_MULTIPLY_LC,
+	OP_INPLACE_DIVIDE_LC,
+	OP_INPLACE_ADD_LL,		// local += local
+	OP_INPLACE_SUBTRACT_LL,
+	OP_INPLACE_MULTIPLY_LL,
+	OP_INPLACE_DIVIDE_LL,
+	OP_INPLACE_ADD_UC,		// upvalue += k
+	OP_INPLACE_SUBTRACT_UC,
+	OP_INPLACE_MULTIPLY_UC,
+	OP_INPLACE_DIVIDE_UC,
+	OP_INPLACE_ADD_GC,		// global += k
+	OP_INPLACE_SUBTRACT_GC,
+	OP_INPLACE_MULTIPLY_GC,
+	OP_INPLACE_DIVIDE_GC,
+
+	//register commond (--register), operands are frame slots
+	OP_REG_MOVE,			// a = b
+	OP_REG_LOAD_CONST,		// a = k
+	OP_REG_NEGATE,			// a = -b
+	OP_REG_ADD_LL,			// a = b + c
+	OP_REG_SUBTRACT_LL,
+	OP_REG_MULTIPLY_LL,
+	OP_REG_DIVIDE_LL,
+	OP_REG_MODULUS_LL,
+	OP_REG_ADD_LC,			// a = b + k
+	OP_REG_SUBTRACT_LC,
+	OP_REG_MULTIPLY_LC,
+	OP_REG_DIVIDE_LC,
+	OP_REG_MODULUS_LC,
+
+	//array loop 'for (...; i < @array.length(arr); ...)',operands are frame slots.
+	//the element commonds are only in the body version that the jump enters
+	OP_JUMP_IF_IN_ARRAY_LL,	// jump if i is a number in range of arr (OBJ_ARRAY or OBJ_ARRAY_F64)
+	OP_GET_ELEMENT_LL,		// push arr[i],not checked
+	OP_SET_ELEMENT_LL,		// arr[i] = top,not checked
+
+	//quickened commond, only written by vm at runtime
+	OP_GET_SUBSCRIPT_ARRAY,
+	OP_GET_SUBSCRIPT_F64,
+	OP_SET_SUBSCRIPT_ARRAY,
+	OP_SET_SUBSCRIPT_F64,
+	OP_GET_INDEX_ARRAY,
+	OP_GET_INDEX_F64,
+	OP_SET_INDEX_ARRAY,
+	OP_SET_INDEX_F64,
+	OP_ADD_NUMBER,
+	OP_CALL_NATIVE_NUMBER,
 } OpCode;
 
+//the order of OP_EQUAL..OP_GREATER_EQUAL,every family of compare commonds keeps it
+typedef enum {
+	COMPARE_EQUAL,
+	COMPARE_GREATER,
+	COMPARE_LESS,
+	COMPARE_NOT_EQUAL,
+	COMPARE_LESS_EQUAL,
+	COMPARE_GREATER_EQUAL,
+} CompareType;
+
+#define COMPARE_IS_EQUALITY(type) ((type) == COMPARE_EQUAL || (type) == COMPARE_NOT_EQUAL)
+
 typedef enum {
 	BIT_OP_NOT,			//~
 	BIT_OP_AND,			//&
@@ -138,6 +219,11 @@ void chunk_init(Chunk* chunk);
 void chunk_write(Chunk* chunk, uint8_t byte, uint32_t line);
 void chunk_fallback(Chunk* chunk, uint32_t byteCount);
 void chunk_free(Chunk* chunk);
+//the length of commond,operands included
+uint32_t chunk_commondLength(uint8_t* code);
+//the most values on the stack while the code runs,from entryDepth at the start.
+//the temporaries inside one commond are not counted,STACK_SLACK keeps room for them
+uint32_t chunk_maxStack(Chunk* chunk, uint32_t entryDepth);
 
 //chech opStack first,than use this to override old codes
 #define CHUNK_PEEK(chunk, offset) chunk->code[chunk->count - offset - 1]
@@ -6,6 +6,7 @@
 #include "compiler.h"
 #include "gc.h"
 #include "nativeBuiltin.h"
+#include "profile.h"
 
 #if DEBUG_PRINT_CODE
 #include "debug.h"
@@ -26,11 +27,15 @@ static void statement();
 static ParseRule* getRule(TokenType type);
 static void namedVariable(Token name, bool canAssign);
 static void variable(bool canAssign);
+static void compoundExpression(OpCode op);
 static Token syntheticToken(C_STR text);
 
 #if COMPILATION_TIME_OPTIMIZATION
 //do optimize here
 static void instructionOptimize();
+static bool branchOptimize();
+static int32_t arrayLoopGuard(int32_t conditionStart, ArrayLoop* arrayLoop);
+static bool elementOptimize(bool isAssignment, OpCode* compoundOp);
 #endif
 
 static Chunk* currentChunk() {
@@ -59,6 +64,9 @@ static void emitOpStack(uint8_t byte, bool doCheck) {
 #endif
 
 	instructionOptimize();
+	if (vm.config.profile) {
+		profile_optimized(currentOpStack()->code, currentOpStack()->count);
+	}
 #endif
 }
 
@@ -122,6 +130,20 @@ static bool match(TokenType type) {
 	return true;
 }
 
+//'a op= b' is compiled as 'a = a op b'
+static bool matchCompoundAssign(OpCode* op_out) {
+	switch (parser.current.type) {
+	case TOKEN_PLUS_EQUAL: *op_out = OP_ADD; break;
+	case TOKEN_MINUS_EQUAL: *op_out = OP_SUBTRACT; break;
+	case TOKEN_STAR_EQUAL: *op_out = OP_MULTIPLY; break;
+	case TOKEN_SLASH_EQUAL: *op_out = OP_DIVIDE; break;
+	default: return false;
+	}
+
+	advance();
+	return true;
+}
+
 static void emitByte(uint8_t byte) {
 	chunk_write(currentChunk(), byte, parser.previous.line);
 }
@@ -153,7 +175,42 @@ static void emitConstantCommond(OpCode target, uint32_t index) {
 	}
 }
 
+//property instruction carries the index of its inline cache
+static void emitPropertyCommond(OpCode target, uint32_t index) {
+	emitConstantCommond(target, index);
+
+	if (current->function->propertyCacheCount == PROPERTY_CACHE_MAX) {
+		error("Too many property accesses in function.");
+		return;
+	}
+
+	uint32_t cache = addPropertyCache(current->function);
+	emitBytes(2, (uint8_t)cache, (uint8_t)(cache >> 8));
+}
+
+static void emitInvokeCommond(OpCode target, uint32_t index, uint8_t argCount) {
+	emitConstantCommond(target, index);
+	emitByte(argCount);
+
+	if (current->function->invokeCacheCount == INVOKE_CACHE_MAX) {
+		error("Too many method calls in function.");
+		return;
+	}
+
+	uint32_t cache = addInvokeCache(current->function);
+	emitBytes(2, (uint8_t)cache, (uint8_t)(cache >> 8));
+}
+
 static int32_t emitJump(uint8_t instruction) {
+#if COMPILATION_TIME_OPTIMIZATION
+	//the fused commond is already emitted with its operands,only the offset follows
+	if (instruction == OP_JUMP_IF_FALSE_POP && branchOptimize()) {
+		emitBytes(2, 0xff, 0xff);
+		clearOpStack();
+		return currentChunk()->count - 2;
+	}
+#endif
+
 	emitBytes(3, instruction, 0xff, 0xff);
 	clearOpStack();
 	return currentChunk()->count - 2;
@@ -170,6 +227,18 @@ static void emitLoop(int32_t loopStart) {
 	clearOpStack();
 }
 
+//'return f(x)',the call right before return can reuse the frame
+static void emitReturnValue() {
+	Chunk* chunk = currentChunk();
+
+	if (current->lastCallEnd == chunk->count && chunk->code[chunk->count - 2] == OP_CALL) {
+		chunk->code[chunk->count - 2] = OP_TAIL_CALL;
+	}
+
+	emitByte(OP_RETURN);
+	clearOpStack();
+}
+
 static void emitReturn() {
 	if (current->type == TYPE_INITIALIZER) {
 		//16bits index get_local
@@ -183,6 +252,8 @@ static void emitReturn() {
 
 static uint32_t makeConstant(Value value) {
 	if (IS_NUMBER(value)) {
+		//int32 if it is one,so the pool has one value of a number
+		value = NUMBER_VAL_FIT(AS_NUMBER(value));
 		//deduplicate in pool
 		NumberEntry* entry = getNumberEntryInPool(&value);
 
@@ -204,6 +275,15 @@ static uint32_t makeConstant(Value value) {
 			return entry->index;
 		}
 	}
+	else if (IS_NATIVE(value)) {
+		//builtin members are resolved at compile time,keep one constant each
+		ObjNative* native = AS_NATIVE_OBJ(value);
+
+		if (native->constant == UINT32_MAX) {
+			native->constant = addConstant(value) & UINT24_MAX;
+		}
+		return native->constant;
+	}
 	else {
 		return addConstant(value);
 	}
@@ -225,6 +305,8 @@ static void patchJump(int32_t offset) {
 	//write low and high
 	currentChunk()->code[offset] = jump & 0xff;
 	currentChunk()->code[offset + 1] = (jump >> 8) & 0xff;
+	//here is a jump target,commonds before it can't be fused with the ones after
+	clearOpStack();
 }
 
 static void initCompiler(Compiler* compiler, FunctionType type) {
@@ -233,6 +315,7 @@ static void initCompiler(Compiler* compiler, FunctionType type) {
 
 	//init
 	compiler->currentLoop = NULL;
+	compiler->arrayLoop = NULL;
 
 	compiler->function = NULL;
 	compiler->type = type;
@@ -245,6 +328,8 @@ static void initCompiler(Compiler* compiler, FunctionType type) {
 
 	compiler->function = newFunction();
 	compiler->objectNestingDepth = 0;
+	compiler->lastCallEnd = UINT32_MAX;
+	compiler->registerTop = 0;
 
 	opStack_init(&compiler->stack);
 
@@ -265,6 +350,9 @@ static void initCompiler(Compiler* compiler, FunctionType type) {
 	Local* local = &compiler->locals[compiler->localCount++];
 	local->depth = 0;
 	local->isCaptured = false;
+	local->isConst = false;
+	local->isChecked = true;
+	local->isAssigned = false;
 
 	if (type != TYPE_FUNCTION && type != TYPE_LAMBDA) {
 		local->name.start = "this";
@@ -303,6 +391,10 @@ static ObjFunction* endCompiler() {
 	opStack_free(currentOpStack());
 
 	ObjFunction* function = current->function;
+	//the callee and the arguments are on the stack when it starts
+	function->maxStack = chunk_maxStack(currentChunk(), 1 + function->arity);
+	//the register temporaries are above the values of the stack commonds
+	if (function->maxStack < current->registerTop) function->maxStack = current->registerTop;
 #if DEBUG_PRINT_CODE
 	if (!parser.hadError) {
 		disassembleChunk(currentChunk(), (function->name != NULL)
@@ -324,6 +416,7 @@ static void emitPopCount(uint16_t popCount) {
 	}
 	else {
 		emitByte(OP_POP);
+		emitOpStack(OP_POP, true);
 	}
 	clearOpStack();
 }
@@ -379,7 +472,8 @@ static void parsePrecedence(Precedence precedence) {
 		infixRule(canAssign);
 	}
 
-	if (canAssign && match(TOKEN_EQUAL)) {
+	OpCode compoundOp;
+	if (canAssign && (match(TOKEN_EQUAL) || matchCompoundAssign(&compoundOp))) {
 		error("Invalid assignment target.");
 	}
 }
@@ -388,6 +482,16 @@ static uint32_t identifierConstant(Token* name) {
 	return makeConstant(OBJ_VAL(copyString(name->start, name->length, false)));
 }
 
+//the global slot of the name,one for each name and kept for the later scripts
+static uint32_t identifierGlobal(Token* name) {
+	ObjString* string = copyString(name->start, name->length, false);
+	if (string->symbol == INVALID_OBJ_STRING_SYMBOL && vm.globalCount == GLOBAL_MAX) {
+		error("Too many global variables.");
+		return 0;
+	}
+	return globalSlot(string);
+}
+
 static void addLocal(Token name) {
 	if (current->localCount == LOCAL_MAX) {
 		error("Too many nested local variables in scope.");
@@ -406,6 +510,8 @@ static void addLocal(Token name) {
 	local->depth = -1;// var a = a;??? avoid this
 	local->isCaptured = false;
 	local->isConst = false;
+	local->isChecked = false;
+	local->isAssigned = false;
 }
 
 static bool identifiersEqual(Token* a, Token* b) {
@@ -437,6 +543,7 @@ static void declareVariable() {
 typedef struct {
 	int32_t arg;
 	bool isConst;
+	bool byValue; //an upvalue copied into the closure
 } LocalInfo;
 
 static LocalInfo resolveLocal(Compiler* compiler, Token* name) {
@@ -447,7 +554,7 @@ static LocalInfo resolveLocal(Compiler* compiler, Token* name) {
 				error("Can't read local variable in its own initializer.");
 			}
 
-			return (LocalInfo) { .arg = i, .isConst = local->isConst };
+			return (LocalInfo) { .arg = i, .isConst = local->isConst, .byValue = false };
 		}
 	}
 
@@ -455,25 +562,103 @@ static LocalInfo resolveLocal(Compiler* compiler, Token* name) {
 	return (LocalInfo) { .arg = -1, .isConst = false };
 }
 
-static uint32_t addUpvalue(Compiler* compiler, int32_t index, bool isLocal) {
-	uint32_t upvalueCount = compiler->function->upvalueCount;
+static uint32_t addUpvalue(Compiler* compiler, int32_t index, bool isLocal, bool byValue) {
+	Upvalue* upvalues = byValue ? compiler->captures : compiler->upvalues;
+	uint16_t* count = byValue ? &compiler->function->captureCount : &compiler->function->upvalueCount;
 
 	//deduplicate
-	for (uint32_t i = 0; i < upvalueCount; i++) {
-		Upvalue* upvalue = &compiler->upvalues[i];
+	for (uint32_t i = 0; i < *count; i++) {
+		Upvalue* upvalue = &upvalues[i];
 		if (upvalue->index == index && upvalue->isLocal == isLocal) {
 			return i;
 		}
 	}
 
-	if (upvalueCount == UINT8_COUNT) {
+	if (*count == UINT8_COUNT) {
 		error("Too many closure variables in function.");
 		return 0;
 	}
 
-	compiler->upvalues[upvalueCount].isLocal = isLocal;
-	compiler->upvalues[upvalueCount].index = index;
-	return compiler->function->upvalueCount++;
+	upvalues[*count].isLocal = isLocal;
+	upvalues[*count].index = index;
+	return (*count)++;
+}
+
+//scan the scope of local from its name to the '}' that ends it,for an assignment of its name.
+//the scope of a parameter is the body of its function,the block after the parameters or the expression after '=>'.
+//the ones of a shadowing variable count too,it's never missed
+static bool localIsAssigned(Local* local, bool isParameter) {
+	//'this' and 'super' are keywords,their names are not in the source
+	if ((local->name.length == 4 && memcmp(local->name.start, "this", 4) == 0)
+		|| (local->name.length == 5 && memcmp(local->name.start, "super", 5) == 0)) return false;
+
+	Scanner mark = scanner_mark();
+	scanner_reset((Scanner) { .start = local->name.start, .current = local->name.start + local->name.length, .line = local->name.line });
+
+	Token previous = local->name;
+	TokenType beforePrevious = TOKEN_VAR;
+	bool isAssigned = false;
+	bool isExpression = false;
+	int32_t depth = 0;
+
+	if (isParameter) {
+		//the other parameters have no parentheses
+		do {
+			previous = scanToken();
+		} while (previous.type != TOKEN_RIGHT_PAREN && previous.type != TOKEN_EOF && previous.type != TOKEN_ERROR);
+		previous = scanToken();
+		isExpression = previous.type == TOKEN_RIGHT_ARROW;
+		beforePrevious = TOKEN_RIGHT_PAREN;
+	}
+
+	for (;;) {
+		Token token = scanToken();
+		if (token.type == TOKEN_EOF) break;
+		if (token.type == TOKEN_ERROR) {
+			isAssigned = true;
+			break;
+		}
+
+		//the statement of a lambda ends after its expression
+		if (isExpression && depth == 0 && token.type == TOKEN_SEMICOLON) break;
+
+		if (token.type == TOKEN_LEFT_BRACE) {
+			++depth;
+		}
+		else if (token.type == TOKEN_RIGHT_BRACE) {
+			if (--depth < 0) break;
+		}
+		else if (token.type == TOKEN_EQUAL || token.type == TOKEN_PLUS_EQUAL || token.type == TOKEN_MINUS_EQUAL
+			|| token.type == TOKEN_STAR_EQUAL || token.type == TOKEN_SLASH_EQUAL) {
+			//'a.x =' is a property and 'var x =' is another variable
+			if (previous.type == TOKEN_IDENTIFIER && identifiersEqual(&previous, &local->name)
+				&& beforePrevious != TOKEN_DOT && beforePrevious != TOKEN_VAR && beforePrevious != TOKEN_CONST) {
+				isAssigned = true;
+				break;
+			}
+		}
+
+		beforePrevious = previous.type;
+		previous = token;
+	}
+
+	scanner_reset(mark);
+	return isAssigned;
+}
+
+//the value of the local is final when the closure is made,so it's copied instead of boxed
+static bool isCapturedByValue(Compiler* compiler, int32_t slot) {
+	//a local function is stored after its closure is made,it can't copy itself
+	if (compiler->type == TYPE_FUNCTION && slot == compiler->enclosing->localCount - 1) return false;
+
+	Local* local = &compiler->enclosing->locals[slot];
+	if (local->isConst) return true;
+	if (!local->isChecked) {
+		//slot 0 is 'this' or unnamed,the parameters follow it
+		local->isAssigned = localIsAssigned(local, slot >= 1 && slot <= (int32_t)compiler->enclosing->function->arity);
+		local->isChecked = true;
+	}
+	return !local->isAssigned;
 }
 
 static LocalInfo resolveUpvalue(Compiler* compiler, Token* name) {
@@ -482,15 +667,19 @@ static LocalInfo resolveUpvalue(Compiler* compiler, Token* name) {
 	//local
 	LocalInfo localInfo = resolveLocal(compiler->enclosing, name);
 	if (localInfo.arg != -1) {
-		compiler->enclosing->locals[localInfo.arg].isCaptured = true;//mark it as captured
-		localInfo.arg = addUpvalue(compiler, localInfo.arg, true);
+		localInfo.byValue = isCapturedByValue(compiler, localInfo.arg);
+		if (!localInfo.byValue) {
+			compiler->enclosing->locals[localInfo.arg].isCaptured = true;//mark it as captured
+			compiler->enclosing->function->closesUpvalues = true;
+		}
+		localInfo.arg = addUpvalue(compiler, localInfo.arg, true, localInfo.byValue);
 		return localInfo;
 	}
 
-	//recursion
+	//recursion,copied if the enclosing one is copied
 	LocalInfo upvalue = resolveUpvalue(compiler->enclosing, name);
 	if (upvalue.arg != -1) {
-		upvalue.arg = addUpvalue(compiler, upvalue.arg, false);
+		upvalue.arg = addUpvalue(compiler, upvalue.arg, false, upvalue.byValue);
 		return upvalue;
 	}
 
@@ -504,7 +693,7 @@ static uint32_t parseVariable(C_STR errorMessage) {
 	//it is a local one
 	if (current->scopeDepth > 0) return 0;
 
-	return identifierConstant(&parser.previous);
+	return identifierGlobal(&parser.previous);
 }
 
 static void markInitialized(bool isConst) {
@@ -607,20 +796,26 @@ static void function(FunctionType type) {
 		}
 
 		expression();
-		emitByte(OP_RETURN);
-		clearOpStack();
+		emitReturnValue();
 	}
 
 	ObjFunction* function = endCompiler();
+	if (function->upvalueCount == 0 && function->captureCount == 0) {
+		makeSharedClosure(function);
+	}
 
 	//create a closure
 	emitConstantCommond(OP_CLOSURE, makeConstant(OBJ_VAL(function)));
 
-	//insert upValue index
+	//insert upValue index,the boxed ones then the copied ones
 	for (uint32_t i = 0; i < function->upvalueCount; i++) {
 		emitByte(compiler.upvalues[i].isLocal ? 1 : 0);
 		emitBytes(2, (uint8_t)(compiler.upvalues[i].index), (uint8_t)(compiler.upvalues[i].index >> 8));
 	}
+	for (uint32_t i = 0; i < function->captureCount; i++) {
+		emitByte(compiler.captures[i].isLocal ? 1 : 0);
+		emitBytes(2, (uint8_t)(compiler.captures[i].index), (uint8_t)(compiler.captures[i].index >> 8));
+	}
 	clearOpStack();
 
 	freeLocals(&compiler);
@@ -653,7 +848,7 @@ static void classDeclaration() {
 
 	emitConstantCommond(OP_CLASS, nameConstant);
 	clearOpStack();
-	defineVariable(nameConstant);
+	defineVariable((current->scopeDepth > 0) ? 0 : identifierGlobal(&className));
 
 	//link the chain
 	ClassCompiler classCompiler = { .enclosing = currentClass,.hasSuperclass = false };
@@ -744,7 +939,233 @@ static void constDeclaration() {
 	consume(TOKEN_SEMICOLON, "Expect ';' after constant declaration.");
 }
 
+// ==================== register commonds (--register) ====================
+//'local = expression' and 'local op= expression' of locals,numbers and + - * / % are emitted
+//as three-address commonds over frame slots,nothing is pushed.
+//between statements the stack holds only the locals,the slots above them are the temporaries
+
+typedef struct {
+	bool isConstant;
+	uint32_t index; //frame slot or constant index
+} RegisterOperand;
+
+typedef struct {
+	uint32_t base;		//slot of the first temporary,right above the locals
+	uint32_t count;		//temporaries in use,freed in the order of a stack
+	uint32_t lastDst;	//chunk offset of the dst operand of the last commond
+} RegisterState;
+
+static RegisterOperand registerTerm(RegisterState* state);
+
+//slot of an initialized local of the current function,-1 if the name is not one
+static int32_t registerLocal(Token* name) {
+	for (int32_t i = current->localCount - 1; i >= 0; i--) {
+		if (identifiersEqual(name, &current->locals[i].name)) {
+			return (current->locals[i].depth == -1) ? -1 : i;
+		}
+	}
+	return -1;
+}
+
+//true if the tokens after the name are an assignment the register commonds cover,up to terminator
+static bool registerCovers(TokenType terminator) {
+	Scanner mark = scanner_mark();
+	TokenType assign = scanToken().type;
+	bool covers = (assign == TOKEN_EQUAL || assign == TOKEN_PLUS_EQUAL || assign == TOKEN_MINUS_EQUAL
+		|| assign == TOKEN_STAR_EQUAL || assign == TOKEN_SLASH_EQUAL);
+	bool expectOperand = true;
+	int32_t depth = 0;
+	uint32_t length = 0;
+
+	while (covers) {
+		Token token = scanToken();
+		++length;
+		if (!expectOperand && depth == 0 && token.type == terminator) break;
+
+		if (expectOperand) {
+			if (token.type == TOKEN_IDENTIFIER) {
+				covers = registerLocal(&token) != -1;
+				expectOperand = false;
+			}
+			else if (token.type == TOKEN_NUMBER) {
+				expectOperand = false;
+			}
+			else if (token.type == TOKEN_LEFT_PAREN) {
+				++depth;
+			}
+			else {
+				covers = token.type == TOKEN_MINUS;
+			}
+		}
+		else if (token.type == TOKEN_RIGHT_PAREN && depth > 0) {
+			--depth;
+		}
+		else {
+			covers = (token.type == TOKEN_PLUS || token.type == TOKEN_MINUS || token.type == TOKEN_STAR
+				|| token.type == TOKEN_SLASH || token.type == TOKEN_PERCENT);
+			expectOperand = true;
+		}
+	}
+
+	scanner_reset(mark);
+	//a token takes one temporary at most,they must fit in 16-bit slots
+	return covers && current->localCount + length + 3 <= UINT16_MAX;
+}
+
+static bool isRegisterTemp(RegisterState* state, RegisterOperand operand) {
+	return !operand.isConstant && operand.index >= state->base;
+}
+
+//the lowest free temporary
+static RegisterOperand registerTemp(RegisterState* state) {
+	uint32_t slot = state->base + state->count++;
+	//a string concatenation pushes its two operands above the temporary
+	if (current->registerTop < slot + 3) current->registerTop = slot + 3;
+	return (RegisterOperand) { .isConstant = false, .index = slot };
+}
+
+static RegisterOperand registerLoadConstant(RegisterState* state, RegisterOperand constant) {
+	RegisterOperand temp = registerTemp(state);
+	state->lastDst = currentChunk()->count + 1;
+	emitBytes(6, OP_REG_LOAD_CONST, (uint8_t)temp.index, (uint8_t)(temp.index >> 8),
+		(uint8_t)constant.index, (uint8_t)(constant.index >> 8), (uint8_t)(constant.index >> 16));
+	return temp;
+}
+
+//op is the _LL commond,the result is a temporary
+static RegisterOperand registerBinary(RegisterState* state, OpCode op, RegisterOperand left, RegisterOperand right) {
+	//the constants are numbers,'k + b' and 'k * b' are 'b + k' and 'b * k'
+	if (left.isConstant && !right.isConstant && (op == OP_REG_ADD_LL || op == OP_REG_MULTIPLY_LL)) {
+		RegisterOperand swap = left;
+		left = right;
+		right = swap;
+	}
+	if (left.isConstant) left = registerLoadConstant(state, left);
+
+	//the operands are read before the result is written,it may take their temporaries
+	if (isRegisterTemp(state, right)) --state->count;
+	if (isRegisterTemp(state, left)) --state->count;
+	RegisterOperand result = registerTemp(state);
+
+	state->lastDst = currentChunk()->count + 1;
+	if (right.isConstant) {
+		emitBytes(8, op - OP_REG_ADD_LL + OP_REG_ADD_LC, (uint8_t)result.index, (uint8_t)(result.index >> 8),
+			(uint8_t)left.index, (uint8_t)(left.index >> 8), (uint8_t)right.index, (uint8_t)(right.index >> 8), (uint8_t)(right.index >> 16));
+	}
+	else {
+		emitBytes(7, op, (uint8_t)result.index, (uint8_t)(result.index >> 8),
+			(uint8_t)left.index, (uint8_t)(left.index >> 8), (uint8_t)right.index, (uint8_t)(right.index >> 8));
+	}
+	return result;
+}
+
+static RegisterOperand registerPrimary(RegisterState* state) {
+	if (match(TOKEN_NUMBER)) {
+		return (RegisterOperand) { .isConstant = true, .index = makeConstant(NUMBER_VAL(strtod(parser.previous.start, NULL))) };
+	}
+	if (match(TOKEN_LEFT_PAREN)) {
+		RegisterOperand operand = registerTerm(state);
+		consume(TOKEN_RIGHT_PAREN, "Expect ')' after expression.");
+		return operand;
+	}
+
+	consume(TOKEN_IDENTIFIER, "Expect expression.");
+	return (RegisterOperand) { .isConstant = false, .index = (uint32_t)registerLocal(&parser.previous) };
+}
+
+static RegisterOperand registerUnary(RegisterState* state) {
+	if (!match(TOKEN_MINUS)) return registerPrimary(state);
+
+	RegisterOperand operand = registerUnary(state);
+	if (operand.isConstant) {
+		//fold,as OP_NEGATE would do at runtime
+		return (RegisterOperand) { .isConstant = true, .index = makeConstant(number_negate(vm.constants.values[operand.index])) };
+	}
+
+	if (isRegisterTemp(state, operand)) --state->count;
+	RegisterOperand result = registerTemp(state);
+	state->lastDst = currentChunk()->count + 1;
+	emitBytes(5, OP_REG_NEGATE, (uint8_t)result.index, (uint8_t)(result.index >> 8), (uint8_t)operand.index, (uint8_t)(operand.index >> 8));
+	return result;
+}
+
+static RegisterOperand registerFactor(RegisterState* state) {
+	RegisterOperand left = registerUnary(state);
+
+	for (;;) {
+		OpCode op;
+		if (match(TOKEN_STAR)) op = OP_REG_MULTIPLY_LL;
+		else if (match(TOKEN_SLASH)) op = OP_REG_DIVIDE_LL;
+		else if (match(TOKEN_PERCENT)) op = OP_REG_MODULUS_LL;
+		else return left;
+
+		RegisterOperand right = registerUnary(state);
+		left = registerBinary(state, op, left, right);
+	}
+}
+
+static RegisterOperand registerTerm(RegisterState* state) {
+	RegisterOperand left = registerFactor(state);
+
+	for (;;) {
+		OpCode op;
+		if (match(TOKEN_PLUS)) op = OP_REG_ADD_LL;
+		else if (match(TOKEN_MINUS)) op = OP_REG_SUBTRACT_LL;
+		else return left;
+
+		RegisterOperand right = registerFactor(state);
+		left = registerBinary(state, op, left, right);
+	}
+}
+
+//compile the assignment before terminator to register commonds,false if they don't cover it
+static bool registerAssignment(TokenType terminator) {
+	if (!vm.config.registerMode || !check(TOKEN_IDENTIFIER)) return false;
+
+	int32_t target = registerLocal(&parser.current);
+	if (target == -1 || current->locals[target].isConst || !registerCovers(terminator)) return false;
+	advance();
+
+	RegisterState state = { .base = current->localCount, .count = 0, .lastDst = 0 };
+	//a string concatenation into a local pushes its two operands above the locals
+	if (current->registerTop < state.base + 2) current->registerTop = state.base + 2;
+
+	RegisterOperand value;
+	OpCode compoundOp;
+	if (matchCompoundAssign(&compoundOp)) {
+		RegisterOperand left = { .isConstant = false, .index = (uint32_t)target };
+		RegisterOperand right = registerTerm(&state);
+		value = registerBinary(&state, OP_REG_ADD_LL + (compoundOp - OP_ADD), left, right);
+	}
+	else {
+		consume(TOKEN_EQUAL, "Expect '='.");
+		value = registerTerm(&state);
+	}
+
+	if (isRegisterTemp(&state, value)) {
+		//the last commond computed it,it writes the local instead
+		currentChunk()->code[state.lastDst] = (uint8_t)target;
+		currentChunk()->code[state.lastDst + 1] = (uint8_t)(target >> 8);
+	}
+	else if (value.isConstant) {
+		emitBytes(6, OP_REG_LOAD_CONST, (uint8_t)target, (uint8_t)(target >> 8),
+			(uint8_t)value.index, (uint8_t)(value.index >> 8), (uint8_t)(value.index >> 16));
+	}
+	else if (value.index != (uint32_t)target) {
+		emitBytes(5, OP_REG_MOVE, (uint8_t)target, (uint8_t)(target >> 8), (uint8_t)value.index, (uint8_t)(value.index >> 8));
+	}
+
+	//the commonds after it can't fuse with the ones before
+	clearOpStack();
+	return true;
+}
+
 static void expressionStatement() {
+	if (registerAssignment(TOKEN_SEMICOLON)) {
+		consume(TOKEN_SEMICOLON, "Expect ';' after expression.");
+		return;
+	}
+
 	expression();
 	consume(TOKEN_SEMICOLON, "Expect ';' after expression.");
 	emitPopCount(1);
@@ -769,10 +1190,15 @@ static void forStatement() {
 	int32_t loopStart = currentChunk()->count;
 
 	int32_t exitJump = -1;
+	int32_t guardJump = -1;
+	ArrayLoop arrayLoop;
 	if (!match(TOKEN_SEMICOLON)) {//for(; here ;)
 		expression();
 		consume(TOKEN_SEMICOLON, "Expect ';' after loop condition.");
 
+#if COMPILATION_TIME_OPTIMIZATION
+		guardJump = arrayLoopGuard(loopStart, &arrayLoop);
+#endif
 		// Jump out of the loop if the condition is false.
 		exitJump = emitJump(OP_JUMP_IF_FALSE_POP);
 	}
@@ -782,8 +1208,10 @@ static void forStatement() {
 		//we don't do increase first,we go to body first
 		int32_t bodyJump = emitJump(OP_JUMP);
 		int32_t incrementStart = currentChunk()->count;
-		expression();
-		emitPopCount(1);
+		if (!registerAssignment(TOKEN_RIGHT_PAREN)) {
+			expression();
+			emitPopCount(1);
+		}
 
 		consume(TOKEN_RIGHT_PAREN, "Expect ')' after for clauses.");
 
@@ -801,9 +1229,26 @@ static void forStatement() {
 	loop.breakJumps = ALLOCATE_NO_GC(int32_t, loop.breakJumpCapacity);
 	current->currentLoop = &loop;
 
+	//the body may be compiled again
+	Parser bodyParser = parser;
+	Scanner bodyScanner = scanner_mark();
+
 	statement();
 	emitLoop(loopStart);
 
+	//the body version that the guard enters,both versions go back to the increment
+	if (guardJump != -1 && !parser.hadError) {
+		patchJump(guardJump);
+		parser = bodyParser;
+		scanner_reset(bodyScanner);
+
+		ArrayLoop* enclosing = current->arrayLoop;
+		current->arrayLoop = &arrayLoop;
+		statement();
+		emitLoop(loopStart);
+		current->arrayLoop = enclosing;
+	}
+
 	//if there is no exitJump,this is an infinite loop
 	if (exitJump != -1) {
 		patchJump(exitJump);
@@ -895,8 +1340,7 @@ static void returnStatement() {
 
 		expression();
 		consume(TOKEN_SEMICOLON, "Expect ';' after return value.");
-		emitByte(OP_RETURN);
-		clearOpStack();
+		emitReturnValue();
 	}
 }
 
@@ -1220,24 +1664,33 @@ static void binary(bool canAssign) {
 static void call(bool canAssign) {
 	uint8_t argCount = argumentList();
 	emitBytes(2, OP_CALL, argCount);
+	current->lastCallEnd = currentChunk()->count;
 	clearOpStack();
 }
 
 static void dot(bool canAssign) {
 	consume(TOKEN_IDENTIFIER, "Expect property name after '.'.");
 	uint32_t name = identifierConstant(&parser.previous);
+	OpCode compoundOp;
 
 	if (canAssign && match(TOKEN_EQUAL)) {
 		expression();
-		emitConstantCommond(OP_SET_PROPERTY, name);
+		emitPropertyCommond(OP_SET_PROPERTY, name);
+	}
+	else if (canAssign && matchCompoundAssign(&compoundOp)) {
+		//the receiver is read once for the get and once for the set
+		emitByte(OP_DUP);
+		emitPropertyCommond(OP_GET_PROPERTY, name);
+		clearOpStack();
+		compoundExpression(compoundOp);
+		emitPropertyCommond(OP_SET_PROPERTY, name);
 	}
 	else if (match(TOKEN_LEFT_PAREN)) {
 		uint8_t argCount = argumentList();
-		emitConstantCommond(OP_INVOKE, name);
-		emitByte(argCount);
+		emitInvokeCommond(OP_INVOKE, name, argCount);
 	}
 	else {
-		emitConstantCommond(OP_GET_PROPERTY, name);
+		emitPropertyCommond(OP_GET_PROPERTY, name);
 	}
 	clearOpStack();
 }
@@ -1307,7 +1760,7 @@ static void objectLiteral(bool canAssign) {
 }
 
 //when it is constant index,use this
-static void mergeSubscript(bool isAssignment) {
+static void mergeSubscript(bool isAssignment, OpCode* compoundOp) {
 	Chunk* chunk = currentChunk();
 #define READ_CONSTANT(index) (vm.constants.values[(index)])
 #define READ_24BITS_INDEX()	\
@@ -1322,18 +1775,34 @@ static void mergeSubscript(bool isAssignment) {
 	chunk_fallback(chunk, 4);
 	clearOpStack();
 
-	if (isAssignment) expression();
+	if (!IS_NUMBER(val) && !IS_STRING(val)) {
+		error("Can only subscript with string or number.\n");
+		return;
+	}
 
-	if (IS_NUMBER(val)) {
-		emitConstantCommond(isAssignment ? OP_SET_INDEX : OP_GET_INDEX, index);
+	if (compoundOp != NULL) {
+		//the receiver is read once for the get and once for the set
+		emitByte(OP_DUP);
+		if (IS_NUMBER(val)) {
+			emitConstantCommond(OP_GET_INDEX, index);
+		}
+		else {
+			emitPropertyCommond(OP_GET_PROPERTY, index);
+		}
 		clearOpStack();
+		compoundExpression(*compoundOp);
 	}
-	else if (IS_STRING(val)) {
-		emitConstantCommond(isAssignment ? OP_SET_PROPERTY : OP_GET_PROPERTY, index);
+	else if (isAssignment) {
+		expression();
+	}
+
+	if (IS_NUMBER(val)) {
+		emitConstantCommond(isAssignment ? OP_SET_INDEX : OP_GET_INDEX, index);
 		clearOpStack();
 	}
 	else {
-		error("Can only subscript with string or number.\n");
+		emitPropertyCommond(isAssignment ? OP_SET_PROPERTY : OP_GET_PROPERTY, index);
+		clearOpStack();
 	}
 #undef READ_CONSTANT
 #undef READ_24BITS_INDEX
@@ -1345,13 +1814,33 @@ static void subscript(bool canAssign) {
 
 	// Because of the order of parsing, the index must be processed here
 	uint8_t code = opStack_peek(currentOpStack(), 0);
+	//'a[i] op= b' is 'a[i] = a[i] op b',compoundOp is NULL for the others
+	OpCode compound;
+	OpCode* compoundOp = NULL;
 	bool isAssignment = canAssign && match(TOKEN_EQUAL);
+	if (canAssign && !isAssignment && matchCompoundAssign(&compound)) {
+		compoundOp = &compound;
+		isAssignment = true;
+	}
+
+#if COMPILATION_TIME_OPTIMIZATION
+	if (current->arrayLoop != NULL && elementOptimize(isAssignment, compoundOp)) return;
+#endif
 
 	if (code == OP_CONSTANT) {// constant index
-		mergeSubscript(isAssignment);
+		mergeSubscript(isAssignment, compoundOp);
 	}
 	else {
-		if (isAssignment) {
+		if (compoundOp != NULL) {
+			//the array and the index are read once for the get and once for the set
+			emitByte(OP_DUP2);
+			emitByte(OP_GET_SUBSCRIPT);
+			clearOpStack();
+			compoundExpression(*compoundOp);
+			emitByte(OP_SET_SUBSCRIPT);
+			clearOpStack();
+		}
+		else if (isAssignment) {
 			expression();
 			emitByte(OP_SET_SUBSCRIPT);
 			clearOpStack();
@@ -1365,49 +1854,41 @@ static void subscript(bool canAssign) {
 
 //check builtin
 static void builtinLiteral(bool canAssign) {
+	BuiltinMouduleType module;
+
 	switch (parser.previous.type)
 	{
-	case TOKEN_MODULE_MATH: {
-		emitBytes(2, OP_MODULE_BUILTIN, MODULE_MATH);
-		clearOpStack();
-		break;
-	}
-	case TOKEN_MODULE_ARRAY: {
-		emitBytes(2, OP_MODULE_BUILTIN, MODULE_ARRAY);
-		clearOpStack();
-		break;
-	}
-	case TOKEN_MODULE_OBJECT: {
-		emitBytes(2, OP_MODULE_BUILTIN, MODULE_OBJECT);
-		clearOpStack();
-		break;
-	}
-	case TOKEN_MODULE_STRING: {
-		emitBytes(2, OP_MODULE_BUILTIN, MODULE_STRING);
-		clearOpStack();
-		break;
-	}
-	case TOKEN_MODULE_TIME: {
-		emitBytes(2, OP_MODULE_BUILTIN, MODULE_TIME);
-		clearOpStack();
-		break;
-	}
-	case TOKEN_MODULE_CTOR: {
-		emitBytes(2, OP_MODULE_BUILTIN, MODULE_CTOR);
-		clearOpStack();
-		break;
-	}
-	case TOKEN_MODULE_SYSTEM: {
-		emitBytes(2, OP_MODULE_BUILTIN, MODULE_SYSTEM);
-		clearOpStack();
-		break;
-	}
+	case TOKEN_MODULE_MATH: module = MODULE_MATH; break;
+	case TOKEN_MODULE_ARRAY: module = MODULE_ARRAY; break;
+	case TOKEN_MODULE_OBJECT: module = MODULE_OBJECT; break;
+	case TOKEN_MODULE_STRING: module = MODULE_STRING; break;
+	case TOKEN_MODULE_TIME: module = MODULE_TIME; break;
+	case TOKEN_MODULE_CTOR: module = MODULE_CTOR; break;
+	case TOKEN_MODULE_SYSTEM: module = MODULE_SYSTEM; break;
 	default: {
 		emitByte(OP_NIL);
 		clearOpStack();
-		break;
+		return;
 	}
 	}
+
+	//the builtin tables are frozen,so '@module.name' is resolved here
+	if (match(TOKEN_DOT)) {
+		consume(TOKEN_IDENTIFIER, "Expect property name after '.'.");
+		ObjString* name = copyString(parser.previous.start, parser.previous.length, false);
+
+		Value member;
+		if (!tableGet(&vm.builtins[module].fields, name, &member)) {
+			error("Undefined member of builtin module.");
+			return;
+		}
+
+		emitConstant(member);
+		return;
+	}
+
+	emitBytes(2, OP_MODULE_BUILTIN, module);
+	clearOpStack();
 }
 
 static void literal(bool canAssign) {
@@ -1464,9 +1945,17 @@ static void string(bool canAssign) {
 	emitConstant(OBJ_VAL(copyString(parser.previous.start + 1, parser.previous.length - 2, false)));
 }
 
+//the right side of 'a op= b',a is already loaded
+static void compoundExpression(OpCode op) {
+	expression();
+	emitByte(op);
+	emitOpStack(op, true);
+}
+
 static void namedVariable(Token name, bool canAssign) {
 	LocalInfo args = resolveLocal(current, &name);
 	int32_t arg = args.arg;
+	OpCode compoundOp;
 
 	if (arg != -1) {//it's a local var
 		if (canAssign && match(TOKEN_EQUAL)) {
@@ -1480,6 +1969,18 @@ static void namedVariable(Token name, bool canAssign) {
 			emitBytes(3, OP_SET_LOCAL, (uint8_t)arg, (uint8_t)(arg >> 8));
 			emitOpStack(OP_SET_LOCAL, true);
 		}
+		else if (canAssign && matchCompoundAssign(&compoundOp)) {
+			emitBytes(3, OP_GET_LOCAL, (uint8_t)arg, (uint8_t)(arg >> 8));
+			emitOpStack(OP_GET_LOCAL, false);
+			compoundExpression(compoundOp);
+
+			if (args.isConst) {
+				errorAtCurrent("Assignment to constant variable.");
+				return;
+			}
+			emitBytes(3, OP_SET_LOCAL, (uint8_t)arg, (uint8_t)(arg >> 8));
+			emitOpStack(OP_SET_LOCAL, true);
+		}
 		else { // 16-bit index
 			emitBytes(3, OP_GET_LOCAL, (uint8_t)arg, (uint8_t)(arg >> 8));
 			emitOpStack(OP_GET_LOCAL, false);
@@ -1497,25 +1998,50 @@ static void namedVariable(Token name, bool canAssign) {
 					errorAtCurrent("Assignment to constant variable.");
 					return;
 				}
-				// 16-bit index
+				// 8-bit index
 				emitBytes(2, OP_SET_UPVALUE, (uint8_t)arg);
+				emitOpStack(OP_SET_UPVALUE, false);
 			}
-			else { // 16-bit index
+			else if (canAssign && matchCompoundAssign(&compoundOp)) {
 				emitBytes(2, OP_GET_UPVALUE, (uint8_t)arg);
+				emitOpStack(OP_GET_UPVALUE, false);
+				compoundExpression(compoundOp);
+
+				if (args.isConst) {
+					errorAtCurrent("Assignment to constant variable.");
+					return;
+				}
+				emitBytes(2, OP_SET_UPVALUE, (uint8_t)arg);
+				emitOpStack(OP_SET_UPVALUE, false);
+			}
+			else if (args.byValue) { // 8-bit index
+				emitBytes(2, OP_GET_CAPTURE, (uint8_t)arg);
+				emitOpStack(OP_GET_CAPTURE, false);
+			}
+			else { // 8-bit index
+				emitBytes(2, OP_GET_UPVALUE, (uint8_t)arg);
+				emitOpStack(OP_GET_UPVALUE, false);
 			}
-			clearOpStack();
 		}
-		else {//it's a global var
-			arg = identifierConstant(&name);
+		else {//it's a global var,the operand is the slot
+			arg = identifierGlobal(&name);
 
 			if (canAssign && match(TOKEN_EQUAL)) {
 				expression();
 				emitConstantCommond(OP_SET_GLOBAL, arg);
+				emitOpStack(OP_SET_GLOBAL, false);
+			}
+			else if (canAssign && matchCompoundAssign(&compoundOp)) {
+				emitConstantCommond(OP_GET_GLOBAL, arg);
+				emitOpStack(OP_GET_GLOBAL, false);
+				compoundExpression(compoundOp);
+				emitConstantCommond(OP_SET_GLOBAL, arg);
+				emitOpStack(OP_SET_GLOBAL, false);
 			}
 			else {
 				emitConstantCommond(OP_GET_GLOBAL, arg);
+				emitOpStack(OP_GET_GLOBAL, false);
 			}
-			clearOpStack();
 		}
 	}
 }
@@ -1556,8 +2082,7 @@ static void super_(bool canAssign) {
 	if (match(TOKEN_LEFT_PAREN)) {
 		uint8_t argCount = argumentList();
 		namedVariable(syntheticToken("super"), false);
-		emitConstantCommond(OP_SUPER_INVOKE, name);//super call
-		emitByte(argCount);
+		emitInvokeCommond(OP_SUPER_INVOKE, name, argCount);//super call
 	}
 	else {
 		namedVariable(syntheticToken("super"), false);//load class
@@ -1721,6 +2246,275 @@ void markCompilerRoots()
 */
 #if COMPILATION_TIME_OPTIMIZATION
 //COLD_FUNCTION
+//keep the fused commond on opStack,so the branch or statement can be fused again
+static void fuseOpStack(uint8_t fused) {
+	opStack_fallback(currentOpStack(), 2);//operand + op
+	opStack_push(currentOpStack(), fused);
+}
+
+#define CHUNK_PEEK(offset) chunk->code[chunk->count - (offset) - 1]
+#define READ_SHORT_AT(offset) ((uint16_t)(CHUNK_PEEK(offset) | (CHUNK_PEEK((offset) - 1) << 8)))
+#define READ_24BITS_AT(offset) ((uint32_t)CHUNK_PEEK(offset) | ((uint32_t)CHUNK_PEEK((offset) - 1) << 8) | ((uint32_t)CHUNK_PEEK((offset) - 2) << 16))
+
+//fuse 'a = a op b;' into one in-place commond, a is a local, upvalue or global
+static bool inplaceOptimize() {
+	Chunk* chunk = currentChunk();
+
+	//[GET a][value][SET a][POP]
+	uint8_t set = opStack_peek(currentOpStack(), 1);
+	uint8_t value = opStack_peek(currentOpStack(), 2);
+	uint8_t get = opStack_peek(currentOpStack(), 3);
+
+	bool isConst = (value >= OP_ADD_CONST && value <= OP_DIVIDE_CONST);
+	bool isLocal = (value >= OP_ADD_LOCAL && value <= OP_DIVIDE_LOCAL);
+
+	if (set == OP_SET_LOCAL && get == OP_GET_LOCAL && isConst
+		&& CHUNK_PEEK(3) == set && CHUNK_PEEK(7) == value && CHUNK_PEEK(10) == get
+		&& READ_SHORT_AT(2) == READ_SHORT_AT(9)) {
+		//GET_LOCAL a, OP_CONST k, SET_LOCAL a, POP
+		uint16_t slot = READ_SHORT_AT(2);
+		uint32_t constant = READ_24BITS_AT(6);
+		chunk_fallback(chunk, 3 + 4 + 3 + 1);
+		emitBytes(6, OP_INPLACE_ADD_LC + (value - OP_ADD_CONST), (uint8_t)slot, (uint8_t)(slot >> 8),
+			(uint8_t)constant, (uint8_t)(constant >> 8), (uint8_t)(constant >> 16));
+	}
+	else if (set == OP_SET_LOCAL && get == OP_GET_LOCAL && isLocal
+		&& CHUNK_PEEK(3) == set && CHUNK_PEEK(6) == value && CHUNK_PEEK(9) == get
+		&& READ_SHORT_AT(2) == READ_SHORT_AT(8)) {
+		//GET_LOCAL a, OP_LOCAL b, SET_LOCAL a, POP
+		uint16_t slot = READ_SHORT_AT(2);
+		uint16_t right = READ_SHORT_AT(5);
+		chunk_fallback(chunk, 3 + 3 + 3 + 1);
+		emitBytes(5, OP_INPLACE_ADD_LL + (value - OP_ADD_LOCAL), (uint8_t)slot, (uint8_t)(slot >> 8),
+			(uint8_t)right, (uint8_t)(right >> 8));
+	}
+	else if (set == OP_SET_UPVALUE && get == OP_GET_UPVALUE && isConst
+		&& CHUNK_PEEK(2) == set && CHUNK_PEEK(6) == value && CHUNK_PEEK(8) == get
+		&& CHUNK_PEEK(1) == CHUNK_PEEK(7)) {
+		//GET_UPVALUE a, OP_CONST k, SET_UPVALUE a, POP
+		uint8_t slot = CHUNK_PEEK(1);
+		uint32_t constant = READ_24BITS_AT(5);
+		chunk_fallback(chunk, 2 + 4 + 2 + 1);
+		emitBytes(5, OP_INPLACE_ADD_UC + (value - OP_ADD_CONST), slot,
+			(uint8_t)constant, (uint8_t)(constant >> 8), (uint8_t)(constant >> 16));
+	}
+	else if (set == OP_SET_GLOBAL && get == OP_GET_GLOBAL && isConst
+		&& CHUNK_PEEK(4) == set && CHUNK_PEEK(8) == value && CHUNK_PEEK(12) == get
+		&& READ_24BITS_AT(3) == READ_24BITS_AT(11)) {
+		//GET_GLOBAL a, OP_CONST k, SET_GLOBAL a, POP
+		uint32_t name = READ_24BITS_AT(3);
+		uint32_t constant = READ_24BITS_AT(7);
+		chunk_fallback(chunk, 4 + 4 + 4 + 1);
+		emitBytes(7, OP_INPLACE_ADD_GC + (value - OP_ADD_CONST), (uint8_t)name, (uint8_t)(name >> 8), (uint8_t)(name >> 16),
+			(uint8_t)constant, (uint8_t)(constant >> 8), (uint8_t)(constant >> 16));
+	}
+	else {
+		return false;
+	}
+
+	//the statement is done
+	clearOpStack();
+	return true;
+}
+
+//fuse 'local op k' or 'local op local' with the conditional jump after it,no bool is made
+static bool branchOptimize() {
+	Chunk* chunk = currentChunk();
+	OPStack* opStack = currentOpStack();
+
+	uint8_t compare = opStack_peek(opStack, 0);
+	if (opStack_peek(opStack, 1) != OP_GET_LOCAL) return false;
+
+	if (compare >= OP_EQUAL_CONST && compare <= OP_GREATER_EQUAL_CONST
+		&& CHUNK_PEEK(3) == compare && CHUNK_PEEK(6) == OP_GET_LOCAL) {
+		//GET_LOCAL a, CMP_CONST k
+		uint32_t constant = READ_24BITS_AT(2);
+		uint16_t left = READ_SHORT_AT(5);
+		chunk_fallback(chunk, 3 + 4);
+		opStack_fallback(opStack, 2);
+		emitBytes(6, OP_JUMP_IF_FALSE_EQUAL_LC + (compare - OP_EQUAL_CONST), (uint8_t)left, (uint8_t)(left >> 8),
+			(uint8_t)constant, (uint8_t)(constant >> 8), (uint8_t)(constant >> 16));
+		return true;
+	}
+	else if (compare >= OP_EQUAL_LOCAL && compare <= OP_GREATER_EQUAL_LOCAL
+		&& CHUNK_PEEK(2) == compare && CHUNK_PEEK(5) == OP_GET_LOCAL) {
+		//GET_LOCAL a, CMP_LOCAL b
+		uint16_t right = READ_SHORT_AT(1);
+		uint16_t left = READ_SHORT_AT(4);
+		chunk_fallback(chunk, 3 + 3);
+		opStack_fallback(opStack, 2);
+		emitBytes(5, OP_JUMP_IF_FALSE_EQUAL_LL + (compare - OP_EQUAL_LOCAL), (uint8_t)left, (uint8_t)(left >> 8),
+			(uint8_t)right, (uint8_t)(right >> 8));
+		return true;
+	}
+
+	return false;
+}
+
+//'arr[i]' in the body version of an array loop,the guard has checked both
+static bool elementOptimize(bool isAssignment, OpCode* compoundOp) {
+	Chunk* chunk = currentChunk();
+	OPStack* opStack = currentOpStack();
+	ArrayLoop* arrayLoop = current->arrayLoop;
+
+	if (opStack_peek(opStack, 0) != OP_GET_LOCAL || opStack_peek(opStack, 1) != OP_GET_LOCAL) return false;
+	if (CHUNK_PEEK(2) != OP_GET_LOCAL || READ_SHORT_AT(1) != arrayLoop->indexSlot
+		|| CHUNK_PEEK(5) != OP_GET_LOCAL || READ_SHORT_AT(4) != arrayLoop->arraySlot) return false;
+
+	//GET_LOCAL arr, GET_LOCAL i
+	chunk_fallback(chunk, 3 + 3);
+	opStack_fallback(opStack, 2);
+	clearOpStack();
+
+	if (compoundOp != NULL) {
+		//the element is read in place,nothing to copy
+		emitBytes(5, OP_GET_ELEMENT_LL, (uint8_t)arrayLoop->arraySlot, (uint8_t)(arrayLoop->arraySlot >> 8),
+			(uint8_t)arrayLoop->indexSlot, (uint8_t)(arrayLoop->indexSlot >> 8));
+		clearOpStack();
+		compoundExpression(*compoundOp);
+	}
+	else if (isAssignment) {
+		expression();
+	}
+	emitBytes(5, isAssignment ? OP_SET_ELEMENT_LL : OP_GET_ELEMENT_LL, (uint8_t)arrayLoop->arraySlot, (uint8_t)(arrayLoop->arraySlot >> 8),
+		(uint8_t)arrayLoop->indexSlot, (uint8_t)(arrayLoop->indexSlot >> 8));
+	clearOpStack();
+	return true;
+}
+
+#undef CHUNK_PEEK
+#undef READ_SHORT_AT
+#undef READ_24BITS_AT
+
+//scan the increment and the body ahead.the body is versioned when it has 'arr[i]' and can't
+//resize arr or change i:no call,no function and no assignment to either name
+static bool arrayLoopBody(Token* index, Token* array) {
+	Scanner mark = scanner_mark();
+	Token token = parser.current;
+	Token window[3] = { 0 }; //the tokens before,the nearest first
+	bool hasElement = false;
+	bool versioned = true;
+	int32_t depth = 0;
+
+	//the increment,to the ')' of the clauses
+	while (token.type != TOKEN_EOF && token.type != TOKEN_ERROR) {
+		if (token.type == TOKEN_LEFT_PAREN) ++depth;
+		else if (token.type == TOKEN_RIGHT_PAREN && depth-- == 0) break;
+		token = scanToken();
+	}
+
+	//a block,or a simple statement to its ';'
+	token = scanToken();
+	if (token.type != TOKEN_LEFT_BRACE && token.type != TOKEN_IDENTIFIER && token.type != TOKEN_PRINT) {
+		versioned = false;
+	}
+	bool isBlock = token.type == TOKEN_LEFT_BRACE;
+	depth = 0;
+
+	while (versioned) {
+		switch (token.type) {
+		case TOKEN_LEFT_BRACE:
+		case TOKEN_LEFT_SQUARE_BRACKET:
+			++depth;
+			break;
+		case TOKEN_RIGHT_BRACE:
+		case TOKEN_RIGHT_SQUARE_BRACKET:
+			--depth;
+			if (token.type == TOKEN_RIGHT_SQUARE_BRACKET && window[2].type == TOKEN_IDENTIFIER && identifiersEqual(&window[2], array)
+				&& window[1].type == TOKEN_LEFT_SQUARE_BRACKET && window[0].type == TOKEN_IDENTIFIER && identifiersEqual(&window[0], index)) {
+				hasElement = true;
+			}
+			break;
+		case TOKEN_LEFT_PAREN:
+			//a call,'if (' and '(a + b)' are not
+			switch (window[0].type) {
+			case TOKEN_IDENTIFIER:
+			case TOKEN_RIGHT_PAREN:
+			case TOKEN_RIGHT_SQUARE_BRACKET:
+			case TOKEN_STRING:
+			case TOKEN_STRING_ESCAPE:
+			case TOKEN_THIS:
+			case TOKEN_SUPER:
+				versioned = false;
+				break;
+			default:
+				++depth;
+				break;
+			}
+			break;
+		case TOKEN_RIGHT_PAREN:
+			--depth;
+			break;
+		case TOKEN_EQUAL:
+		case TOKEN_PLUS_EQUAL:
+		case TOKEN_MINUS_EQUAL:
+		case TOKEN_STAR_EQUAL:
+		case TOKEN_SLASH_EQUAL:
+			if (window[0].type == TOKEN_IDENTIFIER && (identifiersEqual(&window[0], index) || identifiersEqual(&window[0], array))) {
+				versioned = false;
+			}
+			break;
+		case TOKEN_FUN:
+		case TOKEN_LAMBDA:
+		case TOKEN_CLASS:
+		case TOKEN_IMPORT:
+		case TOKEN_ERROR:
+		case TOKEN_EOF:
+			versioned = false;
+			break;
+		default:
+			break;
+		}
+
+		if (depth == 0 && (isBlock ? token.type == TOKEN_RIGHT_BRACE : token.type == TOKEN_SEMICOLON)) break;
+
+		window[2] = window[1];
+		window[1] = window[0];
+		window[0] = token;
+		token = scanToken();
+	}
+
+	scanner_reset(mark);
+	return versioned && hasElement;
+}
+
+//'i < @array.length(arr)' with local i and arr,the guard before it jumps to the body version
+//without checks.returns the offset to patch,or -1
+static int32_t arrayLoopGuard(int32_t conditionStart, ArrayLoop* arrayLoop) {
+	Chunk* chunk = currentChunk();
+	uint8_t* code = chunk->code + conditionStart;
+
+	//GET_LOCAL i, CONSTANT length, GET_LOCAL arr, CALL 1, LESS
+	if (chunk->count - conditionStart != 3 + 4 + 3 + 2 + 1
+		|| code[0] != OP_GET_LOCAL || code[3] != OP_CONSTANT || code[7] != OP_GET_LOCAL
+		|| code[10] != OP_CALL || code[11] != 1 || code[12] != OP_LESS) return -1;
+
+	Value length;
+	Value native = vm.constants.values[code[4] | (code[5] << 8) | (code[6] << 16)];
+	if (!tableGet(&vm.builtins[MODULE_ARRAY].fields, copyString("length", 6, false), &length)
+		|| !valuesEqual(native, length)) return -1;
+
+	arrayLoop->indexSlot = (uint16_t)(code[1] | (code[2] << 8));
+	arrayLoop->arraySlot = (uint16_t)(code[8] | (code[9] << 8));
+	if (arrayLoop->indexSlot == arrayLoop->arraySlot
+		|| !arrayLoopBody(&current->locals[arrayLoop->indexSlot].name, &current->locals[arrayLoop->arraySlot].name)) return -1;
+
+	//the guard goes before the condition,it is checked again after the increment
+	uint8_t condition[3 + 4 + 3 + 2 + 1];
+	memcpy(condition, code, sizeof(condition));
+	chunk_fallback(chunk, sizeof(condition));
+
+	emitBytes(7, OP_JUMP_IF_IN_ARRAY_LL, (uint8_t)arrayLoop->indexSlot, (uint8_t)(arrayLoop->indexSlot >> 8),
+		(uint8_t)arrayLoop->arraySlot, (uint8_t)(arrayLoop->arraySlot >> 8), 0xff, 0xff);
+	int32_t guardJump = chunk->count - 2;
+
+	for (uint32_t i = 0; i < sizeof(condition); ++i) {
+		emitByte(condition[i]);
+	}
+	clearOpStack();
+	return guardJump;
+}
+
 static void instructionOptimize() {
 	//do optimize here
 	Chunk* chunk = currentChunk();
@@ -1799,12 +2593,12 @@ static void instructionOptimize() {
 		}
 		else if (isRightConstant) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_ADD_CONST);
 			CHUNK_PEEK(3) = OP_ADD_CONST; //convert command
 		}
 		else if (isRightLocal) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_ADD_LOCAL);
 			CHUNK_PEEK(2) = OP_ADD_LOCAL; //convert command
 		}
 		break;
@@ -1820,12 +2614,12 @@ static void instructionOptimize() {
 		}
 		else if (isRightConstant) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_SUBTRACT_CONST);
 			CHUNK_PEEK(3) = OP_SUBTRACT_CONST; //convert command
 		}
 		else if (isRightLocal) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_SUBTRACT_LOCAL);
 			CHUNK_PEEK(2) = OP_SUBTRACT_LOCAL; //convert command
 		}
 		break;
@@ -1841,12 +2635,12 @@ static void instructionOptimize() {
 		}
 		else if (isRightConstant) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_MULTIPLY_CONST);
 			CHUNK_PEEK(3) = OP_MULTIPLY_CONST; //convert command
 		}
 		else if (isRightLocal) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_MULTIPLY_LOCAL);
 			CHUNK_PEEK(2) = OP_MULTIPLY_LOCAL; //convert command
 		}
 		break;
@@ -1862,12 +2656,12 @@ static void instructionOptimize() {
 		}
 		else if (isRightConstant) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_DIVIDE_CONST);
 			CHUNK_PEEK(3) = OP_DIVIDE_CONST; //convert command
 		}
 		else if (isRightLocal) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_DIVIDE_LOCAL);
 			CHUNK_PEEK(2) = OP_DIVIDE_LOCAL; //convert command
 		}
 		break;
@@ -1892,12 +2686,12 @@ static void instructionOptimize() {
 		}
 		else if (isRightConstant) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_MODULUS_CONST);
 			CHUNK_PEEK(3) = OP_MODULUS_CONST; //convert command
 		}
 		else if (isRightLocal) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_MODULUS_LOCAL);
 			CHUNK_PEEK(2) = OP_MODULUS_LOCAL; //convert command
 		}
 		break;
@@ -1970,12 +2764,12 @@ static void instructionOptimize() {
 		}
 		else if (isRightConstant) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_EQUAL_CONST);
 			CHUNK_PEEK(3) = OP_EQUAL_CONST; //convert command
 		}
 		else if (isRightLocal) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_EQUAL_LOCAL);
 			CHUNK_PEEK(2) = OP_EQUAL_LOCAL; //convert command
 		}
 		break;
@@ -1996,12 +2790,12 @@ static void instructionOptimize() {
 		}
 		else if (isRightConstant) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_NOT_EQUAL_CONST);
 			CHUNK_PEEK(3) = OP_NOT_EQUAL_CONST; //convert command
 		}
 		else if (isRightLocal) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_NOT_EQUAL_LOCAL);
 			CHUNK_PEEK(2) = OP_NOT_EQUAL_LOCAL; //convert command
 		}
 		break;
@@ -2017,12 +2811,12 @@ static void instructionOptimize() {
 		}
 		else if (isRightConstant) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_GREATER_CONST);
 			CHUNK_PEEK(3) = OP_GREATER_CONST; //convert command
 		}
 		else if (isRightLocal) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_GREATER_LOCAL);
 			CHUNK_PEEK(2) = OP_GREATER_LOCAL; //convert command
 		}
 		break;
@@ -2038,12 +2832,12 @@ static void instructionOptimize() {
 		}
 		else if (isRightConstant) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_LESS_CONST);
 			CHUNK_PEEK(3) = OP_LESS_CONST; //convert command
 		}
 		else if (isRightLocal) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_LESS_LOCAL);
 			CHUNK_PEEK(2) = OP_LESS_LOCAL; //convert command
 		}
 		break;
@@ -2059,12 +2853,12 @@ static void instructionOptimize() {
 		}
 		else if (isRightConstant) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_LESS_EQUAL_CONST);
 			CHUNK_PEEK(3) = OP_LESS_EQUAL_CONST; //convert command
 		}
 		else if (isRightLocal) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_LESS_EQUAL_LOCAL);
 			CHUNK_PEEK(2) = OP_LESS_EQUAL_LOCAL; //convert command
 		}
 		break;
@@ -2080,12 +2874,12 @@ static void instructionOptimize() {
 		}
 		else if (isRightConstant) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_GREATER_EQUAL_CONST);
 			CHUNK_PEEK(3) = OP_GREATER_EQUAL_CONST; //convert command
 		}
 		else if (isRightLocal) {
 			chunk_fallback(chunk, 1);//op
-			clearOpStack();
+			fuseOpStack(OP_GREATER_EQUAL_LOCAL);
 			CHUNK_PEEK(2) = OP_GREATER_EQUAL_LOCAL; //convert command
 		}
 		break;
@@ -2093,6 +2887,10 @@ static void instructionOptimize() {
 	case OP_SET_LOCAL: {
 		break;
 	}
+	case OP_POP: {
+		inplaceOptimize();
+		break;
+	}
 	default: {
 		fprintf(stderr, "Unexpected(%u)\n", code);
 		break;
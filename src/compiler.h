@@ -55,8 +55,10 @@ typedef struct {
 typedef struct {
 	Token name;
 	int32_t depth;
-	bool isCaptured; //captured by upvalue
+	bool isCaptured; //captured by a boxed upvalue,closed at the end of its scope
 	bool isConst; //is a const
+	bool isChecked; //isAssigned is known,checked when it's captured first
+	bool isAssigned; //assigned somewhere in its scope,captured boxed
 } Local;
 
 typedef struct LoopContext {
@@ -68,6 +70,13 @@ typedef struct LoopContext {
 	struct LoopContext* enclosing;
 } LoopContext;
 
+//'for (...; i < @array.length(arr); ...)' whose body is compiled the second time after the guard,
+//'arr[i]' in it is in range
+typedef struct {
+	uint16_t indexSlot;
+	uint16_t arraySlot;
+} ArrayLoop;
+
 typedef enum {
 	TYPE_FUNCTION,
 	TYPE_METHOD, //class method
@@ -98,7 +107,12 @@ typedef struct Compiler {
 	Local* locals;
 
 	LoopContext* currentLoop;
-	Upvalue upvalues[UINT8_COUNT];
+	ArrayLoop* arrayLoop; //NULL if not in the body version of an array loop
+	Upvalue upvalues[UINT8_COUNT];	//boxed
+	Upvalue captures[UINT8_COUNT];	//copied by value
+
+	uint32_t lastCallEnd; //chunk count after the last OP_CALL,for tail call,UINT32_MAX before the first
+	uint32_t registerTop; //slots the register temporaries reach,the frame keeps them in maxStack
 } Compiler;
 
 typedef struct ClassCompiler {
@@ -98,6 +98,79 @@ static uint32_t shortInstruction(C_STR name, Chunk* chunk, uint32_t offset) {
 	return offset + 3;
 }
 
+COLD_FUNCTION
+static uint32_t registerInstruction(C_STR name, Chunk* chunk, uint32_t offset, uint32_t operandCount) {
+	printf("%-16s", name);
+	for (uint32_t i = 0; i < operandCount; ++i) {
+		uint32_t slot = ((uint32_t)chunk->code[offset + 1 + i * 2]) | ((uint32_t)chunk->code[offset + 2 + i * 2] << 8);
+		printf(" %4d", slot);
+	}
+	printf("\n");
+	return offset + 1 + operandCount * 2;
+}
+
+COLD_FUNCTION
+static uint32_t registerConstantInstruction(C_STR name, Chunk* chunk, uint32_t offset, uint32_t operandCount) {
+	printf("%-16s", name);
+	for (uint32_t i = 0; i < operandCount; ++i) {
+		uint32_t slot = ((uint32_t)chunk->code[offset + 1 + i * 2]) | ((uint32_t)chunk->code[offset + 2 + i * 2] << 8);
+		printf(" %4d", slot);
+	}
+
+	//24bit index after slots
+	offset += operandCount * 2;
+	uint32_t constant = ((uint32_t)chunk->code[offset + 1]) | ((uint32_t)chunk->code[offset + 2] << 8) | ((uint32_t)chunk->code[offset + 3] << 16);
+	printf(" %4d '", constant);
+	printValue(vm.constants.values[constant]);
+	printf("'\n");
+	return offset + 4;
+}
+
+COLD_FUNCTION
+static uint32_t compareJumpInstruction(C_STR name, Chunk* chunk, uint32_t offset, bool isConstant) {
+	uint32_t start = offset;
+	uint32_t left = ((uint32_t)chunk->code[offset + 1]) | ((uint32_t)chunk->code[offset + 2] << 8);
+	printf("%-16s %4d", name, left);
+
+	if (isConstant) {
+		uint32_t constant = ((uint32_t)chunk->code[offset + 3]) | ((uint32_t)chunk->code[offset + 4] << 8) | ((uint32_t)chunk->code[offset + 5] << 16);
+		printf(" %4d '", constant);
+		printValue(vm.constants.values[constant]);
+		printf("'");
+		offset += 6;
+	}
+	else {
+		uint32_t right = ((uint32_t)chunk->code[offset + 3]) | ((uint32_t)chunk->code[offset + 4] << 8);
+		printf(" %4d", right);
+		offset += 5;
+	}
+
+	uint16_t jump = (uint16_t)chunk->code[offset];
+	jump |= (chunk->code[offset + 1] << 8);
+	printf(" %4d -> %d\n", start, offset + 2 + jump);
+	return offset + 2;
+}
+
+//upvalue or global slot target, then the 24bit constant
+COLD_FUNCTION
+static uint32_t inplaceInstruction(C_STR name, Chunk* chunk, uint32_t offset, bool isGlobal) {
+	if (isGlobal) {
+		uint32_t global = ((uint32_t)chunk->code[offset + 1]) | ((uint32_t)chunk->code[offset + 2] << 8) | ((uint32_t)chunk->code[offset + 3] << 16);
+		printf("%-16s %4d '%s'", name, global, vm.globalNames[global]->chars);
+		offset += 3;
+	}
+	else {
+		printf("%-16s %4d", name, chunk->code[offset + 1]);
+		offset += 1;
+	}
+
+	uint32_t constant = ((uint32_t)chunk->code[offset + 1]) | ((uint32_t)chunk->code[offset + 2] << 8) | ((uint32_t)chunk->code[offset + 3] << 16);
+	printf(" %4d '", constant);
+	printValue(vm.constants.values[constant]);
+	printf("'\n");
+	return offset + 4;
+}
+
 COLD_FUNCTION
 static uint32_t constantInstruction(C_STR name, Chunk* chunk, uint32_t offset) {
 	//24bit index
@@ -111,15 +184,42 @@ static uint32_t constantInstruction(C_STR name, Chunk* chunk, uint32_t offset) {
 	return offset + 4;
 }
 
+COLD_FUNCTION
+static uint32_t globalInstruction(C_STR name, Chunk* chunk, uint32_t offset) {
+	//24bit slot
+	uint32_t slot = ((uint32_t)chunk->code[offset + 1]) | ((uint32_t)chunk->code[offset + 2] << 8) | ((uint32_t)chunk->code[offset + 3] << 16);
+
+	printf("%-16s %4d '%s'\n", name, slot, vm.globalNames[slot]->chars);
+	return offset + 4;
+}
+
+COLD_FUNCTION
+static uint32_t propertyInstruction(C_STR name, Chunk* chunk, uint32_t offset) {
+	//24bit index
+	uint32_t constant = ((uint32_t)chunk->code[offset + 1]) | ((uint32_t)chunk->code[offset + 2] << 8) | ((uint32_t)chunk->code[offset + 3] << 16);
+	uint16_t cache = (uint16_t)(chunk->code[offset + 4] | (chunk->code[offset + 5] << 8));
+
+	printf("%-16s %4d '", name, constant);
+	printValue(vm.constants.values[constant]);
+	printf("' (cache %d)\n", cache);
+
+	//OP_GET_PROPERTY 6
+	return offset + 6;
+}
+
 COLD_FUNCTION
 static uint32_t invokeInstruction(C_STR name, Chunk* chunk, uint32_t offset) {
 	//24bit index
 	uint32_t constant = ((uint32_t)chunk->code[offset + 1]) | ((uint32_t)chunk->code[offset + 2] << 8) | ((uint32_t)chunk->code[offset + 3] << 16);
 	uint8_t argCount = chunk->code[offset + 4];
+	uint16_t cache = (uint16_t)(chunk->code[offset + 5] | (chunk->code[offset + 6] << 8));
+
 	printf("%-16s (%d args) %4d '", name, argCount, constant);
 	printValue(vm.constants.values[constant]);
-	printf("'\n");
-	return offset + 5;
+	printf("' (cache %d)\n", cache);
+
+	//OP_INVOKE 7
+	return offset + 7;
 }
 
 COLD_FUNCTION
@@ -138,6 +238,8 @@ uint32_t disassembleInstruction(Chunk* chunk, uint32_t offset) {
 	switch (instruction) {
 	case OP_CALL:
 		return byteInstruction("OP_CALL", chunk, offset);
+	case OP_TAIL_CALL:
+		return byteInstruction("OP_TAIL_CALL", chunk, offset);
 	case OP_INVOKE:
 		return invokeInstruction("OP_INVOKE", chunk, offset);
 	case OP_SUPER_INVOKE:
@@ -148,6 +250,10 @@ uint32_t disassembleInstruction(Chunk* chunk, uint32_t offset) {
 		return simpleInstruction("OP_THROW", offset);
 	case OP_POP:
 		return simpleInstruction("OP_POP", offset);
+	case OP_DUP:
+		return simpleInstruction("OP_DUP", offset);
+	case OP_DUP2:
+		return simpleInstruction("OP_DUP2", offset);
 	case OP_PRINT:
 		return simpleInstruction("OP_PRINT", offset);
 	case OP_ADD:
@@ -177,14 +283,15 @@ uint32_t disassembleInstruction(Chunk* chunk, uint32_t offset) {
 		//OP_CONSTANT 4
 		offset += 4;
 
+		//the boxed upvalues,then the captured values
 		ObjFunction* function = AS_FUNCTION(vm.constants.values[constant]);
-		for (uint32_t j = 0; j < function->upvalueCount; j++) {
+		for (uint32_t j = 0; j < function->upvalueCount + function->captureCount; j++) {
 			int32_t isLocal = chunk->code[offset++];
 			uint16_t index = chunk->code[offset++];
 			index |= (chunk->code[offset++] << 8);
 
-			printf("%04d      |                     %s %d\n",
-				offset - 3, isLocal ? "local" : "upvalue", index);
+			printf("%04d      |                     %s %s %d\n",
+				offset - 3, (j < function->upvalueCount) ? "box" : "copy", isLocal ? "local" : "upvalue", index);
 		}
 		return offset;
 	}
@@ -194,6 +301,8 @@ uint32_t disassembleInstruction(Chunk* chunk, uint32_t offset) {
 		return byteInstruction("OP_SET_UPVALUE", chunk, offset);
 	case OP_CLOSE_UPVALUE:
 		return simpleInstruction("OP_CLOSE_UPVALUE", offset);
+	case OP_GET_CAPTURE:
+		return byteInstruction("OP_GET_CAPTURE", chunk, offset);
 	case OP_NIL:
 		return simpleInstruction("OP_NIL", offset);
 	case OP_TRUE:
@@ -221,11 +330,11 @@ uint32_t disassembleInstruction(Chunk* chunk, uint32_t offset) {
 		return bitwiseInStruction("OP_BITWISE", chunk, offset);
 
 	case OP_DEFINE_GLOBAL:
-		return constantInstruction("OP_DEFINE_GLOBAL", chunk, offset);
+		return globalInstruction("OP_DEFINE_GLOBAL", chunk, offset);
 	case OP_GET_GLOBAL:
-		return constantInstruction("OP_GET_GLOBAL", chunk, offset);
+		return globalInstruction("OP_GET_GLOBAL", chunk, offset);
 	case OP_SET_GLOBAL:
-		return constantInstruction("OP_SET_GLOBAL", chunk, offset);
+		return globalInstruction("OP_SET_GLOBAL", chunk, offset);
 	case OP_CLASS:
 		return constantInstruction("OP_CLASS", chunk, offset);
 	case OP_INHERIT:
@@ -235,9 +344,9 @@ uint32_t disassembleInstruction(Chunk* chunk, uint32_t offset) {
 	case OP_GET_SUPER:
 		return constantInstruction("OP_GET_SUPER", chunk, offset);
 	case OP_GET_PROPERTY:
-		return constantInstruction("OP_GET_PROPERTY", chunk, offset);
+		return propertyInstruction("OP_GET_PROPERTY", chunk, offset);
 	case OP_SET_PROPERTY:
-		return constantInstruction("OP_SET_PROPERTY", chunk, offset);
+		return propertyInstruction("OP_SET_PROPERTY", chunk, offset);
 	case OP_GET_INDEX:
 		return constantInstruction("OP_GET_INDEX", chunk, offset);
 	case OP_SET_INDEX:
@@ -328,6 +437,119 @@ uint32_t disassembleInstruction(Chunk* chunk, uint32_t offset) {
 	case OP_LESS_EQUAL_LOCAL:
 		return shortInstruction("OP_LESS_EQUAL_LOCAL", chunk, offset);
 
+	case OP_JUMP_IF_FALSE_EQUAL_LC:
+		return compareJumpInstruction("OP_JUMP_IF_FALSE_EQUAL_LC", chunk, offset, true);
+	case OP_JUMP_IF_FALSE_NOT_EQUAL_LC:
+		return compareJumpInstruction("OP_JUMP_IF_FALSE_NOT_EQUAL_LC", chunk, offset, true);
+	case OP_JUMP_IF_FALSE_GREATER_LC:
+		return compareJumpInstruction("OP_JUMP_IF_FALSE_GREATER_LC", chunk, offset, true);
+	case OP_JUMP_IF_FALSE_GREATER_EQUAL_LC:
+		return compareJumpInstruction("OP_JUMP_IF_FALSE_GREATER_EQUAL_LC", chunk, offset, true);
+	case OP_JUMP_IF_FALSE_LESS_LC:
+		return compareJumpInstruction("OP_JUMP_IF_FALSE_LESS_LC", chunk, offset, true);
+	case OP_JUMP_IF_FALSE_LESS_EQUAL_LC:
+		return compareJumpInstruction("OP_JUMP_IF_FALSE_LESS_EQUAL_LC", chunk, offset, true);
+	case OP_JUMP_IF_FALSE_EQUAL_LL:
+		return compareJumpInstruction("OP_JUMP_IF_FALSE_EQUAL_LL", chunk, offset, false);
+	case OP_JUMP_IF_FALSE_NOT_EQUAL_LL:
+		return compareJumpInstruction("OP_JUMP_IF_FALSE_NOT_EQUAL_LL", chunk, offset, false);
+	case OP_JUMP_IF_FALSE_GREATER_LL:
+		return compareJumpInstruction("OP_JUMP_IF_FALSE_GREATER_LL", chunk, offset, false);
+	case OP_JUMP_IF_FALSE_GREATER_EQUAL_LL:
+		return compareJumpInstruction("OP_JUMP_IF_FALSE_GREATER_EQUAL_LL", chunk, offset, false);
+	case OP_JUMP_IF_FALSE_LESS_LL:
+		return compareJumpInstruction("OP_JUMP_IF_FALSE_LESS_LL", chunk, offset, false);
+	case OP_JUMP_IF_FALSE_LESS_EQUAL_LL:
+		return compareJumpInstruction("OP_JUMP_IF_FALSE_LESS_EQUAL_LL", chunk, offset, false);
+
+	case OP_INPLACE_ADD_LC:
+		return registerConstantInstruction("OP_INPLACE_ADD_LC", chunk, offset, 1);
+	case OP_INPLACE_SUBTRACT_LC:
+		return registerConstantInstruction("OP_INPLACE_SUBTRACT_LC", chunk, offset, 1);
+	case OP_INPLACE_MULTIPLY_LC:
+		return registerConstantInstruction("OP_INPLACE_MULTIPLY_LC", chunk, offset, 1);
+	case OP_INPLACE_DIVIDE_LC:
+		return registerConstantInstruction("OP_INPLACE_DIVIDE_LC", chunk, offset, 1);
+	case OP_INPLACE_ADD_LL:
+		return registerInstruction("OP_INPLACE_ADD_LL", chunk, offset, 2);
+	case OP_INPLACE_SUBTRACT_LL:
+		return registerInstruction("OP_INPLACE_SUBTRACT_LL", chunk, offset, 2);
+	case OP_INPLACE_MULTIPLY_LL:
+		return registerInstruction("OP_INPLACE_MULTIPLY_LL", chunk, offset, 2);
+	case OP_INPLACE_DIVIDE_LL:
+		return registerInstruction("OP_INPLACE_DIVIDE_LL", chunk, offset, 2);
+	case OP_INPLACE_ADD_UC:
+		return inplaceInstruction("OP_INPLACE_ADD_UC", chunk, offset, false);
+	case OP_INPLACE_SUBTRACT_UC:
+		return inplaceInstruction("OP_INPLACE_SUBTRACT_UC", chunk, offset, false);
+	case OP_INPLACE_MULTIPLY_UC:
+		return inplaceInstruction("OP_INPLACE_MULTIPLY_UC", chunk, offset, false);
+	case OP_INPLACE_DIVIDE_UC:
+		return inplaceInstruction("OP_INPLACE_DIVIDE_UC", chunk, offset, false);
+	case OP_INPLACE_ADD_GC:
+		return inplaceInstruction("OP_INPLACE_ADD_GC", chunk, offset, true);
+	case OP_INPLACE_SUBTRACT_GC:
+		return inplaceInstruction("OP_INPLACE_SUBTRACT_GC", chunk, offset, true);
+	case OP_INPLACE_MULTIPLY_GC:
+		return inplaceInstruction("OP_INPLACE_MULTIPLY_GC", chunk, offset, true);
+	case OP_INPLACE_DIVIDE_GC:
+		return inplaceInstruction("OP_INPLACE_DIVIDE_GC", chunk, offset, true);
+
+	case OP_REG_MOVE:
+		return registerInstruction("OP_REG_MOVE", chunk, offset, 2);
+	case OP_REG_LOAD_CONST:
+		return registerConstantInstruction("OP_REG_LOAD_CONST", chunk, offset, 1);
+	case OP_REG_NEGATE:
+		return registerInstruction("OP_REG_NEGATE", chunk, offset, 2);
+	case OP_REG_ADD_LL:
+		return registerInstruction("OP_REG_ADD_LL", chunk, offset, 3);
+	case OP_REG_SUBTRACT_LL:
+		return registerInstruction("OP_REG_SUBTRACT_LL", chunk, offset, 3);
+	case OP_REG_MULTIPLY_LL:
+		return registerInstruction("OP_REG_MULTIPLY_LL", chunk, offset, 3);
+	case OP_REG_DIVIDE_LL:
+		return registerInstruction("OP_REG_DIVIDE_LL", chunk, offset, 3);
+	case OP_REG_MODULUS_LL:
+		return registerInstruction("OP_REG_MODULUS_LL", chunk, offset, 3);
+	case OP_REG_ADD_LC:
+		return registerConstantInstruction("OP_REG_ADD_LC", chunk, offset, 2);
+	case OP_REG_SUBTRACT_LC:
+		return registerConstantInstruction("OP_REG_SUBTRACT_LC", chunk, offset, 2);
+	case OP_REG_MULTIPLY_LC:
+		return registerConstantInstruction("OP_REG_MULTIPLY_LC", chunk, offset, 2);
+	case OP_REG_DIVIDE_LC:
+		return registerConstantInstruction("OP_REG_DIVIDE_LC", chunk, offset, 2);
+	case OP_REG_MODULUS_LC:
+		return registerConstantInstruction("OP_REG_MODULUS_LC", chunk, offset, 2);
+
+	case OP_JUMP_IF_IN_ARRAY_LL:
+		return compareJumpInstruction("OP_JUMP_IF_IN_ARRAY_LL", chunk, offset, false);
+	case OP_GET_ELEMENT_LL:
+		return registerInstruction("OP_GET_ELEMENT_LL", chunk, offset, 2);
+	case OP_SET_ELEMENT_LL:
+		return registerInstruction("OP_SET_ELEMENT_LL", chunk, offset, 2);
+
+	case OP_GET_SUBSCRIPT_ARRAY:
+		return simpleInstruction("OP_GET_SUBSCRIPT_ARRAY", offset);
+	case OP_GET_SUBSCRIPT_F64:
+		return simpleInstruction("OP_GET_SUBSCRIPT_F64", offset);
+	case OP_SET_SUBSCRIPT_ARRAY:
+		return simpleInstruction("OP_SET_SUBSCRIPT_ARRAY", offset);
+	case OP_SET_SUBSCRIPT_F64:
+		return simpleInstruction("OP_SET_SUBSCRIPT_F64", offset);
+	case OP_GET_INDEX_ARRAY:
+		return constantInstruction("OP_GET_INDEX_ARRAY", chunk, offset);
+	case OP_GET_INDEX_F64:
+		return constantInstruction("OP_GET_INDEX_F64", chunk, offset);
+	case OP_SET_INDEX_ARRAY:
+		return constantInstruction("OP_SET_INDEX_ARRAY", chunk, offset);
+	case OP_SET_INDEX_F64:
+		return constantInstruction("OP_SET_INDEX_F64", chunk, offset);
+	case OP_ADD_NUMBER:
+		return simpleInstruction("OP_ADD_NUMBER", offset);
+	case OP_CALL_NATIVE_NUMBER:
+		return byteInstruction("OP_CALL_NATIVE_NUMBER", chunk, offset);
+
 	default:
 		printf("Unknown opcode %d offset = %d\n", instruction, offset);
 		return offset + 1;
@@ -372,6 +594,17 @@ void disassembleOpStack(OPStack* opStack) {
 		case OP_NOT_EQUAL:        printf("OP_NOT_EQUAL\n"); break;
 		case OP_LESS_EQUAL:       printf("OP_LESS_EQUAL\n"); break;
 		case OP_GREATER_EQUAL:    printf("OP_GREATER_EQUAL\n"); break;
+		case OP_POP:              printf("OP_POP\n"); break;
+		case OP_ADD_CONST:        printf("OP_ADD_CONST\n"); break;
+		case OP_SUBTRACT_CONST:   printf("OP_SUBTRACT_CONST\n"); break;
+		case OP_MULTIPLY_CONST:   printf("OP_MULTIPLY_CONST\n"); break;
+		case OP_DIVIDE_CONST:     printf("OP_DIVIDE_CONST\n"); break;
+		case OP_MODULUS_CONST:    printf("OP_MODULUS_CONST\n"); break;
+		case OP_ADD_LOCAL:        printf("OP_ADD_LOCAL\n"); break;
+		case OP_SUBTRACT_LOCAL:   printf("OP_SUBTRACT_LOCAL\n"); break;
+		case OP_MULTIPLY_LOCAL:   printf("OP_MULTIPLY_LOCAL\n"); break;
+		case OP_DIVIDE_LOCAL:     printf("OP_DIVIDE_LOCAL\n"); break;
+		case OP_MODULUS_LOCAL:    printf("OP_MODULUS_LOCAL\n"); break;
 		default:
 			fprintf(stderr, "Unexpected(%u)\n", code);
 			break;
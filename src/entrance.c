@@ -6,8 +6,10 @@
 #include "entrance.h"
 #include "version.h"
 #include "vm.h"
+#include "aot.h"
 #include "file.h"
 #include "allocator.h"
+#include "gc.h"
 
 static void print_help() {
 	printf("Commands:\n");
@@ -77,6 +79,72 @@ static STR dealWithFilePath(STR line) {
 	return begin;
 }
 
+bool setOption(C_STR option) {
+	if (strcmp(option, "--register") == 0) {
+		vm.config.registerMode = true;
+		return true;
+	}
+	if (strcmp(option, "--jit") == 0) {
+		vm.config.jit = true;
+		return true;
+	}
+	if (strcmp(option, "--no-jit") == 0) {
+		vm.config.jit = false;
+		return true;
+	}
+	if (strcmp(option, "--trace") == 0) {
+		vm.config.trace = true;
+		return true;
+	}
+	if (strcmp(option, "--trace-dump") == 0) {
+		vm.config.trace = true;
+		vm.config.traceDump = true;
+		return true;
+	}
+	if (strcmp(option, "--emit-c") == 0) {
+		vm.config.emitC = true;
+		return true;
+	}
+	if (strcmp(option, "--profile") == 0) {
+		vm.config.profile = true;
+		return true;
+	}
+	if (strcmp(option, "--gc-thread") == 0) {
+#if GC_THREAD_AVAILABLE
+		vm.config.gcThread = true;
+		return true;
+#else
+		fprintf(stderr, "--gc-thread needs NaN boxing on x86-64.\n");
+		return false;
+#endif
+	}
+	if (strcmp(option, "--gc-threads") == 0) {
+		vm.config.gcThreads = thread_hardwareCount();
+		return true;
+	}
+	if (strncmp(option, "--gc-threads=", 13) == 0) {
+		uint32_t count = (uint32_t)strtoul(option + 13, NULL, 10);
+		if (count == 0) return false;
+		vm.config.gcThreads = count;
+		return true;
+	}
+	return false;
+}
+
+void printUsage() {
+	fprintf(stderr, "Usage: [options] [path]\n");
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "  --register  Emit register commonds for local arithmetic.\n");
+	fprintf(stderr, "  --jit       Compile hot functions to native code (x86-64 Linux).\n");
+	fprintf(stderr, "  --no-jit    Run everything in the interpreter (default).\n");
+	fprintf(stderr, "  --trace     Record hot loops and compile the traces to native code (x86-64 Linux).\n");
+	fprintf(stderr, "  --trace-dump  Same as --trace,and print the recorded traces.\n");
+	fprintf(stderr, "  --emit-c    Print the script as a C program instead of running it.\n");
+	fprintf(stderr, "  --profile   Count the commonds,pairs and triples run by the interpreter and report them.\n");
+	fprintf(stderr, "  --gc-thread Mark the old objects on a background thread.\n");
+	fprintf(stderr, "  --gc-threads[=N]  Mark and sweep a full collection on N threads,at most and by default the hardware ones.\n");
+}
+
 void repl() {
 	printf("%s %s  Copyright (C) %s, %s\n", INTERPRETER_NAME, INTERPRETER_VERSION, INTERPRETER_COPYRIGHT, INTERPRETER_DEVELOPER);
 
@@ -194,7 +262,7 @@ void runFile(C_STR path) {
 	vm_init();
 
 	STR source = readFile(path);
-	InterpretResult result = interpret(source);
+	InterpretResult result = vm.config.emitC ? aot_emit(source) : interpret(source);
 	mem_free(source);
 
 	if (result == INTERPRET_COMPILE_ERROR) exit(65);
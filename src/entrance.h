@@ -7,4 +7,8 @@
 #include "common.h"
 
 void runFile(C_STR path);
-void repl();
\ No newline at end of file
+void repl();
+
+//parse '--xxx' before vm_init,false if unknown
+bool setOption(C_STR option);
+void printUsage();
\ No newline at end of file
@@ -10,6 +10,9 @@
 #include "memory.h"
 #include "timer.h"
 
+#define GC_ALIGN(size) (((size) + 7) & ~(uint64_t)7)
+#define BLOCK_OF(object) ((GCBlock*)((uintptr_t)(object) & ~(uintptr_t)(GC_BLOCK_SIZE - 1)))
+
 void markValue(Value value)
 {
 	if (IS_OBJ(value)) markObject(AS_OBJ(value));
@@ -36,7 +39,7 @@ static void markArrayAny(ObjArray* array) {
 	Value* arrPtr = (Value*)array->payload;
 
 	for (uint32_t i = 0; i < array->length; ++i) {
-		Value value = arrPtr[i];
+		Value value = gc_loadSlot(&arrPtr[i]);
 
 		if (IS_OBJ(value)) {
 			markObject(AS_OBJ(value));
@@ -57,7 +60,9 @@ static void markRoots() {
 		markObject((Obj*)upvalue);
 	}
 
-	markTable(&vm.globals.fields);
+	for (uint32_t i = 0; i < vm.globalCount; i++) {
+		markValue(vm.globalValues[i]);
+	}
 	//the shared constants don't gc
 	//markConstants(&vm.constants);
 
@@ -66,12 +71,118 @@ static void markRoots() {
 	//markObject((Obj*)vm.initString);
 }
 
+//the gray objects of a marking thread,the script pushes to vm.grayStack.
+//a worker of a parallel collection blackens its own stack depth first without a lock,the objects of a list
+//are allocated in order and found in order.while another one is idle it moves the oldest ones to shared,
+//the others steal from the bottom of shared holding its lock
+struct GCWorker {
+	uint64_t bottom;	//the ones below were moved to shared
+	uint64_t count;
+	uint64_t capacity;
+	Obj** stack;
+	uint64_t sharedBottom;
+	uint64_t sharedCount;
+	uint64_t sharedCapacity;
+	Obj** shared;
+	uint8_t lock;
+	uint32_t id;
+	Thread* thread;
+	//what its part of a parallel sweep kept,the dead classes are left to the script
+	ObjSegments kept;
+	Obj* classes;
+	uint64_t bytes;	//allocatedBytes of the thread
+};
+
+//NULL on the script's thread
+static THREAD_LOCAL GCWorker* worker = NULL;
+
+static void pushStack(Obj*** stack, uint64_t* count, uint64_t* capacity, Obj* object) {
+	if (*capacity < *count + 1) {
+		*capacity = GROW_CAPACITY(*capacity);
+		*stack = (Obj**)mem_realloc(*stack, sizeof(Obj*) * *capacity);
+		//We don’t want growing the gray stack during a GC to cause the GC to recursively start a new GC
+		if (*stack == NULL) exit(1);//realloc failed
+	}
+
+	(*stack)[(*count)++] = object;
+}
+
+static void relaxWorker(uint32_t* spins) {
+	if (*spins < GC_SPIN_LIMIT) {
+		++*spins;
+		CPU_RELAX();
+	}
+	else {
+		thread_yield();
+	}
+}
+
+static void lockWorker(GCWorker* self) {
+	uint32_t spins = 0;
+	while (!atomic_cas8(&self->lock, 0, 1)) {
+		relaxWorker(&spins);
+	}
+}
+
+static void unlockWorker(GCWorker* self) {
+	atomic_store8(&self->lock, 0);
+}
+
+//half of its own gray objects from the bottom,GC_STEAL_BATCH at most.the others read sharedCount without the lock
+static void shareBatch(GCWorker* self) {
+	uint32_t count = (uint32_t)min((self->count - self->bottom) / 2, GC_STEAL_BATCH);
+
+	lockWorker(self);
+	if (self->sharedCapacity < self->sharedCount + count) {
+		self->sharedCapacity = max(GROW_CAPACITY(self->sharedCapacity), self->sharedCount + count);
+		self->shared = (Obj**)mem_realloc(self->shared, sizeof(Obj*) * self->sharedCapacity);
+		if (self->shared == NULL) exit(1);//realloc failed
+	}
+
+	memcpy(self->shared + self->sharedCount, self->stack + self->bottom, sizeof(Obj*) * count);
+	atomic_store64(&self->sharedCount, self->sharedCount + count);
+	unlockWorker(self);
+	self->bottom += count;
+}
+
+static void pushGray(Obj* object) {
+	if (worker != NULL) {
+		pushStack(&worker->stack, &worker->count, &worker->capacity, object);
+	}
+	else if (vm.gcThreadActive) {
+		mutex_lock(vm.gcMutex);
+		pushStack(&vm.grayStack, &vm.grayCount, &vm.grayCapacity, object);
+		if (vm.gcThreadIdle) condvar_signal(vm.gcWork);
+		mutex_unlock(vm.gcMutex);
+	}
+	else {
+		pushStack(&vm.grayStack, &vm.grayCount, &vm.grayCapacity, object);
+	}
+}
+
+//set the mark bit,false if it was marked.both threads set bits of the byte while the thread marks
+static bool setMark(Obj* object) {
+	if (worker == NULL && !vm.gcThreadActive) {
+		object->isMarked = (object->isMarked & ~OBJ_MARK_BIT) | vm.gcMark;
+		return true;
+	}
+
+	for (;;) {
+		uint8_t bits = atomic_load8(&object->isMarked);
+		if ((bits & OBJ_MARK_BIT) == vm.gcMark) return false;
+		if (atomic_cas8(&object->isMarked, bits, (bits & ~OBJ_MARK_BIT) | vm.gcMark)) return true;
+	}
+}
+
 void markObject(Obj* object)
 {
 	//skip the null and things that don't need mark
 	if (object == NULL) return;
-	//skip marked one
-	if (object->isMarked == vm.gcMark) return;
+	//skip marked one,the thread may be setting other bits
+	uint8_t bits = atomic_load8(&object->isMarked);
+	if ((bits & OBJ_MARK_BIT) == vm.gcMark) return;
+	//the old ones are not traced by a minor collection,the remembered ones are its roots
+	if (vm.gcMinor && (bits & OBJ_OLD_BIT)) return;
 
 	switch (object->type) {
 	case OBJ_FUNCTION:
@@ -87,16 +198,7 @@ void markObject(Obj* object)
 	printValue(OBJ_VAL(object));
 	printf("\n");
 #endif
-	object->isMarked = vm.gcMark;
-
-	if (vm.grayCapacity < vm.grayCount + 1) {
-		vm.grayCapacity = GROW_CAPACITY(vm.grayCapacity);
-		vm.grayStack = (Obj**)mem_realloc(vm.grayStack, sizeof(Obj*) * vm.grayCapacity);
-		//We don’t want growing the gray stack during a GC to cause the GC to recursively start a new GC
-		if (vm.grayStack == NULL) exit(1);//realloc failed
-	}
-
-	vm.grayStack[vm.grayCount++] = object;
+	if (setMark(object)) pushGray(object);
 }
 
 static void blackenObject(Obj* object) {
@@ -109,7 +211,7 @@ static void blackenObject(Obj* object) {
 	switch (object->type) {
 	case OBJ_UPVALUE: {
 		//When an upvalue is closed, it contains a reference to the closed-over value
-		markValue(((ObjUpvalue*)object)->closed);
+		markValue(gc_loadSlot(&((ObjUpvalue*)object)->closed));
 		break;
 	}
 	case OBJ_CLOSURE: {
@@ -117,8 +219,12 @@ static void blackenObject(Obj* object) {
 		//no need
 		//markObject((Obj*)closure->function);
 
+		ObjUpvalue** upvalues = CLOSURE_UPVALUES(closure);
 		for (uint32_t i = 0; i < closure->upvalueCount; i++) {
-			markObject((Obj*)closure->upvalues[i]);
+			markObject((Obj*)upvalues[i]);
+		}
+		for (uint32_t i = 0; i < closure->captureCount; i++) {
+			markValue(gc_loadSlot(&closure->captures[i]));
 		}
 		break;
 	}
@@ -140,7 +246,7 @@ static void blackenObject(Obj* object) {
 	case OBJ_CLASS: {
 		ObjClass* klass = (ObjClass*)object;
 		//markObject((Obj*)klass->name);
-		markValue(klass->initializer);
+		markValue(gc_loadSlot(&klass->initializer));
 		markTable(&klass->methods);
 		break;
 	}
@@ -149,7 +255,16 @@ static void blackenObject(Obj* object) {
 		ObjClass* klass = instance->klass;
 		if (klass != NULL) {
 			markObject((Obj*)klass);
-			markTable(&instance->fields);
+
+			if (INSTANCE_IS_DICTIONARY(instance)) {
+				markTable(&instance->fields);
+			}
+			else {
+				//only the live slots
+				for (uint32_t i = 0; i < instance->shape->slotCount; ++i) {
+					markValue(gc_loadSlot(&instance->slots[i]));
+				}
+			}
 		}
 		break;
 	}
@@ -166,32 +281,547 @@ static void traceReferences() {
 	}
 }
 
-static void sweep() {
-	Obj* previous = NULL;
-	Obj* object = vm.objects;
+static uint64_t objectSize(Obj* object) {
+	switch (object->type) {
+	case OBJ_UPVALUE:
+		return GC_ALIGN(sizeof(ObjUpvalue));
+	case OBJ_CLOSURE: {
+		ObjClosure* closure = (ObjClosure*)object;
+		return GC_ALIGN(CLOSURE_SIZE(closure->upvalueCount, closure->captureCount));
+	}
+	case OBJ_BOUND_METHOD:
+		return GC_ALIGN(sizeof(ObjBoundMethod));
+	case OBJ_CLASS:
+		return GC_ALIGN(sizeof(ObjClass));
+	case OBJ_INSTANCE:
+		return GC_ALIGN(sizeof(ObjInstance));
+	default://string builder and arrays
+		return GC_ALIGN(sizeof(ObjArray));
+	}
+}
+
+//the lines of an old object are not allocated again,marks is lineMarks or sweepMarks of its block
+static void markLines(Obj* object, bool isSweeping) {
+	uint64_t size = objectSize(object);
+	if (size > GC_LARGE_OBJECT) return;
+
+	GCBlock* block = BLOCK_OF(object);
+	uint8_t* marks = isSweeping ? block->sweepMarks : block->lineMarks;
+	uint64_t offset = (uintptr_t)object & (GC_BLOCK_SIZE - 1);
+	uint32_t last = (uint32_t)((offset + size - 1) / GC_LINE_SIZE);
+
+	//the workers of a parallel sweep may mark the same line
+	for (uint32_t line = (uint32_t)(offset / GC_LINE_SIZE); line <= last; ++line) {
+		atomic_store8(&marks[line], 1);
+	}
+}
+
+//into the last segment,a new one when it is full
+static void addSegmented(ObjSegments* list, Obj* object) {
+	if (list->count == 0 || list->segments[list->count - 1].count >= GC_SEGMENT_OBJECTS) {
+		if (list->capacity < list->count + 1) {
+			list->capacity = GROW_CAPACITY(list->capacity);
+			list->segments = (ObjSegment*)mem_realloc(list->segments, sizeof(ObjSegment) * list->capacity);
+			if (list->segments == NULL) exit(1);//realloc failed
+		}
+		list->segments[list->count++] = (ObjSegment){ .first = NULL, .count = 0 };
+	}
+
+	ObjSegment* segment = &list->segments[list->count - 1];
+	OBJ_PTR_SET_NEXT(object, segment->first);
+	segment->first = object;
+	segment->count++;
+}
+
+//free the dead young objects and promote the others
+static void sweepYoung() {
+	Obj* object = vm.youngObjects;
 
 	while (object != NULL) {
-		if (object->isMarked == vm.gcMark) {
-			//object->isMarked = false;//clear the mark
+		Obj* next = OBJ_PTR_GET_NEXT(object);
+
+		if ((object->isMarked & OBJ_MARK_BIT) == vm.gcMark) {
+			//a minor collection doesn't flip the mark,so clear it here
+			object->isMarked = OBJ_OLD_BIT | !vm.gcMark;
+			addSegmented(&vm.objects, object);
+			markLines(object, false);
+		}
+		else {
+			freeObject(object);
+		}
+
+		object = next;
+	}
+
+	vm.youngObjects = NULL;
+	vm.youngBytes = 0;
+}
+
+static void forgetRemembered() {
+	for (uint64_t i = 0; i < vm.rememberedCount; ++i) {
+		vm.remembered[i]->isMarked &= ~OBJ_REMEMBERED_BIT;
+	}
+	vm.rememberedCount = 0;
+}
+
+static GCBlock* newBlock() {
+	GCBlock* block = (GCBlock*)mem_alloc_aligned(GC_BLOCK_SIZE, GC_BLOCK_SIZE);
+	if (block == NULL) {
+		fprintf(stderr, "Memory reallocation failed!\n");
+		exit(1);
+	}
+
+	block->next = NULL;
+	memset(block->lineMarks, 0, GC_LINE_COUNT);
+	memset(block->lineMarks, 1, GC_HEADER_LINES);
+	memcpy(block->sweepMarks, block->lineMarks, GC_LINE_COUNT);
+	return block;
+}
+
+static bool isEmptyBlock(GCBlock* block) {
+	for (uint32_t line = GC_HEADER_LINES; line < GC_LINE_COUNT; ++line) {
+		if (block->lineMarks[line]) return false;
+	}
+	return true;
+}
 
-			previous = object;
-			object = OBJ_PTR_GET_NEXT(object);
+//free the empty blocks after a major collection,but keep those that a nursery fills
+static void releaseBlocks() {
+	uint32_t kept = 0;
+	GCBlock** link = &vm.blocks;
+	while (*link != NULL) {
+		GCBlock* block = *link;
+		if (isEmptyBlock(block) && ++kept > GC_NURSERY_SIZE / GC_BLOCK_SIZE) {
+			*link = block->next;
+			mem_free(block);
 		}
 		else {
-			Obj* unreached = object;
-			object = OBJ_PTR_GET_NEXT(object);
-			if (previous != NULL) {
-				OBJ_PTR_SET_NEXT(previous, object);
+			link = &block->next;
+		}
+	}
+}
+
+//allocate from the first hole again
+static void rewindAllocator() {
+	vm.allocBlock = NULL;
+	vm.allocLine = 0;
+	vm.allocCursor = NULL;
+	vm.allocLimit = NULL;
+}
+
+//the next hole of free lines that size fits in,a new block if there is none
+static void nextHole(uint64_t size) {
+	for (;;) {
+		if (vm.allocBlock == NULL) {
+			if (vm.blocks == NULL) vm.blocks = newBlock();
+			vm.allocBlock = vm.blocks;
+			vm.allocLine = 0;
+		}
+
+		GCBlock* block = vm.allocBlock;
+		uint32_t line = vm.allocLine;
+
+		while (line < GC_LINE_COUNT) {
+			while (line < GC_LINE_COUNT && block->lineMarks[line]) line++;
+			uint32_t end = line;
+			while (end < GC_LINE_COUNT && !block->lineMarks[end]) end++;
+
+			if ((uint64_t)(end - line) * GC_LINE_SIZE >= size) {
+				vm.allocCursor = (uint8_t*)block + (uint64_t)line * GC_LINE_SIZE;
+				vm.allocLimit = (uint8_t*)block + (uint64_t)end * GC_LINE_SIZE;
+				vm.allocLine = end;
+				return;
+			}
+			line = end;
+		}
+
+		if (block->next == NULL) block->next = newBlock();
+		vm.allocBlock = block->next;
+		vm.allocLine = 0;
+	}
+}
+
+//the objects of the marking are swept between the allocations.the mark is flipped first,
+//so the new objects are white and the unreached ones look marked.the live ones take sweepMarks
+static void startSweep() {
+	//nothing the sweep keeps is young
+	forgetRemembered();
+	vm.gcMark = !vm.gcMark;
+	vm.gcPhase = GC_PHASE_SWEEPING;
+
+	//the segments of the last sweep are empty,their buffer takes the kept objects
+	ObjSegments swept = vm.sweepObjects;
+	vm.sweepObjects = vm.objects;
+	vm.sweepSegment = 0;
+	vm.objects = (ObjSegments){ .count = 0, .capacity = swept.capacity, .segments = swept.segments };
+	vm.sweepYoungObjects = vm.youngObjects;
+	vm.youngObjects = NULL;
+	vm.youngBytes = 0;
+	vm.gcStepAt = GC_STEP_SIZE;
+
+	for (GCBlock* block = vm.blocks; block != NULL; block = block->next) {
+		memset(block->sweepMarks + GC_HEADER_LINES, 0, GC_LINE_COUNT - GC_HEADER_LINES);
+	}
+}
+
+//false if it is dead
+static bool keepObject(Obj* object, ObjSegments* kept) {
+	if ((object->isMarked & OBJ_MARK_BIT) == vm.gcMark) return false;
+
+	object->isMarked |= OBJ_OLD_BIT;
+	addSegmented(kept, object);
+	markLines(object, true);
+	return true;
+}
+
+//the next object of the sweep,the old ones first
+static Obj* nextSwept() {
+	while (vm.sweepSegment < vm.sweepObjects.count) {
+		ObjSegment* segment = &vm.sweepObjects.segments[vm.sweepSegment];
+		Obj* object = segment->first;
+		if (object != NULL) {
+			segment->first = OBJ_PTR_GET_NEXT(object);
+			segment->count--;
+			return object;
+		}
+		vm.sweepSegment++;
+	}
+
+	Obj* object = vm.sweepYoungObjects;
+	if (object != NULL) vm.sweepYoungObjects = OBJ_PTR_GET_NEXT(object);
+	return object;
+}
+
+//sweep until the pause target,true when all are swept
+static bool sweepSlice(uint64_t pauseTarget) {
+	uint64_t begin = get_nanoseconds();
+
+	for (;;) {
+		for (uint32_t i = 0; i < GC_SLICE_BATCH; ++i) {
+			Obj* object = nextSwept();
+			if (object == NULL) return true;
+
+			if (!keepObject(object, &vm.objects)) freeObject(object);
+		}
+
+		if (get_nanoseconds() - begin >= pauseTarget) return false;
+	}
+}
+
+//the allocator kept to the old lines while sweeping.now only the lines of the live objects are marked,
+//and the young objects of the sweep are in free lines,so a minor collection promotes them first
+static void finishSweep() {
+	for (GCBlock* block = vm.blocks; block != NULL; block = block->next) {
+		memcpy(block->lineMarks, block->sweepMarks, GC_LINE_COUNT);
+	}
+
+	vm.sweepObjects.count = 0;
+	vm.sweepSegment = 0;
+
+	vm.gcPhase = GC_PHASE_IDLE;
+	vm.nextGC = max(vm.bytesAllocated * GC_HEAP_GROW_FACTOR, vm.beginGC);
+	minorCollect();
+	releaseBlocks();
+}
+
+// ==================== parallel collection ====================
+
+typedef enum {
+	GC_JOB_MARK,
+	GC_JOB_SWEEP,
+} GCJob;
+
+//up to GC_STEAL_BATCH from the top of its own shared objects,no one stole them
+static uint32_t popBatch(GCWorker* self, Obj** batch) {
+	if (atomic_load64(&self->sharedCount) == 0) return 0;
+
+	lockWorker(self);
+	uint32_t count = (uint32_t)min(self->sharedCount - self->sharedBottom, GC_STEAL_BATCH);
+	memcpy(batch, self->shared + self->sharedCount - count, sizeof(Obj*) * count);
+	if (self->sharedCount - count == self->sharedBottom) {
+		self->sharedBottom = 0;
+		atomic_store64(&self->sharedCount, 0);
+	}
+	else {
+		atomic_store64(&self->sharedCount, self->sharedCount - count);
+	}
+	unlockWorker(self);
+	return count;
+}
+
+//half of the shared objects of another worker from the bottom,they are the oldest and lead to the most work
+static uint32_t stealBatch(GCWorker* self, Obj** batch) {
+	for (uint32_t i = 1; i < vm.gcWorkerCount; ++i) {
+		GCWorker* victim = vm.gcWorkers[(self->id + i) % vm.gcWorkerCount];
+		if (atomic_load64(&victim->sharedCount) == 0) continue;
+
+		lockWorker(victim);
+		uint32_t count = (uint32_t)min((victim->sharedCount - victim->sharedBottom + 1) / 2, GC_STEAL_BATCH);
+		memcpy(batch, victim->shared + victim->sharedBottom, sizeof(Obj*) * count);
+		victim->sharedBottom += count;
+		if (victim->sharedBottom == victim->sharedCount) {
+			victim->sharedBottom = 0;
+			atomic_store64(&victim->sharedCount, 0);
+		}
+		unlockWorker(victim);
+
+		if (count > 0) return count;
+	}
+	return 0;
+}
+
+static bool hasGray() {
+	for (uint32_t i = 0; i < vm.gcWorkerCount; ++i) {
+		if (atomic_load64(&vm.gcWorkers[i]->sharedCount) != 0) return true;
+	}
+	return false;
+}
+
+//blacken its own gray objects,share them while another worker is idle and steal more when they run out.
+//only a busy worker has gray objects,so the marking is done when all are idle
+static void markWorker(GCWorker* self) {
+	Obj* batch[GC_STEAL_BATCH];
+
+	for (;;) {
+		while (self->count > self->bottom) {
+			blackenObject(self->stack[--self->count]);
+
+			if (self->count - self->bottom > GC_STEAL_BATCH && atomic_load32(&vm.gcIdleWorkers) > 0
+				&& atomic_load64(&self->sharedCount) == 0) {
+				shareBatch(self);
+			}
+		}
+		self->count = 0;
+		self->bottom = 0;
+
+		uint32_t count = popBatch(self, batch);
+		if (count == 0) count = stealBatch(self, batch);
+
+		if (count > 0) {
+			for (uint32_t i = 0; i < count; ++i) {
+				pushStack(&self->stack, &self->count, &self->capacity, batch[i]);
+			}
+			continue;
+		}
+
+		atomic_add32(&vm.gcIdleWorkers, 1);
+		uint32_t spins = 0;
+		for (;;) {
+			if (atomic_load32(&vm.gcIdleWorkers) == vm.gcWorkerCount) return;
+			if (hasGray()) break;
+			relaxWorker(&spins);
+		}
+		atomic_add32(&vm.gcIdleWorkers, (uint32_t)-1);
+	}
+}
+
+//the young objects are the first unit,they may be many more than a segment
+static void sweepWorker(GCWorker* self) {
+	for (;;) {
+		uint32_t unit = atomic_add32(&vm.gcSweepNext, 1);
+		if (unit > vm.sweepObjects.count) return;
+
+		Obj* object = (unit == 0) ? vm.sweepYoungObjects : vm.sweepObjects.segments[unit - 1].first;
+		while (object != NULL) {
+			Obj* next = OBJ_PTR_GET_NEXT(object);
+
+			if (keepObject(object, &self->kept)) {
+				object = next;
+				continue;
+			}
+
+			if (object->type == OBJ_CLASS) {
+				//freeing it changes vm.methodCacheEpoch
+				OBJ_PTR_SET_NEXT(object, self->classes);
+				self->classes = object;
 			}
 			else {
-				vm.objects = object;
+				freeObject(object);
 			}
 
-			freeObject(unreached);
+			object = next;
 		}
 	}
 }
 
+static void runJob(GCWorker* self, GCJob job) {
+	switch (job) {
+	case GC_JOB_MARK:
+		markWorker(self);
+		break;
+	case GC_JOB_SWEEP:
+		sweepWorker(self);
+		break;
+	}
+}
+
+static void workerMain(void* arg) {
+	GCWorker* self = (GCWorker*)arg;
+	worker = self;
+	allocatedBytes = &self->bytes;
+	uint32_t epoch = 0;
+
+	mutex_lock(vm.gcPoolMutex);
+	for (;;) {
+		while (!vm.gcPoolExit && vm.gcJobEpoch == epoch) {
+			condvar_wait(vm.gcPoolWork, vm.gcPoolMutex);
+		}
+		if (vm.gcPoolExit) break;
+
+		epoch = vm.gcJobEpoch;
+		GCJob job = (GCJob)vm.gcJob;
+		mutex_unlock(vm.gcPoolMutex);
+		runJob(self, job);
+		mutex_lock(vm.gcPoolMutex);
+
+		if (--vm.gcBusyWorkers == 0) condvar_signal(vm.gcPoolDone);
+	}
+	mutex_unlock(vm.gcPoolMutex);
+}
+
+//the script's thread is the first worker,it returns when all are done
+static void runWorkers(GCJob job) {
+	mutex_lock(vm.gcPoolMutex);
+	vm.gcJob = job;
+	vm.gcJobEpoch++;
+	vm.gcBusyWorkers = vm.gcWorkerCount - 1;
+	condvar_broadcast(vm.gcPoolWork);
+	mutex_unlock(vm.gcPoolMutex);
+
+	runJob(vm.gcWorkers[0], job);
+
+	mutex_lock(vm.gcPoolMutex);
+	while (vm.gcBusyWorkers != 0) {
+		condvar_wait(vm.gcPoolDone, vm.gcPoolMutex);
+	}
+	mutex_unlock(vm.gcPoolMutex);
+}
+
+//the gray objects of the roots are dealt to the workers
+static void markParallel() {
+	for (uint64_t i = 0; i < vm.grayCount; ++i) {
+		GCWorker* self = vm.gcWorkers[i % vm.gcWorkerCount];
+		pushStack(&self->stack, &self->count, &self->capacity, vm.grayStack[i]);
+	}
+	vm.grayCount = 0;
+	vm.gcIdleWorkers = 0;
+
+	//the mark bits are set by more than one thread
+	worker = vm.gcWorkers[0];
+	runWorkers(GC_JOB_MARK);
+	worker = NULL;
+}
+
+//the kept segments of the workers join vm.objects,the script frees the dead classes
+static void sweepParallel() {
+	vm.gcSweepNext = 0;
+	runWorkers(GC_JOB_SWEEP);
+
+	for (uint32_t i = 0; i < vm.gcWorkerCount; ++i) {
+		GCWorker* self = vm.gcWorkers[i];
+
+		for (uint32_t j = 0; j < self->kept.count; ++j) {
+			if (vm.objects.capacity < vm.objects.count + 1) {
+				vm.objects.capacity = GROW_CAPACITY(vm.objects.capacity);
+				vm.objects.segments = (ObjSegment*)mem_realloc(vm.objects.segments, sizeof(ObjSegment) * vm.objects.capacity);
+				if (vm.objects.segments == NULL) exit(1);//realloc failed
+			}
+			vm.objects.segments[vm.objects.count++] = self->kept.segments[j];
+		}
+		self->kept.count = 0;
+
+		vm.bytesAllocated += self->bytes;
+		self->bytes = 0;
+
+		while (self->classes != NULL) {
+			Obj* next = OBJ_PTR_GET_NEXT(self->classes);
+			freeObject(self->classes);
+			self->classes = next;
+		}
+	}
+
+	for (uint32_t i = 0; i < vm.sweepObjects.count; ++i) {
+		vm.sweepObjects.segments[i].first = NULL;
+		vm.sweepObjects.segments[i].count = 0;
+	}
+	vm.sweepSegment = vm.sweepObjects.count;
+	vm.sweepYoungObjects = NULL;
+}
+
+static void traceAll() {
+	if (vm.gcWorkerCount > 1) {
+		markParallel();
+	}
+	else {
+		traceReferences();
+	}
+}
+
+static void sweepAll() {
+	if (vm.gcWorkerCount > 1) {
+		sweepParallel();
+	}
+	else {
+		sweepSlice(UINT64_MAX);
+	}
+}
+
+void gc_startWorkers(uint32_t count)
+{
+	vm.gcWorkerCount = max(count, 1);
+	vm.gcWorkers = (GCWorker**)mem_alloc(sizeof(GCWorker*) * vm.gcWorkerCount);
+	vm.gcPoolMutex = mutex_new();
+	vm.gcPoolWork = condvar_new();
+	vm.gcPoolDone = condvar_new();
+	vm.gcJobEpoch = 0;
+	vm.gcBusyWorkers = 0;
+	vm.gcPoolExit = false;
+
+	for (uint32_t i = 0; i < vm.gcWorkerCount; ++i) {
+		//a cache line each,they are locked by different threads
+		GCWorker* self = (GCWorker*)mem_alloc_aligned((sizeof(GCWorker) + 63) & ~(uint64_t)63, 64);
+		if (self == NULL) exit(1);
+		memset(self, 0, sizeof(GCWorker));
+		self->id = i;
+		vm.gcWorkers[i] = self;
+	}
+
+	for (uint32_t i = 1; i < vm.gcWorkerCount; ++i) {
+		vm.gcWorkers[i]->thread = thread_start(workerMain, vm.gcWorkers[i]);
+	}
+}
+
+void gc_stopWorkers()
+{
+	if (vm.gcWorkers == NULL) return;
+
+	mutex_lock(vm.gcPoolMutex);
+	vm.gcPoolExit = true;
+	condvar_broadcast(vm.gcPoolWork);
+	mutex_unlock(vm.gcPoolMutex);
+
+	for (uint32_t i = 0; i < vm.gcWorkerCount; ++i) {
+		GCWorker* self = vm.gcWorkers[i];
+		if (self->thread != NULL) thread_join(self->thread);
+		if (self->stack != NULL) mem_free(self->stack);
+		if (self->shared != NULL) mem_free(self->shared);
+		if (self->kept.segments != NULL) mem_free(self->kept.segments);
+		mem_free(self);
+	}
+
+	mem_free(vm.gcWorkers);
+	mutex_free(vm.gcPoolMutex);
+	condvar_free(vm.gcPoolWork);
+	condvar_free(vm.gcPoolDone);
+	vm.gcWorkers = NULL;
+	vm.gcWorkerCount = 1;
+	vm.gcPoolMutex = NULL;
+	vm.gcPoolWork = NULL;
+	vm.gcPoolDone = NULL;
+}
+
+static void pauseThread();
+
 void garbageCollect()
 {
 #if DEBUG_LOG_GC
@@ -202,20 +832,25 @@ void garbageCollect()
 	uint64_t time_gc = get_nanoseconds();
 	uint64_t before = vm.bytesAllocated;
 #endif
+	if (vm.gcThreadActive) pauseThread();
+	//the sweep of the last marking goes first
+	if (vm.gcPhase == GC_PHASE_SWEEPING) {
+		sweepAll();
+		finishSweep();
+	}
+
 	//mark the state
 	vm.gcWorking = 1;
 
+	//the roots again if it was marking,they have no barriers
 	markRoots();
-	traceReferences();
-	//tableRemoveWhite(&vm.strings);
-	sweep();
+	traceAll();
+	startSweep();
+	sweepAll();
 
-	//reset the limit
-	vm.nextGC = max(vm.bytesAllocated * GC_HEAP_GROW_FACTOR, vm.beginGC);
-	//flip the mark
-	vm.gcMark = !vm.gcMark;
 	//mark the state
 	vm.gcWorking = 0;
+	finishSweep();
 
 #if DEBUG_LOG_GC
 	printf("-- gc end\n");
@@ -228,6 +863,441 @@ void garbageCollect()
 #endif
 }
 
+static void startMarking();
+static void activateThread();
+
+void minorCollect()
+{
+#if DEBUG_LOG_GC
+	printf("-- minor gc begin\n");
+#endif
+
+#if DEBUG_LOG_GC || LOG_GC_RESULT
+	uint64_t time_gc = get_nanoseconds();
+	uint64_t before = vm.bytesAllocated;
+	uint64_t young = vm.youngBytes;
+#endif
+	vm.gcWorking = 1;
+	vm.gcMinor = 1;
+
+	markRoots();
+	//the old objects that got young ones,they are not marked
+	for (uint64_t i = 0; i < vm.rememberedCount; ++i) {
+		Obj* owner = vm.remembered[i];
+		owner->isMarked &= ~OBJ_REMEMBERED_BIT;
+		blackenObject(owner);
+	}
+	vm.rememberedCount = 0;
+	traceReferences();
+	sweepYoung();
+	rewindAllocator();
+
+	vm.gcMinor = 0;
+	vm.gcWorking = 0;
+
+#if DEBUG_LOG_GC
+	printf("-- minor gc end\n");
+#endif
+
+#if DEBUG_LOG_GC || LOG_GC_RESULT
+	double time_ms = (get_nanoseconds() - time_gc) * 1e-6;
+	printf("[gc] minor collected %zu of %zu young bytes (to %zu), in %g ms\n",
+		before - vm.bytesAllocated, young, vm.bytesAllocated, time_ms);
+#endif
+
+	//the promoted objects only leave with a major collection
+	if (vm.bytesAllocated > vm.nextGC) {
+		if (vm.gcPauseTarget == 0) {
+			garbageCollect();
+		}
+		else {
+			startMarking();
+		}
+	}
+}
+
+static void startMarking() {
+#if DEBUG_LOG_GC
+	printf("-- marking begin\n");
+#endif
+
+#if DEBUG_LOG_GC || LOG_GC_RESULT
+	uint64_t time_gc = get_nanoseconds();
+#endif
+	//nothing is young after the minor collection,the new objects are white
+	vm.gcPhase = GC_PHASE_MARKING;
+	markRoots();
+	vm.gcStepAt = vm.youngBytes + GC_STEP_SIZE;
+	if (vm.config.gcThread && vm.gcLockDepth == 0) activateThread();
+
+#if DEBUG_LOG_GC || LOG_GC_RESULT
+	printf("[gc] marking roots, in %g ms\n", (get_nanoseconds() - time_gc) * 1e-6);
+#endif
+}
+
+//the roots again,they have no barriers.then the sweep starts
+static void finishMarking() {
+	markRoots();
+	traceReferences();
+	startSweep();
+}
+
+//blacken the gray objects until the pause target.the last slice finishes the marking
+static void markSlice() {
+#if DEBUG_LOG_GC || LOG_GC_RESULT
+	uint64_t time_gc = get_nanoseconds();
+	uint64_t grayCount = vm.grayCount;
+#endif
+	vm.gcWorking = 1;
+
+#if DEBUG_STRESS_GC
+	//one object at a time,so the barriers are tested
+	if (vm.grayCount > 0) {
+		blackenObject(vm.grayStack[--vm.grayCount]);
+	}
+#else
+	uint64_t begin = get_nanoseconds();
+	do {
+		for (uint32_t i = 0; i < GC_SLICE_BATCH && vm.grayCount > 0; ++i) {
+			blackenObject(vm.grayStack[--vm.grayCount]);
+		}
+	} while (vm.grayCount > 0 && get_nanoseconds() - begin < vm.gcPauseTarget);
+#endif
+
+	if (vm.grayCount == 0) {
+		finishMarking();
+	}
+
+	vm.gcWorking = 0;
+	vm.gcStepAt = vm.youngBytes + GC_STEP_SIZE;
+
+#if DEBUG_LOG_GC || LOG_GC_RESULT
+	printf("[gc] marking slice of %zu gray objects (%zu left), in %g ms\n",
+		grayCount, vm.grayCount, (get_nanoseconds() - time_gc) * 1e-6);
+#endif
+}
+
+// ==================== marking thread ====================
+
+//only these change their layout,the thread scans them holding the lock bit
+static bool hasLayout(Obj* object) {
+	return object->type == OBJ_ARRAY || object->type == OBJ_INSTANCE || object->type == OBJ_CLASS;
+}
+
+//false if the script stops the thread while it waits,the script may be inside the layout change
+static bool lockScan(Obj* object) {
+	for (;;) {
+		uint8_t bits = atomic_load8(&object->isMarked);
+		if (!(bits & OBJ_LOCK_BIT) && atomic_cas8(&object->isMarked, bits, bits | OBJ_LOCK_BIT)) return true;
+		if (!atomic_load8(&vm.gcThreadActive)) return false;
+		CPU_RELAX();
+	}
+}
+
+//give the gray objects of the thread back to vm.grayStack
+static void spillWorker(GCWorker* self) {
+	mutex_lock(vm.gcMutex);
+	while (self->count > 0) {
+		pushStack(&vm.grayStack, &vm.grayCount, &vm.grayCapacity, self->stack[--self->count]);
+	}
+	mutex_unlock(vm.gcMutex);
+}
+
+static void drainWorker(GCWorker* self) {
+	while (self->count > 0) {
+		for (uint32_t i = 0; i < GC_SLICE_BATCH && self->count > 0; ++i) {
+			Obj* object = self->stack[self->count - 1];
+			bool isLocked = hasLayout(object);
+			if (isLocked && !lockScan(object)) break;
+
+			self->count--;
+			blackenObject(object);
+			if (isLocked) atomic_and8(&object->isMarked, (uint8_t)~OBJ_LOCK_BIT);
+		}
+
+		if (!atomic_load8(&vm.gcThreadActive)) {
+			spillWorker(self);
+			return;
+		}
+	}
+}
+
+//takes the gray objects the script pushes in batches and blackens them with its own stack
+static void threadMain(void* arg) {
+	(void)arg;
+	GCWorker self = { .count = 0, .capacity = 0, .stack = NULL };
+	worker = &self;
+
+	mutex_lock(vm.gcMutex);
+	for (;;) {
+		while (!vm.gcThreadExit && !(vm.gcThreadActive && vm.grayCount > 0)) {
+			vm.gcThreadIdle = 1;
+			condvar_broadcast(vm.gcIdle);
+			condvar_wait(vm.gcWork, vm.gcMutex);
+		}
+		if (vm.gcThreadExit) break;
+
+		vm.gcThreadIdle = 0;
+		uint64_t count = min(vm.grayCount, GC_SLICE_BATCH);
+		for (uint64_t i = 0; i < count; ++i) {
+			pushStack(&self.stack, &self.count, &self.capacity, vm.grayStack[--vm.grayCount]);
+		}
+
+		mutex_unlock(vm.gcMutex);
+		drainWorker(&self);
+		mutex_lock(vm.gcMutex);
+	}
+	mutex_unlock(vm.gcMutex);
+
+	if (self.stack != NULL) mem_free(self.stack);
+}
+
+//only outside the layout changes,the script may have started one without the lock bit
+static void activateThread() {
+	mutex_lock(vm.gcMutex);
+	vm.gcThreadActive = 1;
+	condvar_signal(vm.gcWork);
+	mutex_unlock(vm.gcMutex);
+}
+
+//the script marks alone after it,the gray objects of the thread are in vm.grayStack
+static void pauseThread() {
+	mutex_lock(vm.gcMutex);
+	vm.gcThreadActive = 0;
+	while (!vm.gcThreadIdle) {
+		condvar_wait(vm.gcIdle, vm.gcMutex);
+	}
+	mutex_unlock(vm.gcMutex);
+}
+
+//the step of the script while the thread marks: start it,or finish the marking when it is idle.
+//false if the script must mark a slice itself
+static bool threadStep() {
+	if (!vm.gcThreadActive) {
+		if (vm.gcLockDepth != 0) return false;
+		activateThread();
+		return true;
+	}
+
+	mutex_lock(vm.gcMutex);
+	bool isDone = vm.gcThreadIdle && vm.grayCount == 0;
+	if (isDone) vm.gcThreadActive = 0;
+	mutex_unlock(vm.gcMutex);
+
+	if (isDone) {
+#if DEBUG_LOG_GC || LOG_GC_RESULT
+		uint64_t time_gc = get_nanoseconds();
+#endif
+		vm.gcWorking = 1;
+		finishMarking();
+		vm.gcWorking = 0;
+
+#if DEBUG_LOG_GC || LOG_GC_RESULT
+		printf("[gc] marking finished by the thread, in %g ms\n", (get_nanoseconds() - time_gc) * 1e-6);
+#endif
+	}
+	return true;
+}
+
+void gc_startThread()
+{
+	vm.gcMutex = mutex_new();
+	vm.gcWork = condvar_new();
+	vm.gcIdle = condvar_new();
+	vm.gcThreadActive = 0;
+	vm.gcThreadIdle = 0;
+	vm.gcThreadExit = 0;
+	vm.gcThread = thread_start(threadMain, NULL);
+}
+
+void gc_stopThread()
+{
+	if (vm.gcThread == NULL) return;
+
+	mutex_lock(vm.gcMutex);
+	vm.gcThreadExit = 1;
+	vm.gcThreadActive = 0;
+	condvar_signal(vm.gcWork);
+	mutex_unlock(vm.gcMutex);
+
+	thread_join(vm.gcThread);
+	mutex_free(vm.gcMutex);
+	condvar_free(vm.gcWork);
+	condvar_free(vm.gcIdle);
+	vm.gcThread = NULL;
+	vm.gcMutex = NULL;
+	vm.gcWork = NULL;
+	vm.gcIdle = NULL;
+}
+
+void gc_lock(Obj* object)
+{
+	for (;;) {
+		uint8_t bits = atomic_load8(&object->isMarked);
+		if (!(bits & OBJ_LOCK_BIT) && atomic_cas8(&object->isMarked, bits, bits | OBJ_LOCK_BIT)) return;
+		CPU_RELAX();
+	}
+}
+
+void gc_unlock(Obj* object)
+{
+	atomic_and8(&object->isMarked, (uint8_t)~OBJ_LOCK_BIT);
+}
+
+static void sweepStep() {
+#if DEBUG_LOG_GC || LOG_GC_RESULT
+	uint64_t time_gc = get_nanoseconds();
+	uint64_t before = vm.bytesAllocated;
+#endif
+	vm.gcWorking = 1;
+
+#if DEBUG_STRESS_GC
+	bool isDone = sweepSlice(0);
+#else
+	bool isDone = sweepSlice(vm.gcPauseTarget);
+#endif
+
+	vm.gcWorking = 0;
+	vm.gcStepAt = vm.youngBytes + GC_STEP_SIZE;
+
+#if DEBUG_LOG_GC || LOG_GC_RESULT
+	printf("[gc] sweeping slice freed %zu bytes, in %g ms\n",
+		before - vm.bytesAllocated, (get_nanoseconds() - time_gc) * 1e-6);
+#endif
+
+	if (isDone) finishSweep();
+}
+
+void gc_step()
+{
+	switch (vm.gcPhase) {
+	case GC_PHASE_MARKING:
+		if (vm.config.gcThread && threadStep()) {
+			vm.gcStepAt = vm.youngBytes + GC_STEP_SIZE;
+		}
+		else {
+			markSlice();
+		}
+		return;
+	case GC_PHASE_SWEEPING:
+		sweepStep();
+		return;
+	}
+
+	minorCollect();
+#if DEBUG_STRESS_GC
+	if (vm.gcPhase == GC_PHASE_IDLE && vm.gcPauseTarget != 0) startMarking();
+#endif
+}
+
+HOT_FUNCTION
+Obj* gc_allocate(uint64_t size)
+{
+	size = GC_ALIGN(size);
+
+	if (size > GC_LARGE_OBJECT) {
+		return (Obj*)reallocate(NULL, 0, size);
+	}
+
+	gc_allocated(size);
+
+	if ((uint64_t)(vm.allocLimit - vm.allocCursor) < size) {
+		nextHole(size);
+	}
+
+	Obj* object = (Obj*)vm.allocCursor;
+	vm.allocCursor += size;
+	vm.bytesAllocated += size;
+	return object;
+}
+
+void gc_release(Obj* object, uint64_t size)
+{
+	size = GC_ALIGN(size);
+
+	if (size > GC_LARGE_OBJECT) {
+		reallocate(object, size, 0);
+	}
+	else {
+		//its lines are free when no old object is in them
+		*allocatedBytes -= size;
+	}
+}
+
+void gc_freeBlocks()
+{
+	GCBlock* block = vm.blocks;
+	while (block != NULL) {
+		GCBlock* next = block->next;
+		mem_free(block);
+		block = next;
+	}
+
+	vm.blocks = NULL;
+	rewindAllocator();
+}
+
+void gc_remember(Obj* owner)
+{
+	if (atomic_load8(&owner->isMarked) & OBJ_REMEMBERED_BIT) return;
+	if (vm.gcThreadActive) {
+		atomic_or8(&owner->isMarked, OBJ_REMEMBERED_BIT);
+	}
+	else {
+		owner->isMarked |= OBJ_REMEMBERED_BIT;
+	}
+
+	if (vm.rememberedCapacity < vm.rememberedCount + 1) {
+		vm.rememberedCapacity = GROW_CAPACITY(vm.rememberedCapacity);
+		vm.remembered = (Obj**)mem_realloc(vm.remembered, sizeof(Obj*) * vm.rememberedCapacity);
+		//a barrier never starts a collection
+		if (vm.remembered == NULL) exit(1);//realloc failed
+	}
+
+	vm.remembered[vm.rememberedCount++] = owner;
+}
+
+void gc_barrier(Obj* owner, Obj* value)
+{
+	//the swept objects are promoted one by one,so any owner may be old before the next minor collection
+	//the thread may be setting the mark bits of both
+	uint8_t bits = atomic_load8(&owner->isMarked);
+	if (((bits & OBJ_OLD_BIT) || vm.gcPhase == GC_PHASE_SWEEPING) && !(atomic_load8(&value->isMarked) & OBJ_OLD_BIT)) {
+		gc_remember(owner);
+	}
+
+	//the thread may be scanning owner,so the stored object is always shaded
+	if (vm.gcPhase == GC_PHASE_MARKING && (vm.gcThreadActive || (bits & OBJ_MARK_BIT) == vm.gcMark)) {
+		markObject(value);
+	}
+}
+
+void gc_barrierAll(Obj* owner)
+{
+	uint8_t bits = atomic_load8(&owner->isMarked);
+	if ((bits & OBJ_OLD_BIT) || vm.gcPhase == GC_PHASE_SWEEPING) {
+		gc_remember(owner);
+	}
+
+	if (vm.gcPhase == GC_PHASE_MARKING) {
+		if (vm.gcThreadActive) {
+			//scanned again after the stores
+			setMark(owner);
+			pushGray(owner);
+		}
+		else if ((bits & OBJ_MARK_BIT) == vm.gcMark) {
+			pushGray(owner);
+		}
+	}
+}
+
+void gc_barrierValue(Obj* owner, Value value)
+{
+	if (IS_OBJ(value)) {
+		gc_barrier(owner, AS_OBJ(value));
+	}
+}
+
 void changeNextGC(uint64_t newSize)
 {
 	vm.nextGC = newSize;
@@ -236,4 +1306,9 @@ void changeNextGC(uint64_t newSize)
 void changeBeginGC(uint64_t newSize)
 {
 	vm.beginGC = newSize;
+}
+
+void changePauseTarget(uint64_t nanoseconds)
+{
+	vm.gcPauseTarget = nanoseconds;
 }
\ No newline at end of file
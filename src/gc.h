@@ -6,12 +6,132 @@
 #pragma once
 #include "common.h"
 #include "value.h"
+#include "object.h"
+#include "vm.h"
 
 #define GC_HEAP_GROW_FACTOR 2
 #define GC_HEAP_BEGIN 1024 * 1024
 
+//the gc objects are bump allocated in the free lines of aligned blocks,they never move.
+//a line is free when no old object is in it,the young objects fill the holes between the old ones
+#define GC_BLOCK_SIZE (32 * 1024)
+#define GC_LINE_SIZE 128
+#define GC_LINE_COUNT (GC_BLOCK_SIZE / GC_LINE_SIZE)
+//larger objects are allocated alone
+#define GC_LARGE_OBJECT (GC_BLOCK_SIZE / 4)
+//bytes allocated,the objects and their buffers,that start a minor collection
+#define GC_NURSERY_SIZE (2 * 1024 * 1024)
+
+//a major collection marks and then sweeps incrementally,a slice after each step of allocation.
+//the minor collections wait until it is done,the young objects are white and found by the last slice
+#define GC_STEP_SIZE (256 * 1024)
+//default of @sys.gcPause,in nanoseconds
+#define GC_PAUSE_TARGET (1000 * 1000)
+//objects blackened or swept between the checks of the clock
+#define GC_SLICE_BATCH 256
+
+//the script stores the slots with plain 8 byte stores while --gc-thread reads them,only x86-64 keeps them whole
+#if NAN_BOXING && (defined(__x86_64__) || defined(_M_X64))
+#define GC_THREAD_AVAILABLE 1
+#else
+#define GC_THREAD_AVAILABLE 0
+#endif
+
+//objects in a segment of vm.objects,the unit of a parallel sweep
+#define GC_SEGMENT_OBJECTS 4096
+//gray objects a worker of a parallel marking takes from a stack at once,half of another one's at most
+#define GC_STEAL_BATCH 64
+//pauses a waiting worker spins before it yields,the one it waits for may need its processor
+#define GC_SPIN_LIMIT 128
+
+//vm.gcPhase
+typedef enum {
+	GC_PHASE_IDLE,
+	GC_PHASE_MARKING,	//the barriers shade the stored objects
+	GC_PHASE_SWEEPING,	//the objects are promoted as they are swept,the barriers remember any owner
+} GCPhase;
+
+struct GCBlock {
+	struct GCBlock* next;
+	uint8_t lineMarks[GC_LINE_COUNT];	//lines with old objects
+	uint8_t sweepMarks[GC_LINE_COUNT];	//lines with the objects a sweep kept,they replace lineMarks after it
+};
+
+//lines taken by the header at the start of a block
+#define GC_HEADER_LINES ((sizeof(GCBlock) + GC_LINE_SIZE - 1) / GC_LINE_SIZE)
+
 void markObject(Obj* object);
 void markValue(Value value);
+//major collection,all objects.it finishes the incremental one if it is running
 void garbageCollect();
+//a slice of the incremental marking or sweep,or a minor collection
+void gc_step();
+//minor collection,the young objects reached from the roots and the remembered ones
+void minorCollect();
 void changeNextGC(uint64_t newSize);
-void changeBeginGC(uint64_t newSize);
\ No newline at end of file
+void changeBeginGC(uint64_t newSize);
+void changePauseTarget(uint64_t nanoseconds);
+//the marking thread of --gc-thread
+void gc_startThread();
+void gc_stopThread();
+//the workers of --gc-threads,count includes the script's thread
+void gc_startWorkers(uint32_t count);
+void gc_stopWorkers();
+
+//a slot the marking thread may read while the script stores to it
+static inline Value gc_loadSlot(Value* slot) {
+#if NAN_BOXING
+	return (Value)atomic_loadRelaxed64((volatile uint64_t*)slot);
+#else
+	return *slot;
+#endif
+}
+
+//the collection work owed by the allocations,before newBytes more are taken
+static inline void gc_allocated(uint64_t newBytes) {
+	vm.youngBytes += newBytes;
+#if DEBUG_STRESS_GC
+	gc_step();
+#else
+	if (vm.youngBytes >= (vm.gcPhase != GC_PHASE_IDLE ? vm.gcStepAt : GC_NURSERY_SIZE)) gc_step();
+#endif
+}
+//memory of a gc object,it may collect first
+Obj* gc_allocate(uint64_t size);
+//free the memory of a gc object,its buffers are freed by freeObject
+void gc_release(Obj* object, uint64_t size);
+void gc_freeBlocks();
+
+void gc_remember(Obj* owner);
+void gc_barrier(Obj* owner, Obj* value);
+void gc_barrierAll(Obj* owner);
+//the barrier of the machine code,called when owner is old or a major collection is running
+void gc_barrierValue(Obj* owner, Value value);
+
+void gc_lock(Obj* object);
+void gc_unlock(Obj* object);
+
+//around a change of the layout of an array,an instance or a class: the length and buffer of the elements,
+//the shape and slots,or a table.the marking thread scans them holding the same lock bit
+static inline void gc_lockLayout(Obj* object) {
+	vm.gcLockDepth++;
+	if (vm.gcThreadActive) gc_lock(object);
+}
+
+static inline void gc_unlockLayout(Obj* object) {
+	vm.gcLockDepth--;
+	if (object->isMarked & OBJ_LOCK_BIT) gc_unlock(object);
+}
+
+//call it after value is stored in owner.an old owner of a young object is traced by the minor collections,
+//and a white object stored in a marked one is shaded while marking (dijkstra)
+static inline void gc_writeBarrier(Obj* owner, Value value) {
+	if (IS_OBJ(value) && ((owner->isMarked & OBJ_OLD_BIT) || vm.gcPhase != GC_PHASE_IDLE)) {
+		gc_barrier(owner, AS_OBJ(value));
+	}
+}
+
+//for stores of many values,like a table or the captures of a closure.a marked owner is gray again
+static inline void gc_writeBarrierAll(Obj* owner) {
+	if ((owner->isMarked & OBJ_OLD_BIT) || vm.gcPhase != GC_PHASE_IDLE) gc_barrierAll(owner);
+}
@@ -0,0 +1,1046 @@
+/*
+ * MIT License
+ * Copyright (c) 2025 IMSDcrueoft (https://github.com/IMSDcrueoft)
+ * See LICENSE file in the root directory for full license text.
+*/
+#include "jit.h"
+
+#if JIT_AVAILABLE
+#include "memory.h"
+#include "gc.h"
+
+//the templates build bool from the flags,and array commonds check two types at once
+_Static_assert(TRUE_VAL == (FALSE_VAL | 1), "TRUE_VAL must be FALSE_VAL | 1");
+_Static_assert(OBJ_ARRAY_F64 == OBJ_ARRAY + 1, "OBJ_ARRAY_F64 must follow OBJ_ARRAY");
+_Static_assert(sizeof(Entry) == 16, "Entry must be 16 bytes");
+
+//kept by the native code,all callee saved
+#define REG_TOP		RBX		//vm stack top
+#define REG_SLOTS	R12		//frame->slots
+#define REG_FRAME	R13		//the running CallFrame
+#define REG_VM		R14		//&vm
+#define REG_QNAN	R15		//QNAN,number check
+#define REG_TAG		RBP		//SIGN_BIT | QNAN,object check
+
+//the order of OP_ADD..OP_MODULUS,every family of arithmetic commonds keeps it
+static const uint8_t arithmeticOps[] = { SSE_ADD, SSE_SUB, SSE_MUL, SSE_DIV, SSE_MOD };
+
+typedef struct {
+	uint32_t codeOffset;	//the rel32 to patch
+	uint32_t target;		//bytecode offset
+} JitFixup;
+
+typedef struct {
+	uint32_t count;
+	uint32_t capacity;
+	JitFixup* fixups;
+} JitFixupArray;
+
+typedef struct {
+	ObjFunction* function;
+	uint8_t* bytecode;
+	uint32_t bytecodeCount;
+
+	//native code being emitted
+	X64Code code;
+
+	//bytecode offset -> code offset,for all commonds
+	uint32_t* positions;
+	//bytecode offset -> code offset,JIT_NO_ENTRY if the commond only exits
+	uint32_t* entries;
+	//bytecode offset -> code offset of the exit stub,0 if not emitted
+	uint32_t* exitStubs;
+
+	JitFixupArray jumps;	//jump to a commond
+	JitFixupArray exits;	//jump to the exit stub of a commond
+
+	uint32_t exitCommon;	//stores ip(rax) and stack top,then returns JIT_EXIT
+	uint32_t epilogue;		//returns eax
+} JitBuilder;
+
+static void fixupArray_push(JitFixupArray* array, uint32_t codeOffset, uint32_t target) {
+	if (array->count == array->capacity) {
+		uint32_t oldCapacity = array->capacity;
+		array->capacity = GROW_CAPACITY(oldCapacity);
+		array->fixups = GROW_ARRAY_NO_GC(JitFixup, array->fixups, oldCapacity, array->capacity);
+	}
+	array->fixups[array->count++] = (JitFixup){ .codeOffset = codeOffset, .target = target };
+}
+
+static void fixupArray_free(JitFixupArray* array) {
+	FREE_ARRAY_NO_GC(JitFixup, array->fixups, array->capacity);
+}
+
+//call a C function,vm.stackTop is stored first because it may gc
+static void emitCall(JitBuilder* builder, uintptr_t function) {
+	x64_store(&builder->code, REG_VM, offsetof(VM, stackTop), REG_TOP);
+	x64_call(&builder->code, function);
+}
+
+// ==================== vm templates ====================
+
+//leave to the interpreter at the commond,it runs the commond again
+static void emitExitIf(JitBuilder* builder, Condition cc, uint32_t offset) {
+	fixupArray_push(&builder->exits, x64_jcc(&builder->code, cc), offset);
+}
+
+static void emitExit(JitBuilder* builder, uint32_t offset) {
+	fixupArray_push(&builder->exits, x64_jmp(&builder->code), offset);
+}
+
+static void emitJumpTo(JitBuilder* builder, uint32_t target) {
+	fixupArray_push(&builder->jumps, x64_jmp(&builder->code), target);
+}
+
+static void emitJumpToIf(JitBuilder* builder, Condition cc, uint32_t target) {
+	fixupArray_push(&builder->jumps, x64_jcc(&builder->code, cc), target);
+}
+
+//stackTop[-distance]
+static void emitLoadStack(JitBuilder* builder, Register dst, int32_t distance) {
+	x64_load(&builder->code, dst, REG_TOP, -distance * (int32_t)sizeof(Value));
+}
+
+static void emitStoreStack(JitBuilder* builder, int32_t distance, Register src) {
+	x64_store(&builder->code, REG_TOP, -distance * (int32_t)sizeof(Value), src);
+}
+
+static void emitLoadLocal(JitBuilder* builder, Register dst, uint32_t slot) {
+	x64_load(&builder->code, dst, REG_SLOTS, (int32_t)(slot * sizeof(Value)));
+}
+
+static void emitStoreLocal(JitBuilder* builder, uint32_t slot, Register src) {
+	x64_store(&builder->code, REG_SLOTS, (int32_t)(slot * sizeof(Value)), src);
+}
+
+static void emitDrop(JitBuilder* builder, uint32_t count) {
+	if (count != 0) x64_opImmediate(&builder->code, X86_EXT_SUB, REG_TOP, (int32_t)(count * sizeof(Value)));
+}
+
+//same as PUSH() of the interpreter,the frame is checked by call()
+static void emitPush(JitBuilder* builder, Register src) {
+	x64_store(&builder->code, REG_TOP, 0, src);
+	x64_opImmediate(&builder->code, X86_EXT_ADD, REG_TOP, sizeof(Value));
+}
+
+//xmm = the number in reg,exit if it is not a number.rdx is clobbered
+static void emitUnboxNumber(JitBuilder* builder, uint32_t xmm, Register reg, uint32_t offset) {
+	fixupArray_push(&builder->exits, x64_unboxNumber(&builder->code, xmm, reg, RDX, REG_QNAN), offset);
+}
+
+//the templates don't check a constant operand,a number is loaded as double
+static void emitLoadConstant(JitBuilder* builder, Register dst, Value constant) {
+	x64_movImmediate(&builder->code, dst, IS_NUMBER(constant) ? NUMBER_VAL(AS_NUMBER(constant)) : constant);
+}
+
+//jump if the value is not an object,or turn it to the pointer
+static uint32_t emitUnboxObject(JitBuilder* builder, Register reg, Register scratch) {
+	x64_opRegister(&builder->code, X86_MOV_STORE, scratch, reg);
+	x64_opRegister(&builder->code, X86_AND_STORE, scratch, REG_TAG);
+	x64_opRegister(&builder->code, X86_CMP_STORE, scratch, REG_TAG);
+	uint32_t notObject = x64_jcc(&builder->code, CC_NE);
+	//all tag bits are set,clear them
+	x64_opRegister(&builder->code, X86_XOR_STORE, reg, REG_TAG);
+	return notObject;
+}
+
+//rax = BOOL_VAL(al)
+static void emitBoxBool(JitBuilder* builder) {
+	x64_byte(&builder->code, 0x0f);//movzx eax, al
+	x64_byte(&builder->code, 0xb6);
+	x64_byte(&builder->code, 0xc0);
+	x64_opRegister(&builder->code, X86_OR_STORE, RAX, REG_QNAN);
+	x64_opImmediate(&builder->code, X86_EXT_OR, RAX, TAG_FALSE);
+}
+
+//flags of isFalsey(rax),below if falsey,rcx is clobbered
+static void emitTestFalsey(JitBuilder* builder) {
+	//nil and false are QNAN | 1 and QNAN | 2
+	x64_opMemory(&builder->code, X86_LEA, RCX, RAX, -TAG_NIL);
+	x64_opRegister(&builder->code, X86_SUB_STORE, RCX, REG_QNAN);
+	x64_opImmediate(&builder->code, X86_EXT_CMP, RCX, 2);
+}
+
+//rax = rax op rcx,exit if any one is not a number.the result is double
+static void emitArithmetic(JitBuilder* builder, uint8_t op, uint32_t offset, bool checkRight) {
+	emitUnboxNumber(builder, XMM0, RAX, offset);
+	if (checkRight) {
+		emitUnboxNumber(builder, XMM1, RCX, offset);
+	}
+	else {
+		x64_toXmm(&builder->code, XMM1, RCX);
+	}
+	if (op == SSE_MOD) {
+		emitCall(builder, (uintptr_t)fmod);
+	}
+	else {
+		x64_sse(&builder->code, 0xf2, op, XMM0, XMM1);
+	}
+	x64_fromXmm(&builder->code, RAX, XMM0);
+}
+
+//compare rax with rcx,exit if any one is not a number.returns the condition if true,NaN makes it false
+static Condition emitCompare(JitBuilder* builder, CompareType type, uint32_t offset, bool checkRight) {
+	emitUnboxNumber(builder, XMM0, RAX, offset);
+	if (checkRight) {
+		emitUnboxNumber(builder, XMM1, RCX, offset);
+	}
+	else {
+		x64_toXmm(&builder->code, XMM1, RCX);
+	}
+	switch (type) {
+	case COMPARE_GREATER:
+		x64_sse(&builder->code, 0x66, SSE_COMPARE, XMM0, XMM1);//ucomisd
+		return CC_A;
+	case COMPARE_GREATER_EQUAL:
+		x64_sse(&builder->code, 0x66, SSE_COMPARE, XMM0, XMM1);
+		return CC_AE;
+	case COMPARE_LESS:
+		x64_sse(&builder->code, 0x66, SSE_COMPARE, XMM1, XMM0);
+		return CC_A;
+	case COMPARE_LESS_EQUAL:
+	default:
+		x64_sse(&builder->code, 0x66, SSE_COMPARE, XMM1, XMM0);
+		return CC_AE;
+	}
+}
+
+//al = valuesEqual(rax, rcx)
+static void emitEqual(JitBuilder* builder) {
+	uint32_t leftNotNumber = x64_unboxNumber(&builder->code, XMM0, RAX, RDX, REG_QNAN);
+	uint32_t rightNotNumber = x64_unboxNumber(&builder->code, XMM1, RCX, RDX, REG_QNAN);
+
+	x64_sse(&builder->code, 0x66, SSE_COMPARE, XMM0, XMM1);//ucomisd
+	x64_setAl(&builder->code, CC_E);
+	x64_byte(&builder->code, 0x0f);//setnp dl
+	x64_byte(&builder->code, 0x9b);
+	x64_byte(&builder->code, 0xc2);
+	x64_byte(&builder->code, 0x20);//and al, dl
+	x64_byte(&builder->code, 0xd0);
+	uint32_t done = x64_jmp(&builder->code);
+
+	//not both numbers,compare the bits
+	x64_patchHere(&builder->code, leftNotNumber);
+	x64_patchHere(&builder->code, rightNotNumber);
+	x64_opRegister(&builder->code, X86_CMP_STORE, RAX, RCX);
+	x64_setAl(&builder->code, CC_E);
+	x64_patchHere(&builder->code, done);
+}
+
+//al = !al
+static void emitNotAl(JitBuilder* builder) {
+	x64_byte(&builder->code, 0x34);//xor al, 1
+	x64_byte(&builder->code, 0x01);
+}
+
+//jump to target if al is false (or true)
+static void emitJumpToIfAl(JitBuilder* builder, bool isTrue, uint32_t target) {
+	x64_byte(&builder->code, 0x84);//test al, al
+	x64_byte(&builder->code, 0xc0);
+	emitJumpToIf(builder, isTrue ? CC_NE : CC_E, target);
+}
+
+//al = rax op rcx
+static void emitCompareToAl(JitBuilder* builder, CompareType type, uint32_t offset, bool checkRight) {
+	if (COMPARE_IS_EQUALITY(type)) {
+		emitEqual(builder);
+		if (type == COMPARE_NOT_EQUAL) emitNotAl(builder);
+	}
+	else {
+		x64_setAl(&builder->code, emitCompare(builder, type, offset, checkRight));
+	}
+}
+
+//jump to target if !(rax op rcx)
+static void emitCompareJump(JitBuilder* builder, CompareType type, uint32_t offset, bool checkRight, uint32_t target) {
+	if (COMPARE_IS_EQUALITY(type)) {
+		emitEqual(builder);
+		emitJumpToIfAl(builder, type == COMPARE_NOT_EQUAL, target);
+	}
+	else {
+		emitJumpToIf(builder, CC_NOT(emitCompare(builder, type, offset, checkRight)), target);
+	}
+}
+
+//dst = CLOSURE_UPVALUES(frame->closure)[index]->location,they are after the captures
+static void emitUpvalue(JitBuilder* builder, Register dst, uint32_t index) {
+	x64_load(&builder->code, dst, REG_FRAME, offsetof(CallFrame, closure));
+	x64_load(&builder->code, dst, dst, (int32_t)(offsetof(ObjClosure, captures) + builder->function->captureCount * sizeof(Value) + index * sizeof(ObjUpvalue*)));
+}
+
+static void emitUpvalueLocation(JitBuilder* builder, Register dst, uint32_t index) {
+	emitUpvalue(builder, dst, index);
+	x64_load(&builder->code, dst, dst, offsetof(ObjUpvalue, location));
+}
+
+//after value is stored in owner,gc_barrierValue is called if owner is old or a major collection is running.rdi and rsi are used
+static void emitWriteBarrier(JitBuilder* builder, Register owner, Register value) {
+	x64_loadByte(&builder->code, RDI, owner, offsetof(Obj, isMarked));
+	x64_opImmediate(&builder->code, X86_EXT_AND, RDI, OBJ_OLD_BIT);
+	uint32_t isOld = x64_jcc(&builder->code, CC_NE);
+	x64_loadByte(&builder->code, RDI, REG_VM, offsetof(VM, gcPhase));
+	x64_opRegister(&builder->code, X86_TEST, RDI, RDI);
+	uint32_t noBarrier = x64_jcc(&builder->code, CC_E);
+
+	x64_patchHere(&builder->code, isOld);
+	if (value != RSI) x64_opRegister(&builder->code, X86_MOV_STORE, RSI, value);
+	x64_opRegister(&builder->code, X86_MOV_STORE, RDI, owner);
+	emitCall(builder, (uintptr_t)gc_barrierValue);
+	x64_patchHere(&builder->code, noBarrier);
+}
+
+//rax = the value pointer of global slot,exit if undefined.the slots never move
+static void emitGlobalRef(JitBuilder* builder, uint32_t slot, uint32_t offset) {
+	x64_movImmediate(&builder->code, RAX, (uint64_t)(uintptr_t)&vm.globalValues[slot]);
+	x64_movImmediate(&builder->code, RCX, UNDEFINED_VAL);
+	x64_opMemory(&builder->code, X86_CMP_STORE, RCX, RAX, 0);
+	emitExitIf(builder, CC_E, offset);
+}
+
+//a call is done by the runtime,then the callee's frame is popped
+static void emitAfterCall(JitBuilder* builder) {
+	x64_byte(&builder->code, 0x85);//test eax, eax
+	x64_byte(&builder->code, 0xc0);
+	x64_patchTo(&builder->code, x64_jcc(&builder->code, CC_NE), builder->epilogue);
+	x64_load(&builder->code, REG_TOP, REG_VM, offsetof(VM, stackTop));
+	x64_load(&builder->code, REG_SLOTS, REG_FRAME, offsetof(CallFrame, slots));
+}
+
+//unboxed native call,falls to the generic call if any guard misses
+static uint32_t emitNativeNumberCall(JitBuilder* builder, uint32_t argCount) {
+	uint32_t misses[5];
+	uint32_t missCount = 0;
+
+	emitLoadStack(builder, RAX, argCount + 1);
+	misses[missCount++] = emitUnboxObject(builder, RAX, RDX);
+	x64_loadByte(&builder->code, RDX, RAX, offsetof(Obj, type));
+	x64_compare32(&builder->code, RDX, OBJ_NATIVE);
+	misses[missCount++] = x64_jcc(&builder->code, CC_NE);
+	x64_compareMemory32(&builder->code, RAX, offsetof(ObjNative, fastArity), (int8_t)argCount);
+	misses[missCount++] = x64_jcc(&builder->code, CC_NE);
+
+	for (uint32_t i = 0; i < argCount; ++i) {
+		emitLoadStack(builder, RCX, argCount - i);
+		misses[missCount++] = x64_unboxNumber(&builder->code, i, RCX, RDX, REG_QNAN);
+	}
+
+	//call [rax + unary]
+	x64_byte(&builder->code, 0xff);
+	x64_memory(&builder->code, 2, RAX, offsetof(ObjNative, unary));
+	//box as the interpreter does,integral results are int32
+	emitCall(builder, (uintptr_t)jit_numberFit);
+	emitStoreStack(builder, argCount + 1, RAX);
+	emitDrop(builder, argCount);
+	uint32_t done = x64_jmp(&builder->code);
+
+	for (uint32_t i = 0; i < missCount; ++i) {
+		x64_patchHere(&builder->code, misses[i]);
+	}
+	return done;
+}
+
+//rax = the array pointer of OBJ_ARRAY or OBJ_ARRAY_F64,edi = the type.exit if not
+static void emitCheckArray(JitBuilder* builder, uint32_t offset) {
+	fixupArray_push(&builder->exits, emitUnboxObject(builder, RAX, RDX), offset);
+	x64_loadByte(&builder->code, RDI, RAX, offsetof(Obj, type));
+	x64_opMemory(&builder->code, X86_LEA, RDX, RDI, -OBJ_ARRAY);
+	x64_compare32(&builder->code, RDX, 1);
+	emitExitIf(builder, CC_A, offset);
+}
+
+//rcx = the index of number in rcx,jump to the returned places if not in range of rax
+static void emitCheckIndex(JitBuilder* builder, uint32_t offset, uint32_t outOfRange[2]) {
+	emitUnboxNumber(builder, XMM0, RCX, offset);
+	x64_sse(&builder->code, 0x66, SSE_XOR, XMM1, XMM1);//xorpd
+	x64_sse(&builder->code, 0x66, SSE_COMPARE, XMM0, XMM1);//ucomisd,negative and NaN are below
+	outOfRange[0] = x64_jcc(&builder->code, CC_B);
+	x64_truncate(&builder->code, RCX, XMM0);
+	x64_load32(&builder->code, RDX, RAX, offsetof(ObjArray, length));
+	x64_opRegister(&builder->code, X86_CMP_STORE, RCX, RDX);
+	outOfRange[1] = x64_jcc(&builder->code, CC_AE);
+}
+
+//rcx = the constant index,jump to the returned places if not in range of rax
+static void emitConstantIndex(JitBuilder* builder, double index, uint32_t outOfRange[2]) {
+	if (index >= 0 && index < (double)UINT32_MAX) {
+		x64_movImmediate(&builder->code, RCX, (uint32_t)index);
+		x64_load32(&builder->code, RDX, RAX, offsetof(ObjArray, length));
+		x64_opRegister(&builder->code, X86_CMP_STORE, RCX, RDX);
+		outOfRange[0] = x64_jcc(&builder->code, CC_AE);
+		outOfRange[1] = UINT32_MAX;
+	}
+	else {
+		outOfRange[0] = x64_jmp(&builder->code);
+		outOfRange[1] = UINT32_MAX;
+	}
+}
+
+//target at stackTop[-distance],the element or nil replaces it
+static void emitArrayGet(JitBuilder* builder, uint32_t outOfRange[2], int32_t distance) {
+	//f64 element is a number value too
+	x64_load(&builder->code, RDX, RAX, offsetof(ObjArray, payload));
+	x64_loadIndexed(&builder->code, RAX, RDX, RCX);
+	uint32_t done = x64_jmp(&builder->code);
+
+	for (uint32_t i = 0; i < 2; ++i) {
+		if (outOfRange[i] != UINT32_MAX) x64_patchHere(&builder->code, outOfRange[i]);
+	}
+	x64_movImmediate(&builder->code, RAX, NIL_VAL);
+
+	x64_patchHere(&builder->code, done);
+	emitStoreStack(builder, distance, RAX);
+	emitDrop(builder, distance - 1);
+}
+
+//the value is stackTop[-1],only in range and converted without loss
+static void emitArraySet(JitBuilder* builder, uint32_t offset, uint32_t outOfRange[2], int32_t distance) {
+	for (uint32_t i = 0; i < 2; ++i) {
+		//the interpreter throws
+		if (outOfRange[i] != UINT32_MAX) fixupArray_push(&builder->exits, outOfRange[i], offset);
+	}
+
+	emitLoadStack(builder, RSI, 1);
+	x64_compare32(&builder->code, RDI, OBJ_ARRAY_F64);
+	uint32_t isValueArray = x64_jcc(&builder->code, CC_NE);
+	//f64 element is the double of the number
+	emitUnboxNumber(builder, XMM0, RSI, offset);
+	x64_fromXmm(&builder->code, RSI, XMM0);
+	x64_patchHere(&builder->code, isValueArray);
+
+	x64_load(&builder->code, RDX, RAX, offsetof(ObjArray, payload));
+	x64_storeIndexed(&builder->code, RDX, RCX, RSI);
+	emitStoreStack(builder, distance, RSI);
+	emitDrop(builder, distance - 1);
+
+	//no barrier for the doubles
+	x64_compare32(&builder->code, RDI, OBJ_ARRAY_F64);
+	uint32_t isDoubleArray = x64_jcc(&builder->code, CC_E);
+	emitWriteBarrier(builder, RAX, RSI);
+	x64_patchHere(&builder->code, isDoubleArray);
+}
+
+// ==================== commonds ====================
+
+#define READ_SHORT(at)	((uint32_t)(at)[0] | ((uint32_t)(at)[1] << 8))
+#define READ_24bits(at)	((uint32_t)(at)[0] | ((uint32_t)(at)[1] << 8) | ((uint32_t)(at)[2] << 16))
+#define READ_CONSTANT(at) (vm.constants.values[READ_24bits(at)])
+
+//rax = rax op rcx,stored to [base + disp]
+static bool emitArithmeticTo(JitBuilder* builder, uint32_t op, uint32_t offset, bool checkRight, Register base, int32_t disp) {
+	emitArithmetic(builder, arithmeticOps[op], offset, checkRight);
+	x64_store(&builder->code, base, disp, RAX);
+	return true;
+}
+
+//false if the commond is not compiled,the interpreter runs it
+static bool emitCommond(JitBuilder* builder, uint32_t offset) {
+	uint8_t* code = builder->bytecode + offset;
+	uint8_t* operands = code + 1;
+	uint32_t next = offset + chunk_commondLength(code);
+
+	switch (code[0]) {
+	case OP_CONSTANT:
+		x64_movImmediate(&builder->code, RAX, READ_CONSTANT(operands));
+		emitPush(builder, RAX);
+		return true;
+	case OP_CLOSURE: {
+		//only the shared closure,the others allocate and capture in the interpreter
+		ObjClosure* closure = AS_FUNCTION(READ_CONSTANT(operands))->closure;
+		if (closure == NULL) return false;
+		x64_movImmediate(&builder->code, RAX, OBJ_VAL(closure));
+		emitPush(builder, RAX);
+		return true;
+	}
+	case OP_NIL:
+		x64_movImmediate(&builder->code, RAX, NIL_VAL);
+		emitPush(builder, RAX);
+		return true;
+	case OP_TRUE:
+		x64_movImmediate(&builder->code, RAX, TRUE_VAL);
+		emitPush(builder, RAX);
+		return true;
+	case OP_FALSE:
+		x64_movImmediate(&builder->code, RAX, FALSE_VAL);
+		emitPush(builder, RAX);
+		return true;
+	case OP_MODULE_BUILTIN:
+		x64_movImmediate(&builder->code, RAX, OBJ_VAL(&vm.builtins[operands[0]]));
+		emitPush(builder, RAX);
+		return true;
+
+	case OP_GET_LOCAL:
+		emitLoadLocal(builder, RAX, READ_SHORT(operands));
+		emitPush(builder, RAX);
+		return true;
+	case OP_SET_LOCAL:
+		emitLoadStack(builder, RAX, 1);
+		emitStoreLocal(builder, READ_SHORT(operands), RAX);
+		return true;
+	case OP_GET_UPVALUE:
+		emitUpvalueLocation(builder, RAX, operands[0]);
+		x64_load(&builder->code, RAX, RAX, 0);
+		emitPush(builder, RAX);
+		return true;
+	case OP_SET_UPVALUE:
+		emitUpvalue(builder, RDX, operands[0]);
+		x64_load(&builder->code, RCX, RDX, offsetof(ObjUpvalue, location));
+		emitLoadStack(builder, RAX, 1);
+		x64_store(&builder->code, RCX, 0, RAX);
+		emitWriteBarrier(builder, RDX, RAX);
+		return true;
+	case OP_GET_CAPTURE:
+		x64_load(&builder->code, RAX, REG_FRAME, offsetof(CallFrame, closure));
+		x64_load(&builder->code, RAX, RAX, (int32_t)(offsetof(ObjClosure, captures) + operands[0] * sizeof(Value)));
+		emitPush(builder, RAX);
+		return true;
+	case OP_GET_GLOBAL:
+		emitGlobalRef(builder, READ_24bits(operands), offset);
+		x64_load(&builder->code, RAX, RAX, 0);
+		emitPush(builder, RAX);
+		return true;
+	case OP_SET_GLOBAL:
+		emitGlobalRef(builder, READ_24bits(operands), offset);
+		emitLoadStack(builder, RCX, 1);
+		x64_store(&builder->code, RAX, 0, RCX);
+		return true;
+
+	case OP_POP:
+		emitDrop(builder, 1);
+		return true;
+	case OP_POP_N:
+		emitDrop(builder, READ_SHORT(operands));
+		return true;
+	case OP_DUP:
+		emitLoadStack(builder, RAX, 1);
+		emitPush(builder, RAX);
+		return true;
+	case OP_DUP2:
+		emitLoadStack(builder, RAX, 2);
+		emitLoadStack(builder, RCX, 1);
+		emitPush(builder, RAX);
+		emitPush(builder, RCX);
+		return true;
+	case OP_CLOSE_UPVALUE:
+		x64_opMemory(&builder->code, X86_LEA, RDI, REG_TOP, -(int32_t)sizeof(Value));
+		emitCall(builder, (uintptr_t)jit_closeUpvalues);
+		emitDrop(builder, 1);
+		return true;
+
+	case OP_ADD:
+	case OP_ADD_NUMBER:
+	case OP_SUBTRACT:
+	case OP_MULTIPLY:
+	case OP_DIVIDE:
+	case OP_MODULUS:
+		emitLoadStack(builder, RAX, 2);
+		emitLoadStack(builder, RCX, 1);
+		emitArithmeticTo(builder, (code[0] == OP_ADD_NUMBER) ? 0 : code[0] - OP_ADD, offset, true, REG_TOP, -2 * (int32_t)sizeof(Value));
+		emitDrop(builder, 1);
+		return true;
+
+	case OP_NOT:
+		emitLoadStack(builder, RAX, 1);
+		emitTestFalsey(builder);
+		x64_setAl(&builder->code, CC_B);
+		emitBoxBool(builder);
+		emitStoreStack(builder, 1, RAX);
+		return true;
+	case OP_NOT_LOCAL:
+		emitLoadLocal(builder, RAX, READ_SHORT(operands));
+		emitTestFalsey(builder);
+		x64_setAl(&builder->code, CC_B);
+		emitBoxBool(builder);
+		emitPush(builder, RAX);
+		return true;
+	case OP_NEGATE:
+	case OP_NEGATE_LOCAL:
+		if (code[0] == OP_NEGATE) {
+			emitLoadStack(builder, RAX, 1);
+		}
+		else {
+			emitLoadLocal(builder, RAX, READ_SHORT(operands));
+		}
+		emitUnboxNumber(builder, XMM0, RAX, offset);
+		x64_fromXmm(&builder->code, RAX, XMM0);
+		//btc rax, 63
+		x64_rex(&builder->code, true, 0, 0, RAX);
+		x64_byte(&builder->code, 0x0f);
+		x64_byte(&builder->code, 0xba);
+		x64_byte(&builder->code, 0xf8);
+		x64_byte(&builder->code, 63);
+		if (code[0] == OP_NEGATE) {
+			emitStoreStack(builder, 1, RAX);
+		}
+		else {
+			emitPush(builder, RAX);
+		}
+		return true;
+
+	case OP_EQUAL:
+	case OP_GREATER:
+	case OP_LESS:
+	case OP_NOT_EQUAL:
+	case OP_LESS_EQUAL:
+	case OP_GREATER_EQUAL:
+		emitLoadStack(builder, RAX, 2);
+		emitLoadStack(builder, RCX, 1);
+		emitCompareToAl(builder, (CompareType)(code[0] - OP_EQUAL), offset, true);
+		emitBoxBool(builder);
+		emitStoreStack(builder, 2, RAX);
+		emitDrop(builder, 1);
+		return true;
+
+	case OP_JUMP:
+		emitJumpTo(builder, next + READ_SHORT(operands));
+		return true;
+	case OP_LOOP:
+		emitJumpTo(builder, next - READ_SHORT(operands));
+		return true;
+	case OP_JUMP_IF_FALSE:
+		emitLoadStack(builder, RAX, 1);
+		emitTestFalsey(builder);
+		emitJumpToIf(builder, CC_B, next + READ_SHORT(operands));
+		return true;
+	case OP_JUMP_IF_FALSE_POP:
+		emitLoadStack(builder, RAX, 1);
+		emitDrop(builder, 1);
+		emitTestFalsey(builder);
+		emitJumpToIf(builder, CC_B, next + READ_SHORT(operands));
+		return true;
+	case OP_JUMP_IF_TRUE:
+		emitLoadStack(builder, RAX, 1);
+		emitTestFalsey(builder);
+		emitJumpToIf(builder, CC_AE, next + READ_SHORT(operands));
+		return true;
+
+	case OP_CALL:
+		x64_opRegister(&builder->code, X86_MOV_STORE, RDI, REG_FRAME);
+		x64_movImmediate(&builder->code, RSI, (uintptr_t)(builder->bytecode + next));
+		x64_movImmediate(&builder->code, RDX, operands[0]);
+		emitCall(builder, (uintptr_t)jit_call);
+		emitAfterCall(builder);
+		return true;
+	case OP_CALL_NATIVE_NUMBER: {
+		uint32_t done = UINT32_MAX;
+		if (operands[0] == 1 || operands[0] == 2) {
+			done = emitNativeNumberCall(builder, operands[0]);
+		}
+		//guard missed,call as usual
+		x64_opRegister(&builder->code, X86_MOV_STORE, RDI, REG_FRAME);
+		x64_movImmediate(&builder->code, RSI, (uintptr_t)(builder->bytecode + next));
+		x64_movImmediate(&builder->code, RDX, operands[0]);
+		emitCall(builder, (uintptr_t)jit_call);
+		emitAfterCall(builder);
+		if (done != UINT32_MAX) x64_patchHere(&builder->code, done);
+		return true;
+	}
+	case OP_INVOKE: {
+		InvokeCache* cache = &builder->function->invokeCaches[READ_SHORT(operands + 4)];
+		x64_opRegister(&builder->code, X86_MOV_STORE, RDI, REG_FRAME);
+		x64_movImmediate(&builder->code, RSI, (uintptr_t)(builder->bytecode + next));
+		x64_movImmediate(&builder->code, RDX, (uintptr_t)AS_STRING(READ_CONSTANT(operands)));
+		x64_movImmediate(&builder->code, RCX, operands[3]);
+		x64_movImmediate(&builder->code, R8, (uintptr_t)cache);
+		emitCall(builder, (uintptr_t)jit_invoke);
+		emitAfterCall(builder);
+		return true;
+	}
+	case OP_RETURN: {
+		//the script returns in the interpreter
+		x64_compareMemory32(&builder->code, REG_VM, offsetof(VM, frameCount), 1);
+		emitExitIf(builder, CC_E, offset);
+
+		//close the upvalues of the frame,if a local may have one
+		if (builder->function->closesUpvalues) {
+			x64_load(&builder->code, RAX, REG_VM, offsetof(VM, openUpvalues));
+			x64_opRegister(&builder->code, X86_TEST, RAX, RAX);
+			uint32_t noUpvalue = x64_jcc(&builder->code, CC_E);
+			x64_opMemory(&builder->code, X86_CMP_STORE, REG_SLOTS, RAX, offsetof(ObjUpvalue, location));
+			uint32_t notInFrame = x64_jcc(&builder->code, CC_B);
+			x64_opRegister(&builder->code, X86_MOV_STORE, RDI, REG_SLOTS);
+			emitCall(builder, (uintptr_t)jit_closeUpvalues);
+			x64_patchHere(&builder->code, noUpvalue);
+			x64_patchHere(&builder->code, notInFrame);
+		}
+
+		emitLoadStack(builder, RAX, 1);
+		//dec dword [vm.frameCount]
+		x64_rex(&builder->code, false, 0, 0, REG_VM);
+		x64_byte(&builder->code, 0xff);
+		x64_memory(&builder->code, 1, REG_VM, offsetof(VM, frameCount));
+		emitStoreLocal(builder, 0, RAX);
+		x64_opMemory(&builder->code, X86_LEA, REG_TOP, REG_SLOTS, sizeof(Value));
+		x64_store(&builder->code, REG_VM, offsetof(VM, stackTop), REG_TOP);
+		x64_byte(&builder->code, 0x31);//xor eax, eax
+		x64_byte(&builder->code, 0xc0);
+		x64_patchTo(&builder->code, x64_jmp(&builder->code), builder->epilogue);
+		return true;
+	}
+
+	case OP_PRINT:
+		emitLoadStack(builder, RDI, 1);
+		emitDrop(builder, 1);
+		emitCall(builder, (uintptr_t)jit_print);
+		return true;
+
+	case OP_GET_SUBSCRIPT:
+	case OP_GET_SUBSCRIPT_ARRAY:
+	case OP_GET_SUBSCRIPT_F64: {
+		uint32_t outOfRange[2];
+		emitLoadStack(builder, RAX, 2);
+		emitCheckArray(builder, offset);
+		emitLoadStack(builder, RCX, 1);
+		emitCheckIndex(builder, offset, outOfRange);
+		emitArrayGet(builder, outOfRange, 2);
+		return true;
+	}
+	case OP_SET_SUBSCRIPT:
+	case OP_SET_SUBSCRIPT_ARRAY:
+	case OP_SET_SUBSCRIPT_F64: {
+		uint32_t outOfRange[2];
+		emitLoadStack(builder, RAX, 3);
+		emitCheckArray(builder, offset);
+		emitLoadStack(builder, RCX, 2);
+		emitCheckIndex(builder, offset, outOfRange);
+		emitArraySet(builder, offset, outOfRange, 3);
+		return true;
+	}
+	case OP_GET_INDEX:
+	case OP_GET_INDEX_ARRAY:
+	case OP_GET_INDEX_F64: {
+		uint32_t outOfRange[2];
+		if (!IS_NUMBER(READ_CONSTANT(operands))) return false;
+
+		emitLoadStack(builder, RAX, 1);
+		emitCheckArray(builder, offset);
+		emitConstantIndex(builder, AS_NUMBER(READ_CONSTANT(operands)), outOfRange);
+		emitArrayGet(builder, outOfRange, 1);
+		return true;
+	}
+	case OP_SET_INDEX:
+	case OP_SET_INDEX_ARRAY:
+	case OP_SET_INDEX_F64: {
+		uint32_t outOfRange[2];
+		if (!IS_NUMBER(READ_CONSTANT(operands))) return false;
+
+		emitLoadStack(builder, RAX, 2);
+		emitCheckArray(builder, offset);
+		emitConstantIndex(builder, AS_NUMBER(READ_CONSTANT(operands)), outOfRange);
+		emitArraySet(builder, offset, outOfRange, 2);
+		return true;
+	}
+	case OP_JUMP_IF_IN_ARRAY_LL: {
+		//same as isArrayLoopIndex,the condition after it is run when any check misses
+		uint32_t misses[5];
+		emitLoadLocal(builder, RAX, READ_SHORT(operands + 2));
+		misses[0] = emitUnboxObject(builder, RAX, RDX);
+		x64_loadByte(&builder->code, RDI, RAX, offsetof(Obj, type));
+		x64_opMemory(&builder->code, X86_LEA, RDX, RDI, -OBJ_ARRAY);
+		x64_compare32(&builder->code, RDX, 1);
+		misses[1] = x64_jcc(&builder->code, CC_A);
+		emitLoadLocal(builder, RCX, READ_SHORT(operands));
+		misses[2] = x64_unboxNumber(&builder->code, XMM0, RCX, RDX, REG_QNAN);
+		x64_sse(&builder->code, 0x66, SSE_XOR, XMM1, XMM1);//xorpd
+		x64_sse(&builder->code, 0x66, SSE_COMPARE, XMM0, XMM1);//ucomisd,negative and NaN are below
+		misses[3] = x64_jcc(&builder->code, CC_B);
+		x64_truncate(&builder->code, RCX, XMM0);
+		x64_load32(&builder->code, RDX, RAX, offsetof(ObjArray, length));
+		x64_opRegister(&builder->code, X86_CMP_STORE, RCX, RDX);
+		misses[4] = x64_jcc(&builder->code, CC_AE);
+		emitJumpTo(builder, next + READ_SHORT(operands + 4));
+
+		for (uint32_t i = 0; i < 5; ++i) {
+			x64_patchHere(&builder->code, misses[i]);
+		}
+		return true;
+	}
+	case OP_GET_ELEMENT_LL:
+	case OP_SET_ELEMENT_LL: {
+		//the guard has checked both,rax = the array,rcx = the index
+		emitLoadLocal(builder, RAX, READ_SHORT(operands));
+		x64_opRegister(&builder->code, X86_XOR_STORE, RAX, REG_TAG);
+		emitLoadLocal(builder, RCX, READ_SHORT(operands + 2));
+		emitUnboxNumber(builder, XMM0, RCX, offset);
+		x64_truncate(&builder->code, RCX, XMM0);
+		if (code[0] == OP_GET_ELEMENT_LL) {
+			x64_load(&builder->code, RDX, RAX, offsetof(ObjArray, payload));
+			x64_loadIndexed(&builder->code, RAX, RDX, RCX);
+			emitPush(builder, RAX);
+		}
+		else {
+			uint32_t inRange[2] = { UINT32_MAX, UINT32_MAX };
+			x64_loadByte(&builder->code, RDI, RAX, offsetof(Obj, type));
+			emitArraySet(builder, offset, inRange, 1);
+		}
+		return true;
+	}
+
+	case OP_REG_MOVE:
+		emitLoadLocal(builder, RAX, READ_SHORT(operands + 2));
+		emitStoreLocal(builder, READ_SHORT(operands), RAX);
+		return true;
+	case OP_REG_LOAD_CONST:
+		x64_movImmediate(&builder->code, RAX, READ_CONSTANT(operands + 2));
+		emitStoreLocal(builder, READ_SHORT(operands), RAX);
+		return true;
+	}
+
+	//families of super commonds,a constant operand must be a number
+	if (code[0] >= OP_ADD_CONST && code[0] <= OP_MODULUS_CONST) {
+		Value constant = READ_CONSTANT(operands);
+		if (!IS_NUMBER(constant)) return false;
+
+		emitLoadStack(builder, RAX, 1);
+		emitLoadConstant(builder, RCX, constant);
+		return emitArithmeticTo(builder, code[0] - OP_ADD_CONST, offset, false, REG_TOP, -(int32_t)sizeof(Value));
+	}
+	if (code[0] >= OP_EQUAL_CONST && code[0] <= OP_GREATER_EQUAL_CONST) {
+		CompareType type = (CompareType)(code[0] - OP_EQUAL_CONST);
+		Value constant = READ_CONSTANT(operands);
+		if (!COMPARE_IS_EQUALITY(type) && !IS_NUMBER(constant)) return false;
+
+		emitLoadStack(builder, RAX, 1);
+		emitLoadConstant(builder, RCX, constant);
+		emitCompareToAl(builder, type, offset, false);
+		emitBoxBool(builder);
+		emitStoreStack(builder, 1, RAX);
+		return true;
+	}
+	if (code[0] >= OP_ADD_LOCAL && code[0] <= OP_MODULUS_LOCAL) {
+		emitLoadStack(builder, RAX, 1);
+		emitLoadLocal(builder, RCX, READ_SHORT(operands));
+		return emitArithmeticTo(builder, code[0] - OP_ADD_LOCAL, offset, true, REG_TOP, -(int32_t)sizeof(Value));
+	}
+	if (code[0] >= OP_EQUAL_LOCAL && code[0] <= OP_GREATER_EQUAL_LOCAL) {
+		emitLoadStack(builder, RAX, 1);
+		emitLoadLocal(builder, RCX, READ_SHORT(operands));
+		emitCompareToAl(builder, (CompareType)(code[0] - OP_EQUAL_LOCAL), offset, true);
+		emitBoxBool(builder);
+		emitStoreStack(builder, 1, RAX);
+		return true;
+	}
+	if (code[0] >= OP_JUMP_IF_FALSE_EQUAL_LC && code[0] <= OP_JUMP_IF_FALSE_GREATER_EQUAL_LC) {
+		CompareType type = (CompareType)(code[0] - OP_JUMP_IF_FALSE_EQUAL_LC);
+		Value constant = READ_CONSTANT(operands + 2);
+		if (!COMPARE_IS_EQUALITY(type) && !IS_NUMBER(constant)) return false;
+
+		emitLoadLocal(builder, RAX, READ_SHORT(operands));
+		emitLoadConstant(builder, RCX, constant);
+		emitCompareJump(builder, type, offset, false, next + READ_SHORT(operands + 5));
+		return true;
+	}
+	if (code[0] >= OP_JUMP_IF_FALSE_EQUAL_LL && code[0] <= OP_JUMP_IF_FALSE_GREATER_EQUAL_LL) {
+		emitLoadLocal(builder, RAX, READ_SHORT(operands));
+		emitLoadLocal(builder, RCX, READ_SHORT(operands + 2));
+		emitCompareJump(builder, (CompareType)(code[0] - OP_JUMP_IF_FALSE_EQUAL_LL), offset, true, next + READ_SHORT(operands + 4));
+		return true;
+	}
+	if (code[0] >= OP_INPLACE_ADD_LC && code[0] <= OP_INPLACE_DIVIDE_LC) {
+		Value constant = READ_CONSTANT(operands + 2);
+		if (!IS_NUMBER(constant)) return false;
+
+		uint32_t slot = READ_SHORT(operands);
+		emitLoadLocal(builder, RAX, slot);
+		emitLoadConstant(builder, RCX, constant);
+		return emitArithmeticTo(builder, code[0] - OP_INPLACE_ADD_LC, offset, false, REG_SLOTS, (int32_t)(slot * sizeof(Value)));
+	}
+	if (code[0] >= OP_INPLACE_ADD_LL && code[0] <= OP_INPLACE_DIVIDE_LL) {
+		uint32_t slot = READ_SHORT(operands);
+		emitLoadLocal(builder, RAX, slot);
+		emitLoadLocal(builder, RCX, READ_SHORT(operands + 2));
+		return emitArithmeticTo(builder, code[0] - OP_INPLACE_ADD_LL, offset, true, REG_SLOTS, (int32_t)(slot * sizeof(Value)));
+	}
+	if (code[0] >= OP_INPLACE_ADD_UC && code[0] <= OP_INPLACE_DIVIDE_UC) {
+		Value constant = READ_CONSTANT(operands + 1);
+		if (!IS_NUMBER(constant)) return false;
+
+		emitUpvalueLocation(builder, RSI, operands[0]);
+		x64_load(&builder->code, RAX, RSI, 0);
+		emitLoadConstant(builder, RCX, constant);
+		return emitArithmeticTo(builder, code[0] - OP_INPLACE_ADD_UC, offset, false, RSI, 0);
+	}
+	if (code[0] >= OP_INPLACE_ADD_GC && code[0] <= OP_INPLACE_DIVIDE_GC) {
+		Value constant = READ_CONSTANT(operands + 3);
+		if (!IS_NUMBER(constant)) return false;
+
+		emitGlobalRef(builder, READ_24bits(operands), offset);
+		x64_opRegister(&builder->code, X86_MOV_STORE, RSI, RAX);
+		x64_load(&builder->code, RAX, RSI, 0);
+		emitLoadConstant(builder, RCX, constant);
+		return emitArithmeticTo(builder, code[0] - OP_INPLACE_ADD_GC, offset, false, RSI, 0);
+	}
+	if (code[0] >= OP_REG_ADD_LL && code[0] <= OP_REG_MODULUS_LL) {
+		emitLoadLocal(builder, RAX, READ_SHORT(operands + 2));
+		emitLoadLocal(builder, RCX, READ_SHORT(operands + 4));
+		return emitArithmeticTo(builder, code[0] - OP_REG_ADD_LL, offset, true, REG_SLOTS, (int32_t)(READ_SHORT(operands) * sizeof(Value)));
+	}
+	if (code[0] >= OP_REG_ADD_LC && code[0] <= OP_REG_MODULUS_LC) {
+		Value constant = READ_CONSTANT(operands + 4);
+		if (!IS_NUMBER(constant)) return false;
+
+		emitLoadLocal(builder, RAX, READ_SHORT(operands + 2));
+		emitLoadConstant(builder, RCX, constant);
+		return emitArithmeticTo(builder, code[0] - OP_REG_ADD_LC, offset, false, REG_SLOTS, (int32_t)(READ_SHORT(operands) * sizeof(Value)));
+	}
+
+	return false;
+}
+
+//entry,exit and the shared subroutines before the body
+static void emitPrologue(JitBuilder* builder) {
+	//JitStatus entry(CallFrame* frame, uint8_t* target)
+	x64_push(&builder->code, RBP);
+	x64_push(&builder->code, RBX);
+	x64_push(&builder->code, R12);
+	x64_push(&builder->code, R13);
+	x64_push(&builder->code, R14);
+	x64_push(&builder->code, R15);
+	x64_opImmediate(&builder->code, X86_EXT_SUB, RSP, 8);//align to 16
+
+	x64_opRegister(&builder->code, X86_MOV_STORE, REG_FRAME, RDI);
+	x64_movImmediate(&builder->code, REG_VM, (uintptr_t)&vm);
+	x64_load(&builder->code, REG_SLOTS, REG_FRAME, offsetof(CallFrame, slots));
+	x64_load(&builder->code, REG_TOP, REG_VM, offsetof(VM, stackTop));
+	x64_movImmediate(&builder->code, REG_QNAN, QNAN);
+	x64_movImmediate(&builder->code, REG_TAG, SIGN_BIT | QNAN);
+	x64_byte(&builder->code, 0xff);//jmp rsi
+	x64_byte(&builder->code, 0xe6);
+
+	//rax is the ip to go on
+	builder->exitCommon = builder->code.count;
+	x64_store(&builder->code, REG_FRAME, offsetof(CallFrame, ip), RAX);
+	x64_store(&builder->code, REG_VM, offsetof(VM, stackTop), REG_TOP);
+	x64_movImmediate(&builder->code, RAX, JIT_EXIT);
+
+	builder->epilogue = builder->code.count;
+	x64_opImmediate(&builder->code, X86_EXT_ADD, RSP, 8);
+	x64_pop(&builder->code, R15);
+	x64_pop(&builder->code, R14);
+	x64_pop(&builder->code, R13);
+	x64_pop(&builder->code, R12);
+	x64_pop(&builder->code, RBX);
+	x64_pop(&builder->code, RBP);
+	x64_ret(&builder->code);
+}
+
+static bool emitBody(JitBuilder* builder) {
+	uint32_t offset = 0;
+	while (offset < builder->bytecodeCount) {
+		uint32_t length = chunk_commondLength(builder->bytecode + offset);
+		if (offset + length > builder->bytecodeCount) return false;
+
+		uint32_t jumpCount = builder->jumps.count;
+		uint32_t exitCount = builder->exits.count;
+
+		builder->positions[offset] = builder->code.count;
+		if (emitCommond(builder, offset)) {
+			builder->entries[offset] = builder->positions[offset];
+		}
+		else {
+			//drop what is emitted,leave to the interpreter
+			builder->code.count = builder->positions[offset];
+			builder->jumps.count = jumpCount;
+			builder->exits.count = exitCount;
+			emitExit(builder, offset);
+		}
+		offset += length;
+	}
+
+	for (uint32_t i = 0; i < builder->jumps.count; ++i) {
+		JitFixup* jump = &builder->jumps.fixups[i];
+		if (jump->target >= builder->bytecodeCount || builder->positions[jump->target] == JIT_NO_ENTRY) return false;
+		x64_patchTo(&builder->code, jump->codeOffset, builder->positions[jump->target]);
+	}
+
+	//one stub for each commond,shared by its guards
+	for (uint32_t i = 0; i < builder->exits.count; ++i) {
+		JitFixup* exit = &builder->exits.fixups[i];
+		if (builder->exitStubs[exit->target] == 0) {
+			builder->exitStubs[exit->target] = builder->code.count;
+			x64_movImmediate(&builder->code, RAX, (uintptr_t)(builder->bytecode + exit->target));
+			x64_patchTo(&builder->code, x64_jmp(&builder->code), builder->exitCommon);
+		}
+		x64_patchTo(&builder->code, exit->codeOffset, builder->exitStubs[exit->target]);
+	}
+	return true;
+}
+
+//copy the code to executable memory
+static JitCode* install(JitBuilder* builder) {
+	uint64_t size;
+	uint8_t* memory = x64_map(&builder->code, &size);
+	if (memory == NULL) return NULL;
+
+	JitCode* jit = ALLOCATE_NO_GC(JitCode, 1);
+	jit->code = memory;
+	jit->size = size;
+	jit->entries = builder->entries;
+	jit->entryCount = builder->bytecodeCount;
+	return jit;
+}
+
+void jit_compile(ObjFunction* function) {
+	uint32_t count = function->chunk.count;
+	if (count == 0) return;
+
+	JitBuilder builder = {
+		.function = function,
+		.bytecode = function->chunk.code,
+		.bytecodeCount = count,
+		.positions = ALLOCATE_NO_GC(uint32_t, count),
+		.entries = ALLOCATE_NO_GC(uint32_t, count),
+		.exitStubs = ALLOCATE_NO_GC(uint32_t, count),
+	};
+	for (uint32_t i = 0; i < count; ++i) {
+		builder.positions[i] = JIT_NO_ENTRY;
+		builder.entries[i] = JIT_NO_ENTRY;
+		builder.exitStubs[i] = 0;
+	}
+
+	emitPrologue(&builder);
+	if (emitBody(&builder)) {
+		function->jit = install(&builder);
+	}
+
+	//entries are kept by the jit code
+	if (function->jit == NULL) {
+		FREE_ARRAY_NO_GC(uint32_t, builder.entries, count);
+	}
+	FREE_ARRAY_NO_GC(uint32_t, builder.positions, count);
+	FREE_ARRAY_NO_GC(uint32_t, builder.exitStubs, count);
+	x64_free(&builder.code);
+	fixupArray_free(&builder.jumps);
+	fixupArray_free(&builder.exits);
+}
+
+void jit_free(JitCode* jit) {
+	x64_unmap(jit->code, jit->size);
+	FREE_ARRAY_NO_GC(uint32_t, jit->entries, jit->entryCount);
+	FREE_NO_GC(JitCode, jit);
+}
+
+typedef JitStatus(*JitEntry)(CallFrame* frame, uint8_t* target);
+
+JitStatus jit_enter(CallFrame* frame) {
+	JitCode* jit = frame->closure->function->jit;
+	uint32_t entry = jit->entries[frame->ip - frame->closure->function->chunk.code];
+	if (entry == JIT_NO_ENTRY) return JIT_EXIT;
+
+	return ((JitEntry)jit->code)(frame, jit->code + entry);
+}
+
+JitStatus jit_run(CallFrame* frame) {
+	while (true) {
+		JitStatus status = jit_enter(frame);
+		if (status != JIT_OK) return status;
+
+		//the frame returned,go on if the caller is compiled
+		frame = &vm.frames[vm.frameCount - 1];
+		if (!jit_ready(frame->closure->function, false)) return JIT_EXIT;
+	}
+}
+
+#undef READ_SHORT
+#undef READ_24bits
+#undef READ_CONSTANT
+#endif
@@ -0,0 +1,63 @@
+/*
+ * MIT License
+ * Copyright (c) 2025 IMSDcrueoft (https://github.com/IMSDcrueoft)
+ * See LICENSE file in the root directory for full license text.
+*/
+#pragma once
+#include "common.h"
+#include "object.h"
+#include "vm.h"
+#include "x64.h"
+
+//the baseline jit emits x86-64 only
+#define JIT_AVAILABLE X64_AVAILABLE
+
+//calls and loop back edges before a function is compiled
+#define JIT_HOT_THRESHOLD 1000
+//the commond is not compiled,the interpreter runs it
+#define JIT_NO_ENTRY UINT32_MAX
+
+typedef enum {
+	JIT_OK,		//the frame returned,the caller goes on
+	JIT_EXIT,	//the interpreter goes on with the top frame
+	JIT_ERROR,	//runtime error is reported
+} JitStatus;
+
+//native code of a function,the stack and frames are kept the same as the interpreter
+//at every commond boundary,so it can be entered or left at any compiled commond
+struct JitCode {
+	uint8_t* code;		//executable memory,begins with the entry stub
+	uint64_t size;		//mapped size
+	uint32_t* entries;	//bytecode offset -> code offset,JIT_NO_ENTRY if not compiled
+	uint32_t entryCount;
+};
+
+#if JIT_AVAILABLE
+//compile the function,function->jit stays NULL if failed
+void jit_compile(ObjFunction* function);
+void jit_free(JitCode* jit);
+
+//run the compiled code of frame from frame->ip,it goes on with the callers that are compiled too.
+//never JIT_OK,vm.stackTop and the top frame's ip are fresh after it
+JitStatus jit_run(CallFrame* frame);
+//run the compiled code of frame from frame->ip until it returns
+JitStatus jit_enter(CallFrame* frame);
+
+//count the heat of function,true if it has native code
+static inline bool jit_ready(ObjFunction* function, bool isHot) {
+	if (function->jit != NULL) return true;
+
+	if (isHot && ++function->hotness == JIT_HOT_THRESHOLD) {
+		jit_compile(function);
+		return function->jit != NULL;
+	}
+	return false;
+}
+#endif
+
+//runtime of the native code and the C code of --emit-c,in vm.c
+JitStatus jit_call(CallFrame* frame, uint8_t* ip, int argCount);
+JitStatus jit_invoke(CallFrame* frame, uint8_t* ip, ObjString* name, int argCount, InvokeCache* cache);
+void jit_closeUpvalues(Value* last);
+Value jit_numberFit(double num);
+void jit_print(Value value);
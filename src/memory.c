@@ -8,6 +8,56 @@
 #include "vm.h"
 #include "allocator.h"
 #include "gc.h"
+#include "jit.h"
+#include "trace.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+//a multiple of the page sizes of the platforms
+#define GUARD_SIZE 0x10000
+
+#ifdef _WIN32
+//windows doesn't overcommit,the reserved pages are committed by the block when touched
+#define COMMIT_SIZE 0x10000
+#define RESERVED_MAX 8
+
+typedef struct {
+	uint8_t* base;
+	uint64_t size;	//the guard after it is never committed
+} Reserved;
+
+static Reserved reserved[RESERVED_MAX];
+static PVOID reservedHandler = NULL;
+
+static LONG WINAPI commitOnAccess(PEXCEPTION_POINTERS info)
+{
+	if (info->ExceptionRecord->ExceptionCode != EXCEPTION_ACCESS_VIOLATION) {
+		return EXCEPTION_CONTINUE_SEARCH;
+	}
+
+	uint8_t* address = (uint8_t*)info->ExceptionRecord->ExceptionInformation[1];
+	for (uint32_t i = 0; i < RESERVED_MAX; ++i) {
+		Reserved* region = &reserved[i];
+		if (region->base == NULL || address < region->base || address >= region->base + region->size) continue;
+
+		//committing a committed page again is fine,so racing threads need no lock
+		uint64_t offset = (uint64_t)(address - region->base) & ~(uint64_t)(COMMIT_SIZE - 1);
+		uint64_t size = min(COMMIT_SIZE, region->size - offset);
+		if (VirtualAlloc(region->base + offset, size, MEM_COMMIT, PAGE_READWRITE) != NULL) {
+			return EXCEPTION_CONTINUE_EXECUTION;
+		}
+		break;
+	}
+	return EXCEPTION_CONTINUE_SEARCH;
+}
+#endif
+
+THREAD_LOCAL uint64_t* allocatedBytes = &vm.bytesAllocated;
 
 void* reallocate_no_gc(void* pointer, uint64_t oldSize, uint64_t newSize)
 {
@@ -40,15 +90,11 @@ void* reallocate_no_gc(void* pointer, uint64_t oldSize, uint64_t newSize)
 
 void* reallocate(void* pointer, uint64_t oldSize, uint64_t newSize)
 {
-	vm.bytesAllocated += newSize - oldSize;
+	*allocatedBytes += newSize - oldSize;
 
 	if (newSize > oldSize) {
-#if DEBUG_STRESS_GC
-		garbageCollect();
-#endif
-		if (vm.bytesAllocated > vm.nextGC) {
-			garbageCollect();
-		}
+		//the buffers fill the nursery too,a minor collection starts a major one when the heap is over vm.nextGC
+		gc_allocated(newSize - oldSize);
 	}
 
 	if (newSize == 0) {
@@ -76,6 +122,56 @@ void* reallocate(void* pointer, uint64_t oldSize, uint64_t newSize)
 	return result;
 }
 
+void* reserveMemory(uint64_t size)
+{
+#ifdef _WIN32
+	void* memory = VirtualAlloc(NULL, size + GUARD_SIZE, MEM_RESERVE, PAGE_NOACCESS);
+	if (memory != NULL) {
+		uint32_t i = 0;
+		while (i < RESERVED_MAX && reserved[i].base != NULL) ++i;
+
+		if (i == RESERVED_MAX || (reservedHandler == NULL && (reservedHandler = AddVectoredExceptionHandler(1, commitOnAccess)) == NULL)) {
+			VirtualFree(memory, 0, MEM_RELEASE);
+			memory = NULL;
+		}
+		else {
+			reserved[i] = (Reserved){ .base = (uint8_t*)memory, .size = size };
+		}
+	}
+#else
+	void* memory = mmap(NULL, size + GUARD_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (memory == MAP_FAILED) {
+		memory = NULL;
+	}
+	else if (mprotect((uint8_t*)memory + size, GUARD_SIZE, PROT_NONE) != 0) {
+		munmap(memory, size + GUARD_SIZE);
+		memory = NULL;
+	}
+#endif
+
+	if (memory == NULL) {
+		fprintf(stderr, "Memory reservation failed!\n");
+		exit(1);
+	}
+
+	return memory;
+}
+
+void releaseMemory(void* memory, uint64_t size)
+{
+	if (memory == NULL) return;
+#ifdef _WIN32
+	for (uint32_t i = 0; i < RESERVED_MAX; ++i) {
+		if (reserved[i].base == (uint8_t*)memory) {
+			reserved[i] = (Reserved){ .base = NULL, .size = 0 };
+		}
+	}
+	VirtualFree(memory, 0, MEM_RELEASE);
+#else
+	munmap(memory, size + GUARD_SIZE);
+#endif
+}
+
 void freeObject(Obj* object) {
 #if DEBUG_LOG_GC
 	printf("[gc] %p free (%s)\n", (void*)object, objTypeInfo[object->type]);
@@ -85,32 +181,45 @@ void freeObject(Obj* object) {
 	case OBJ_CLASS: {
 		ObjClass* klass = (ObjClass*)object;
 		table_free(&klass->methods);
-		FREE(ObjClass, object);
+		gc_release(object, sizeof(ObjClass));
+		vm.methodCacheEpoch++;//the address may be reused by a new class
 		break;
 	}
 	case OBJ_INSTANCE: {
 		ObjInstance* instance = (ObjInstance*)object;
-		table_free(&instance->fields);
-		FREE(ObjInstance, object);
+		if (INSTANCE_IS_DICTIONARY(instance)) {
+			table_free(&instance->fields);
+		}
+		else {
+			FREE_ARRAY(Value, instance->slots, instance->slotCapacity);
+		}
+		gc_release(object, sizeof(ObjInstance));
 		break;
 	}
 	case OBJ_CLOSURE: {
 		ObjClosure* closure = (ObjClosure*)object;
-		FREE_ARRAY(ObjUpvalue*, closure->upvalues, closure->upvalueCount);
-
-		FREE(ObjClosure, object);
+		gc_release(object, CLOSURE_SIZE(closure->upvalueCount, closure->captureCount));
 		break;
 	}
 	case OBJ_BOUND_METHOD: {
-		FREE(ObjBoundMethod, object);
+		gc_release(object, sizeof(ObjBoundMethod));
 		break;
 	}
 	case OBJ_UPVALUE:
-		FREE(ObjUpvalue, object);
+		gc_release(object, sizeof(ObjUpvalue));
 		break;
 	case OBJ_FUNCTION: {
 		ObjFunction* function = (ObjFunction*)object;
 		chunk_free(&function->chunk);
+		FREE_ARRAY_NO_GC(PropertyCache, function->propertyCaches, function->propertyCacheCapacity);
+		FREE_ARRAY_NO_GC(InvokeCache, function->invokeCaches, function->invokeCacheCapacity);
+#if JIT_AVAILABLE
+		if (function->jit != NULL) jit_free(function->jit);
+#endif
+#if TRACE_AVAILABLE
+		trace_freeAnchors(function);
+#endif
+		if (function->closure != NULL) FREE_NO_GC(ObjClosure, function->closure);
 		FREE_NO_GC(ObjFunction, object);
 		break;
 	}
@@ -129,7 +238,7 @@ void freeObject(Obj* object) {
 #if DEBUG_LOG_GC
 		printf("[gc] %p free buffer : %llu\n", (void*)array->payload, (uint64_t)array->capacity * sizeof(Value));
 #endif
-		FREE(ObjArray, object);
+		gc_release(object, sizeof(ObjArray));
 		break;
 	}
 	case OBJ_ARRAY_F64: {
@@ -139,7 +248,7 @@ void freeObject(Obj* object) {
 #if DEBUG_LOG_GC
 		printf("[gc] %p free buffer : %llu\n", (void*)array->payload, (uint64_t)array->capacity * 8);
 #endif
-		FREE(ObjArray, object);
+		gc_release(object, sizeof(ObjArray));
 		break;
 	}
 	case OBJ_ARRAY_F32:
@@ -151,7 +260,7 @@ void freeObject(Obj* object) {
 #if DEBUG_LOG_GC
 		printf("[gc] %p free buffer : %llu\n", (void*)array->payload, (uint64_t)array->capacity * 4);
 #endif
-		FREE(ObjArray, object);
+		gc_release(object, sizeof(ObjArray));
 		break;
 	}
 	case OBJ_ARRAY_U16:
@@ -162,7 +271,7 @@ void freeObject(Obj* object) {
 #if DEBUG_LOG_GC
 		printf("[gc] %p free buffer : %llu\n", (void*)array->payload, (uint64_t)array->capacity * 2);
 #endif
-		FREE(ObjArray, object);
+		gc_release(object, sizeof(ObjArray));
 		break;
 	}
 	case OBJ_ARRAY_U8:
@@ -174,29 +283,53 @@ void freeObject(Obj* object) {
 #if DEBUG_LOG_GC
 		printf("[gc] %p free buffer : %llu\n", (void*)array->payload, (uint64_t)array->capacity);
 #endif
-		FREE(ObjArray, object);
+		gc_release(object, sizeof(ObjArray));
 		break;
 	}
 	}
 	}
 }
 
+static void freeSegments(ObjSegments* list) {
+	for (uint32_t i = 0; i < list->count; ++i) {
+		Obj* object = list->segments[i].first;
+		while (object != NULL) {
+			Obj* next = OBJ_PTR_GET_NEXT(object);
+			freeObject(object);
+			object = next;
+		}
+	}
+
+	if (list->segments != NULL) mem_free(list->segments);
+	*list = (ObjSegments){ .count = 0, .capacity = 0, .segments = NULL };
+}
+
 void freeObjects()
 {
 #if DEBUG_LOG_GC
 	printf("-- free dynamic objects\n");
 #endif
-	Obj* object = vm.objects;
-	while (object != NULL) {
-		Obj* next = OBJ_PTR_GET_NEXT(object);
-		freeObject(object);
-		object = next;
+	freeSegments(&vm.objects);
+	freeSegments(&vm.sweepObjects);
+	Obj* lists[] = { vm.youngObjects, vm.sweepYoungObjects };
+	for (uint32_t i = 0; i < 2; ++i) {
+		Obj* object = lists[i];
+		while (object != NULL) {
+			Obj* next = OBJ_PTR_GET_NEXT(object);
+			freeObject(object);
+			object = next;
+		}
 	}
+	gc_freeBlocks();
 
 	if (vm.grayStack != NULL) {
 		mem_free(vm.grayStack);
 	}
 
+	if (vm.remembered != NULL) {
+		mem_free(vm.remembered);
+	}
+
 #if DEBUG_LOG_GC
 	printf("-- free static objects\n");
 #endif
@@ -6,10 +6,14 @@
 #pragma once
 #include "common.h"
 #include "value.h"
+#include "thread.h"
 
 #define GROW_CAPACITY(capacity) \
 	((capacity) < 16 ? 16 : (capacity << 1))
 
+//vm.bytesAllocated.a thread of a parallel sweep counts what it frees on its own,the script adds it after
+extern THREAD_LOCAL uint64_t* allocatedBytes;
+
 void* reallocate(void* pointer, uint64_t oldSize, uint64_t newSize);
 
 #define GROW_ARRAY(type, pointer, oldCount, newCount) \
@@ -41,6 +45,11 @@ void* reallocate_no_gc(void* pointer, uint64_t oldSize, uint64_t newSize);
 
 #define FREE_FLEX_NO_GC(type,pointer,flexType,count) reallocate_no_gc(pointer, sizeof(type) + sizeof(flexType) * count, 0)
 
+//address space of size bytes with a guard page after it,the pages are only backed when touched.
+//size is a multiple of the page size,it exits when there is no address space
+void* reserveMemory(uint64_t size);
+void releaseMemory(void* memory, uint64_t size);
+
 void freeObject(Obj* object);
 void freeObjects();
 
@@ -6,12 +6,13 @@
 #include "nativeBuiltin.h"
 #include "vm.h"
 #include "object.h"
+#include "gc.h"
 //Array
 
 static Value lengthNative(int argCount, Value* args)
 {
 	if (argCount >= 1 && isArrayLike(args[0])) {
-		return NUMBER_VAL(AS_ARRAY(args[0])->length);
+		return NUMBER_VAL_FIT(AS_ARRAY(args[0])->length);
 	}
 	else {
 		return NAN_VAL;
@@ -28,7 +29,8 @@ static Value pushNative(int argCount, Value* args) {
 	ObjArray* array = AS_ARRAY(args[0]);
 
 	if (argCount >= 2) {
-		uint64_t newSize = (uint64_t)array->length + argCount - 1;
+		uint32_t count = (uint32_t)argCount;
+		uint64_t newSize = (uint64_t)array->length + count - 1;
 
 		if (newSize > ARRAYLIKE_MAX) {
 			fprintf(stderr, "Array size overflow\n");
@@ -51,13 +53,18 @@ static Value pushNative(int argCount, Value* args) {
 
 		if (OBJ_IS_TYPE(array, OBJ_ARRAY)) {
 			//no type check,so it's faster
-			for (uint32_t i = 1; i < argCount; ++i) {
+			gc_lockLayout(&array->obj);
+			for (uint32_t i = 1; i < count; ++i) {
 				ARRAY_ELEMENT(array, Value, array->length) = args[i];
 				array->length++;
 			}
+			gc_unlockLayout(&array->obj);
+			for (uint32_t i = 1; i < count; ++i) {
+				gc_writeBarrier(&array->obj, args[i]);
+			}
 		}
 		else {//typed array
-			for (uint32_t i = 1; i < argCount; ++i) {
+			for (uint32_t i = 1; i < count; ++i) {
 				Value val = IS_NUMBER(args[i]) ? args[i] : NUMBER_VAL(0);
 
 				switch (OBJ_GET_TYPE(array->obj)) {
@@ -92,7 +99,7 @@ static Value pushNative(int argCount, Value* args) {
 		}
 	}
 
-	return NUMBER_VAL(array->length);
+	return NUMBER_VAL_FIT(array->length);
 }
 
 static Value popNative(int argCount, Value* args) {
@@ -142,10 +149,12 @@ static Value resizeNative(int argCount, Value* args) {
 
 			if (OBJ_IS_TYPE(array, OBJ_ARRAY)) {
 				//no type check,so it's faster
+				gc_lockLayout(&array->obj);
 				while (array->length < length) {
 					ARRAY_ELEMENT(array, Value, array->length) = NIL_VAL;
 					array->length++;
 				}
+				gc_unlockLayout(&array->obj);
 			}
 			else {//typed array
 				switch (OBJ_GET_TYPE(array->obj)) {
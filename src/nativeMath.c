@@ -83,7 +83,7 @@ static Value absNative(int argCount, Value* args) {
 
 static Value floorNative(int argCount, Value* args) {
 	if (argCount >= 1 && IS_NUMBER(args[0])) {
-		return NUMBER_VAL(floor(AS_NUMBER(args[0])));
+		return NUMBER_VAL_FIT(floor(AS_NUMBER(args[0])));
 	}
 	else {
 		return NAN_VAL;
@@ -92,7 +92,7 @@ static Value floorNative(int argCount, Value* args) {
 
 static Value ceilNative(int argCount, Value* args) {
 	if (argCount >= 1 && IS_NUMBER(args[0])) {
-		return NUMBER_VAL(ceil(AS_NUMBER(args[0])));
+		return NUMBER_VAL_FIT(ceil(AS_NUMBER(args[0])));
 	}
 	else {
 		return NAN_VAL;
@@ -101,7 +101,7 @@ static Value ceilNative(int argCount, Value* args) {
 
 static Value roundNative(int argCount, Value* args) {
 	if (argCount >= 1 && IS_NUMBER(args[0])) {
-		return NUMBER_VAL(round(AS_NUMBER(args[0])));
+		return NUMBER_VAL_FIT(round(AS_NUMBER(args[0])));
 	}
 	else {
 		return NAN_VAL;
@@ -222,22 +222,22 @@ void importNative_math() {
 
 	defineNative_math("max", maxNative);
 	defineNative_math("min", minNative);
-	defineNative_math("abs", absNative);
-	defineNative_math("floor", floorNative);
-	defineNative_math("ceil", ceilNative);
-	defineNative_math("round", roundNative);
-	defineNative_math("pow", powNative);
-	defineNative_math("sqrt", sqrtNative);
-	defineNative_math("sin", sinNative);
-	defineNative_math("asin", asinNative);
-	defineNative_math("cos", cosNative);
-	defineNative_math("acos", acosNative);
-	defineNative_math("tan", tanNative);
-	defineNative_math("atan", atanNative);
-	defineNative_math("log", logNative);
-	defineNative_math("log2", log2Native);
-	defineNative_math("log10", log10Native);
-	defineNative_math("exp", expNative);
+	defineNativeUnary_math("abs", absNative, fabs);
+	defineNativeUnary_math("floor", floorNative, floor);
+	defineNativeUnary_math("ceil", ceilNative, ceil);
+	defineNativeUnary_math("round", roundNative, round);
+	defineNativeBinary_math("pow", powNative, pow);
+	defineNativeUnary_math("sqrt", sqrtNative, sqrt);
+	defineNativeUnary_math("sin", sinNative, sin);
+	defineNativeUnary_math("asin", asinNative, asin);
+	defineNativeUnary_math("cos", cosNative, cos);
+	defineNativeUnary_math("acos", acosNative, acos);
+	defineNativeUnary_math("tan", tanNative, tan);
+	defineNativeUnary_math("atan", atanNative, atan);
+	defineNativeUnary_math("log", logNative, log);
+	defineNativeUnary_math("log2", log2Native, log2);
+	defineNativeUnary_math("log10", log10Native, log10);
+	defineNativeUnary_math("exp", expNative, exp);
 	defineNative_math("isNaN", isNaNNative);
 	defineNative_math("isFinite", isFiniteNative);
 	defineNative_math("random", randomNative);
@@ -56,6 +56,20 @@ static Value getGlobalNative(int argCount, Value* args) {
 	return OBJ_VAL(&vm.globals);
 }
 
+static void pushKey(ObjArray* result, ObjString* key) {
+	// Check if we need to grow the array  
+	uint64_t newSize = result->length + 1;
+
+	if (newSize > result->capacity) {
+		uint64_t newCapacity = max((result->capacity < 64) ? (result->capacity * 2) : ((result->capacity * 3) >> 1), 8);
+		reserveArray(result, newCapacity);
+	}
+
+	// Add key to result array  
+	ARRAY_ELEMENT(result, Value, result->length) = OBJ_VAL(key);
+	result->length++;
+}
+
 COLD_FUNCTION
 static Value keysNative(int argCount, Value* args) {
 	// Create an empty array as result  
@@ -71,21 +85,30 @@ static Value keysNative(int argCount, Value* args) {
 	// Get instance object  
 	ObjInstance* instance = AS_INSTANCE(args[0]);
 
-	// Iterate through the instance's fields table  
-	for (uint32_t i = 0; i < instance->fields.capacity; i++) {
-		Entry* entry = &instance->fields.entries[i];
-		if (entry->key != NULL) {
-			// Check if we need to grow the array  
-			uint64_t newSize = result->length + 1;
-
-			if (newSize > result->capacity) {
-				uint64_t newCapacity = max((result->capacity < 64) ? (result->capacity * 2) : ((result->capacity * 3) >> 1), 8);
-				reserveArray(result, newCapacity);
+	if (INSTANCE_IS_GLOBAL(instance)) {
+		// Iterate through the global slots in order, undefined slot is no key
+		for (uint32_t i = 0; i < vm.globalCount; i++) {
+			if (!IS_UNDEFINED(vm.globalValues[i])) {
+				pushKey(result, vm.globalNames[i]);
+			}
+		}
+	}
+	else if (INSTANCE_IS_DICTIONARY(instance)) {
+		// Iterate through the instance's fields table  
+		for (uint32_t i = 0; i < instance->fields.capacity; i++) {
+			Entry* entry = &instance->fields.entries[i];
+			if (entry->key != NULL) {
+				pushKey(result, entry->key);
+			}
+		}
+	}
+	else {
+		// Iterate through the slots in order, undefined slot is deleted
+		Shape* shape = instance->shape;
+		for (uint32_t i = 0; i < shape->slotCount; i++) {
+			if (!IS_UNDEFINED(instance->slots[i])) {
+				pushKey(result, shape->keys[i]);
 			}
-
-			// Add key to result array  
-			ARRAY_ELEMENT(result, Value, result->length) = OBJ_VAL(entry->key);
-			result->length++;
 		}
 	}
 
@@ -14,10 +14,10 @@ static Value lengthNative(int argCount, Value* args)
 {
 	if (argCount >= 1) {
 		if (IS_STRING(args[0])) {
-			return NUMBER_VAL(AS_STRING(args[0])->length);
+			return NUMBER_VAL_FIT(AS_STRING(args[0])->length);
 		}
 		else if (IS_STRING_BUILDER(args[0])) {
-			return NUMBER_VAL(AS_ARRAY(args[0])->length);
+			return NUMBER_VAL_FIT(AS_ARRAY(args[0])->length);
 		}
 	}
 	return NAN_VAL;
@@ -65,7 +65,7 @@ static Value UTF8LenNative(int argCount, Value* args) {
 					return NAN_VAL;//invalid utf8
 				}
 			}
-			return NUMBER_VAL((double)char_count);
+			return NUMBER_VAL_FIT((double)char_count);
 		}
 	}
 
@@ -311,7 +311,7 @@ static Value parseIntNative(int argCount, Value* args) {
 					int64_t value = strtol(startPtr + 2, &endPtr, 2);
 					if (endPtr != startPtr + 2) {
 						if (isNegative) value = -value;
-						return NUMBER_VAL((double)value);
+						return NUMBER_VAL_FIT((double)value);
 					}
 				}
 				else if (startPtr[1] == 'x' || startPtr[1] == 'X') {
@@ -320,7 +320,7 @@ static Value parseIntNative(int argCount, Value* args) {
 					int64_t value = strtol(startPtr, &endPtr, 16);
 					if (endPtr != startPtr) {
 						if (isNegative) value = -value;
-						return NUMBER_VAL((double)value);
+						return NUMBER_VAL_FIT((double)value);
 					}
 				}
 			}
@@ -329,7 +329,7 @@ static Value parseIntNative(int argCount, Value* args) {
 				int64_t value = strtol(startPtr, &endPtr, base);
 				if (endPtr != startPtr) {
 					if (isNegative) value = -value;
-					return NUMBER_VAL((double)value);
+					return NUMBER_VAL_FIT((double)value);
 				}
 			}
 		}
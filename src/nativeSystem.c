@@ -53,6 +53,24 @@ static Value gcBeginNative(int argCount, Value* args) {
 	}
 }
 
+//change the pause target of the incremental collection in milliseconds,0 collects all at once
+static Value gcPauseNative(int argCount, Value* args) {
+	if (argCount == 1 && IS_NUMBER(args[0])) {
+		double pause = AS_NUMBER(args[0]);
+		if (!(pause > 0)) {
+			pause = 0;
+		}
+		else if (pause > 1000) {
+			pause = 1000;
+		}
+		changePauseTarget((uint64_t)(pause * 1e6));
+		return BOOL_VAL(true);
+	}
+	else {
+		return BOOL_VAL(false);
+	}
+}
+
 static Value allocatedBytesNative(int argCount, Value* args) {
 	return NUMBER_VAL((double)vm.bytesAllocated);
 }
@@ -230,6 +248,7 @@ void importNative_system() {
 	defineNative_system("gc", gcNative);
 	defineNative_system("gcNext", gcNextNative);
 	defineNative_system("gcBegin", gcBeginNative);
+	defineNative_system("gcPause", gcPauseNative);
 	defineNative_system("allocated", allocatedBytesNative);
 	defineNative_system("static", staticBytesNative);
 
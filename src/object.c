@@ -48,15 +48,16 @@ static Obj* allocateObject(uint64_t size, ObjType type) {
 		object = (Obj*)reallocate_no_gc(NULL, 0, size);
 		OBJ_PTR_SET_NEXT(object, vm.objects_no_gc);
 		object->type = type;
-		object->isMarked = !vm.gcMark;
+		object->isMarked = OBJ_OLD_BIT | !vm.gcMark;
 		vm.objects_no_gc = object;
 		break;
 	default:
-		object = (Obj*)reallocate(NULL, 0, size);
-		OBJ_PTR_SET_NEXT(object, vm.objects);
+		//young until it survives a collection
+		object = gc_allocate(size);
+		OBJ_PTR_SET_NEXT(object, vm.youngObjects);
 		object->type = type;
 		object->isMarked = !vm.gcMark;
-		vm.objects = object;
+		vm.youngObjects = object;
 		break;
 	}
 
@@ -81,25 +82,81 @@ ObjFunction* newFunction() {
 	ObjFunction* function = ALLOCATE_OBJ(ObjFunction, OBJ_FUNCTION);
 	function->arity = 0;
 	function->upvalueCount = 0;
+	function->captureCount = 0;
+	function->closesUpvalues = false;
+	function->maxStack = 1;
 	function->id = vm.functionID++;//unique id
 	function->name = NULL;
+	function->propertyCacheCount = 0;
+	function->propertyCacheCapacity = 0;
+	function->propertyCaches = NULL;
+	function->invokeCacheCount = 0;
+	function->invokeCacheCapacity = 0;
+	function->invokeCaches = NULL;
+	function->hotness = 0;
+	function->jit = NULL;
+	function->traceAnchorCount = 0;
+	function->traceAnchorCapacity = 0;
+	function->traceAnchors = NULL;
+	function->aot = NULL;
+	function->closure = NULL;
 	chunk_init(&function->chunk);
 	return function;
 }
 
 HOT_FUNCTION
 ObjClosure* newClosure(ObjFunction* function) {
-	ObjUpvalue** upvalues = ALLOCATE(ObjUpvalue*, function->upvalueCount);
-	for (uint32_t i = 0; i < function->upvalueCount; i++) {
+	ObjClosure* closure = ALLOCATE_FLEX_OBJ(ObjClosure, OBJ_CLOSURE, CLOSURE_SIZE(function->upvalueCount, function->captureCount));
+	closure->function = function;
+	closure->upvalueCount = function->upvalueCount;
+	closure->captureCount = function->captureCount;
+
+	for (uint32_t i = 0; i < closure->captureCount; i++) {
+		closure->captures[i] = NIL_VAL;
+	}
+	ObjUpvalue** upvalues = CLOSURE_UPVALUES(closure);
+	for (uint32_t i = 0; i < closure->upvalueCount; i++) {
 		upvalues[i] = NULL;
 	}
 
-	ObjClosure* closure = ALLOCATE_OBJ(ObjClosure, OBJ_CLOSURE);
+	return closure;
+}
+
+COLD_FUNCTION
+void makeSharedClosure(ObjFunction* function) {
+	//not in the list of objects,same as the function
+	ObjClosure* closure = (ObjClosure*)reallocate_no_gc(NULL, 0, sizeof(ObjClosure));
+	closure->obj = stateLess_obj_header(OBJ_CLOSURE);
 	closure->function = function;
-	closure->upvalues = upvalues;
-	closure->upvalueCount = function->upvalueCount;
+	closure->upvalueCount = 0;
+	closure->captureCount = 0;
+	function->closure = closure;
+}
 
-	return closure;
+//alloc a cache for property instruction,return the index
+uint32_t addPropertyCache(ObjFunction* function) {
+	if (function->propertyCacheCount == function->propertyCacheCapacity) {
+		uint32_t oldCapacity = function->propertyCacheCapacity;
+		function->propertyCacheCapacity = GROW_CAPACITY(oldCapacity);
+		function->propertyCaches = GROW_ARRAY_NO_GC(PropertyCache, function->propertyCaches, oldCapacity, function->propertyCacheCapacity);
+	}
+
+	//no instance has NULL shape, so the first lookup must miss
+	function->propertyCaches[function->propertyCacheCount] = (PropertyCache){ .shape = NULL, .transition = NULL, .slot = 0 };
+	return function->propertyCacheCount++;
+}
+
+//alloc a cache for invoke instruction,return the index
+uint32_t addInvokeCache(ObjFunction* function) {
+	if (function->invokeCacheCount == function->invokeCacheCapacity) {
+		uint32_t oldCapacity = function->invokeCacheCapacity;
+		function->invokeCacheCapacity = GROW_CAPACITY(oldCapacity);
+		function->invokeCaches = GROW_ARRAY_NO_GC(InvokeCache, function->invokeCaches, oldCapacity, function->invokeCacheCapacity);
+	}
+
+	//empty cache always misses
+	function->invokeCaches[function->invokeCacheCount] = (InvokeCache){ .epoch = 0, .count = 0 };
+	return function->invokeCacheCount++;
 }
 
 ObjBoundMethod* newBoundMethod(Value receiver, ObjClosure* method)
@@ -114,6 +171,23 @@ ObjBoundMethod* newBoundMethod(Value receiver, ObjClosure* method)
 ObjNative* newNative(NativeFn function) {
 	ObjNative* native = ALLOCATE_OBJ(ObjNative, OBJ_NATIVE);
 	native->function = function;
+	native->fastArity = 0;
+	native->constant = UINT32_MAX;
+	native->unary = NULL;
+	return native;
+}
+
+ObjNative* newNativeUnary(NativeFn function, NativeUnaryFn unary) {
+	ObjNative* native = newNative(function);
+	native->fastArity = 1;
+	native->unary = unary;
+	return native;
+}
+
+ObjNative* newNativeBinary(NativeFn function, NativeBinaryFn binary) {
+	ObjNative* native = newNative(function);
+	native->fastArity = 2;
+	native->binary = binary;
 	return native;
 }
 
@@ -122,7 +196,6 @@ ObjClass* newClass(ObjString* name)
 	ObjClass* klass = ALLOCATE_OBJ(ObjClass, OBJ_CLASS);
 	klass->name = name;
 	klass->initializer = NIL_VAL;
-	klass->methods.isGlobal = false;
 	klass->methods.isFrozen = false;
 	table_init(&klass->methods);
 	return klass;
@@ -132,12 +205,147 @@ HOT_FUNCTION
 ObjInstance* newInstance(ObjClass* klass) {
 	ObjInstance* instance = ALLOCATE_OBJ(ObjInstance, OBJ_INSTANCE);
 	instance->klass = klass;
-	instance->fields.isGlobal = false;
-	instance->fields.isFrozen = false;
-	table_init(&instance->fields);
+	instance->shape = vm.rootShape;
+	instance->slotCapacity = 0;
+	instance->deleteCount = 0;
+	instance->slots = NULL;
 	return instance;
 }
 
+//make sure the slots can hold slotCount values
+HOT_FUNCTION
+void instanceReserve(ObjInstance* instance, uint32_t slotCount) {
+	if (slotCount > instance->slotCapacity) {
+		uint32_t oldCapacity = instance->slotCapacity;
+		uint32_t newCapacity = (oldCapacity < 4) ? 4 : (oldCapacity << 1);
+		while (newCapacity < slotCount) newCapacity <<= 1;
+		//gc may happen here, the old shape still describes the old slots
+		gc_lockLayout(&instance->obj);
+		instance->slots = GROW_ARRAY(Value, instance->slots, oldCapacity, newCapacity);
+		instance->slotCapacity = newCapacity;
+		gc_unlockLayout(&instance->obj);
+	}
+}
+
+//shape mode -> dictionary mode
+static void instanceToDictionary(ObjInstance* instance) {
+	Table fields = { .isFrozen = false };
+	table_init(&fields);
+
+	//gc may happen here, the slots are still alive
+	Shape* shape = instance->shape;
+	for (uint32_t slot = 0; slot < shape->slotCount; ++slot) {
+		if (!IS_UNDEFINED(instance->slots[slot])) {
+			tableSet(&fields, shape->keys[slot], instance->slots[slot]);
+		}
+	}
+
+	gc_lockLayout(&instance->obj);
+	FREE_ARRAY(Value, instance->slots, instance->slotCapacity);
+	instance->shape = &vm.dictionaryShape;
+	instance->fields = fields;
+	gc_unlockLayout(&instance->obj);
+}
+
+//add a new slot for key
+static void instanceAddSlot(ObjInstance* instance, ObjString* key, Value value) {
+	Shape* shape = shapeTransition(instance->shape, key);
+
+	if (shape == NULL) {
+		instanceToDictionary(instance);
+		gc_lockLayout(&instance->obj);
+		tableSet(&instance->fields, key, value);
+		gc_unlockLayout(&instance->obj);
+		return;
+	}
+
+	instanceReserve(instance, shape->slotCount);
+	gc_lockLayout(&instance->obj);
+	instance->slots[shape->slotCount - 1] = value;
+	instance->shape = shape;
+	gc_unlockLayout(&instance->obj);
+}
+
+HOT_FUNCTION
+bool instanceGet(ObjInstance* instance, ObjString* key, Value* value_out) {
+	if (INSTANCE_IS_DICTIONARY(instance)) {
+		if (INSTANCE_IS_GLOBAL(instance)) return globalGet(key, value_out);
+		return tableGet(&instance->fields, key, value_out);
+	}
+
+	uint32_t slot = shapeGetSlot(instance->shape, key);
+	//undefined slot is a deleted field,nil is a value
+	if (slot == SHAPE_INVALID_SLOT || IS_UNDEFINED(instance->slots[slot])) return false;
+
+	*value_out = instance->slots[slot];
+	return true;
+}
+
+//set nil means delete,the slot keeps undefined as tombstone
+HOT_FUNCTION
+void instanceSet(ObjInstance* instance, ObjString* key, Value value) {
+	//only a major collection may run before the store,nothing is young after it
+	gc_writeBarrier(&instance->obj, value);
+
+	if (INSTANCE_IS_DICTIONARY(instance)) {
+		if (INSTANCE_IS_GLOBAL(instance)) {
+			globalSet(key, value);
+		}
+		else {
+			gc_lockLayout(&instance->obj);
+			if (NOT_NIL(value)) {
+				tableSet(&instance->fields, key, value);
+			}
+			else {
+				tableDelete(&instance->fields, key);
+			}
+			gc_unlockLayout(&instance->obj);
+		}
+		return;
+	}
+
+	uint32_t slot = shapeGetSlot(instance->shape, key);
+	if (slot != SHAPE_INVALID_SLOT) {
+		if (IS_NIL(value)) {
+			if (IS_UNDEFINED(instance->slots[slot])) return;
+			instance->slots[slot] = UNDEFINED_VAL;
+			if (++instance->deleteCount > INSTANCE_MAX_DELETES) instanceToDictionary(instance);
+			return;
+		}
+
+		instance->slots[slot] = value;
+	}
+	else if (NOT_NIL(value)) {
+		instanceAddSlot(instance, key, value);
+	}
+}
+
+//for object literal, keep the slot even if value is nil
+HOT_FUNCTION
+void instanceDefine(ObjInstance* instance, ObjString* key, Value value) {
+	gc_writeBarrier(&instance->obj, value);
+
+	if (INSTANCE_IS_DICTIONARY(instance)) {
+		if (INSTANCE_IS_GLOBAL(instance)) {
+			vm.globalValues[globalSlot(key)] = value;
+		}
+		else {
+			gc_lockLayout(&instance->obj);
+			tableSet(&instance->fields, key, value);
+			gc_unlockLayout(&instance->obj);
+		}
+		return;
+	}
+
+	uint32_t slot = shapeGetSlot(instance->shape, key);
+	if (slot != SHAPE_INVALID_SLOT) {
+		instance->slots[slot] = value;
+	}
+	else {
+		instanceAddSlot(instance, key, value);
+	}
+}
+
 HOT_FUNCTION
 ObjArray* newArray(ObjType type) {
 	ObjArray* array = ALLOCATE_OBJ(ObjArray, type);
@@ -160,6 +368,8 @@ void reserveArray(ObjArray* array, uint64_t size)
 #define GROW_TYPED_ARRAY(type, ptr, size) reallocate(ptr, sizeof(type) * array->capacity, sizeof(type) * size)
 	void* newPayload = NULL;
 
+	gc_lockLayout(&array->obj);
+
 	switch (OBJ_GET_TYPE(array->obj)) {
 	case OBJ_ARRAY:
 		newPayload = GROW_TYPED_ARRAY(Value, array->payload, size);
@@ -195,6 +405,7 @@ void reserveArray(ObjArray* array, uint64_t size)
 
 	array->payload = newPayload;
 	array->capacity = size;
+	gc_unlockLayout(&array->obj);
 #undef GROW_TYPED_ARRAY
 }
 
@@ -207,20 +418,22 @@ Value getTypedArrayElement(ObjArray* array, uint32_t index)
 		return NUMBER_VAL(ARRAY_ELEMENT(array, double, index));
 	case OBJ_ARRAY_F32:
 		return NUMBER_VAL(ARRAY_ELEMENT(array, float, index));
-	case OBJ_ARRAY_U32:
-		return NUMBER_VAL(ARRAY_ELEMENT(array, uint32_t, index));
+	case OBJ_ARRAY_U32: {
+		uint32_t element = ARRAY_ELEMENT(array, uint32_t, index);
+		return (element <= INT32_MAX) ? INT_VAL(element) : NUMBER_VAL(element);
+	}
 	case OBJ_ARRAY_I32:
-		return NUMBER_VAL(ARRAY_ELEMENT(array, int32_t, index));
+		return INT_VAL(ARRAY_ELEMENT(array, int32_t, index));
 	case OBJ_ARRAY_U16:
-		return NUMBER_VAL(ARRAY_ELEMENT(array, uint16_t, index));
+		return INT_VAL(ARRAY_ELEMENT(array, uint16_t, index));
 	case OBJ_ARRAY_I16:
-		return NUMBER_VAL(ARRAY_ELEMENT(array, int16_t, index));
+		return INT_VAL(ARRAY_ELEMENT(array, int16_t, index));
 	case OBJ_ARRAY_U8:
-		return NUMBER_VAL(ARRAY_ELEMENT(array, uint8_t, index));
+		return INT_VAL(ARRAY_ELEMENT(array, uint8_t, index));
 	case OBJ_ARRAY_I8:
-		return NUMBER_VAL(ARRAY_ELEMENT(array, int8_t, index));
+		return INT_VAL(ARRAY_ELEMENT(array, int8_t, index));
 	case OBJ_STRING_BUILDER:
-		return NUMBER_VAL(ARRAY_ELEMENT(array, uint8_t, index));
+		return INT_VAL(ARRAY_ELEMENT(array, uint8_t, index));
 	default:
 		return NIL_VAL;
 	}
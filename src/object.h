@@ -8,6 +8,7 @@
 #include "value.h"
 #include "table.h"
 #include "chunk.h"
+#include "shape.h"
 
 typedef enum {
 	//objects that don't gc
@@ -64,6 +65,12 @@ typedef enum {
 extern const C_STR objTypeInfo[];
 #endif
 
+//bits of isMarked
+#define OBJ_MARK_BIT		0x01	//reached when it equals vm.gcMark
+#define OBJ_OLD_BIT			0x02	//survived a collection,only a major one frees it
+#define OBJ_REMEMBERED_BIT	0x04	//old and in vm.remembered
+#define OBJ_LOCK_BIT		0x08	//the marking thread scans it or the script changes its layout
+
 #if COMPRESS_OBJ_HEADER
 struct Obj {
 	union {
@@ -81,7 +88,7 @@ struct Obj {
 
 static inline Obj stateLess_obj_header(ObjType objType) {
 	Obj o = { .boxedNext = (uintptr_t)NULL << 16 };
-	o.isMarked = 1;
+	o.isMarked = OBJ_OLD_BIT | 1;
 	o.type = objType;
 	return o;
 }
@@ -100,18 +107,75 @@ struct Obj {
 #define OBJ_PTR_GET_NEXT(obj)			(obj->next)
 
 static inline Obj stateLess_obj_header(ObjType objType) {
-	return (Obj) { .next = NULL, .isMarked = 1, .type = objType };
+	return (Obj) { .next = NULL, .isMarked = OBJ_OLD_BIT | 1, .type = objType };
 }
 
 #endif
 
+//monomorphic inline cache of a property instruction
+#define PROPERTY_CACHE_MAX UINT16_MAX
+typedef struct {
+	Shape* shape;		//shape of instance when cached
+	Shape* transition;	//shape after adding the key,NULL if key exists
+	uint32_t slot;		//slot of the key
+} PropertyCache;
+
+//polymorphic inline cache of an invoke instruction
+#define INVOKE_CACHE_MAX UINT16_MAX
+#define INVOKE_CACHE_WAYS 4
+typedef struct ObjClass ObjClass;
+typedef struct ObjClosure ObjClosure;
+typedef struct JitCode JitCode;
+typedef struct TraceAnchor TraceAnchor;
+typedef struct AotFunction AotFunction;
+
+typedef struct {
+	ObjClass* klass;		//class of receiver
+	Shape* shape;			//shape of receiver,no field shadows the method
+	ObjClosure* method;		//resolved method
+} InvokeCacheEntry;
+
+typedef struct {
+	uint32_t epoch;			//vm.methodCacheEpoch when filled
+	uint32_t count;			//used entries
+	InvokeCacheEntry entries[INVOKE_CACHE_WAYS];
+} InvokeCache;
+
 typedef struct {
 	Obj obj;
 	uint16_t arity;
-	uint16_t upvalueCount;
+	uint16_t upvalueCount;	//boxed,the variables assigned after they are captured
+	uint16_t captureCount;	//copied into the closure
+	bool closesUpvalues;	//some local is captured boxed,the return closes the upvalues of the frame
 	uint32_t id;
+	uint32_t maxStack;	//the most values of a frame,the callee and the arguments included
 	Chunk chunk;
 	ObjString* name;
+
+	//inline caches of property instructions
+	uint32_t propertyCacheCount;
+	uint32_t propertyCacheCapacity;
+	PropertyCache* propertyCaches;
+
+	//inline caches of invoke instructions
+	uint32_t invokeCacheCount;
+	uint32_t invokeCacheCapacity;
+	InvokeCache* invokeCaches;
+
+	//calls and loop back edges,compiled by jit when hot
+	uint32_t hotness;
+	JitCode* jit;
+
+	//loop headers counted by the trace recorder
+	uint32_t traceAnchorCount;
+	uint32_t traceAnchorCapacity;
+	TraceAnchor* traceAnchors;
+
+	//C code of --emit-c,NULL if interpreted
+	const AotFunction* aot;
+
+	//pushed by every OP_CLOSURE of a function that captures nothing,NULL for the others
+	ObjClosure* closure;
 } ObjFunction;
 
 typedef struct ObjUpvalue {
@@ -121,12 +185,18 @@ typedef struct ObjUpvalue {
 	struct ObjUpvalue* next;
 } ObjUpvalue;
 
-typedef struct {
+struct ObjClosure {
 	Obj obj;
-	uint32_t upvalueCount;
-	ObjUpvalue** upvalues;
+	uint16_t upvalueCount;
+	uint16_t captureCount;
 	ObjFunction* function;
-} ObjClosure;
+	//the copied values,then the pointers of the boxed upvalues.one allocation with the closure
+	Value captures[];
+};
+
+//the boxed upvalues of the closure,after its captures
+#define CLOSURE_UPVALUES(closure) ((ObjUpvalue**)((closure)->captures + (closure)->captureCount))
+#define CLOSURE_SIZE(upvalueCount, captureCount) (sizeof(ObjClosure) + sizeof(Value) * (captureCount) + sizeof(ObjUpvalue*) * (upvalueCount))
 
 typedef struct {
 	Obj obj;
@@ -136,29 +206,54 @@ typedef struct {
 
 //argCount and argValues
 typedef Value(*NativeFn)(int argCount, Value* args);
+//fast path with fixed arity,arguments and result are unboxed numbers
+typedef double(*NativeUnaryFn)(double a);
+typedef double(*NativeBinaryFn)(double a, double b);
 
 typedef struct {
 	Obj obj;
 	NativeFn function;
+	uint32_t fastArity; //0 means no fast path
+	uint32_t constant; //index in shared constants,UINT32_MAX if not added
+	union {
+		NativeUnaryFn unary;
+		NativeBinaryFn binary;
+	};
 } ObjNative;
 
-typedef struct {
+struct ObjClass {
 	Obj obj;
 	ObjString* name;
 	Value initializer;//inline cache
 	Table methods;
-} ObjClass;
+};
+
+//too many deletes makes instance go dictionary mode
+#define INSTANCE_MAX_DELETES 8
+#define INSTANCE_IS_DICTIONARY(instance) ((instance)->shape == &vm.dictionaryShape)
+//@object.getGlobal(),a dictionary whose fields are the global slots
+#define INSTANCE_IS_GLOBAL(instance) ((instance) == &vm.globals)
 
 typedef struct {
 	Obj obj;
 	ObjClass* klass;
-	Table fields;
+	Shape* shape; //&vm.dictionaryShape means dictionary mode
+	union {
+		//shape mode
+		struct {
+			uint32_t slotCapacity;
+			uint32_t deleteCount;
+			Value* slots;
+		};
+		//dictionary mode
+		Table fields;
+	};
 } ObjInstance;
 
 #define INVALID_OBJ_STRING_SYMBOL UINT32_MAX
 struct ObjString {
 	Obj obj;
-	uint32_t symbol; // used to boost global hash table
+	uint32_t symbol; // the global slot of this name,assigned once by globalSlot()
 	uint32_t length; // the real length,not include '\0'
 	uint64_t hash; // the hash
 	char chars[]; // flexible array members FAM
@@ -192,6 +287,9 @@ typedef struct {
 #define OBJ_IS_TYPE(array, arrayType)		(OBJ_GET_TYPE(array->obj) == arrayType)
 #define ARRAY_ELEMENT(array, type, index)	(((type*)array->payload)[index])
 #define ARRAY_IN_RANGE(array, index)		((index >= 0) && (index < array->length))
+//same as above of a number value,int32 is checked without converting
+#define ARRAY_VALUE_IN_RANGE(array, index)	((IS_INT(index) ? ((uint32_t)AS_INT(index) < (array)->length) : ARRAY_IN_RANGE((array), AS_NUMBER(index))))
+#define ARRAY_VALUE_INDEX(index)			(IS_INT(index) ? (uint32_t)AS_INT(index) : (uint32_t)AS_NUMBER(index))
 
 #define AS_CLOSURE(value)			((ObjClosure*)AS_OBJ(value))
 #define AS_FUNCTION(value)			((ObjFunction*)AS_OBJ(value))
@@ -199,6 +297,7 @@ typedef struct {
 #define AS_CLASS(value)				((ObjClass*)AS_OBJ(value))
 #define AS_INSTANCE(value)			((ObjInstance*)AS_OBJ(value))
 #define AS_NATIVE(value)			(((ObjNative*)AS_OBJ(value))->function)
+#define AS_NATIVE_OBJ(value)		((ObjNative*)AS_OBJ(value))
 #define AS_STRING(value)			((ObjString*)AS_OBJ(value))
 #define AS_ARRAY(value)				((ObjArray*)AS_OBJ(value))
 
@@ -219,6 +318,12 @@ static inline bool isTypedArray(Value value) {
 	return IS_OBJ(value) && (AS_OBJ(value)->type >= OBJ_ARRAY_F64);//enum type
 }
 
+//the guard of array loops,a number index in range of OBJ_ARRAY or OBJ_ARRAY_F64
+static inline bool isArrayLoopIndex(Value target, Value index) {
+	return IS_NUMBER(index) && (isObjType(target, OBJ_ARRAY) || isObjType(target, OBJ_ARRAY_F64))
+		&& ARRAY_VALUE_IN_RANGE(AS_ARRAY(target), index);
+}
+
 ObjString* copyString(C_STR chars, uint32_t length, bool escapeChars);
 ObjString* connectString(ObjString* strA, ObjString* strB);
 
@@ -230,10 +335,20 @@ NumberEntry* getNumberEntryInPool(Value* value);
 ObjUpvalue* newUpvalue(Value* slot);
 ObjFunction* newFunction();
 ObjClosure* newClosure(ObjFunction* function);
+//the closure shared by OP_CLOSURE when function captures nothing,it's freed with the function
+void makeSharedClosure(ObjFunction* function);
+uint32_t addPropertyCache(ObjFunction* function);
+uint32_t addInvokeCache(ObjFunction* function);
 ObjBoundMethod* newBoundMethod(Value receiver, ObjClosure* method);
 ObjNative* newNative(NativeFn function);
+ObjNative* newNativeUnary(NativeFn function, NativeUnaryFn unary);
+ObjNative* newNativeBinary(NativeFn function, NativeBinaryFn binary);
 ObjClass* newClass(ObjString* name);
 ObjInstance* newInstance(ObjClass* klass);
+bool instanceGet(ObjInstance* instance, ObjString* key, Value* value_out);
+void instanceSet(ObjInstance* instance, ObjString* key, Value value);
+void instanceDefine(ObjInstance* instance, ObjString* key, Value value);
+void instanceReserve(ObjInstance* instance, uint32_t slotCount);
 ObjArray* newArray(ObjType type);
 
 void reserveArray(ObjArray* array, uint64_t size);
@@ -20,14 +20,20 @@
 #if IS_CLANGCL || IS_CLANG || IS_GCC
 #define HOT_FUNCTION    __attribute__((hot))
 #define COLD_FUNCTION   __attribute__((cold))
+#define LIKELY(x)       __builtin_expect(!!(x), 1)
+#define UNLIKELY(x)     __builtin_expect(!!(x), 0)
 #define COMPUTE_GOTO 1
 #elif IS_MSVC
 #define HOT_FUNCTION    __pragma(optimize("t", on))
 #define COLD_FUNCTION   __pragma(optimize("t", off))
+#define LIKELY(x)       (x)
+#define UNLIKELY(x)     (x)
 #define COMPUTE_GOTO 0
 #else
 #define HOT_FUNCTION
 #define COLD_FUNCTION
+#define LIKELY(x)       (x)
+#define UNLIKELY(x)     (x)
 #define COMPUTE_GOTO 0
 #endif
 
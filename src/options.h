@@ -27,6 +27,8 @@
 #define LOG_GC_RESULT 0
 // log memory info after execute
 #define LOG_MALLOC_INFO 1
+// log the hit rate of inline caches after execute
+#define LOG_INLINE_CACHE 0
 
 #if !DEBUG_MODE
 #undef DEBUG_PRINT_CODE
@@ -41,4 +43,5 @@
 #undef LOG_EACH_MALLOC_INFO
 #undef LOG_GC_RESULT
 #undef LOG_MALLOC_INFO
+#undef LOG_INLINE_CACHE
 #endif
\ No newline at end of file
@@ -0,0 +1,417 @@
+/*
+ * MIT License
+ * Copyright (c) 2025 IMSDcrueoft (https://github.com/IMSDcrueoft)
+ * See LICENSE file in the root directory for full license text.
+*/
+#include "profile.h"
+#include "chunk.h"
+#include "memory.h"
+
+//the length of a commond that has more than one
+#define PROFILE_VARIABLE_LENGTH UINT8_MAX
+//the function id of the counts of all functions
+#define PROFILE_ALL_FUNCTIONS 0
+//the function id of the sequences the compiler kept on the opStack
+#define PROFILE_OPSTACK UINT32_MAX
+
+typedef struct {
+	uint64_t key;	//function id + 1,length and commonds,0 is empty
+	uint64_t count;
+} ProfileEntry;
+
+typedef struct {
+	STR name;		//copied,the function may be freed before the report
+	uint32_t nameLength;
+	uint64_t count;
+} ProfileFunction;
+
+static struct {
+	ProfileEntry* entries;
+	uint32_t entryCount;
+	uint32_t entryCapacity;	//power of 2
+
+	ProfileFunction* functions;	//by function id
+	uint32_t functionCapacity;
+
+	uint64_t total;
+	uint8_t lengths[UINT8_MAX + 1];
+
+	//the running sequence
+	uint8_t* expected;	//where the next commond of the sequence is
+	uint8_t history[PROFILE_MAX_SEQUENCE - 1];
+	uint32_t historyCount;
+} profile;
+
+static C_STR commondNames[UINT8_MAX + 1] = {
+	[OP_CONSTANT] = "OP_CONSTANT",
+	[OP_GET_LOCAL] = "OP_GET_LOCAL",
+	[OP_SET_LOCAL] = "OP_SET_LOCAL",
+	[OP_ADD] = "OP_ADD",
+	[OP_SUBTRACT] = "OP_SUBTRACT",
+	[OP_MULTIPLY] = "OP_MULTIPLY",
+	[OP_DIVIDE] = "OP_DIVIDE",
+	[OP_MODULUS] = "OP_MODULUS",
+	[OP_NOT] = "OP_NOT",
+	[OP_NEGATE] = "OP_NEGATE",
+	[OP_NIL] = "OP_NIL",
+	[OP_TRUE] = "OP_TRUE",
+	[OP_FALSE] = "OP_FALSE",
+	[OP_EQUAL] = "OP_EQUAL",
+	[OP_GREATER] = "OP_GREATER",
+	[OP_LESS] = "OP_LESS",
+	[OP_NOT_EQUAL] = "OP_NOT_EQUAL",
+	[OP_LESS_EQUAL] = "OP_LESS_EQUAL",
+	[OP_GREATER_EQUAL] = "OP_GREATER_EQUAL",
+	[OP_JUMP] = "OP_JUMP",
+	[OP_LOOP] = "OP_LOOP",
+	[OP_JUMP_IF_FALSE] = "OP_JUMP_IF_FALSE",
+	[OP_JUMP_IF_FALSE_POP] = "OP_JUMP_IF_FALSE_POP",
+	[OP_JUMP_IF_TRUE] = "OP_JUMP_IF_TRUE",
+	[OP_POP] = "OP_POP",
+	[OP_POP_N] = "OP_POP_N",
+	[OP_DUP] = "OP_DUP",
+	[OP_DUP2] = "OP_DUP2",
+	[OP_BITWISE] = "OP_BITWISE",
+	[OP_CALL] = "OP_CALL",
+	[OP_TAIL_CALL] = "OP_TAIL_CALL",
+	[OP_INVOKE] = "OP_INVOKE",
+	[OP_SUPER_INVOKE] = "OP_SUPER_INVOKE",
+	[OP_RETURN] = "OP_RETURN",
+	[OP_GET_PROPERTY] = "OP_GET_PROPERTY",
+	[OP_SET_PROPERTY] = "OP_SET_PROPERTY",
+	[OP_SET_INDEX] = "OP_SET_INDEX",
+	[OP_GET_INDEX] = "OP_GET_INDEX",
+	[OP_GET_SUPER] = "OP_GET_SUPER",
+	[OP_GET_GLOBAL] = "OP_GET_GLOBAL",
+	[OP_SET_GLOBAL] = "OP_SET_GLOBAL",
+	[OP_DEFINE_GLOBAL] = "OP_DEFINE_GLOBAL",
+	[OP_SET_SUBSCRIPT] = "OP_SET_SUBSCRIPT",
+	[OP_GET_SUBSCRIPT] = "OP_GET_SUBSCRIPT",
+	[OP_CLOSURE] = "OP_CLOSURE",
+	[OP_GET_UPVALUE] = "OP_GET_UPVALUE",
+	[OP_SET_UPVALUE] = "OP_SET_UPVALUE",
+	[OP_CLOSE_UPVALUE] = "OP_CLOSE_UPVALUE",
+	[OP_GET_CAPTURE] = "OP_GET_CAPTURE",
+	[OP_NEW_ARRAY] = "OP_NEW_ARRAY",
+	[OP_NEW_OBJECT] = "OP_NEW_OBJECT",
+	[OP_NEW_PROPERTY] = "OP_NEW_PROPERTY",
+	[OP_INSTANCE_OF] = "OP_INSTANCE_OF",
+	[OP_TYPE_OF] = "OP_TYPE_OF",
+	[OP_CLASS] = "OP_CLASS",
+	[OP_INHERIT] = "OP_INHERIT",
+	[OP_METHOD] = "OP_METHOD",
+	[OP_MODULE_BUILTIN] = "OP_MODULE_BUILTIN",
+	[OP_PRINT] = "OP_PRINT",
+	[OP_THROW] = "OP_THROW",
+	[OP_IMPORT] = "OP_IMPORT",
+	[OP_ADD_CONST] = "OP_ADD_CONST",
+	[OP_SUBTRACT_CONST] = "OP_SUBTRACT_CONST",
+	[OP_MULTIPLY_CONST] = "OP_MULTIPLY_CONST",
+	[OP_DIVIDE_CONST] = "OP_DIVIDE_CONST",
+	[OP_MODULUS_CONST] = "OP_MODULUS_CONST",
+	[OP_EQUAL_CONST] = "OP_EQUAL_CONST",
+	[OP_GREATER_CONST] = "OP_GREATER_CONST",
+	[OP_LESS_CONST] = "OP_LESS_CONST",
+	[OP_NOT_EQUAL_CONST] = "OP_NOT_EQUAL_CONST",
+	[OP_LESS_EQUAL_CONST] = "OP_LESS_EQUAL_CONST",
+	[OP_GREATER_EQUAL_CONST] = "OP_GREATER_EQUAL_CONST",
+	[OP_ADD_LOCAL] = "OP_ADD_LOCAL",
+	[OP_SUBTRACT_LOCAL] = "OP_SUBTRACT_LOCAL",
+	[OP_MULTIPLY_LOCAL] = "OP_MULTIPLY_LOCAL",
+	[OP_DIVIDE_LOCAL] = "OP_DIVIDE_LOCAL",
+	[OP_MODULUS_LOCAL] = "OP_MODULUS_LOCAL",
+	[OP_EQUAL_LOCAL] = "OP_EQUAL_LOCAL",
+	[OP_GREATER_LOCAL] = "OP_GREATER_LOCAL",
+	[OP_LESS_LOCAL] = "OP_LESS_LOCAL",
+	[OP_NOT_EQUAL_LOCAL] = "OP_NOT_EQUAL_LOCAL",
+	[OP_LESS_EQUAL_LOCAL] = "OP_LESS_EQUAL_LOCAL",
+	[OP_GREATER_EQUAL_LOCAL] = "OP_GREATER_EQUAL_LOCAL",
+	[OP_NOT_LOCAL] = "OP_NOT_LOCAL",
+	[OP_NEGATE_LOCAL] = "OP_NEGATE_LOCAL",
+	[OP_JUMP_IF_FALSE_EQUAL_LC] = "OP_JUMP_IF_FALSE_EQUAL_LC",
+	[OP_JUMP_IF_FALSE_GREATER_LC] = "OP_JUMP_IF_FALSE_GREATER_LC",
+	[OP_JUMP_IF_FALSE_LESS_LC] = "OP_JUMP_IF_FALSE_LESS_LC",
+	[OP_JUMP_IF_FALSE_NOT_EQUAL_LC] = "OP_JUMP_IF_FALSE_NOT_EQUAL_LC",
+	[OP_JUMP_IF_FALSE_LESS_EQUAL_LC] = "OP_JUMP_IF_FALSE_LESS_EQUAL_LC",
+	[OP_JUMP_IF_FALSE_GREATER_EQUAL_LC] = "OP_JUMP_IF_FALSE_GREATER_EQUAL_LC",
+	[OP_JUMP_IF_FALSE_EQUAL_LL] = "OP_JUMP_IF_FALSE_EQUAL_LL",
+	[OP_JUMP_IF_FALSE_GREATER_LL] = "OP_JUMP_IF_FALSE_GREATER_LL",
+	[OP_JUMP_IF_FALSE_LESS_LL] = "OP_JUMP_IF_FALSE_LESS_LL",
+	[OP_JUMP_IF_FALSE_NOT_EQUAL_LL] = "OP_JUMP_IF_FALSE_NOT_EQUAL_LL",
+	[OP_JUMP_IF_FALSE_LESS_EQUAL_LL] = "OP_JUMP_IF_FALSE_LESS_EQUAL_LL",
+	[OP_JUMP_IF_FALSE_GREATER_EQUAL_LL] = "OP_JUMP_IF_FALSE_GREATER_EQUAL_LL",
+	[OP_INPLACE_ADD_LC] = "OP_INPLACE_ADD_LC",
+	[OP_INPLACE_SUBTRACT_LC] = "OP_INPLACE_SUBTRACT_LC",
+	[OP_INPLACE_MULTIPLY_LC] = "OP_INPLACE_MULTIPLY_LC",
+	[OP_INPLACE_DIVIDE_LC] = "OP_INPLACE_DIVIDE_LC",
+	[OP_INPLACE_ADD_LL] = "OP_INPLACE_ADD_LL",
+	[OP_INPLACE_SUBTRACT_LL] = "OP_INPLACE_SUBTRACT_LL",
+	[OP_INPLACE_MULTIPLY_LL] = "OP_INPLACE_MULTIPLY_LL",
+	[OP_INPLACE_DIVIDE_LL] = "OP_INPLACE_DIVIDE_LL",
+	[OP_INPLACE_ADD_UC] = "OP_INPLACE_ADD_UC",
+	[OP_INPLACE_SUBTRACT_UC] = "OP_INPLACE_SUBTRACT_UC",
+	[OP_INPLACE_MULTIPLY_UC] = "OP_INPLACE_MULTIPLY_UC",
+	[OP_INPLACE_DIVIDE_UC] = "OP_INPLACE_DIVIDE_UC",
+	[OP_INPLACE_ADD_GC] = "OP_INPLACE_ADD_GC",
+	[OP_INPLACE_SUBTRACT_GC] = "OP_INPLACE_SUBTRACT_GC",
+	[OP_INPLACE_MULTIPLY_GC] = "OP_INPLACE_MULTIPLY_GC",
+	[OP_INPLACE_DIVIDE_GC] = "OP_INPLACE_DIVIDE_GC",
+	[OP_REG_MOVE] = "OP_REG_MOVE",
+	[OP_REG_LOAD_CONST] = "OP_REG_LOAD_CONST",
+	[OP_REG_NEGATE] = "OP_REG_NEGATE",
+	[OP_REG_ADD_LL] = "OP_REG_ADD_LL",
+	[OP_REG_SUBTRACT_LL] = "OP_REG_SUBTRACT_LL",
+	[OP_REG_MULTIPLY_LL] = "OP_REG_MULTIPLY_LL",
+	[OP_REG_DIVIDE_LL] = "OP_REG_DIVIDE_LL",
+	[OP_REG_MODULUS_LL] = "OP_REG_MODULUS_LL",
+	[OP_REG_ADD_LC] = "OP_REG_ADD_LC",
+	[OP_REG_SUBTRACT_LC] = "OP_REG_SUBTRACT_LC",
+	[OP_REG_MULTIPLY_LC] = "OP_REG_MULTIPLY_LC",
+	[OP_REG_DIVIDE_LC] = "OP_REG_DIVIDE_LC",
+	[OP_REG_MODULUS_LC] = "OP_REG_MODULUS_LC",
+	[OP_JUMP_IF_IN_ARRAY_LL] = "OP_JUMP_IF_IN_ARRAY_LL",
+	[OP_GET_ELEMENT_LL] = "OP_GET_ELEMENT_LL",
+	[OP_SET_ELEMENT_LL] = "OP_SET_ELEMENT_LL",
+	[OP_GET_SUBSCRIPT_ARRAY] = "OP_GET_SUBSCRIPT_ARRAY",
+	[OP_GET_SUBSCRIPT_F64] = "OP_GET_SUBSCRIPT_F64",
+	[OP_SET_SUBSCRIPT_ARRAY] = "OP_SET_SUBSCRIPT_ARRAY",
+	[OP_SET_SUBSCRIPT_F64] = "OP_SET_SUBSCRIPT_F64",
+	[OP_GET_INDEX_ARRAY] = "OP_GET_INDEX_ARRAY",
+	[OP_GET_INDEX_F64] = "OP_GET_INDEX_F64",
+	[OP_SET_INDEX_ARRAY] = "OP_SET_INDEX_ARRAY",
+	[OP_SET_INDEX_F64] = "OP_SET_INDEX_F64",
+	[OP_ADD_NUMBER] = "OP_ADD_NUMBER",
+	[OP_CALL_NATIVE_NUMBER] = "OP_CALL_NATIVE_NUMBER",
+};
+
+//the commond the compiler emitted
+static uint8_t unquicken(uint8_t commond) {
+	switch (commond) {
+	case OP_GET_SUBSCRIPT_ARRAY:
+	case OP_GET_SUBSCRIPT_F64: return OP_GET_SUBSCRIPT;
+	case OP_SET_SUBSCRIPT_ARRAY:
+	case OP_SET_SUBSCRIPT_F64: return OP_SET_SUBSCRIPT;
+	case OP_GET_INDEX_ARRAY:
+	case OP_GET_INDEX_F64: return OP_GET_INDEX;
+	case OP_SET_INDEX_ARRAY:
+	case OP_SET_INDEX_F64: return OP_SET_INDEX;
+	case OP_ADD_NUMBER: return OP_ADD;
+	case OP_CALL_NATIVE_NUMBER: return OP_CALL;
+	default: return commond;
+	}
+}
+
+static uint64_t makeKey(uint32_t functionKey, uint32_t length, const uint8_t* commonds) {
+	uint64_t key = ((uint64_t)functionKey << 32) | ((uint64_t)length << 24);
+	for (uint32_t i = 0; i < length; ++i) {
+		key |= (uint64_t)commonds[i] << (16 - i * 8);
+	}
+	return key;
+}
+
+static ProfileEntry* findEntry(ProfileEntry* entries, uint32_t capacity, uint64_t key) {
+	uint32_t index = (uint32_t)((key * 0x9e3779b97f4a7c15ull) >> 32) & (capacity - 1);
+	while (entries[index].key != key && entries[index].key != 0) {
+		index = (index + 1) & (capacity - 1);
+	}
+	return &entries[index];
+}
+
+static void growEntries() {
+	uint32_t capacity = (profile.entryCapacity == 0) ? 1024 : profile.entryCapacity * 2;
+	ProfileEntry* entries = ALLOCATE_NO_GC(ProfileEntry, capacity);
+	memset(entries, 0, sizeof(ProfileEntry) * capacity);
+
+	for (uint32_t i = 0; i < profile.entryCapacity; ++i) {
+		if (profile.entries[i].key != 0) {
+			*findEntry(entries, capacity, profile.entries[i].key) = profile.entries[i];
+		}
+	}
+	FREE_ARRAY_NO_GC(ProfileEntry, profile.entries, profile.entryCapacity);
+	profile.entries = entries;
+	profile.entryCapacity = capacity;
+}
+
+static void count(uint32_t functionKey, uint32_t length, const uint8_t* commonds) {
+	if ((profile.entryCount + 1) * 4 > profile.entryCapacity * 3) growEntries();
+
+	uint64_t key = makeKey(functionKey, length, commonds);
+	ProfileEntry* entry = findEntry(profile.entries, profile.entryCapacity, key);
+	if (entry->key == 0) {
+		entry->key = key;
+		profile.entryCount++;
+	}
+	entry->count++;
+}
+
+static ProfileFunction* getFunction(ObjFunction* function) {
+	if (function->id >= profile.functionCapacity) {
+		uint32_t oldCapacity = profile.functionCapacity;
+		profile.functionCapacity = GROW_CAPACITY(oldCapacity);
+		while (profile.functionCapacity <= function->id) profile.functionCapacity *= 2;
+
+		profile.functions = GROW_ARRAY_NO_GC(ProfileFunction, profile.functions, oldCapacity, profile.functionCapacity);
+		memset(profile.functions + oldCapacity, 0, sizeof(ProfileFunction) * (profile.functionCapacity - oldCapacity));
+	}
+
+	ProfileFunction* record = &profile.functions[function->id];
+	if (record->name == NULL) {
+		C_STR name = (function->name == NULL) ? "<script>" : ((function->name->length == 0) ? "<lambda>" : function->name->chars);
+		record->nameLength = (uint32_t)strlen(name);
+		record->name = ALLOCATE_NO_GC(char, record->nameLength + 1);
+		memcpy(record->name, name, record->nameLength + 1);
+	}
+	return record;
+}
+
+void profile_commond(ObjFunction* function, uint8_t* ip) {
+	uint8_t commond = unquicken(ip[0]);
+	uint32_t length = chunk_commondLength(ip);
+
+	if (profile.lengths[commond] == 0) profile.lengths[commond] = (uint8_t)length;
+	else if (profile.lengths[commond] != length) profile.lengths[commond] = PROFILE_VARIABLE_LENGTH;
+
+	//the sequence goes on only if nothing jumped
+	if (ip != profile.expected) profile.historyCount = 0;
+	profile.expected = ip + length;
+
+	uint8_t sequence[PROFILE_MAX_SEQUENCE];
+	memcpy(sequence, profile.history, profile.historyCount);
+	sequence[profile.historyCount] = commond;
+	uint32_t sequenceLength = profile.historyCount + 1;
+
+	//every suffix ends here
+	uint32_t functionKey = function->id + 1;
+	for (uint32_t i = 0; i < sequenceLength; ++i) {
+		count(PROFILE_ALL_FUNCTIONS, sequenceLength - i, sequence + i);
+		count(functionKey, sequenceLength - i, sequence + i);
+	}
+
+	profile.total++;
+	getFunction(function)->count++;
+
+	//keep the last commonds
+	if (sequenceLength == PROFILE_MAX_SEQUENCE) {
+		memmove(sequence, sequence + 1, PROFILE_MAX_SEQUENCE - 1);
+		sequenceLength--;
+	}
+	memcpy(profile.history, sequence, sequenceLength);
+	profile.historyCount = sequenceLength;
+}
+
+void profile_optimized(const uint8_t* opStack, uint32_t depth) {
+	for (uint32_t length = 2; length <= PROFILE_MAX_SEQUENCE && length <= depth; ++length) {
+		count(PROFILE_OPSTACK, length, opStack + depth - length);
+	}
+}
+
+// ==================== report ====================
+
+static int compareEntries(const void* a, const void* b) {
+	uint64_t left = ((const ProfileEntry*)a)->count;
+	uint64_t right = ((const ProfileEntry*)b)->count;
+	return (left < right) - (left > right);
+}
+
+//the entries of functionKey and length,most counted first
+static uint32_t collect(ProfileEntry* out, uint32_t functionKey, uint32_t length) {
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < profile.entryCapacity; ++i) {
+		uint64_t key = profile.entries[i].key;
+		if (key != 0 && (uint32_t)(key >> 32) == functionKey && ((key >> 24) & 0xff) == length) {
+			out[count++] = profile.entries[i];
+		}
+	}
+	qsort(out, count, sizeof(ProfileEntry), compareEntries);
+	return count;
+}
+
+//OP_GET_LOCAL(3) OP_ADD(1),'?' if the length changes
+static void printSequence(uint64_t key) {
+	uint32_t length = (key >> 24) & 0xff;
+	for (uint32_t i = 0; i < length; ++i) {
+		uint8_t commond = (uint8_t)(key >> (16 - i * 8));
+		C_STR name = (commondNames[commond] != NULL) ? commondNames[commond] : "OP_UNKNOWN";
+
+		if (profile.lengths[commond] == PROFILE_VARIABLE_LENGTH) {
+			fprintf(stderr, "%s%s(?)", (i == 0) ? "" : " ", name);
+		}
+		else {
+			fprintf(stderr, "%s%s(%u)", (i == 0) ? "" : " ", name, profile.lengths[commond]);
+		}
+	}
+	fprintf(stderr, "\n");
+}
+
+static void printRanking(ProfileEntry* buffer, C_STR title, uint32_t functionKey, uint32_t length, uint32_t top, uint64_t total) {
+	uint32_t count = collect(buffer, functionKey, length);
+	if (title != NULL) fprintf(stderr, "[Profile] %s\n", title);
+
+	for (uint32_t i = 0; i < count && i < top; ++i) {
+		fprintf(stderr, "%14llu %6.2f%%  ", (unsigned long long)buffer[i].count, 100.0 * buffer[i].count / total);
+		printSequence(buffer[i].key);
+	}
+}
+
+//every sequence the compiler kept,without lengths:they may never run
+static void printOpStack(ProfileEntry* buffer) {
+	fprintf(stderr, "[Profile] opStack\n");
+	for (uint32_t length = 2; length <= PROFILE_MAX_SEQUENCE; ++length) {
+		uint32_t count = collect(buffer, PROFILE_OPSTACK, length);
+		for (uint32_t i = 0; i < count; ++i) {
+			fprintf(stderr, "%14llu ", (unsigned long long)buffer[i].count);
+			for (uint32_t j = 0; j < length; ++j) {
+				uint8_t commond = (uint8_t)(buffer[i].key >> (16 - j * 8));
+				fprintf(stderr, " %s", (commondNames[commond] != NULL) ? commondNames[commond] : "OP_UNKNOWN");
+			}
+			fprintf(stderr, "\n");
+		}
+	}
+}
+
+static int compareFunctions(const void* a, const void* b) {
+	uint64_t left = profile.functions[*(const uint32_t*)a].count;
+	uint64_t right = profile.functions[*(const uint32_t*)b].count;
+	return (left < right) - (left > right);
+}
+
+void profile_report() {
+	if (profile.total == 0) return;
+
+	ProfileEntry* buffer = ALLOCATE_NO_GC(ProfileEntry, profile.entryCapacity);
+	fprintf(stderr, "[Profile] %llu commonds run by the interpreter\n", (unsigned long long)profile.total);
+	printRanking(buffer, "commonds", PROFILE_ALL_FUNCTIONS, 1, PROFILE_REPORT_TOP, profile.total);
+	printRanking(buffer, "pairs", PROFILE_ALL_FUNCTIONS, 2, PROFILE_REPORT_TOP, profile.total);
+	printRanking(buffer, "triples", PROFILE_ALL_FUNCTIONS, 3, PROFILE_REPORT_TOP, profile.total);
+
+	//the hottest functions and their own sequences
+	uint32_t* order = ALLOCATE_NO_GC(uint32_t, profile.functionCapacity);
+	uint32_t functionCount = 0;
+	for (uint32_t i = 0; i < profile.functionCapacity; ++i) {
+		if (profile.functions[i].count != 0) order[functionCount++] = i;
+	}
+	qsort(order, functionCount, sizeof(uint32_t), compareFunctions);
+
+	fprintf(stderr, "[Profile] functions\n");
+	for (uint32_t i = 0; i < functionCount && i < PROFILE_REPORT_FUNCTIONS; ++i) {
+		ProfileFunction* function = &profile.functions[order[i]];
+		fprintf(stderr, "%14llu %6.2f%%  %s : (%u)\n", (unsigned long long)function->count, 100.0 * function->count / profile.total, function->name, order[i]);
+		printRanking(buffer, NULL, order[i] + 1, 2, PROFILE_REPORT_FUNCTION_TOP, profile.total);
+	}
+
+	printOpStack(buffer);
+
+	FREE_ARRAY_NO_GC(uint32_t, order, profile.functionCapacity);
+	FREE_ARRAY_NO_GC(ProfileEntry, buffer, profile.entryCapacity);
+}
+
+void profile_free() {
+	for (uint32_t i = 0; i < profile.functionCapacity; ++i) {
+		if (profile.functions[i].name != NULL) {
+			FREE_ARRAY_NO_GC(char, profile.functions[i].name, profile.functions[i].nameLength + 1);
+		}
+	}
+	FREE_ARRAY_NO_GC(ProfileFunction, profile.functions, profile.functionCapacity);
+	FREE_ARRAY_NO_GC(ProfileEntry, profile.entries, profile.entryCapacity);
+	memset(&profile, 0, sizeof(profile));
+}
@@ -0,0 +1,27 @@
+/*
+ * MIT License
+ * Copyright (c) 2025 IMSDcrueoft (https://github.com/IMSDcrueoft)
+ * See LICENSE file in the root directory for full license text.
+*/
+#pragma once
+#include "common.h"
+#include "object.h"
+
+//the longest sequence of commonds that is counted
+#define PROFILE_MAX_SEQUENCE 3
+//rows of each ranking in the report
+#define PROFILE_REPORT_TOP 24
+//functions in the report,and the sequences of each
+#define PROFILE_REPORT_FUNCTIONS 8
+#define PROFILE_REPORT_FUNCTION_TOP 6
+
+//count the commond at ip run by the interpreter (--profile).
+//a sequence only grows when ip follows the previous commond in the code,so a taken jump,
+//a call or a return begins a new one.quickened commonds are counted as the compiled ones
+void profile_commond(ObjFunction* function, uint8_t* ip);
+//count the pairs and triples on top of the opStack when instructionOptimize() returns,
+//the only sequences a superinstruction rule at its end can fuse
+void profile_optimized(const uint8_t* opStack, uint32_t depth);
+//print the ranked commonds,pairs and triples to stderr
+void profile_report();
+void profile_free();
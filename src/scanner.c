@@ -15,6 +15,16 @@ void scanner_init(C_STR source)
 	scanner.line = 1;
 }
 
+Scanner scanner_mark()
+{
+	return scanner;
+}
+
+void scanner_reset(Scanner mark)
+{
+	scanner = mark;
+}
+
 static bool isAlpha(char c) {
 	return (c >= 'a' && c <= 'z') ||
 		(c >= 'A' && c <= 'Z') ||
@@ -435,10 +445,10 @@ Token scanToken()
 	case ':': return makeToken(TOKEN_COLON);
 	case ',': return makeToken(TOKEN_COMMA);
 	case '.': return makeToken(TOKEN_DOT);
-	case '-': return makeToken(TOKEN_MINUS);
-	case '+': return makeToken(TOKEN_PLUS);
-	case '/': return makeToken(TOKEN_SLASH);
-	case '*': return makeToken(TOKEN_STAR);
+	case '-': return makeToken(match('=') ? TOKEN_MINUS_EQUAL : TOKEN_MINUS);
+	case '+': return makeToken(match('=') ? TOKEN_PLUS_EQUAL : TOKEN_PLUS);
+	case '/': return makeToken(match('=') ? TOKEN_SLASH_EQUAL : TOKEN_SLASH);
+	case '*': return makeToken(match('=') ? TOKEN_STAR_EQUAL : TOKEN_STAR);
 	case '%': return makeToken(TOKEN_PERCENT);
 	case '@':
 		return isAlpha(peek()) ? mention() : errorToken("Expected module name after @.");
@@ -20,6 +20,8 @@ typedef enum {
 	TOKEN_EQUAL, TOKEN_EQUAL_EQUAL,
 	TOKEN_GREATER, TOKEN_GREATER_EQUAL,
 	TOKEN_LESS, TOKEN_LESS_EQUAL,
+	TOKEN_PLUS_EQUAL, TOKEN_MINUS_EQUAL,
+	TOKEN_STAR_EQUAL, TOKEN_SLASH_EQUAL,
 	// Literals.
 	TOKEN_IDENTIFIER, TOKEN_STRING, TOKEN_STRING_ESCAPE, TOKEN_NUMBER, TOKEN_NUMBER_BIN, TOKEN_NUMBER_HEX,
 	// Builtin Literals.
@@ -50,5 +52,8 @@ typedef struct {
 } Token;
 
 void scanner_init(C_STR source);
+//the position of the scanner,to scan some tokens ahead and come back
+Scanner scanner_mark();
+void scanner_reset(Scanner mark);
 
 Token scanToken();
\ No newline at end of file
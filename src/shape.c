@@ -0,0 +1,146 @@
+/*
+ * MIT License
+ * Copyright (c) 2025 IMSDcrueoft (https://github.com/IMSDcrueoft)
+ * See LICENSE file in the root directory for full license text.
+*/
+#include "shape.h"
+#include "object.h"
+#include "memory.h"
+#include "vm.h"
+
+static Shape* newShape(Shape* parent, ObjString* key) {
+	Shape* shape = ALLOCATE_NO_GC(Shape, 1);
+	shape->parent = parent;
+	shape->slotCount = (parent == NULL) ? 0 : parent->slotCount + 1;
+	shape->indexCapacity = 0;
+	shape->keys = NULL;
+	shape->index = NULL;
+	shape->transitionCount = 0;
+	shape->transitionCapacity = 0;
+	shape->transitions = NULL;
+
+	//link for free
+	shape->next = vm.shapes;
+	vm.shapes = shape;
+	vm.shapeCount++;
+
+	if (shape->slotCount == 0) return shape;
+
+	//copy the keys of parent
+	shape->keys = ALLOCATE_NO_GC(ObjString*, shape->slotCount);
+	//the keys of the root are NULL
+	if (parent->slotCount > 0) {
+		memcpy(shape->keys, parent->keys, sizeof(ObjString*) * parent->slotCount);
+	}
+	shape->keys[parent->slotCount] = key;
+
+	//big shape needs hash index
+	if (shape->slotCount > SHAPE_LINEAR_MAX) {
+		uint32_t capacity = 16;
+		while (capacity < shape->slotCount * 2) capacity <<= 1;
+
+		shape->indexCapacity = capacity;
+		shape->index = ALLOCATE_NO_GC(ShapeIndex, capacity);
+		for (uint32_t i = 0; i < capacity; ++i) {
+			shape->index[i].key = NULL;
+			shape->index[i].slot = SHAPE_INVALID_SLOT;
+		}
+
+		for (uint32_t slot = 0; slot < shape->slotCount; ++slot) {
+			uint32_t index = (uint32_t)shape->keys[slot]->hash & (capacity - 1);
+			while (shape->index[index].key != NULL) {
+				index = (index + 1) & (capacity - 1);
+			}
+			shape->index[index].key = shape->keys[slot];
+			shape->index[index].slot = slot;
+		}
+	}
+
+	return shape;
+}
+
+static void freeShape(Shape* shape) {
+	FREE_ARRAY_NO_GC(ObjString*, shape->keys, shape->slotCount);
+	FREE_ARRAY_NO_GC(ShapeIndex, shape->index, shape->indexCapacity);
+	FREE_ARRAY_NO_GC(ShapeTransition, shape->transitions, shape->transitionCapacity);
+	FREE_NO_GC(Shape, shape);
+}
+
+COLD_FUNCTION
+void shape_init() {
+	vm.shapes = NULL;
+	vm.shapeCount = 0;
+	vm.rootShape = newShape(NULL, NULL);
+
+	//only a mark, never transition
+	vm.dictionaryShape = (Shape){
+		.parent = NULL,
+		.next = NULL,
+		.slotCount = 0,
+		.indexCapacity = 0,
+		.keys = NULL,
+		.index = NULL,
+		.transitionCount = 0,
+		.transitionCapacity = 0,
+		.transitions = NULL
+	};
+}
+
+COLD_FUNCTION
+void shape_free() {
+	Shape* shape = vm.shapes;
+	while (shape != NULL) {
+		Shape* next = shape->next;
+		freeShape(shape);
+		shape = next;
+	}
+
+	vm.shapes = NULL;
+	vm.shapeCount = 0;
+	vm.rootShape = NULL;
+}
+
+HOT_FUNCTION
+Shape* shapeTransition(Shape* shape, ObjString* key) {
+	for (uint32_t i = 0; i < shape->transitionCount; ++i) {
+		if (shape->transitions[i].key == key) {
+			return shape->transitions[i].shape;
+		}
+	}
+
+	//keep the tree small, the rest use dictionary
+	if (shape->slotCount == SHAPE_MAX_SLOTS || shape->transitionCount == SHAPE_MAX_TRANSITIONS || vm.shapeCount >= SHAPE_MAX_COUNT) {
+		return NULL;
+	}
+
+	if (shape->transitionCount == shape->transitionCapacity) {
+		uint32_t oldCapacity = shape->transitionCapacity;
+		shape->transitionCapacity = (oldCapacity < 4) ? 4 : (oldCapacity << 1);
+		shape->transitions = GROW_ARRAY_NO_GC(ShapeTransition, shape->transitions, oldCapacity, shape->transitionCapacity);
+	}
+
+	Shape* child = newShape(shape, key);
+	shape->transitions[shape->transitionCount++] = (ShapeTransition){ .key = key, .shape = child };
+	return child;
+}
+
+HOT_FUNCTION
+uint32_t shapeGetSlot(Shape* shape, ObjString* key) {
+	if (shape->index == NULL) {
+		for (uint32_t i = 0; i < shape->slotCount; ++i) {
+			if (shape->keys[i] == key) return i;
+		}
+		return SHAPE_INVALID_SLOT;
+	}
+
+	uint32_t mask = shape->indexCapacity - 1;
+	uint32_t index = (uint32_t)key->hash & mask;
+
+	while (true) {
+		ShapeIndex* entry = &shape->index[index];
+		if (entry->key == key) return entry->slot;
+		if (entry->key == NULL) return SHAPE_INVALID_SLOT;
+
+		index = (index + 1) & mask;
+	}
+}
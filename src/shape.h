@@ -0,0 +1,56 @@
+/*
+ * MIT License
+ * Copyright (c) 2025 IMSDcrueoft (https://github.com/IMSDcrueoft)
+ * See LICENSE file in the root directory for full license text.
+*/
+#pragma once
+#include "common.h"
+#include "value.h"
+
+//more slots than this goes to dictionary mode
+#define SHAPE_MAX_SLOTS 64
+//more children than this goes to dictionary mode
+#define SHAPE_MAX_TRANSITIONS 64
+//more shapes than this in the tree sends the new layouts to dictionary mode,they live until vm_free
+#define SHAPE_MAX_COUNT 65536
+//small shapes search keys linearly
+#define SHAPE_LINEAR_MAX 8
+
+#define SHAPE_INVALID_SLOT UINT32_MAX
+
+typedef struct Shape Shape;
+
+typedef struct {
+	ObjString* key;
+	Shape* shape;
+} ShapeTransition;
+
+typedef struct {
+	ObjString* key;
+	uint32_t slot;
+} ShapeIndex;
+
+//shapes are shared by instances and never freed before vm_free
+struct Shape {
+	Shape* parent;
+	Shape* next;//link of all shapes
+
+	uint32_t slotCount;
+	uint32_t indexCapacity;
+
+	ObjString** keys;//slot -> key
+	ShapeIndex* index;//key -> slot,only for big shapes
+
+	uint32_t transitionCount;
+	uint32_t transitionCapacity;
+	ShapeTransition* transitions;
+};
+
+void shape_init();
+void shape_free();
+
+//get the child with key added,NULL if the tree is too big
+Shape* shapeTransition(Shape* shape, ObjString* key);
+
+//get the slot of key,SHAPE_INVALID_SLOT if not exist
+uint32_t shapeGetSlot(Shape* shape, ObjString* key);
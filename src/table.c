@@ -26,7 +26,7 @@ void table_free(Table* table)
 }
 
 HOT_FUNCTION
-static Entry* findEntry(Entry* entries, uint32_t capacity, ObjString* key, bool isGlobal) {
+static Entry* findEntry(Entry* entries, uint32_t capacity, ObjString* key) {
 	//check it
 	Entry* entry = NULL;
 
@@ -38,10 +38,6 @@ static Entry* findEntry(Entry* entries, uint32_t capacity, ObjString* key, bool
 
 		if (entry->key == NULL) {
 			if (IS_NIL(entry->value)) {
-				//only for global
-				if (isGlobal) {
-					key->symbol = index;
-				}
 				// if we find hole after tombstone ,it means the tombstone is target else return the hole
 				// Empty entry.
 				return tombstone != NULL ? tombstone : entry;
@@ -52,10 +48,6 @@ static Entry* findEntry(Entry* entries, uint32_t capacity, ObjString* key, bool
 			}
 		}
 		else if (entry->key == key) {
-			//only for global
-			if (isGlobal) {
-				key->symbol = index;
-			}
 			// We found the key.
 			return entry;
 		}
@@ -79,7 +71,7 @@ static void adjustCapacity(Table* table, uint32_t capacity) {
 		Entry* entry = &table->entries[i];
 		if (entry->key == NULL) continue;
 
-		Entry* dest = findEntry(entries, capacity, entry->key, table->isGlobal);
+		Entry* dest = findEntry(entries, capacity, entry->key);
 		dest->key = entry->key;
 		dest->value = entry->value;
 
@@ -96,13 +88,21 @@ HOT_FUNCTION
 bool tableGet(Table* table, ObjString* key, Value* value_out) {
 	if (table->count == 0) return false;
 
-	Entry* entry = findEntry(table->entries, table->capacity, key, table->isGlobal);
+	Entry* entry = findEntry(table->entries, table->capacity, key);
 	if (entry->key == NULL) return false;
 
 	*value_out = entry->value;
 	return true;
 }
 
+HOT_FUNCTION
+Entry* tableGetEntry(Table* table, ObjString* key) {
+	if (table->count == 0) return NULL;
+
+	Entry* entry = findEntry(table->entries, table->capacity, key);
+	return (entry->key == NULL) ? NULL : entry;
+}
+
 HOT_FUNCTION
 bool tableSet(Table* table, ObjString* key, Value value)
 {
@@ -114,7 +114,7 @@ bool tableSet(Table* table, ObjString* key, Value value)
 		adjustCapacity(table, capacity);
 	}
 
-	Entry* entry = findEntry(table->entries, table->capacity, key, table->isGlobal);
+	Entry* entry = findEntry(table->entries, table->capacity, key);
 	bool isNewKey = entry->key == NULL;
 	if (isNewKey && IS_NIL(entry->value)) table->count++;
 
@@ -130,7 +130,7 @@ bool tableDelete(Table* table, ObjString* key) {
 	if (table->count == 0) return false;
 
 	// Find the entry.
-	Entry* entry = findEntry(table->entries, table->capacity, key, table->isGlobal);
+	Entry* entry = findEntry(table->entries, table->capacity, key);
 	if (entry->key == NULL) return false;
 
 	// Place a tombstone in the entry.
@@ -163,6 +163,6 @@ void markTable(Table* table) {
 	for (uint32_t i = 0; i < table->capacity; i++) {
 		Entry* entry = &table->entries[i];
 		//markObject((Obj*)entry->key);
-		markValue(entry->value);
+		markValue(gc_loadSlot(&entry->value));
 	}
 }
\ No newline at end of file
@@ -25,10 +25,9 @@ typedef struct {
 } StringEntry;
 
 typedef struct {
-	bool isGlobal;
 	bool isFrozen;
 
-	uint8_t padding[6];
+	uint8_t padding[7];
 
 	uint32_t count;
 	uint32_t capacity;
@@ -51,6 +50,8 @@ void table_init(Table* table);
 void table_free(Table* table);
 
 bool tableGet(Table* table, ObjString* key, Value* value_out);
+//get the entry of key, NULL if key not exist
+Entry* tableGetEntry(Table* table, ObjString* key);
 bool tableSet(Table* table, ObjString* key, Value value);
 bool tableDelete(Table* table, ObjString* key);
 void tableAddAll(Table* from, Table* to);
@@ -0,0 +1,78 @@
+/*
+ * MIT License
+ * Copyright (c) 2025 IMSDcrueoft (https://github.com/IMSDcrueoft)
+ * See LICENSE file in the root directory for full license text.
+*/
+#include "thread.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+struct Thread {
+	std::thread thread;
+};
+
+struct Mutex {
+	std::mutex mutex;
+};
+
+struct CondVar {
+	std::condition_variable condition;
+};
+
+Thread* thread_start(void (*run)(void* arg), void* arg) {
+	return new Thread{ std::thread(run, arg) };
+}
+
+void thread_join(Thread* thread) {
+	thread->thread.join();
+	delete thread;
+}
+
+uint32_t thread_hardwareCount() {
+	uint32_t count = std::thread::hardware_concurrency();
+	return count == 0 ? 1 : count;
+}
+
+void thread_yield() {
+	std::this_thread::yield();
+}
+
+Mutex* mutex_new() {
+	return new Mutex();
+}
+
+void mutex_free(Mutex* mutex) {
+	delete mutex;
+}
+
+void mutex_lock(Mutex* mutex) {
+	mutex->mutex.lock();
+}
+
+void mutex_unlock(Mutex* mutex) {
+	mutex->mutex.unlock();
+}
+
+CondVar* condvar_new() {
+	return new CondVar();
+}
+
+void condvar_free(CondVar* condition) {
+	delete condition;
+}
+
+void condvar_wait(CondVar* condition, Mutex* mutex) {
+	//the caller keeps the lock,adopt it for the wait and leave it locked
+	std::unique_lock<std::mutex> lock(mutex->mutex, std::adopt_lock);
+	condition->condition.wait(lock);
+	lock.release();
+}
+
+void condvar_signal(CondVar* condition) {
+	condition->condition.notify_one();
+}
+
+void condvar_broadcast(CondVar* condition) {
+	condition->condition.notify_all();
+}
@@ -0,0 +1,156 @@
+/*
+ * MIT License
+ * Copyright (c) 2025 IMSDcrueoft (https://github.com/IMSDcrueoft)
+ * See LICENSE file in the root directory for full license text.
+*/
+#pragma once
+#ifdef __cplusplus
+#include <cstdint>
+extern "C" {
+#else
+#include <stdint.h>
+#include <stdbool.h>
+
+#endif
+//the threads of the gc,std::thread behind a C interface
+typedef struct Thread Thread;
+typedef struct Mutex Mutex;
+typedef struct CondVar CondVar;
+
+Thread* thread_start(void (*run)(void* arg), void* arg);
+void thread_join(Thread* thread);
+//the threads the hardware runs at once,at least 1
+uint32_t thread_hardwareCount();
+//give the processor to another ready thread
+void thread_yield();
+
+Mutex* mutex_new();
+void mutex_free(Mutex* mutex);
+void mutex_lock(Mutex* mutex);
+void mutex_unlock(Mutex* mutex);
+
+CondVar* condvar_new();
+void condvar_free(CondVar* condition);
+//mutex is locked by the caller
+void condvar_wait(CondVar* condition, Mutex* mutex);
+void condvar_signal(CondVar* condition);
+void condvar_broadcast(CondVar* condition);
+
+#ifdef __cplusplus
+}
+#else
+
+//the flags shared with the gc threads are bytes,loaded with acquire and stored with release
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define THREAD_LOCAL __declspec(thread)
+#define CPU_RELAX() _mm_pause()
+
+//volatile isn't atomic with /volatile:iso,the barrier gives the loads acquire and the stores release
+#if defined(_M_ARM64)
+#define ORDER_BARRIER() __dmb(_ARM64_BARRIER_ISH)
+#else
+#define ORDER_BARRIER() _ReadWriteBarrier()
+#endif
+
+static inline uint8_t atomic_load8(volatile uint8_t* pointer) {
+	uint8_t value = (uint8_t)__iso_volatile_load8((volatile char*)pointer);
+	ORDER_BARRIER();
+	return value;
+}
+
+static inline bool atomic_cas8(volatile uint8_t* pointer, uint8_t expected, uint8_t desired) {
+	return (uint8_t)_InterlockedCompareExchange8((volatile char*)pointer, (char)desired, (char)expected) == expected;
+}
+
+static inline void atomic_or8(volatile uint8_t* pointer, uint8_t bits) {
+	_InterlockedOr8((volatile char*)pointer, (char)bits);
+}
+
+static inline void atomic_and8(volatile uint8_t* pointer, uint8_t bits) {
+	_InterlockedAnd8((volatile char*)pointer, (char)bits);
+}
+
+static inline void atomic_store8(volatile uint8_t* pointer, uint8_t value) {
+	ORDER_BARRIER();
+	__iso_volatile_store8((volatile char*)pointer, (char)value);
+}
+
+static inline uint32_t atomic_load32(volatile uint32_t* pointer) {
+	uint32_t value = (uint32_t)__iso_volatile_load32((volatile int*)pointer);
+	ORDER_BARRIER();
+	return value;
+}
+
+//the value before
+static inline uint32_t atomic_add32(volatile uint32_t* pointer, uint32_t value) {
+	return (uint32_t)_InterlockedExchangeAdd((volatile long*)pointer, (long)value);
+}
+
+static inline uint64_t atomic_load64(volatile uint64_t* pointer) {
+	uint64_t value = (uint64_t)__iso_volatile_load64((volatile __int64*)pointer);
+	ORDER_BARRIER();
+	return value;
+}
+
+//whole,but no order
+static inline uint64_t atomic_loadRelaxed64(volatile uint64_t* pointer) {
+	return (uint64_t)__iso_volatile_load64((volatile __int64*)pointer);
+}
+
+static inline void atomic_store64(volatile uint64_t* pointer, uint64_t value) {
+	ORDER_BARRIER();
+	__iso_volatile_store64((volatile __int64*)pointer, (__int64)value);
+}
+#else
+#define THREAD_LOCAL _Thread_local
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_RELAX() __builtin_ia32_pause()
+#else
+#define CPU_RELAX() ((void)0)
+#endif
+
+static inline uint8_t atomic_load8(volatile uint8_t* pointer) {
+	return __atomic_load_n(pointer, __ATOMIC_ACQUIRE);
+}
+
+static inline bool atomic_cas8(volatile uint8_t* pointer, uint8_t expected, uint8_t desired) {
+	return __atomic_compare_exchange_n(pointer, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+static inline void atomic_or8(volatile uint8_t* pointer, uint8_t bits) {
+	__atomic_fetch_or(pointer, bits, __ATOMIC_SEQ_CST);
+}
+
+static inline void atomic_and8(volatile uint8_t* pointer, uint8_t bits) {
+	__atomic_fetch_and(pointer, bits, __ATOMIC_SEQ_CST);
+}
+
+static inline void atomic_store8(volatile uint8_t* pointer, uint8_t value) {
+	__atomic_store_n(pointer, value, __ATOMIC_RELEASE);
+}
+
+static inline uint32_t atomic_load32(volatile uint32_t* pointer) {
+	return __atomic_load_n(pointer, __ATOMIC_ACQUIRE);
+}
+
+//the value before
+static inline uint32_t atomic_add32(volatile uint32_t* pointer, uint32_t value) {
+	return __atomic_fetch_add(pointer, value, __ATOMIC_SEQ_CST);
+}
+
+static inline uint64_t atomic_load64(volatile uint64_t* pointer) {
+	return __atomic_load_n(pointer, __ATOMIC_ACQUIRE);
+}
+
+//whole,but no order
+static inline uint64_t atomic_loadRelaxed64(volatile uint64_t* pointer) {
+	return __atomic_load_n(pointer, __ATOMIC_RELAXED);
+}
+
+static inline void atomic_store64(volatile uint64_t* pointer, uint64_t value) {
+	__atomic_store_n(pointer, value, __ATOMIC_RELEASE);
+}
+#endif
+
+#endif
@@ -0,0 +1,1600 @@
+/*
+ * MIT License
+ * Copyright (c) 2025 IMSDcrueoft (https://github.com/IMSDcrueoft)
+ * See LICENSE file in the root directory for full license text.
+*/
+#include "trace.h"
+
+#if TRACE_AVAILABLE
+#include "memory.h"
+
+//limits of one recorded iteration
+#define TRACE_MAX_IR			512
+#define TRACE_MAX_DEPTH			32
+#define TRACE_MAX_VARS			16
+#define TRACE_MAX_EXITS			128
+#define TRACE_MAX_EXIT_SLOTS	1024
+#define TRACE_MAX_FIXUPS		(TRACE_MAX_IR * 4)
+#define TRACE_NONE				UINT16_MAX
+//returned by the native code if a type guard at the entry fails,nothing is changed
+#define TRACE_ENTRY_MISS		UINT32_MAX
+
+//kept by the native code,all callee saved
+#define REG_SLOTS	R12		//frame->slots
+#define REG_GLOBALS	R13		//vm.globalValues
+#define REG_BASE	RBX		//stack top at the loop header,the exits rebuild the stack here
+
+//array variables are kept unboxed
+static const Register arrayRegisters[] = { R14, R15, RBP };
+#define TRACE_MAX_ARRAYS (sizeof(arrayRegisters) / sizeof(Register))
+
+//xmm0 and xmm1 are scratch,the others keep the variables and temporaries
+#define XMM_FIRST		2
+#define XMM_COUNT		16
+#define XMM_TEMP_MASK	0xfffc
+//spill of xmm registers around C calls,keeps rsp aligned to 16
+#define FRAME_SIZE		(XMM_COUNT * 8 + 8)
+
+#define LOCATION_NONE		(-1)
+#define LOCATION_CONSTANT	(-2)
+
+typedef enum {
+	IR_CONST,	//number
+	IR_LOAD,	//variable at the first read,its type is guarded at the entry
+	IR_STORE,	//variable = a,written through
+	IR_ADD,		//a op b,the order of OP_ADD..OP_MODULUS
+	IR_SUB,
+	IR_MUL,
+	IR_DIV,
+	IR_MOD,
+	IR_NEG,		//-a
+	IR_CALL,	//native(a) or native(a, b)
+	IR_GUARD,	//(a compare b) == expected,or exit
+	IR_ALOAD,	//array[a],exit if out of range or not a number
+	IR_ASTORE,	//array[a] = b,exit if out of range
+	IR_ABOUND,	//a in range of array,or exit.the guard of array loops
+	IR_LOOP,	//back to the loop header
+} IrOp;
+
+static const C_STR irNames[] = {
+	"const", "load", "store", "add", "sub", "mul", "div", "mod", "neg", "call", "guard", "aload", "astore", "abound", "loop",
+};
+
+static const C_STR compareNames[] = { "==", ">", "<", "!=", "<=", ">=" };
+
+//the order of OP_ADD..OP_MODULUS
+static const uint8_t arithmeticOps[] = { SSE_ADD, SSE_SUB, SSE_MUL, SSE_DIV, SSE_MOD };
+
+typedef struct {
+	uint8_t op;
+	uint8_t compare;	//IR_GUARD
+	bool expected;		//IR_GUARD
+	bool inRange;		//IR_ALOAD,IR_ASTORE,the index is checked by IR_ABOUND before
+	uint8_t var;		//IR_LOAD,IR_STORE,IR_ALOAD,IR_ASTORE,IR_ABOUND
+	uint16_t a;
+	uint16_t b;
+	uint32_t exit;		//IR_GUARD,IR_ALOAD,IR_ASTORE,IR_ABOUND
+	union {
+		double number;		//IR_CONST
+		ObjNative* native;	//IR_CALL
+	};
+} TraceIr;
+
+typedef enum {
+	SLOT_NUMBER,	//ir of a number
+	SLOT_ARRAY,		//array variable
+	SLOT_VALUE,		//known value,like nil,bool or a constant
+	SLOT_COMPARE,	//bool of a compare,guarded when it is tested
+} TraceSlotType;
+
+//a value on the stack while recording
+typedef struct {
+	uint8_t type;
+	uint8_t compare;	//SLOT_COMPARE
+	bool isNegated;		//SLOT_COMPARE,!(a compare b)
+	uint16_t a;			//ir,or the array variable
+	uint16_t b;			//SLOT_COMPARE
+	Value value;		//SLOT_VALUE
+} TraceSlot;
+
+//the slot and the value it has in this iteration
+typedef struct {
+	TraceSlot slot;
+	Value value;
+} TraceOperand;
+
+typedef struct {
+	ObjString* name;	//NULL if local
+	uint32_t slot;		//frame slot,or global slot
+	bool isArray;
+	bool isLoaded;		//read before written,guarded and loaded at the entry
+	uint8_t arrayType;	//OBJ_ARRAY or OBJ_ARRAY_F64
+	uint8_t reg;		//xmm of number,register of array
+	uint16_t current;	//ir of the value,TRACE_NONE before touched
+} TraceVar;
+
+typedef struct {
+	uint32_t ip;		//bytecode offset to go on
+	uint32_t depth;		//temporaries rebuilt on the stack
+	uint32_t slots;		//first one in exitSlots
+} TraceExit;
+
+struct Trace {
+	uint8_t* code;			//executable memory
+	uint64_t size;			//mapped size
+	uint32_t globalCount;
+	uint32_t* globals;		//slots of the global variables,they must be defined to enter
+	uint32_t exitCount;
+	TraceExit* exits;
+};
+
+typedef struct {
+	CallFrame* frame;
+	ObjFunction* function;
+	uint8_t* code;
+	uint32_t header;	//bytecode offset of the loop header
+	uint32_t loopStart;	//the bytecode of the loop is [loopStart, loopEnd]
+	uint32_t loopEnd;
+	uint32_t backEdges;	//OP_LOOP followed to other headers
+	uint8_t* ip;
+	Value* base;		//stack top at the loop header
+	Value* top;			//stack top of the vm
+	C_STR abortReason;
+
+	//temporaries above base
+	TraceSlot stack[TRACE_MAX_DEPTH];
+	uint32_t depth;
+
+	TraceVar vars[TRACE_MAX_VARS];
+	uint32_t varCount;
+	uint32_t globalCount;
+
+	TraceIr ir[TRACE_MAX_IR];
+	uint32_t irCount;
+
+	TraceExit exits[TRACE_MAX_EXITS];
+	uint32_t exitCount;
+	TraceSlot exitSlots[TRACE_MAX_EXIT_SLOTS];
+	uint32_t exitSlotCount;
+} TraceRecorder;
+
+#define ABORT(reason)					\
+	do {								\
+		rec->abortReason = (reason);	\
+		return false;					\
+	} while (false)
+
+#define READ_SHORT(at)	((uint32_t)(at)[0] | ((uint32_t)(at)[1] << 8))
+#define READ_24bits(at)	((uint32_t)(at)[0] | ((uint32_t)(at)[1] << 8) | ((uint32_t)(at)[2] << 16))
+#define READ_CONSTANT(at) (vm.constants.values[READ_24bits(at)])
+
+// ==================== ir ====================
+
+static double arithmeticOf(uint32_t op, double a, double b) {
+	switch (op) {
+	case 0: return a + b;
+	case 1: return a - b;
+	case 2: return a * b;
+	case 3: return a / b;
+	default: return fmod(a, b);
+	}
+}
+
+static bool compareOf(CompareType type, double a, double b) {
+	switch (type) {
+	case COMPARE_EQUAL: return a == b;
+	case COMPARE_GREATER: return a > b;
+	case COMPARE_LESS: return a < b;
+	case COMPARE_NOT_EQUAL: return a != b;
+	case COMPARE_LESS_EQUAL: return a <= b;
+	default: return a >= b;
+	}
+}
+
+static uint16_t emitIr(TraceRecorder* rec, TraceIr ir) {
+	rec->ir[rec->irCount] = ir;
+	return (uint16_t)rec->irCount++;
+}
+
+static bool isConstantIr(TraceRecorder* rec, uint16_t ir) {
+	return rec->ir[ir].op == IR_CONST;
+}
+
+//constants are shared
+static uint16_t irConstant(TraceRecorder* rec, double number) {
+	for (uint32_t i = 0; i < rec->irCount; ++i) {
+		if (rec->ir[i].op == IR_CONST && memcmp(&rec->ir[i].number, &number, sizeof(double)) == 0) return (uint16_t)i;
+	}
+	return emitIr(rec, (TraceIr) { .op = IR_CONST, .a = TRACE_NONE, .b = TRACE_NONE, .number = number });
+}
+
+//folded if both are constants
+static uint16_t irArithmetic(TraceRecorder* rec, uint32_t op, uint16_t a, uint16_t b) {
+	if (isConstantIr(rec, a) && isConstantIr(rec, b)) {
+		return irConstant(rec, arithmeticOf(op, rec->ir[a].number, rec->ir[b].number));
+	}
+	return emitIr(rec, (TraceIr) { .op = (uint8_t)(IR_ADD + op), .a = a, .b = b });
+}
+
+static TraceSlot numberSlot(uint16_t ir) {
+	return (TraceSlot) { .type = SLOT_NUMBER, .a = ir };
+}
+
+static TraceSlot valueSlot(Value value) {
+	return (TraceSlot) { .type = SLOT_VALUE, .value = value };
+}
+
+static TraceOperand constantOperand(TraceRecorder* rec, Value value) {
+	if (IS_NUMBER(value)) return (TraceOperand) { .slot = numberSlot(irConstant(rec, AS_NUMBER(value))), .value = value };
+	return (TraceOperand) { .slot = valueSlot(value), .value = value };
+}
+
+// ==================== recorder ====================
+
+static inline bool isFalsey(Value value) {
+	return IS_NIL(value) || (IS_BOOL(value) && !AS_BOOL(value));
+}
+
+static TraceOperand peek(TraceRecorder* rec, uint32_t distance) {
+	return (TraceOperand) { .slot = rec->stack[rec->depth - 1 - distance], .value = rec->top[-1 - (int32_t)distance] };
+}
+
+static void push(TraceRecorder* rec, TraceOperand operand) {
+	rec->stack[rec->depth++] = operand.slot;
+	*rec->top++ = operand.value;
+}
+
+static void drop(TraceRecorder* rec, uint32_t count) {
+	rec->depth -= count;
+	rec->top -= count;
+}
+
+//the state to go on at ip if a guard fails,it's the stack when recording
+static bool snapshot(TraceRecorder* rec, uint8_t* ip, uint32_t* exit) {
+	if (rec->exitCount == TRACE_MAX_EXITS || rec->exitSlotCount + rec->depth > TRACE_MAX_EXIT_SLOTS) ABORT("too many exits");
+
+	for (uint32_t i = 0; i < rec->depth; ++i) {
+		if (rec->stack[i].type == SLOT_COMPARE) ABORT("bool of compare is kept on stack");
+		rec->exitSlots[rec->exitSlotCount + i] = rec->stack[i];
+	}
+
+	rec->exits[rec->exitCount] = (TraceExit){ .ip = (uint32_t)(ip - rec->code), .depth = rec->depth, .slots = rec->exitSlotCount };
+	rec->exitSlotCount += rec->depth;
+	*exit = rec->exitCount++;
+	return true;
+}
+
+static TraceVar* findVar(TraceRecorder* rec, ObjString* name, uint32_t slot) {
+	for (uint32_t i = 0; i < rec->varCount; ++i) {
+		TraceVar* var = &rec->vars[i];
+		if (var->name == name && (name != NULL || var->slot == slot)) return var;
+	}
+	if (rec->varCount == TRACE_MAX_VARS) {
+		rec->abortReason = "too many variables";
+		return NULL;
+	}
+
+	TraceVar* var = &rec->vars[rec->varCount++];
+	if (name != NULL) rec->globalCount++;
+	*var = (TraceVar){ .name = name, .slot = slot, .current = TRACE_NONE };
+	return var;
+}
+
+//the first read decides the type of variable
+static bool readVar(TraceRecorder* rec, TraceVar* var, TraceOperand* out) {
+	uint16_t index = (uint16_t)(var - rec->vars);
+	if (var->isArray) {
+		out->slot = (TraceSlot){ .type = SLOT_ARRAY, .a = index };
+		return true;
+	}
+	if (var->current != TRACE_NONE) {
+		out->slot = numberSlot(var->current);
+		return true;
+	}
+
+	if (IS_NUMBER(out->value)) {
+		var->isLoaded = true;
+		var->current = emitIr(rec, (TraceIr) { .op = IR_LOAD, .var = (uint8_t)index, .a = TRACE_NONE, .b = TRACE_NONE });
+		out->slot = numberSlot(var->current);
+		return true;
+	}
+	if (isObjType(out->value, OBJ_ARRAY) || isObjType(out->value, OBJ_ARRAY_F64)) {
+		var->isLoaded = true;
+		var->isArray = true;
+		var->arrayType = OBJ_TYPE(out->value);
+		out->slot = (TraceSlot){ .type = SLOT_ARRAY, .a = index };
+		return true;
+	}
+	ABORT("variable is not a number or array");
+}
+
+static bool writeVar(TraceRecorder* rec, TraceVar* var, TraceSlot slot) {
+	if (slot.type != SLOT_NUMBER || var->isArray) ABORT("variable is not kept as number");
+
+	emitIr(rec, (TraceIr) { .op = IR_STORE, .var = (uint8_t)(var - rec->vars), .a = slot.a, .b = TRACE_NONE });
+	var->current = slot.a;
+	return true;
+}
+
+//locals above base are temporaries of the loop body
+static bool readLocal(TraceRecorder* rec, uint32_t slot, TraceOperand* out) {
+	Value* location = rec->frame->slots + slot;
+	out->value = *location;
+
+	if (location >= rec->base) {
+		if (location >= rec->top) ABORT("local is out of stack");
+		out->slot = rec->stack[location - rec->base];
+		return true;
+	}
+
+	TraceVar* var = findVar(rec, NULL, slot);
+	return var != NULL && readVar(rec, var, out);
+}
+
+static bool writeLocal(TraceRecorder* rec, uint32_t slot, TraceOperand operand) {
+	Value* location = rec->frame->slots + slot;
+
+	if (location >= rec->base) {
+		if (location >= rec->top) ABORT("local is out of stack");
+		if (operand.slot.type == SLOT_COMPARE) ABORT("bool of compare is stored");
+		rec->stack[location - rec->base] = operand.slot;
+	}
+	else {
+		TraceVar* var = findVar(rec, NULL, slot);
+		if (var == NULL || !writeVar(rec, var, operand.slot)) return false;
+	}
+	*location = operand.value;
+	return true;
+}
+
+static bool readGlobal(TraceRecorder* rec, uint32_t slot, TraceOperand* out) {
+	if (IS_UNDEFINED(vm.globalValues[slot])) ABORT("undefined global");
+	out->value = vm.globalValues[slot];
+
+	TraceVar* var = findVar(rec, vm.globalNames[slot], slot);
+	return var != NULL && readVar(rec, var, out);
+}
+
+static bool writeGlobal(TraceRecorder* rec, uint32_t slot, TraceOperand operand) {
+	if (IS_UNDEFINED(vm.globalValues[slot])) ABORT("undefined global");
+
+	TraceVar* var = findVar(rec, vm.globalNames[slot], slot);
+	if (var == NULL || !writeVar(rec, var, operand.slot)) return false;
+	vm.globalValues[slot] = operand.value;
+	return true;
+}
+
+static bool arithmetic(TraceRecorder* rec, uint32_t op, TraceOperand left, TraceOperand right, TraceOperand* out) {
+	if (left.slot.type != SLOT_NUMBER || right.slot.type != SLOT_NUMBER) ABORT("operands are not numbers");
+
+	out->value = NUMBER_VAL(arithmeticOf(op, AS_NUMBER(left.value), AS_NUMBER(right.value)));
+	out->slot = numberSlot(irArithmetic(rec, op, left.slot.a, right.slot.a));
+	return true;
+}
+
+static bool compare(TraceRecorder* rec, CompareType type, TraceOperand left, TraceOperand right, TraceOperand* out) {
+	if (left.slot.type != SLOT_NUMBER || right.slot.type != SLOT_NUMBER) ABORT("operands are not numbers");
+
+	out->value = BOOL_VAL(compareOf(type, AS_NUMBER(left.value), AS_NUMBER(right.value)));
+	out->slot = (TraceSlot){ .type = SLOT_COMPARE, .compare = (uint8_t)type, .a = left.slot.a, .b = right.slot.a };
+	return true;
+}
+
+//the compare keeps the recorded result,or exits to ip with the stack now
+static bool guardCompare(TraceRecorder* rec, TraceSlot slot, bool result, uint8_t* ip) {
+	if (isConstantIr(rec, slot.a) && isConstantIr(rec, slot.b)) return true;
+
+	uint32_t exit;
+	if (!snapshot(rec, ip, &exit)) return false;
+
+	emitIr(rec, (TraceIr) { .op = IR_GUARD, .compare = slot.compare, .expected = result != slot.isNegated, .a = slot.a, .b = slot.b, .exit = exit });
+	return true;
+}
+
+//the top is tested by a jump,the path not taken is guarded
+static bool branch(TraceRecorder* rec, bool jumpIfTrue, bool isPop, uint8_t* next, uint8_t* target) {
+	TraceSlot slot = rec->stack[rec->depth - 1];
+	bool isTrue = !isFalsey(rec->top[-1]);
+	uint8_t* taken = (isTrue == jumpIfTrue) ? target : next;
+	uint8_t* other = (isTrue == jumpIfTrue) ? next : target;
+
+	if (slot.type == SLOT_COMPARE) {
+		//the other path sees the opposite bool
+		rec->stack[rec->depth - 1] = valueSlot(BOOL_VAL(!isTrue));
+		if (isPop) --rec->depth;
+		if (!guardCompare(rec, slot, isTrue, other)) return false;
+		if (isPop) ++rec->depth;
+		rec->stack[rec->depth - 1] = valueSlot(BOOL_VAL(isTrue));
+	}
+
+	if (isPop) drop(rec, 1);
+	rec->ip = taken;
+	return true;
+}
+
+//the fused commonds jump if the compare is false
+static bool compareJump(TraceRecorder* rec, CompareType type, TraceOperand left, TraceOperand right, uint8_t* next, uint8_t* target) {
+	TraceOperand result;
+	if (!compare(rec, type, left, right, &result)) return false;
+
+	bool isTrue = AS_BOOL(result.value);
+	if (!guardCompare(rec, result.slot, isTrue, isTrue ? target : next)) return false;
+	rec->ip = isTrue ? next : target;
+	return true;
+}
+
+//an IR_ABOUND of the array and index is before,the body of array loops
+static bool isBoundIr(TraceRecorder* rec, uint16_t var, uint16_t index) {
+	for (uint32_t i = 0; i < rec->irCount; ++i) {
+		TraceIr* ir = &rec->ir[i];
+		if (ir->op == IR_ABOUND && ir->var == var && ir->a == index) return true;
+	}
+	return false;
+}
+
+//the array and index are checked before anything is changed
+static bool arrayIndex(TraceRecorder* rec, TraceOperand target, TraceOperand index, ObjArray** array, uint32_t* at) {
+	if (target.slot.type != SLOT_ARRAY || index.slot.type != SLOT_NUMBER) ABORT("not an array with number index");
+
+	*array = AS_ARRAY(target.value);
+	double number = AS_NUMBER(index.value);
+	if (!ARRAY_IN_RANGE((*array), number)) ABORT("index out of range");
+	*at = (uint32_t)number;
+	return true;
+}
+
+static bool arrayGet(TraceRecorder* rec, TraceOperand target, TraceOperand index, TraceOperand* out) {
+	ObjArray* array;
+	uint32_t at;
+	if (!arrayIndex(rec, target, index, &array, &at)) return false;
+
+	out->value = OBJ_IS_TYPE(array, OBJ_ARRAY) ? ARRAY_ELEMENT(array, Value, at) : NUMBER_VAL(ARRAY_ELEMENT(array, double, at));
+	if (!IS_NUMBER(out->value)) ABORT("element is not a number");
+
+	uint32_t exit;
+	if (!snapshot(rec, rec->ip, &exit)) return false;
+	out->slot = numberSlot(emitIr(rec, (TraceIr) {
+		.op = IR_ALOAD, .inRange = isBoundIr(rec, target.slot.a, index.slot.a), .var = (uint8_t)target.slot.a, .a = index.slot.a, .b = TRACE_NONE, .exit = exit
+	}));
+	return true;
+}
+
+static bool arraySet(TraceRecorder* rec, TraceOperand target, TraceOperand index, TraceOperand value) {
+	ObjArray* array;
+	uint32_t at;
+	if (!arrayIndex(rec, target, index, &array, &at)) return false;
+	if (value.slot.type != SLOT_NUMBER) ABORT("element is not a number");
+
+	uint32_t exit;
+	if (!snapshot(rec, rec->ip, &exit)) return false;
+	emitIr(rec, (TraceIr) {
+		.op = IR_ASTORE, .inRange = isBoundIr(rec, target.slot.a, index.slot.a), .var = (uint8_t)target.slot.a, .a = index.slot.a, .b = value.slot.a, .exit = exit
+	});
+
+	if (OBJ_IS_TYPE(array, OBJ_ARRAY)) {
+		ARRAY_ELEMENT(array, Value, at) = value.value;
+	}
+	else {
+		ARRAY_ELEMENT(array, double, at) = AS_NUMBER(value.value);
+	}
+	return true;
+}
+
+//run one commond and record it,false if it can't be traced and nothing is changed
+static bool recordCommond(TraceRecorder* rec, bool* isDone) {
+	uint32_t offset = (uint32_t)(rec->ip - rec->code);
+	if (offset < rec->loopStart || offset > rec->loopEnd) ABORT("left the loop");
+	if (rec->irCount + 8 > TRACE_MAX_IR) ABORT("too long");
+	if (rec->depth + 2 > TRACE_MAX_DEPTH) ABORT("stack is too deep");
+
+	uint8_t* code = rec->ip;
+	uint8_t* operands = code + 1;
+	TraceOperand left, right, result;
+
+	switch (code[0]) {
+	case OP_CONSTANT:
+		push(rec, constantOperand(rec, READ_CONSTANT(operands)));
+		rec->ip += 4;
+		return true;
+	case OP_NIL:
+		push(rec, constantOperand(rec, NIL_VAL));
+		rec->ip += 1;
+		return true;
+	case OP_TRUE:
+		push(rec, constantOperand(rec, TRUE_VAL));
+		rec->ip += 1;
+		return true;
+	case OP_FALSE:
+		push(rec, constantOperand(rec, FALSE_VAL));
+		rec->ip += 1;
+		return true;
+
+	case OP_GET_LOCAL:
+		if (!readLocal(rec, READ_SHORT(operands), &result)) return false;
+		push(rec, result);
+		rec->ip += 3;
+		return true;
+	case OP_SET_LOCAL:
+		if (!writeLocal(rec, READ_SHORT(operands), peek(rec, 0))) return false;
+		rec->ip += 3;
+		return true;
+	case OP_GET_GLOBAL:
+		if (!readGlobal(rec, READ_24bits(operands), &result)) return false;
+		push(rec, result);
+		rec->ip += 4;
+		return true;
+	case OP_SET_GLOBAL:
+		if (!writeGlobal(rec, READ_24bits(operands), peek(rec, 0))) return false;
+		rec->ip += 4;
+		return true;
+
+	case OP_POP:
+		if (rec->depth < 1) ABORT("pops a variable");
+		drop(rec, 1);
+		rec->ip += 1;
+		return true;
+	case OP_POP_N:
+		if (rec->depth < READ_SHORT(operands)) ABORT("pops a variable");
+		drop(rec, READ_SHORT(operands));
+		rec->ip += 3;
+		return true;
+	case OP_DUP:
+		if (rec->depth < 1) ABORT("copies a variable");
+		push(rec, peek(rec, 0));
+		rec->ip += 1;
+		return true;
+	case OP_DUP2: {
+		if (rec->depth < 2) ABORT("copies a variable");
+		TraceOperand first = peek(rec, 1);
+		TraceOperand second = peek(rec, 0);
+		push(rec, first);
+		push(rec, second);
+		rec->ip += 1;
+		return true;
+	}
+
+	case OP_ADD:
+	case OP_ADD_NUMBER:
+	case OP_SUBTRACT:
+	case OP_MULTIPLY:
+	case OP_DIVIDE:
+	case OP_MODULUS:
+		if (!arithmetic(rec, (code[0] == OP_ADD_NUMBER) ? 0 : code[0] - OP_ADD, peek(rec, 1), peek(rec, 0), &result)) return false;
+		drop(rec, 2);
+		push(rec, result);
+		rec->ip += 1;
+		return true;
+
+	case OP_NEGATE:
+	case OP_NEGATE_LOCAL: {
+		if (code[0] == OP_NEGATE) {
+			left = peek(rec, 0);
+		}
+		else if (!readLocal(rec, READ_SHORT(operands), &left)) {
+			return false;
+		}
+		if (left.slot.type != SLOT_NUMBER) ABORT("operand is not a number");
+
+		result.value = NUMBER_VAL(-AS_NUMBER(left.value));
+		result.slot = numberSlot(isConstantIr(rec, left.slot.a)
+			? irConstant(rec, -rec->ir[left.slot.a].number)
+			: emitIr(rec, (TraceIr) { .op = IR_NEG, .a = left.slot.a, .b = TRACE_NONE }));
+		if (code[0] == OP_NEGATE) {
+			drop(rec, 1);
+			rec->ip += 1;
+		}
+		else {
+			rec->ip += 3;
+		}
+		push(rec, result);
+		return true;
+	}
+
+	case OP_NOT:
+	case OP_NOT_LOCAL:
+		if (code[0] == OP_NOT) {
+			left = peek(rec, 0);
+		}
+		else if (!readLocal(rec, READ_SHORT(operands), &left)) {
+			return false;
+		}
+
+		result.value = BOOL_VAL(isFalsey(left.value));
+		if (left.slot.type == SLOT_COMPARE) {
+			result.slot = left.slot;
+			result.slot.isNegated = !left.slot.isNegated;
+		}
+		else {
+			result.slot = valueSlot(result.value);
+		}
+		if (code[0] == OP_NOT) {
+			drop(rec, 1);
+			rec->ip += 1;
+		}
+		else {
+			rec->ip += 3;
+		}
+		push(rec, result);
+		return true;
+
+	case OP_EQUAL:
+	case OP_GREATER:
+	case OP_LESS:
+	case OP_NOT_EQUAL:
+	case OP_LESS_EQUAL:
+	case OP_GREATER_EQUAL:
+		if (!compare(rec, (CompareType)(code[0] - OP_EQUAL), peek(rec, 1), peek(rec, 0), &result)) return false;
+		drop(rec, 2);
+		push(rec, result);
+		rec->ip += 1;
+		return true;
+
+	case OP_JUMP:
+		rec->ip += 3 + READ_SHORT(operands);
+		return true;
+	case OP_LOOP:
+		if (rec->ip + 3 - READ_SHORT(operands) != rec->code + rec->header) {
+			//the increment of 'for' jumps back to the condition once,more is an inner loop
+			if (rec->backEdges++ != 0) ABORT("inner loop");
+			rec->ip = code + 3 - READ_SHORT(operands);
+			return true;
+		}
+		if (rec->depth != 0) ABORT("stack is not balanced");
+
+		emitIr(rec, (TraceIr) { .op = IR_LOOP, .a = TRACE_NONE, .b = TRACE_NONE });
+		rec->ip = rec->code + rec->header;
+		*isDone = true;
+		return true;
+	case OP_JUMP_IF_FALSE:
+		return branch(rec, false, false, code + 3, code + 3 + READ_SHORT(operands));
+	case OP_JUMP_IF_FALSE_POP:
+		return branch(rec, false, true, code + 3, code + 3 + READ_SHORT(operands));
+	case OP_JUMP_IF_TRUE:
+		return branch(rec, true, false, code + 3, code + 3 + READ_SHORT(operands));
+
+	case OP_CALL:
+	case OP_CALL_NATIVE_NUMBER: {
+		uint32_t argCount = operands[0];
+		if (rec->depth < argCount + 1) ABORT("callee is a variable");
+
+		TraceOperand callee = peek(rec, argCount);
+		if (callee.slot.type != SLOT_VALUE || !IS_NATIVE(callee.value)) ABORT("callee is not a constant native");
+		ObjNative* native = AS_NATIVE_OBJ(callee.value);
+		if ((argCount != 1 && argCount != 2) || native->fastArity != argCount) ABORT("native has no number path");
+
+		TraceOperand a = peek(rec, argCount - 1);
+		TraceOperand b = (argCount == 2) ? peek(rec, 0) : a;
+		if (a.slot.type != SLOT_NUMBER || b.slot.type != SLOT_NUMBER) ABORT("arguments are not numbers");
+
+		result.value = NUMBER_VAL((argCount == 1)
+			? native->unary(AS_NUMBER(a.value))
+			: native->binary(AS_NUMBER(a.value), AS_NUMBER(b.value)));
+		result.slot = numberSlot(emitIr(rec, (TraceIr) {
+			.op = IR_CALL, .a = a.slot.a, .b = (argCount == 2) ? b.slot.a : TRACE_NONE, .native = native
+		}));
+		drop(rec, argCount + 1);
+		push(rec, result);
+		rec->ip += 2;
+		return true;
+	}
+
+	case OP_GET_SUBSCRIPT:
+	case OP_GET_SUBSCRIPT_ARRAY:
+	case OP_GET_SUBSCRIPT_F64:
+		if (rec->depth < 2 || !arrayGet(rec, peek(rec, 1), peek(rec, 0), &result)) return false;
+		drop(rec, 2);
+		push(rec, result);
+		rec->ip += 1;
+		return true;
+	case OP_SET_SUBSCRIPT:
+	case OP_SET_SUBSCRIPT_ARRAY:
+	case OP_SET_SUBSCRIPT_F64:
+		if (rec->depth < 3) ABORT("array is a variable");
+		right = peek(rec, 0);
+		if (!arraySet(rec, peek(rec, 2), peek(rec, 1), right)) return false;
+		drop(rec, 3);
+		push(rec, right);
+		rec->ip += 1;
+		return true;
+	case OP_GET_INDEX:
+	case OP_GET_INDEX_ARRAY:
+	case OP_GET_INDEX_F64:
+		if (rec->depth < 1 || !arrayGet(rec, peek(rec, 0), constantOperand(rec, READ_CONSTANT(operands)), &result)) return false;
+		drop(rec, 1);
+		push(rec, result);
+		rec->ip += 4;
+		return true;
+	case OP_SET_INDEX:
+	case OP_SET_INDEX_ARRAY:
+	case OP_SET_INDEX_F64:
+		if (rec->depth < 2) ABORT("array is a variable");
+		right = peek(rec, 0);
+		if (!arraySet(rec, peek(rec, 1), constantOperand(rec, READ_CONSTANT(operands)), right)) return false;
+		drop(rec, 2);
+		push(rec, right);
+		rec->ip += 4;
+		return true;
+	case OP_JUMP_IF_IN_ARRAY_LL: {
+		//only the way into the body version is recorded
+		if (!readLocal(rec, READ_SHORT(operands), &left) || !readLocal(rec, READ_SHORT(operands + 2), &right)) return false;
+		if (left.slot.type != SLOT_NUMBER || right.slot.type != SLOT_ARRAY) ABORT("not an array with number index");
+		if (!isArrayLoopIndex(right.value, left.value)) ABORT("array loop guard missed");
+
+		uint32_t exit;
+		if (!snapshot(rec, rec->ip, &exit)) return false;
+		emitIr(rec, (TraceIr) { .op = IR_ABOUND, .var = (uint8_t)right.slot.a, .a = left.slot.a, .b = TRACE_NONE, .exit = exit });
+		rec->ip = code + 7 + READ_SHORT(operands + 4);
+		return true;
+	}
+	case OP_GET_ELEMENT_LL:
+		if (!readLocal(rec, READ_SHORT(operands), &left) || !readLocal(rec, READ_SHORT(operands + 2), &right)) return false;
+		if (!arrayGet(rec, left, right, &result)) return false;
+		push(rec, result);
+		rec->ip += 5;
+		return true;
+	case OP_SET_ELEMENT_LL:
+		if (!readLocal(rec, READ_SHORT(operands), &left) || !readLocal(rec, READ_SHORT(operands + 2), &right)) return false;
+		if (!arraySet(rec, left, right, peek(rec, 0))) return false;
+		rec->ip += 5;
+		return true;
+
+	case OP_REG_MOVE:
+		if (!readLocal(rec, READ_SHORT(operands + 2), &result)) return false;
+		if (!writeLocal(rec, READ_SHORT(operands), result)) return false;
+		rec->ip += 5;
+		return true;
+	case OP_REG_LOAD_CONST:
+		if (!writeLocal(rec, READ_SHORT(operands), constantOperand(rec, READ_CONSTANT(operands + 2)))) return false;
+		rec->ip += 6;
+		return true;
+	}
+
+	//families of super commonds
+	if (code[0] >= OP_ADD_CONST && code[0] <= OP_MODULUS_CONST) {
+		if (!arithmetic(rec, code[0] - OP_ADD_CONST, peek(rec, 0), constantOperand(rec, READ_CONSTANT(operands)), &result)) return false;
+		drop(rec, 1);
+		push(rec, result);
+		rec->ip += 4;
+		return true;
+	}
+	if (code[0] >= OP_EQUAL_CONST && code[0] <= OP_GREATER_EQUAL_CONST) {
+		if (!compare(rec, (CompareType)(code[0] - OP_EQUAL_CONST), peek(rec, 0), constantOperand(rec, READ_CONSTANT(operands)), &result)) return false;
+		drop(rec, 1);
+		push(rec, result);
+		rec->ip += 4;
+		return true;
+	}
+	if (code[0] >= OP_ADD_LOCAL && code[0] <= OP_MODULUS_LOCAL) {
+		if (!readLocal(rec, READ_SHORT(operands), &right)) return false;
+		if (!arithmetic(rec, code[0] - OP_ADD_LOCAL, peek(rec, 0), right, &result)) return false;
+		drop(rec, 1);
+		push(rec, result);
+		rec->ip += 3;
+		return true;
+	}
+	if (code[0] >= OP_EQUAL_LOCAL && code[0] <= OP_GREATER_EQUAL_LOCAL) {
+		if (!readLocal(rec, READ_SHORT(operands), &right)) return false;
+		if (!compare(rec, (CompareType)(code[0] - OP_EQUAL_LOCAL), peek(rec, 0), right, &result)) return false;
+		drop(rec, 1);
+		push(rec, result);
+		rec->ip += 3;
+		return true;
+	}
+	if (code[0] >= OP_JUMP_IF_FALSE_EQUAL_LC && code[0] <= OP_JUMP_IF_FALSE_GREATER_EQUAL_LC) {
+		if (!readLocal(rec, READ_SHORT(operands), &left)) return false;
+		right = constantOperand(rec, READ_CONSTANT(operands + 2));
+		return compareJump(rec, (CompareType)(code[0] - OP_JUMP_IF_FALSE_EQUAL_LC), left, right, code + 8, code + 8 + READ_SHORT(operands + 5));
+	}
+	if (code[0] >= OP_JUMP_IF_FALSE_EQUAL_LL && code[0] <= OP_JUMP_IF_FALSE_GREATER_EQUAL_LL) {
+		if (!readLocal(rec, READ_SHORT(operands), &left) || !readLocal(rec, READ_SHORT(operands + 2), &right)) return false;
+		return compareJump(rec, (CompareType)(code[0] - OP_JUMP_IF_FALSE_EQUAL_LL), left, right, code + 7, code + 7 + READ_SHORT(operands + 4));
+	}
+	if (code[0] >= OP_INPLACE_ADD_LC && code[0] <= OP_INPLACE_DIVIDE_LC) {
+		uint32_t slot = READ_SHORT(operands);
+		if (!readLocal(rec, slot, &left)) return false;
+		if (!arithmetic(rec, code[0] - OP_INPLACE_ADD_LC, left, constantOperand(rec, READ_CONSTANT(operands + 2)), &result)) return false;
+		if (!writeLocal(rec, slot, result)) return false;
+		rec->ip += 6;
+		return true;
+	}
+	if (code[0] >= OP_INPLACE_ADD_LL && code[0] <= OP_INPLACE_DIVIDE_LL) {
+		uint32_t slot = READ_SHORT(operands);
+		if (!readLocal(rec, slot, &left) || !readLocal(rec, READ_SHORT(operands + 2), &right)) return false;
+		if (!arithmetic(rec, code[0] - OP_INPLACE_ADD_LL, left, right, &result)) return false;
+		if (!writeLocal(rec, slot, result)) return false;
+		rec->ip += 5;
+		return true;
+	}
+	if (code[0] >= OP_INPLACE_ADD_GC && code[0] <= OP_INPLACE_DIVIDE_GC) {
+		uint32_t slot = READ_24bits(operands);
+		if (!readGlobal(rec, slot, &left)) return false;
+		if (!arithmetic(rec, code[0] - OP_INPLACE_ADD_GC, left, constantOperand(rec, READ_CONSTANT(operands + 3)), &result)) return false;
+		if (!writeGlobal(rec, slot, result)) return false;
+		rec->ip += 7;
+		return true;
+	}
+	if (code[0] >= OP_REG_ADD_LL && code[0] <= OP_REG_MODULUS_LL) {
+		if (!readLocal(rec, READ_SHORT(operands + 2), &left) || !readLocal(rec, READ_SHORT(operands + 4), &right)) return false;
+		if (!arithmetic(rec, code[0] - OP_REG_ADD_LL, left, right, &result)) return false;
+		if (!writeLocal(rec, READ_SHORT(operands), result)) return false;
+		rec->ip += 7;
+		return true;
+	}
+	if (code[0] >= OP_REG_ADD_LC && code[0] <= OP_REG_MODULUS_LC) {
+		if (!readLocal(rec, READ_SHORT(operands + 2), &left)) return false;
+		if (!arithmetic(rec, code[0] - OP_REG_ADD_LC, left, constantOperand(rec, READ_CONSTANT(operands + 4)), &result)) return false;
+		if (!writeLocal(rec, READ_SHORT(operands), result)) return false;
+		rec->ip += 8;
+		return true;
+	}
+
+	ABORT("commond is not traced");
+}
+
+// ==================== code generation ====================
+
+typedef struct {
+	uint32_t at;		//the rel32 to patch
+	uint32_t target;	//offset in stubs,or the ir of constant
+} TraceFixup;
+
+typedef struct {
+	TraceRecorder* rec;
+	X64Code code;
+	X64Code stubs;	//exit stubs,placed after the code
+	C_STR failure;
+
+	int8_t location[TRACE_MAX_IR];		//xmm of the value,or LOCATION_NONE and LOCATION_CONSTANT
+	uint16_t lastUse[TRACE_MAX_IR];		//TRACE_NONE if never used
+	uint32_t exitStubs[TRACE_MAX_EXITS];//offset in stubs,UINT32_MAX if not emitted
+	uint32_t freeXmms;	//bits of xmm for temporaries
+	uint32_t varXmms;	//bits of xmm kept by variables
+
+	TraceFixup stubJumps[TRACE_MAX_FIXUPS];	//code to stub
+	uint32_t stubJumpCount;
+	TraceFixup constants[TRACE_MAX_FIXUPS];	//[rip + constant]
+	uint32_t constantCount;
+	uint32_t stubReturns[TRACE_MAX_EXITS];	//stub to epilogue
+	uint32_t stubReturnCount;
+	uint32_t entryMisses[TRACE_MAX_VARS * 2];//type guards at the entry
+	uint32_t entryMissCount;
+} TraceCompiler;
+
+static void useIr(TraceCompiler* tc, uint16_t ir, uint32_t index) {
+	if (ir != TRACE_NONE) tc->lastUse[ir] = (uint16_t)index;
+}
+
+//the values are kept until the last commond that reads them,exits included
+static void computeLastUses(TraceCompiler* tc) {
+	TraceRecorder* rec = tc->rec;
+	for (uint32_t i = 0; i < rec->irCount; ++i) {
+		tc->lastUse[i] = TRACE_NONE;
+	}
+
+	for (uint32_t i = 0; i < rec->irCount; ++i) {
+		TraceIr* ir = &rec->ir[i];
+		if (ir->op == IR_CONST || ir->op == IR_LOAD || ir->op == IR_LOOP) continue;
+
+		useIr(tc, ir->a, i);
+		useIr(tc, ir->b, i);
+		if (ir->op == IR_GUARD || ir->op == IR_ALOAD || ir->op == IR_ASTORE || ir->op == IR_ABOUND) {
+			TraceExit* exit = &rec->exits[ir->exit];
+			for (uint32_t j = 0; j < exit->depth; ++j) {
+				TraceSlot* slot = &rec->exitSlots[exit->slots + j];
+				if (slot->type == SLOT_NUMBER) useIr(tc, slot->a, i);
+			}
+		}
+	}
+}
+
+static bool isTempXmm(TraceCompiler* tc, int32_t xmm) {
+	return xmm >= XMM_FIRST && ((tc->varXmms >> xmm) & 1) == 0;
+}
+
+static uint32_t allocXmm(TraceCompiler* tc) {
+	for (uint32_t xmm = XMM_FIRST; xmm < XMM_COUNT; ++xmm) {
+		if ((tc->freeXmms >> xmm) & 1) {
+			tc->freeXmms &= ~(1u << xmm);
+			return xmm;
+		}
+	}
+	tc->failure = "too many values in registers";
+	return XMM0;
+}
+
+static void freeXmm(TraceCompiler* tc, int32_t xmm) {
+	if (isTempXmm(tc, xmm)) tc->freeXmms |= 1u << xmm;
+}
+
+static void moveXmm(TraceCompiler* tc, uint32_t dst, uint32_t src) {
+	if (dst != src) x64_sse(&tc->code, 0x66, SSE_MOVE, dst, src);
+}
+
+//op xmm, ir.a constant is [rip + disp] of the pool
+static void opIr(TraceCompiler* tc, uint8_t prefix, uint8_t opcode, uint32_t xmm, uint16_t ir) {
+	if (tc->location[ir] == LOCATION_CONSTANT) {
+		tc->constants[tc->constantCount++] = (TraceFixup){ .at = x64_sseRelative(&tc->code, prefix, opcode, xmm), .target = ir };
+	}
+	else {
+		x64_sse(&tc->code, prefix, opcode, xmm, tc->location[ir]);
+	}
+}
+
+static void loadIr(TraceCompiler* tc, uint32_t xmm, uint16_t ir) {
+	if (tc->location[ir] == LOCATION_CONSTANT) {
+		opIr(tc, 0xf2, SSE_LOAD, xmm, ir);
+	}
+	else {
+		moveXmm(tc, xmm, tc->location[ir]);
+	}
+}
+
+//the values still used in the register of a variable are moved before it's written
+static void evacuate(TraceCompiler* tc, uint32_t xmm, uint32_t index, uint32_t except) {
+	for (uint32_t i = 0; i < index; ++i) {
+		if (i != except && tc->location[i] == (int32_t)xmm && tc->lastUse[i] != TRACE_NONE && tc->lastUse[i] > index) {
+			uint32_t temp = allocXmm(tc);
+			moveXmm(tc, temp, xmm);
+			tc->location[i] = (int8_t)temp;
+		}
+	}
+}
+
+//a value stored to a variable next is made in the register of variable
+static uint32_t destinationOf(TraceCompiler* tc, uint32_t index) {
+	TraceRecorder* rec = tc->rec;
+	if (tc->lastUse[index] == TRACE_NONE) return XMM0;
+
+	TraceIr* next = &rec->ir[index + 1];
+	if (next->op == IR_STORE && next->a == index) {
+		uint32_t xmm = rec->vars[next->var].reg;
+		evacuate(tc, xmm, index, index);
+		return xmm;
+	}
+	return allocXmm(tc);
+}
+
+//xmm registers are caller saved,all the kept ones are spilled
+static void emitCallC(TraceCompiler* tc, uintptr_t function) {
+	uint32_t kept = tc->varXmms | (XMM_TEMP_MASK & ~tc->freeXmms);
+	for (uint32_t xmm = XMM_FIRST; xmm < XMM_COUNT; ++xmm) {
+		if ((kept >> xmm) & 1) x64_sseMemory(&tc->code, 0xf2, SSE_STORE, xmm, RSP, (int32_t)(xmm * 8));
+	}
+	x64_call(&tc->code, function);
+	for (uint32_t xmm = XMM_FIRST; xmm < XMM_COUNT; ++xmm) {
+		if ((kept >> xmm) & 1) x64_sseMemory(&tc->code, 0xf2, SSE_LOAD, xmm, RSP, (int32_t)(xmm * 8));
+	}
+}
+
+//rax = the value of variable,boxed
+static void loadVar(TraceCompiler* tc, TraceVar* var) {
+	if (var->name == NULL) {
+		x64_load(&tc->code, RAX, REG_SLOTS, (int32_t)(var->slot * sizeof(Value)));
+	}
+	else {
+		x64_load(&tc->code, RAX, REG_GLOBALS, (int32_t)(var->slot * sizeof(Value)));
+	}
+}
+
+//number is the value itself
+static void storeVar(TraceCompiler* tc, TraceVar* var, uint32_t xmm) {
+	if (var->name == NULL) {
+		x64_sseMemory(&tc->code, 0xf2, SSE_STORE, xmm, REG_SLOTS, (int32_t)(var->slot * sizeof(Value)));
+	}
+	else {
+		x64_sseMemory(&tc->code, 0xf2, SSE_STORE, xmm, REG_GLOBALS, (int32_t)(var->slot * sizeof(Value)));
+	}
+}
+
+//rebuild the stack of exit,then return its index
+static uint32_t exitStub(TraceCompiler* tc, uint32_t exit) {
+	if (tc->exitStubs[exit] != UINT32_MAX) return tc->exitStubs[exit];
+
+	TraceRecorder* rec = tc->rec;
+	X64Code* stubs = &tc->stubs;
+	TraceExit* info = &rec->exits[exit];
+	tc->exitStubs[exit] = stubs->count;
+
+	for (uint32_t i = 0; i < info->depth; ++i) {
+		TraceSlot* slot = &rec->exitSlots[info->slots + i];
+		int32_t disp = (int32_t)(i * sizeof(Value));
+		switch (slot->type) {
+		case SLOT_NUMBER:
+			if (tc->location[slot->a] == LOCATION_CONSTANT) {
+				x64_movImmediate(stubs, RAX, NUMBER_VAL(rec->ir[slot->a].number));
+				x64_store(stubs, REG_BASE, disp, RAX);
+			}
+			else {
+				x64_sseMemory(stubs, 0xf2, SSE_STORE, tc->location[slot->a], REG_BASE, disp);
+			}
+			break;
+		case SLOT_ARRAY:
+			x64_movImmediate(stubs, RAX, SIGN_BIT | QNAN);
+			x64_opRegister(stubs, X86_OR_STORE, RAX, rec->vars[slot->a].reg);
+			x64_store(stubs, REG_BASE, disp, RAX);
+			break;
+		default:
+			x64_movImmediate(stubs, RAX, slot->value);
+			x64_store(stubs, REG_BASE, disp, RAX);
+			break;
+		}
+	}
+
+	x64_movImmediate(stubs, RAX, exit);
+	tc->stubReturns[tc->stubReturnCount++] = x64_jmp(stubs);
+	return tc->exitStubs[exit];
+}
+
+//the jump to patch goes to the stub of exit
+static void emitExitFrom(TraceCompiler* tc, uint32_t at, uint32_t exit) {
+	tc->stubJumps[tc->stubJumpCount++] = (TraceFixup){ .at = at, .target = exitStub(tc, exit) };
+}
+
+static void emitExitIf(TraceCompiler* tc, Condition cc, uint32_t exit) {
+	emitExitFrom(tc, x64_jcc(&tc->code, cc), exit);
+}
+
+static void emitGuard(TraceCompiler* tc, TraceIr* ir) {
+	uint16_t first = ir->a;
+	uint16_t second = ir->b;
+	Condition cc = CC_E;
+	switch (ir->compare) {
+	case COMPARE_GREATER: cc = CC_A; break;
+	case COMPARE_GREATER_EQUAL: cc = CC_AE; break;
+	case COMPARE_LESS: cc = CC_A; first = ir->b; second = ir->a; break;
+	case COMPARE_LESS_EQUAL: cc = CC_AE; first = ir->b; second = ir->a; break;
+	}
+
+	uint32_t xmm = XMM0;
+	if (tc->location[first] == LOCATION_CONSTANT) {
+		loadIr(tc, XMM0, first);
+	}
+	else {
+		xmm = tc->location[first];
+	}
+	opIr(tc, 0x66, SSE_COMPARE, xmm, second);
+
+	if (COMPARE_IS_EQUALITY(ir->compare)) {
+		//NaN is unordered,it sets ZF and PF
+		if ((ir->compare == COMPARE_EQUAL) == ir->expected) {
+			emitExitIf(tc, CC_NE, ir->exit);
+			emitExitIf(tc, CC_P, ir->exit);
+		}
+		else {
+			uint32_t unordered = x64_jcc(&tc->code, CC_P);
+			emitExitIf(tc, CC_E, ir->exit);
+			x64_patchHere(&tc->code, unordered);
+		}
+	}
+	else {
+		emitExitIf(tc, ir->expected ? CC_NOT(cc) : cc, ir->exit);
+	}
+}
+
+//rax = the index in range of array,rdx = the payload.the range is not checked again after IR_ABOUND
+static void emitArrayIndex(TraceCompiler* tc, TraceIr* ir, Register array) {
+	loadIr(tc, XMM0, ir->a);
+	if (!ir->inRange) {
+		x64_sse(&tc->code, 0x66, SSE_XOR, XMM1, XMM1);
+		x64_sse(&tc->code, 0x66, SSE_COMPARE, XMM0, XMM1);//negative and NaN are below
+		emitExitIf(tc, CC_B, ir->exit);
+	}
+	x64_truncate(&tc->code, RAX, XMM0);
+	if (!ir->inRange) {
+		x64_load32(&tc->code, RDX, array, offsetof(ObjArray, length));
+		x64_opRegister(&tc->code, X86_CMP_STORE, RAX, RDX);
+		emitExitIf(tc, CC_AE, ir->exit);
+	}
+	if (ir->op != IR_ABOUND) x64_load(&tc->code, RDX, array, offsetof(ObjArray, payload));
+}
+
+static void compileIr(TraceCompiler* tc, uint32_t index, uint32_t loopTop) {
+	TraceRecorder* rec = tc->rec;
+	TraceIr* ir = &rec->ir[index];
+
+	switch (ir->op) {
+	case IR_CONST:
+		tc->location[index] = LOCATION_CONSTANT;
+		return;
+	case IR_LOAD:
+		tc->location[index] = (int8_t)rec->vars[ir->var].reg;
+		return;
+	case IR_STORE: {
+		TraceVar* var = &rec->vars[ir->var];
+		if (tc->location[ir->a] != var->reg) {
+			evacuate(tc, var->reg, index, ir->a);
+			loadIr(tc, var->reg, ir->a);
+			//the value is in the variable now
+			if (isTempXmm(tc, tc->location[ir->a])) {
+				freeXmm(tc, tc->location[ir->a]);
+				tc->location[ir->a] = (int8_t)var->reg;
+			}
+		}
+		storeVar(tc, var, var->reg);
+		return;
+	}
+	case IR_ADD:
+	case IR_SUB:
+	case IR_MUL:
+	case IR_DIV:
+	case IR_MOD:
+	case IR_NEG:
+	case IR_CALL: {
+		//pure,dropped if not used
+		if (tc->lastUse[index] == TRACE_NONE) return;
+
+		loadIr(tc, XMM0, ir->a);
+		if (ir->op == IR_MOD) {
+			loadIr(tc, XMM1, ir->b);
+			emitCallC(tc, (uintptr_t)fmod);
+		}
+		else if (ir->op == IR_CALL) {
+			if (ir->b != TRACE_NONE) {
+				loadIr(tc, XMM1, ir->b);
+				emitCallC(tc, (uintptr_t)ir->native->binary);
+			}
+			else {
+				emitCallC(tc, (uintptr_t)ir->native->unary);
+			}
+		}
+		else if (ir->op == IR_NEG) {
+			x64_movImmediate(&tc->code, RAX, SIGN_BIT);
+			x64_toXmm(&tc->code, XMM1, RAX);
+			x64_sse(&tc->code, 0x66, SSE_XOR, XMM0, XMM1);
+		}
+		else {
+			opIr(tc, 0xf2, arithmeticOps[ir->op - IR_ADD], XMM0, ir->b);
+		}
+
+		uint32_t dst = destinationOf(tc, index);
+		moveXmm(tc, dst, XMM0);
+		tc->location[index] = (int8_t)dst;
+		return;
+	}
+	case IR_GUARD:
+		emitGuard(tc, ir);
+		return;
+	case IR_ALOAD: {
+		TraceVar* var = &rec->vars[ir->var];
+		emitArrayIndex(tc, ir, var->reg);
+		if (var->arrayType == OBJ_ARRAY) {
+			x64_loadIndexed(&tc->code, RAX, RDX, RAX);
+			x64_movImmediate(&tc->code, RCX, QNAN);
+			emitExitFrom(tc, x64_unboxNumber(&tc->code, XMM0, RAX, RSI, RCX), ir->exit);
+		}
+		else {
+			x64_sseIndexed(&tc->code, 0xf2, SSE_LOAD, XMM0, RDX, RAX);
+		}
+
+		uint32_t dst = destinationOf(tc, index);
+		moveXmm(tc, dst, XMM0);
+		tc->location[index] = (int8_t)dst;
+		return;
+	}
+	case IR_ASTORE: {
+		//a number element is the same bits in both types
+		emitArrayIndex(tc, ir, rec->vars[ir->var].reg);
+		uint32_t xmm = XMM1;
+		if (tc->location[ir->b] == LOCATION_CONSTANT) {
+			loadIr(tc, XMM1, ir->b);
+		}
+		else {
+			xmm = tc->location[ir->b];
+		}
+		x64_sseIndexed(&tc->code, 0xf2, SSE_STORE, xmm, RDX, RAX);
+		return;
+	}
+	case IR_ABOUND:
+		emitArrayIndex(tc, ir, rec->vars[ir->var].reg);
+		return;
+	case IR_LOOP:
+		x64_patchTo(&tc->code, x64_jmp(&tc->code), loopTop);
+		return;
+	}
+}
+
+//the values read last time by the commond are released
+static void releaseDead(TraceCompiler* tc, uint32_t index) {
+	for (uint32_t i = 0; i <= index; ++i) {
+		if (tc->lastUse[i] == index) freeXmm(tc, tc->location[i]);
+	}
+}
+
+//entry(slots, globals, stackTop),returns the exit index or TRACE_ENTRY_MISS
+static void emitPrologue(TraceCompiler* tc) {
+	TraceRecorder* rec = tc->rec;
+	X64Code* code = &tc->code;
+
+	x64_push(code, RBP);
+	x64_push(code, RBX);
+	x64_push(code, R12);
+	x64_push(code, R13);
+	x64_push(code, R14);
+	x64_push(code, R15);
+	x64_opImmediate(code, X86_EXT_SUB, RSP, FRAME_SIZE);
+	x64_opRegister(code, X86_MOV_STORE, REG_SLOTS, RDI);
+	x64_opRegister(code, X86_MOV_STORE, REG_GLOBALS, RSI);
+	x64_opRegister(code, X86_MOV_STORE, REG_BASE, RDX);
+	x64_movImmediate(code, RCX, QNAN);
+	x64_movImmediate(code, RDI, SIGN_BIT | QNAN);
+
+	//type guards of variables are hoisted here,the loop keeps them unboxed
+	for (uint32_t i = 0; i < rec->varCount; ++i) {
+		TraceVar* var = &rec->vars[i];
+		if (!var->isLoaded) continue;
+
+		loadVar(tc, var);
+		if (var->isArray) {
+			x64_opRegister(code, X86_MOV_STORE, RDX, RAX);
+			x64_opRegister(code, X86_AND_STORE, RDX, RDI);
+			x64_opRegister(code, X86_CMP_STORE, RDX, RDI);
+			tc->entryMisses[tc->entryMissCount++] = x64_jcc(code, CC_NE);
+			x64_opRegister(code, X86_XOR_STORE, RAX, RDI);
+			x64_loadByte(code, RDX, RAX, offsetof(Obj, type));
+			x64_compare32(code, RDX, var->arrayType);
+			tc->entryMisses[tc->entryMissCount++] = x64_jcc(code, CC_NE);
+			x64_opRegister(code, X86_MOV_STORE, var->reg, RAX);
+		}
+		else {
+			//int32 is converted,the loop keeps doubles
+			tc->entryMisses[tc->entryMissCount++] = x64_unboxNumber(code, var->reg, RAX, RDX, RCX);
+		}
+	}
+}
+
+//registers of variables,false if there are too many
+static bool assignRegisters(TraceCompiler* tc) {
+	TraceRecorder* rec = tc->rec;
+	uint32_t xmm = XMM_FIRST;
+	uint32_t arrayCount = 0;
+
+	for (uint32_t i = 0; i < rec->varCount; ++i) {
+		TraceVar* var = &rec->vars[i];
+		if (var->isArray) {
+			if (arrayCount == TRACE_MAX_ARRAYS) return false;
+			var->reg = (uint8_t)arrayRegisters[arrayCount++];
+		}
+		else {
+			if (xmm == XMM_COUNT) return false;
+			tc->varXmms |= 1u << xmm;
+			var->reg = (uint8_t)xmm++;
+		}
+	}
+	tc->freeXmms = XMM_TEMP_MASK & ~tc->varXmms;
+	return true;
+}
+
+//the stubs and constants are placed after the code
+static void link(TraceCompiler* tc, uint32_t epilogue) {
+	TraceRecorder* rec = tc->rec;
+	X64Code* code = &tc->code;
+
+	uint32_t stubBase = code->count;
+	for (uint32_t i = 0; i < tc->stubs.count; ++i) {
+		x64_byte(code, tc->stubs.bytes[i]);
+	}
+	for (uint32_t i = 0; i < tc->stubJumpCount; ++i) {
+		x64_patchTo(code, tc->stubJumps[i].at, stubBase + tc->stubJumps[i].target);
+	}
+	for (uint32_t i = 0; i < tc->stubReturnCount; ++i) {
+		x64_patchTo(code, stubBase + tc->stubReturns[i], epilogue);
+	}
+
+	while (code->count % sizeof(double) != 0) {
+		x64_byte(code, 0xcc);//int3
+	}
+	uint32_t pool = code->count;
+	for (uint32_t i = 0; i < rec->irCount; ++i) {
+		if (rec->ir[i].op == IR_CONST) {
+			//the place of constant,reuse the lastUse
+			tc->lastUse[i] = (uint16_t)((code->count - pool) / sizeof(double));
+			x64_int64(code, NUMBER_VAL(rec->ir[i].number));
+		}
+	}
+	for (uint32_t i = 0; i < tc->constantCount; ++i) {
+		x64_patchTo(code, tc->constants[i].at, pool + tc->lastUse[tc->constants[i].target] * (uint32_t)sizeof(double));
+	}
+}
+
+static Trace* compileTrace(TraceRecorder* rec) {
+	TraceCompiler* tc = ALLOCATE_NO_GC(TraceCompiler, 1);
+	tc->rec = rec;
+	tc->code = (X64Code){ 0 };
+	tc->stubs = (X64Code){ 0 };
+	tc->failure = NULL;
+	tc->freeXmms = 0;
+	tc->varXmms = 0;
+	tc->stubJumpCount = 0;
+	tc->constantCount = 0;
+	tc->stubReturnCount = 0;
+	tc->entryMissCount = 0;
+	for (uint32_t i = 0; i < rec->irCount; ++i) {
+		tc->location[i] = LOCATION_NONE;
+	}
+	for (uint32_t i = 0; i < rec->exitCount; ++i) {
+		tc->exitStubs[i] = UINT32_MAX;
+	}
+
+	Trace* trace = NULL;
+	if (!assignRegisters(tc)) {
+		rec->abortReason = "too many variables in registers";
+	}
+	else {
+		computeLastUses(tc);
+		emitPrologue(tc);
+
+		uint32_t loopTop = tc->code.count;
+		for (uint32_t i = 0; i < rec->irCount && tc->failure == NULL; ++i) {
+			compileIr(tc, i, loopTop);
+			releaseDead(tc, i);
+		}
+
+		uint32_t entryMiss = tc->code.count;
+		x64_movImmediate(&tc->code, RAX, TRACE_ENTRY_MISS);
+		uint32_t epilogue = tc->code.count;
+		x64_opImmediate(&tc->code, X86_EXT_ADD, RSP, FRAME_SIZE);
+		x64_pop(&tc->code, R15);
+		x64_pop(&tc->code, R14);
+		x64_pop(&tc->code, R13);
+		x64_pop(&tc->code, R12);
+		x64_pop(&tc->code, RBX);
+		x64_pop(&tc->code, RBP);
+		x64_ret(&tc->code);
+		for (uint32_t i = 0; i < tc->entryMissCount; ++i) {
+			x64_patchTo(&tc->code, tc->entryMisses[i], entryMiss);
+		}
+		link(tc, epilogue);
+
+		if (tc->failure != NULL) {
+			rec->abortReason = tc->failure;
+		}
+		else {
+			uint64_t size;
+			uint8_t* memory = x64_map(&tc->code, &size);
+			if (memory == NULL) {
+				rec->abortReason = "no executable memory";
+			}
+			else {
+				trace = ALLOCATE_NO_GC(Trace, 1);
+				trace->code = memory;
+				trace->size = size;
+				trace->globalCount = rec->globalCount;
+				trace->globals = ALLOCATE_NO_GC(uint32_t, rec->globalCount);
+				trace->exitCount = rec->exitCount;
+				trace->exits = ALLOCATE_NO_GC(TraceExit, rec->exitCount);
+
+				for (uint32_t i = 0, global = 0; i < rec->varCount; ++i) {
+					if (rec->vars[i].name != NULL) trace->globals[global++] = rec->vars[i].slot;
+				}
+				for (uint32_t i = 0; i < rec->exitCount; ++i) {
+					trace->exits[i] = rec->exits[i];
+				}
+			}
+		}
+	}
+
+	x64_free(&tc->code);
+	x64_free(&tc->stubs);
+	FREE_NO_GC(TraceCompiler, tc);
+	return trace;
+}
+
+static void freeTrace(Trace* trace) {
+	x64_unmap(trace->code, trace->size);
+	FREE_ARRAY_NO_GC(uint32_t, trace->globals, trace->globalCount);
+	FREE_ARRAY_NO_GC(TraceExit, trace->exits, trace->exitCount);
+	FREE_NO_GC(Trace, trace);
+}
+
+// ==================== dump ====================
+
+static void dumpVar(TraceRecorder* rec, uint32_t index) {
+	TraceVar* var = &rec->vars[index];
+	if (var->name != NULL) {
+		printf("global %s", var->name->chars);
+	}
+	else {
+		printf("local %u", var->slot);
+	}
+}
+
+static void dumpLoop(TraceRecorder* rec) {
+	printf("[trace] loop of '%s' at %u", (rec->function->name != NULL) ? rec->function->name->chars : "script", rec->header);
+}
+
+static void dumpTrace(TraceRecorder* rec) {
+	dumpLoop(rec);
+	printf(": %u ir, %u exits\n", rec->irCount, rec->exitCount);
+
+	for (uint32_t i = 0; i < rec->varCount; ++i) {
+		TraceVar* var = &rec->vars[i];
+		printf("  v%-3u ", i);
+		dumpVar(rec, i);
+		printf(" %s%s\n", var->isArray ? ((var->arrayType == OBJ_ARRAY) ? "array" : "f64array") : "number", var->isLoaded ? ", guarded at entry" : "");
+	}
+
+	for (uint32_t i = 0; i < rec->irCount; ++i) {
+		TraceIr* ir = &rec->ir[i];
+		printf("  %04u %-6s ", i, irNames[ir->op]);
+		switch (ir->op) {
+		case IR_CONST:
+			printf("%.17g", ir->number);
+			break;
+		case IR_LOAD:
+			printf("v%u", ir->var);
+			break;
+		case IR_STORE:
+			printf("v%u = %04u", ir->var, ir->a);
+			break;
+		case IR_NEG:
+			printf("%04u", ir->a);
+			break;
+		case IR_CALL:
+			printf("%p %04u", (void*)ir->native, ir->a);
+			if (ir->b != TRACE_NONE) printf(" %04u", ir->b);
+			break;
+		case IR_GUARD:
+			printf("%04u %s %04u is %s", ir->a, compareNames[ir->compare], ir->b, ir->expected ? "true" : "false");
+			break;
+		case IR_ALOAD:
+			printf("v%u[%04u]", ir->var, ir->a);
+			break;
+		case IR_ASTORE:
+			printf("v%u[%04u] = %04u", ir->var, ir->a, ir->b);
+			break;
+		case IR_ABOUND:
+			printf("%04u in v%u", ir->a, ir->var);
+			break;
+		case IR_LOOP:
+			break;
+		default:
+			printf("%04u %04u", ir->a, ir->b);
+			break;
+		}
+
+		if (ir->op == IR_GUARD || ir->op == IR_ALOAD || ir->op == IR_ASTORE || ir->op == IR_ABOUND) {
+			TraceExit* exit = &rec->exits[ir->exit];
+			printf("  -> exit %u at %u, %u on stack", ir->exit, exit->ip, exit->depth);
+		}
+		printf("\n");
+	}
+}
+
+// ==================== entry ====================
+
+//the body of 'for' is placed after its increment,so the loop grows by the back edges into it
+static void findLoop(TraceRecorder* rec) {
+	Chunk* chunk = &rec->function->chunk;
+	bool isGrown = true;
+
+	while (isGrown) {
+		isGrown = false;
+		for (uint32_t offset = rec->loopStart; offset < chunk->count; offset += chunk_commondLength(chunk->code + offset)) {
+			if (chunk->code[offset] != OP_LOOP) continue;
+
+			uint32_t target = offset + 3 - READ_SHORT(chunk->code + offset + 1);
+			bool isInside = offset >= rec->loopStart && offset <= rec->loopEnd;
+			bool isToInside = target >= rec->loopStart && target <= rec->loopEnd;
+			if (isInside && target < rec->loopStart) {
+				rec->loopStart = target;
+				isGrown = true;
+				break;
+			}
+			if (!isInside && isToInside && offset > rec->loopEnd) {
+				rec->loopEnd = offset;
+				isGrown = true;
+			}
+		}
+	}
+}
+
+typedef uint32_t(*TraceEntry)(Value* slots, Value* globals, Value* stackTop);
+
+//record one iteration from the header,the vm has run it when returned
+static Trace* record(CallFrame* frame, uint32_t header, uint32_t loopEnd) {
+	TraceRecorder* rec = ALLOCATE_NO_GC(TraceRecorder, 1);
+	rec->frame = frame;
+	rec->function = frame->closure->function;
+	rec->code = rec->function->chunk.code;
+	rec->header = header;
+	rec->loopStart = header;
+	rec->loopEnd = loopEnd;
+	rec->backEdges = 0;
+	rec->ip = frame->ip;
+	rec->base = vm.stackTop;
+	rec->top = vm.stackTop;
+	rec->abortReason = NULL;
+	rec->depth = 0;
+	rec->varCount = 0;
+	rec->globalCount = 0;
+	rec->irCount = 0;
+	rec->exitCount = 0;
+	rec->exitSlotCount = 0;
+	findLoop(rec);
+
+	bool isDone = false;
+	while (!isDone && recordCommond(rec, &isDone)) {}
+
+	//stopped at a commond boundary,the interpreter goes on from it
+	frame->ip = rec->ip;
+	vm.stackTop = rec->top;
+
+	Trace* trace = NULL;
+	if (isDone) {
+		if (vm.config.traceDump) dumpTrace(rec);
+		trace = compileTrace(rec);
+	}
+
+	if (vm.config.traceDump) {
+		dumpLoop(rec);
+		if (trace != NULL) {
+			printf(" compiled, %u exits\n", trace->exitCount);
+		}
+		else if (isDone) {
+			printf(" not compiled: %s\n", rec->abortReason);
+		}
+		else {
+			printf(" aborted at %u: %s\n", (uint32_t)(rec->ip - rec->code), rec->abortReason);
+		}
+	}
+
+	FREE_NO_GC(TraceRecorder, rec);
+	return trace;
+}
+
+static bool runTrace(Trace* trace, CallFrame* frame) {
+	//a global may be deleted by @object.getGlobal()
+	for (uint32_t i = 0; i < trace->globalCount; ++i) {
+		if (IS_UNDEFINED(vm.globalValues[trace->globals[i]])) return false;
+	}
+
+	uint32_t exit = ((TraceEntry)trace->code)(frame->slots, vm.globalValues, vm.stackTop);
+	if (exit == TRACE_ENTRY_MISS) return false;
+
+	frame->ip = frame->closure->function->chunk.code + trace->exits[exit].ip;
+	vm.stackTop += trace->exits[exit].depth;
+	return true;
+}
+
+static TraceAnchor* findAnchor(ObjFunction* function, uint32_t header) {
+	for (uint32_t i = 0; i < function->traceAnchorCount; ++i) {
+		if (function->traceAnchors[i].header == header) return &function->traceAnchors[i];
+	}
+
+	if (function->traceAnchorCount == function->traceAnchorCapacity) {
+		uint32_t oldCapacity = function->traceAnchorCapacity;
+		function->traceAnchorCapacity = GROW_CAPACITY(oldCapacity);
+		function->traceAnchors = GROW_ARRAY_NO_GC(TraceAnchor, function->traceAnchors, oldCapacity, function->traceAnchorCapacity);
+	}
+	TraceAnchor* anchor = &function->traceAnchors[function->traceAnchorCount++];
+	*anchor = (TraceAnchor){ .header = header, .hotness = 0, .aborts = 0, .trace = NULL };
+	return anchor;
+}
+
+bool trace_loop(CallFrame* frame, uint32_t backEdge) {
+	ObjFunction* function = frame->closure->function;
+	uint32_t header = (uint32_t)(frame->ip - function->chunk.code);
+	TraceAnchor* anchor = findAnchor(function, header);
+
+	if (anchor->trace != NULL) return runTrace(anchor->trace, frame);
+	if (anchor->aborts >= TRACE_MAX_ABORTS || ++anchor->hotness < TRACE_HOT_LOOP) return false;
+
+	anchor->hotness = 0;
+	//OP_LOOP is 3 bytes before the jump back
+	anchor->trace = record(frame, header, header + backEdge - 3);
+	if (anchor->trace == NULL) ++anchor->aborts;
+	return true;
+}
+
+void trace_freeAnchors(ObjFunction* function) {
+	for (uint32_t i = 0; i < function->traceAnchorCount; ++i) {
+		if (function->traceAnchors[i].trace != NULL) freeTrace(function->traceAnchors[i].trace);
+	}
+	FREE_ARRAY_NO_GC(TraceAnchor, function->traceAnchors, function->traceAnchorCapacity);
+}
+
+#undef ABORT
+#undef READ_SHORT
+#undef READ_24bits
+#undef READ_CONSTANT
+#endif
@@ -0,0 +1,35 @@
+/*
+ * MIT License
+ * Copyright (c) 2025 IMSDcrueoft (https://github.com/IMSDcrueoft)
+ * See LICENSE file in the root directory for full license text.
+*/
+#pragma once
+#include "common.h"
+#include "object.h"
+#include "vm.h"
+#include "x64.h"
+
+//the trace jit emits x86-64 only
+#define TRACE_AVAILABLE X64_AVAILABLE
+
+//back edges of a loop before one iteration is recorded
+#define TRACE_HOT_LOOP 64
+//failed records before the loop is left to the interpreter
+#define TRACE_MAX_ABORTS 4
+
+typedef struct Trace Trace;
+
+//a loop header that is counted by its back edges
+struct TraceAnchor {
+	uint32_t header;	//bytecode offset of the loop header
+	uint16_t hotness;	//back edges since the last record
+	uint16_t aborts;	//failed records
+	Trace* trace;		//NULL if not compiled
+};
+
+#if TRACE_AVAILABLE
+//run the trace of the loop at frame->ip,or record it when hot.backEdge is the jump of OP_LOOP.
+//true if the frame has moved on,vm.stackTop and frame->ip are fresh after it
+bool trace_loop(CallFrame* frame, uint32_t backEdge);
+void trace_freeAnchors(ObjFunction* function);
+#endif
@@ -106,6 +106,9 @@ void printValue(Value value) {
 	else if (IS_NIL(value)) {
 		printf("nil");
 	}
+	else if (IS_INT(value)) {
+		printf("%d", AS_INT(value));
+	}
 	else if (IS_NUMBER(value)) {
 		char buffer[40];
 		convert_adaptive_double(AS_NUMBER(value), buffer, sizeof(buffer));
@@ -140,6 +143,9 @@ void printValue_sys(Value value)
 	else if (IS_NIL(value)) {
 		printf("nil");
 	}
+	else if (IS_INT(value)) {
+		printf("%d", AS_INT(value));
+	}
 	else if (IS_NUMBER(value)) {
 		char buffer[40];
 		convert_adaptive_double(AS_NUMBER(value), buffer, sizeof(buffer));
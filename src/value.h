@@ -20,6 +20,24 @@ typedef struct ObjString ObjString;
 
 typedef uint64_t Value;
 
+#define SIGN_BIT ((uint64_t)0x8000000000000000)
+#define QNAN     ((uint64_t)0x7ffc000000000000)
+#define TAG_NIL   1 // 01.
+#define TAG_FALSE 2 // 10.
+#define TAG_TRUE  3 // 11.
+#define TAG_INT   ((uint64_t)0x0002000000000000) // int32 in the low 32 bits,pointers never reach this bit
+
+#define FALSE_VAL       ((Value)(uint64_t)(QNAN | TAG_FALSE))
+#define TRUE_VAL        ((Value)(uint64_t)(QNAN | TAG_TRUE))
+
+//a number is a double or an int32,both are the same number to the language
+#define INT_VAL(i)			((Value)(QNAN | TAG_INT | (uint32_t)(int32_t)(i)))
+#define AS_INT(value)		((int32_t)(uint32_t)(value))
+#define IS_INT(value)		(((value) >> 32) == ((QNAN | TAG_INT) >> 32))
+//both are int32,one branch for the two tests
+#define IS_BOTH_INT(a, b)	(((((a) >> 32) ^ ((QNAN | TAG_INT) >> 32)) | (((b) >> 32) ^ ((QNAN | TAG_INT) >> 32))) == 0)
+#define IS_DOUBLE(value)	(((value) & QNAN) != QNAN)
+
 HOT_FUNCTION
 static inline Value numToValue(double num) {
 	Value value;
@@ -29,29 +47,27 @@ static inline Value numToValue(double num) {
 
 HOT_FUNCTION
 static inline double valueToNum(Value value) {
+	if (IS_INT(value)) return (double)AS_INT(value);
+
 	double num;
 	memcpy(&num, &value, sizeof(Value));
 	return num;
 }
 
-#define SIGN_BIT ((uint64_t)0x8000000000000000)
-#define QNAN     ((uint64_t)0x7ffc000000000000)
-#define TAG_NIL   1 // 01.
-#define TAG_FALSE 2 // 10.
-#define TAG_TRUE  3 // 11.
-
-#define FALSE_VAL       ((Value)(uint64_t)(QNAN | TAG_FALSE))
-#define TRUE_VAL        ((Value)(uint64_t)(QNAN | TAG_TRUE))
-
 #define NUMBER_VAL(num)		numToValue(num)
 #define AS_NUMBER(value)    valueToNum(value)
-#define IS_NUMBER(value)    (((value) & QNAN) != QNAN)
+//nil,bool and objects are the ones with QNAN in the high 16 bits,one test for both numbers
+#define IS_NUMBER(value)    ((((value) >> 48) & 0x7fff) != (QNAN >> 48))
 #define AS_BINARY(value)	(value)
 
 #define NIL_VAL         ((Value)(uint64_t)(QNAN | TAG_NIL))
 #define IS_NIL(value)   ((value) == NIL_VAL)
 #define NOT_NIL(value)  ((value) != NIL_VAL)
 
+//QNAN without a tag,never a value of the language.a global slot that is not defined
+#define UNDEFINED_VAL		((Value)(uint64_t)QNAN)
+#define IS_UNDEFINED(value)	((value) == UNDEFINED_VAL)
+
 #define BOOL_VAL(b)     ((b) ? TRUE_VAL : FALSE_VAL)
 #define AS_BOOL(value)  ((value) == TRUE_VAL)
 #define IS_BOOL(value)  (((value) | 1) == TRUE_VAL)
@@ -81,10 +97,21 @@ typedef struct {
 #define IS_NUMBER(value)	((value).type == VAL_NUMBER)
 #define AS_BINARY(value)	((value).as.binary)
 
+//no int32 tag,the fast paths are never taken
+#define INT_VAL(i)			NUMBER_VAL((double)(i))
+#define AS_INT(value)		((int32_t)AS_NUMBER(value))
+#define IS_INT(value)		(false)
+#define IS_BOTH_INT(a, b)	(false)
+#define IS_DOUBLE(value)	IS_NUMBER(value)
+
 #define NIL_VAL           ((Value){VAL_NIL, {.number = 0}})
 #define IS_NIL(value)     ((value).type == VAL_NIL)
 #define NOT_NIL(value)	  ((value).type != VAL_NIL)
 
+//nil with a payload,never a value of the language.a global slot that is not defined
+#define UNDEFINED_VAL		((Value){VAL_NIL, {.binary = 1}})
+#define IS_UNDEFINED(value)	((value).type == VAL_NIL && (value).as.binary == 1)
+
 #define BOOL_VAL(value)   ((Value){VAL_BOOL, {.boolean = value}})
 #define AS_BOOL(value)    ((value).as.boolean)
 #define IS_BOOL(value)    ((value).type == VAL_BOOL)
@@ -99,6 +126,88 @@ typedef struct {
 #define IS_NAN(value)		(IS_NUMBER(value) && isnan(AS_NUMBER(value))))
 #define IS_INFINITY(value)	(IS_NUMBER(value) && isinf(AS_NUMBER(value))))
 
+//int32 if the number is one (not -0),else double.numbers of the constant pool are made by it
+HOT_FUNCTION
+static inline Value numToValue_fit(double num) {
+	if (num >= INT32_MIN && num <= INT32_MAX) {
+		int32_t i = (int32_t)num;
+		if (i == num && (i != 0 || !signbit(num))) return INT_VAL(i);
+	}
+	return NUMBER_VAL(num);
+}
+
+#define NUMBER_VAL_FIT(num)	numToValue_fit(num)
+
+// ==================== arithmetic of number values ====================
+//the operands must be numbers.int32 operands give int32 if the result fits in,
+//the others (overflow,fraction,-0) are promoted to double,so the results are the same as double's
+
+HOT_FUNCTION
+static inline Value number_add(Value a, Value b) {
+	if (LIKELY(IS_BOTH_INT(a, b))) {
+		int64_t result = (int64_t)AS_INT(a) + AS_INT(b);
+		if (LIKELY(result == (int32_t)result)) return INT_VAL(result);
+	}
+	return NUMBER_VAL(AS_NUMBER(a) + AS_NUMBER(b));
+}
+
+HOT_FUNCTION
+static inline Value number_subtract(Value a, Value b) {
+	if (LIKELY(IS_BOTH_INT(a, b))) {
+		int64_t result = (int64_t)AS_INT(a) - AS_INT(b);
+		if (LIKELY(result == (int32_t)result)) return INT_VAL(result);
+	}
+	return NUMBER_VAL(AS_NUMBER(a) - AS_NUMBER(b));
+}
+
+HOT_FUNCTION
+static inline Value number_multiply(Value a, Value b) {
+	if (LIKELY(IS_BOTH_INT(a, b))) {
+		int64_t result = (int64_t)AS_INT(a) * AS_INT(b);
+		//0 * -1 is -0
+		if (result == (int32_t)result && (result != 0 || (AS_INT(a) | AS_INT(b)) >= 0)) return INT_VAL(result);
+	}
+	return NUMBER_VAL(AS_NUMBER(a) * AS_NUMBER(b));
+}
+
+HOT_FUNCTION
+static inline Value number_divide(Value a, Value b) {
+	return NUMBER_VAL(AS_NUMBER(a) / AS_NUMBER(b));
+}
+
+HOT_FUNCTION
+static inline Value number_modulus(Value a, Value b) {
+	if (LIKELY(IS_BOTH_INT(a, b))) {
+		int32_t left = AS_INT(a);
+		int32_t right = AS_INT(b);
+		//x % 0 is NaN,INT32_MIN % -1 traps,-4 % 2 is -0
+		if (right > 0 || right < -1) {
+			int32_t result = left % right;
+			if (result != 0 || left >= 0) return INT_VAL(result);
+		}
+	}
+	return NUMBER_VAL(fmod(AS_NUMBER(a), AS_NUMBER(b)));
+}
+
+HOT_FUNCTION
+static inline Value number_negate(Value a) {
+	//-0 and -INT32_MIN are doubles
+	if (IS_INT(a) && AS_INT(a) != 0 && AS_INT(a) != INT32_MIN) return INT_VAL(-AS_INT(a));
+	return NUMBER_VAL(-AS_NUMBER(a));
+}
+
+//both are numbers,the int32 pair is tested first so it stays the straight path
+#define IS_BOTH_NUMBER(a, b)	(LIKELY(IS_BOTH_INT(a, b)) || (IS_NUMBER(a) && IS_NUMBER(b)))
+
+//a op b of numbers,op is a compare
+#define NUMBER_COMPARE(a, op, b) (IS_BOTH_INT(a, b) ? (AS_INT(a) op AS_INT(b)) : (AS_NUMBER(a) op AS_NUMBER(b)))
+
+//the int32 operand of the bitwise commonds,double is truncated as before
+HOT_FUNCTION
+static inline int32_t number_toInt32(Value value) {
+	return IS_INT(value) ? AS_INT(value) : (int32_t)AS_NUMBER(value);
+}
+
 typedef struct {
 	uint32_t capacity; //limit to 4G
 	uint32_t count;    //limit to 4G
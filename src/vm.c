@@ -8,6 +8,10 @@
 #include "gc.h"
 #include "file.h"
 #include "allocator.h"
+#include "jit.h"
+#include "trace.h"
+#include "aot.h"
+#include "profile.h"
 
 #if DEBUG_TRACE_EXECUTION
 #include "debug.h"
@@ -23,12 +27,9 @@ VM vm;
 COLD_FUNCTION
 static void stack_reset()
 {
-	//reset the pointer
-	vm.stackTop = vm.stack;
-
-	//set all to nil
-	for (Value* ptr = vm.stack; ptr < vm.stackBoundary; ++ptr) {
-		*ptr = NIL_VAL;
+	//set the used ones to nil,the pages above them are left untouched
+	while (vm.stackTop > vm.stack) {
+		*--vm.stackTop = NIL_VAL;
 	}
 
 	vm.frameCount = 0;
@@ -143,24 +144,11 @@ static void runtimeError(C_STR format, ...) {
 	stack_reset();
 }
 
+//the frames are checked by call(),so there is room for it
 HOT_FUNCTION
 void stack_push(Value value)
 {
-	*vm.stackTop = value;
-
-	if (++vm.stackTop == vm.stackBoundary) {
-		ptrdiff_t oldCapacity = vm.stackBoundary - vm.stack;
-		uint32_t capacity = GROW_CAPACITY(oldCapacity);
-
-		if (capacity > UINT24_COUNT) {
-			runtimeError("Stack overflow.");
-			return;
-		}
-
-		vm.stack = GROW_ARRAY_NO_GC(Value, vm.stack, oldCapacity, capacity);
-		vm.stackBoundary = vm.stack + capacity;		//need fresh
-		vm.stackTop = vm.stack + oldCapacity;		//need fresh
-	}
+	*vm.stackTop++ = value;
 }
 
 HOT_FUNCTION
@@ -185,6 +173,22 @@ void defineNative_math(C_STR name, NativeFn function) {
 	);
 }
 
+COLD_FUNCTION
+void defineNativeUnary_math(C_STR name, NativeFn function, NativeUnaryFn unary) {
+	tableSet(&vm.builtins[MODULE_MATH].fields,
+		copyString(name, (uint32_t)strlen(name), false),
+		OBJ_VAL(newNativeUnary(function, unary))
+	);
+}
+
+COLD_FUNCTION
+void defineNativeBinary_math(C_STR name, NativeFn function, NativeBinaryFn binary) {
+	tableSet(&vm.builtins[MODULE_MATH].fields,
+		copyString(name, (uint32_t)strlen(name), false),
+		OBJ_VAL(newNativeBinary(function, binary))
+	);
+}
+
 COLD_FUNCTION
 void defineNative_array(C_STR name, NativeFn function) {
 	tableSet(&vm.builtins[MODULE_ARRAY].fields,
@@ -235,16 +239,46 @@ void defineNative_system(C_STR name, NativeFn function) {
 
 COLD_FUNCTION
 void defineNative_global(C_STR name, NativeFn function) {
-	//stack_push(OBJ_VAL(copyString(name, (uint32_t)strlen(name), false)));
-	//stack_push(OBJ_VAL(newNative(function)));
-	//tableSet(&vm.globals.fields, AS_STRING(vm.stack[0]), vm.stack[1]);
-	//stack_pop();
-	//stack_pop();
+	uint32_t slot = globalSlot(copyString(name, (uint32_t)strlen(name), false));
+	vm.globalValues[slot] = OBJ_VAL(newNative(function));
+}
 
-	tableSet(&vm.globals.fields,
-		copyString(name, (uint32_t)strlen(name), false),
-		OBJ_VAL(newNative(function))
-	);
+uint32_t globalSlot(ObjString* name) {
+	if (name->symbol != INVALID_OBJ_STRING_SYMBOL) return name->symbol;
+
+	if (vm.globalCount == GLOBAL_MAX) {
+		fprintf(stderr, "Too many global variables.\n");
+		exit(1);
+	}
+	if (vm.globalCount == vm.globalCapacity) {
+		uint32_t oldCapacity = vm.globalCapacity;
+		vm.globalCapacity = GROW_CAPACITY(oldCapacity);
+		vm.globalNames = GROW_ARRAY_NO_GC(ObjString*, vm.globalNames, oldCapacity, vm.globalCapacity);
+	}
+
+	//names are interned,so one slot for each
+	uint32_t slot = vm.globalCount++;
+	vm.globalNames[slot] = name;
+	vm.globalValues[slot] = UNDEFINED_VAL;
+	name->symbol = slot;
+	return slot;
+}
+
+bool globalGet(ObjString* name, Value* value_out) {
+	if (name->symbol == INVALID_OBJ_STRING_SYMBOL) return false;
+
+	Value value = vm.globalValues[name->symbol];
+	if (IS_UNDEFINED(value)) return false;
+	*value_out = value;
+	return true;
+}
+
+void globalSet(ObjString* name, Value value) {
+	if (IS_NIL(value)) {
+		if (name->symbol != INVALID_OBJ_STRING_SYMBOL) vm.globalValues[name->symbol] = UNDEFINED_VAL;
+		return;
+	}
+	vm.globalValues[globalSlot(name)] = value;
 }
 
 COLD_FUNCTION
@@ -253,7 +287,8 @@ static void importBuiltins() {
 		vm.builtins[i] = (ObjInstance){
 		.obj = stateLess_obj_header(OBJ_INSTANCE),
 		.klass = NULL,
-		.fields = {.isGlobal = false,.isFrozen = false}//remind this
+		.shape = &vm.dictionaryShape,
+		.fields = {.isFrozen = false}//remind this
 		};
 	}
 
@@ -323,25 +358,38 @@ void vm_init()
 	valueArray_init(&vm.constants);
 	valueHoles_init(&vm.constantHoles);
 
-	vm.stack = ALLOCATE_NO_GC(Value, STACK_INITIAL_SIZE);
-	vm.stackBoundary = vm.stack + STACK_INITIAL_SIZE;
+	//a push past the end hits the guard page instead of other memory
+	vm.stack = (Value*)reserveMemory(sizeof(Value) * STACK_MAX);
+	vm.stackTop = vm.stack;
+	vm.stackBoundary = vm.stack + STACK_MAX - STACK_SLACK;
 
 	stack_reset();
 
+	//before any instance
+	shape_init();
+
 	// init global 
+	vm.globalValues = (Value*)reserveMemory(sizeof(Value) * GLOBAL_MAX);
+	vm.globalNames = NULL;
+	vm.globalCount = 0;
+	vm.globalCapacity = 0;
 	vm.globals = (ObjInstance){
 		.obj = stateLess_obj_header(OBJ_INSTANCE),
 		.klass = NULL,
-		.fields = {.isGlobal = true,.isFrozen = false}//remind this
+		.shape = &vm.dictionaryShape,
+		.fields = {.isFrozen = false}
 	};
-
 	table_init(&vm.globals.fields);
 
 	stringTable_init(&vm.scripts);
 	stringTable_init(&vm.strings);
 	numberTable_init(&vm.numbers);
 
-	vm.objects = NULL;
+	vm.objects = (ObjSegments){ .count = 0, .capacity = 0, .segments = NULL };
+	vm.youngObjects = NULL;
+	vm.sweepObjects = (ObjSegments){ .count = 0, .capacity = 0, .segments = NULL };
+	vm.sweepYoungObjects = NULL;
+	vm.sweepSegment = 0;
 	vm.objects_no_gc = NULL;
 
 	//init gray stack
@@ -349,7 +397,25 @@ void vm_init()
 	vm.grayCapacity = 0;
 	vm.grayStack = NULL;
 
+	vm.rememberedCount = 0;
+	vm.rememberedCapacity = 0;
+	vm.remembered = NULL;
+
+	vm.blocks = NULL;
+	vm.allocBlock = NULL;
+	vm.allocLine = 0;
+	vm.allocCursor = NULL;
+	vm.allocLimit = NULL;
+	vm.youngBytes = 0;
+
 	vm.functionID = 0;
+	vm.methodCacheEpoch = 0;
+#if LOG_INLINE_CACHE
+	vm.propertyCacheHits = 0;
+	vm.propertyCacheMisses = 0;
+	vm.invokeCacheHits = 0;
+	vm.invokeCacheMisses = 0;
+#endif
 	//set
 	vm.bytesAllocated = 0;
 	vm.bytesAllocated_no_gc = 0;
@@ -357,6 +423,23 @@ void vm_init()
 	vm.beginGC = GC_HEAP_BEGIN;
 	vm.gcMark = true; //bool value
 	vm.gcWorking = false; //bool value
+	vm.gcMinor = false;
+	vm.gcPhase = GC_PHASE_IDLE;
+	vm.gcLockDepth = 0;
+	vm.gcThreadActive = false;
+	vm.gcThread = NULL;
+	if (vm.config.gcThread) {
+		gc_startThread();
+	}
+	vm.gcWorkerCount = 1;
+	vm.gcWorkers = NULL;
+	//more workers than processors only take turns
+	uint32_t gcThreads = min(vm.config.gcThreads, thread_hardwareCount());
+	if (gcThreads > 1) {
+		gc_startWorkers(gcThreads);
+	}
+	vm.gcPauseTarget = GC_PAUSE_TARGET;
+	vm.gcStepAt = 0;
 
 	//import the builtins
 	importBuiltins();
@@ -385,7 +468,12 @@ void vm_free()
 	valueArray_free(&vm.constants);
 	valueHoles_free(&vm.constantHoles);
 
-	table_free(&vm.globals.fields);
+	releaseMemory(vm.globalValues, sizeof(Value) * GLOBAL_MAX);
+	FREE_ARRAY_NO_GC(ObjString*, vm.globalNames, vm.globalCapacity);
+	vm.globalValues = NULL;
+	vm.globalNames = NULL;
+	vm.globalCount = 0;
+	vm.globalCapacity = 0;
 	stringTable_free(&vm.scripts);
 	stringTable_free(&vm.strings);
 	numberTable_free(&vm.numbers);
@@ -394,11 +482,13 @@ void vm_free()
 	for (uint32_t i = 0; i < TYPE_STRING_COUNT; ++i) {
 		vm.typeStrings[i] = NULL;
 	}
+	gc_stopThread();
+	gc_stopWorkers();
 	freeObjects();
+	shape_free();
 
 	//realease the stack
-	ptrdiff_t capacity = vm.stackBoundary - vm.stack;
-	FREE_ARRAY_NO_GC(Value, vm.stack, capacity);
+	releaseMemory(vm.stack, sizeof(Value) * STACK_MAX);
 	vm.stack = NULL;
 	vm.stackTop = NULL;
 	vm.stackBoundary = NULL;
@@ -408,6 +498,7 @@ void vm_free()
 
 	vm.ip_error = NULL;
 	table_free(&vm.emptyClass.methods);
+	profile_free();
 }
 
 uint32_t getConstantSize()
@@ -509,7 +600,8 @@ static bool call(ObjClosure* closure, int argCount) {
 		return false;
 	}
 
-	if (vm.frameCount == FRAMES_MAX) {
+	//the only check of the stack,pushes of the frame stay below its deepest point
+	if (vm.frameCount == FRAMES_MAX || vm.stackTop - argCount - 1 + closure->function->maxStack > vm.stackBoundary) {
 		runtimeError("Stack overflow.");
 		return false;
 	}
@@ -540,10 +632,14 @@ static inline void defineMethod(ObjString* name) {
 	Value method = vm.stackTop[-1];
 	ObjClass* klass = AS_CLASS(vm.stackTop[-2]);
 
+	gc_lockLayout(&klass->obj);
 	tableSet(&klass->methods, name, method);
+	gc_unlockLayout(&klass->obj);
 	if (name == vm.initString) {//inline cache
 		klass->initializer = method;
 	}
+	gc_writeBarrier(&klass->obj, method);
+	vm.methodCacheEpoch++;
 	vm.stackTop--;
 }
 
@@ -579,18 +675,76 @@ static bool callValue(Value callee, int argCount) {
 	return false;
 }
 
+#if LOG_INLINE_CACHE
+#define PROPERTY_CACHE_HIT()	(++vm.propertyCacheHits)
+#define PROPERTY_CACHE_MISS()	(++vm.propertyCacheMisses)
+#define INVOKE_CACHE_HIT()		(++vm.invokeCacheHits)
+#define INVOKE_CACHE_MISS()		(++vm.invokeCacheMisses)
+
+COLD_FUNCTION
+static void logInlineCache() {
+	uint64_t total = vm.propertyCacheHits + vm.propertyCacheMisses;
+	printf("[Log] Property cache hit %llu / %llu (%.2f%%).\n", (unsigned long long)vm.propertyCacheHits, (unsigned long long)total,
+		(total == 0) ? 0.0 : (100.0 * vm.propertyCacheHits / total));
+
+	total = vm.invokeCacheHits + vm.invokeCacheMisses;
+	printf("[Log] Invoke cache hit %llu / %llu (%.2f%%).\n", (unsigned long long)vm.invokeCacheHits, (unsigned long long)total,
+		(total == 0) ? 0.0 : (100.0 * vm.invokeCacheHits / total));
+}
+#else
+#define PROPERTY_CACHE_HIT()	((void)0)
+#define PROPERTY_CACHE_MISS()	((void)0)
+#define INVOKE_CACHE_HIT()		((void)0)
+#define INVOKE_CACHE_MISS()		((void)0)
+#endif
+
+//find the method in the invoke cache,NULL if miss
+HOT_FUNCTION
+static inline ObjClosure* invokeCacheLookup(InvokeCache* cache, ObjClass* klass, Shape* shape) {
+	if (cache->epoch != vm.methodCacheEpoch) {
+		//some method table changed or some class freed
+		cache->epoch = vm.methodCacheEpoch;
+		cache->count = 0;
+		return NULL;
+	}
+
+	for (uint32_t i = 0; i < cache->count; ++i) {
+		InvokeCacheEntry* entry = &cache->entries[i];
+		if (entry->klass == klass && entry->shape == shape) {
+			INVOKE_CACHE_HIT();
+			return entry->method;
+		}
+	}
+	return NULL;
+}
+
+static inline void invokeCacheInsert(InvokeCache* cache, ObjClass* klass, Shape* shape, ObjClosure* method) {
+	if (cache->count == INVOKE_CACHE_WAYS) {
+		//full, drop the oldest one
+		memmove(&cache->entries[0], &cache->entries[1], sizeof(InvokeCacheEntry) * (INVOKE_CACHE_WAYS - 1));
+		cache->count--;
+	}
+	cache->entries[cache->count++] = (InvokeCacheEntry){ .klass = klass, .shape = shape, .method = method };
+}
+
+//shape is the key of cache,NULL means don't cache
 HOT_FUNCTION
-static inline bool invokeFromClass(ObjClass* klass, ObjString* name, int argCount) {
+static inline bool invokeFromClass(ObjClass* klass, ObjString* name, int argCount, InvokeCache* cache, Shape* shape) {
+	INVOKE_CACHE_MISS();
 	Value method;
 	if ((klass == NULL) || !tableGet(&klass->methods, name, &method)) {
 		runtimeError("Undefined property '%s'.", name->chars);
 		return false;
 	}
+
+	if (shape != NULL) {
+		invokeCacheInsert(cache, klass, shape, AS_CLOSURE(method));
+	}
 	return call(AS_CLOSURE(method), argCount);
 }
 
 HOT_FUNCTION
-static inline bool invoke(ObjString* name, int argCount) {
+static inline bool invoke(ObjString* name, int argCount, InvokeCache* cache) {
 	Value receiver = STACK_PEEK(argCount);
 	if (!IS_INSTANCE(receiver)) {
 		runtimeError("Only instances have methods.");
@@ -598,13 +752,24 @@ static inline bool invoke(ObjString* name, int argCount) {
 	}
 	ObjInstance* instance = AS_INSTANCE(receiver);
 
+	//dictionary shape is never cached
+	ObjClosure* closure = invokeCacheLookup(cache, instance->klass, instance->shape);
+	if (closure != NULL) {
+		return call(closure, argCount);
+	}
+
 	Value value;
-	if (tableGet(&instance->fields, name, &value)) {
+	if (instanceGet(instance, name, &value)) {
 		STACK_PEEK(argCount) = value;
 		return callValue(value, argCount);
 	}
 
-	return invokeFromClass(instance->klass, name, argCount);
+	//a field may be added later with the same shape,only cache when the shape has no such key
+	Shape* shape = instance->shape;
+	if (INSTANCE_IS_DICTIONARY(instance) || shapeGetSlot(shape, name) != SHAPE_INVALID_SLOT) {
+		shape = NULL;
+	}
+	return invokeFromClass(instance->klass, name, argCount, cache, shape);
 }
 
 HOT_FUNCTION
@@ -658,6 +823,7 @@ static void closeUpvalues(Value* last) {
 		//if one upValue closed,it's location is it's closed's pointer
 		upvalue->closed = *upvalue->location;
 		upvalue->location = &upvalue->closed;
+		gc_writeBarrier(&upvalue->obj, upvalue->closed);
 		vm.openUpvalues = upvalue->next;
 	}
 }
@@ -677,9 +843,9 @@ static bool bitInstruction(uint8_t bitOpType) {
 #define BIARAY_OP_BIT(op)																			\
     do {																							\
 		/* Pop the top two values from the stack */													\
-		if (IS_NUMBER(vm.stackTop[-2]) && IS_NUMBER(vm.stackTop[-1])) {								\
+		if (IS_BOTH_NUMBER(vm.stackTop[-2], vm.stackTop[-1])) {								\
 			/* Perform the operation and push the result back */									\
-			vm.stackTop[-2] = NUMBER_VAL((int32_t)AS_NUMBER(vm.stackTop[-2]) op (int32_t)AS_NUMBER(vm.stackTop[-1]));	\
+			vm.stackTop[-2] = INT_VAL(number_toInt32(vm.stackTop[-2]) op number_toInt32(vm.stackTop[-1]));	\
 			vm.stackTop--;																			\
 			return true;																			\
 		}																							\
@@ -704,7 +870,7 @@ static bool bitInstruction(uint8_t bitOpType) {
 	case BIT_OP_NOT: {
 	label_bit_not:
 		if (IS_NUMBER(vm.stackTop[-1])) {
-			vm.stackTop[-1] = NUMBER_VAL(~(int32_t)AS_NUMBER(vm.stackTop[-1]));
+			vm.stackTop[-1] = INT_VAL(~number_toInt32(vm.stackTop[-1]));
 			return true;
 		}
 		break;
@@ -727,15 +893,15 @@ static bool bitInstruction(uint8_t bitOpType) {
 
 	case BIT_OP_SHL: {
 	label_bit_shl:
-		if (IS_NUMBER(vm.stackTop[-2]) && IS_NUMBER(vm.stackTop[-1])) {
-			int32_t shiftBits = AS_NUMBER(vm.stackTop[-1]);
+		if (IS_BOTH_NUMBER(vm.stackTop[-2], vm.stackTop[-1])) {
+			int32_t shiftBits = number_toInt32(vm.stackTop[-1]);
 
 			if (shiftBits >= 0) {
-				vm.stackTop[-2] = NUMBER_VAL((int32_t)AS_NUMBER(vm.stackTop[-2]) << (shiftBits & 31));
+				vm.stackTop[-2] = INT_VAL((int32_t)((uint32_t)number_toInt32(vm.stackTop[-2]) << (shiftBits & 31)));
 				vm.stackTop--;
 			}
 			else {
-				vm.stackTop[-2] = NUMBER_VAL(0);
+				vm.stackTop[-2] = INT_VAL(0);
 				vm.stackTop--;
 			}
 			return true;
@@ -744,15 +910,15 @@ static bool bitInstruction(uint8_t bitOpType) {
 	}
 	case BIT_OP_SAR: {
 	label_bit_sar:
-		if (IS_NUMBER(vm.stackTop[-2]) && IS_NUMBER(vm.stackTop[-1])) {
-			int32_t shiftBits = AS_NUMBER(vm.stackTop[-1]);
+		if (IS_BOTH_NUMBER(vm.stackTop[-2], vm.stackTop[-1])) {
+			int32_t shiftBits = number_toInt32(vm.stackTop[-1]);
 
 			if (shiftBits >= 0) {
-				vm.stackTop[-2] = NUMBER_VAL((int32_t)AS_NUMBER(vm.stackTop[-2]) >> (shiftBits & 31));
+				vm.stackTop[-2] = INT_VAL(number_toInt32(vm.stackTop[-2]) >> (shiftBits & 31));
 				vm.stackTop--;
 			}
 			else {
-				vm.stackTop[-2] = NUMBER_VAL(0);
+				vm.stackTop[-2] = INT_VAL(0);
 				vm.stackTop--;
 			}
 			return true;
@@ -761,15 +927,17 @@ static bool bitInstruction(uint8_t bitOpType) {
 	}
 	case BIT_OP_SHR: {
 	label_bit_shr:
-		if (IS_NUMBER(vm.stackTop[-2]) && IS_NUMBER(vm.stackTop[-1])) {
-			int32_t shiftBits = AS_NUMBER(vm.stackTop[-1]);
+		if (IS_BOTH_NUMBER(vm.stackTop[-2], vm.stackTop[-1])) {
+			int32_t shiftBits = number_toInt32(vm.stackTop[-1]);
 
 			if (shiftBits >= 0) {
-				vm.stackTop[-2] = NUMBER_VAL((uint32_t)AS_NUMBER(vm.stackTop[-2]) >> (shiftBits & 31));
+				Value left = vm.stackTop[-2];
+				uint32_t result = (IS_INT(left) ? (uint32_t)AS_INT(left) : (uint32_t)AS_NUMBER(left)) >> (shiftBits & 31);
+				vm.stackTop[-2] = (result <= INT32_MAX) ? INT_VAL(result) : NUMBER_VAL(result);
 				vm.stackTop--;
 			}
 			else {
-				vm.stackTop[-2] = NUMBER_VAL(0);
+				vm.stackTop[-2] = INT_VAL(0);
 				vm.stackTop--;
 			}
 			return true;
@@ -781,12 +949,20 @@ static bool bitInstruction(uint8_t bitOpType) {
 #undef BIARAY_OP_BIT
 }
 
+//the value of global slot for in-place commond,NULL if undefined
+static inline Value* getGlobalRef(uint32_t slot) {
+	Value* global = &vm.globalValues[slot];
+	return IS_UNDEFINED(*global) ? NULL : global;
+}
+
 //to run code in vm
 HOT_FUNCTION
 static InterpretResult run()
 {
 	CallFrame* frame = &vm.frames[vm.frameCount - 1];
 	uint8_t* ip = frame->ip;
+	//keep in register,vm.stackTop is only fresh after STORE_STACK_TOP()
+	Value* stackTop = vm.stackTop;
 	//if error,use this to print
 	vm.ip_error = &ip;
 
@@ -822,8 +998,11 @@ static InterpretResult run()
 		[OP_JUMP_IF_TRUE] = && label_op_jump_if_true,
 		[OP_POP] = && label_op_pop,
 		[OP_POP_N] = && label_op_pop_n,
+		[OP_DUP] = && label_op_dup,
+		[OP_DUP2] = && label_op_dup2,
 		[OP_BITWISE] = && label_op_bitwise,
 		[OP_CALL] = && label_op_call,
+		[OP_TAIL_CALL] = && label_op_tail_call,
 		[OP_INVOKE] = && label_op_invoke,
 		[OP_SUPER_INVOKE] = && label_op_super_invoke,
 		[OP_RETURN] = && label_op_return,
@@ -843,6 +1022,7 @@ static InterpretResult run()
 		[OP_GET_UPVALUE] = && label_op_get_upvalue,
 		[OP_SET_UPVALUE] = && label_op_set_upvalue,
 		[OP_CLOSE_UPVALUE] = && label_op_close_upvalue,
+		[OP_GET_CAPTURE] = && label_op_get_capture,
 		[OP_NEW_ARRAY] = && label_op_new_array,
 		[OP_NEW_OBJECT] = && label_op_new_object,
 		[OP_NEW_PROPERTY] = && label_op_new_property,
@@ -885,52 +1065,269 @@ static InterpretResult run()
 
 		[OP_NOT_LOCAL] = && label_op_not_local,
 		[OP_NEGATE_LOCAL] = && label_op_negate_local,
+
+		[OP_JUMP_IF_FALSE_EQUAL_LC] = && label_op_jump_if_false_equal_lc,
+		[OP_JUMP_IF_FALSE_GREATER_LC] = && label_op_jump_if_false_greater_lc,
+		[OP_JUMP_IF_FALSE_LESS_LC] = && label_op_jump_if_false_less_lc,
+		[OP_JUMP_IF_FALSE_NOT_EQUAL_LC] = && label_op_jump_if_false_not_equal_lc,
+		[OP_JUMP_IF_FALSE_LESS_EQUAL_LC] = && label_op_jump_if_false_less_equal_lc,
+		[OP_JUMP_IF_FALSE_GREATER_EQUAL_LC] = && label_op_jump_if_false_greater_equal_lc,
+		[OP_JUMP_IF_FALSE_EQUAL_LL] = && label_op_jump_if_false_equal_ll,
+		[OP_JUMP_IF_FALSE_GREATER_LL] = && label_op_jump_if_false_greater_ll,
+		[OP_JUMP_IF_FALSE_LESS_LL] = && label_op_jump_if_false_less_ll,
+		[OP_JUMP_IF_FALSE_NOT_EQUAL_LL] = && label_op_jump_if_false_not_equal_ll,
+		[OP_JUMP_IF_FALSE_LESS_EQUAL_LL] = && label_op_jump_if_false_less_equal_ll,
+		[OP_JUMP_IF_FALSE_GREATER_EQUAL_LL] = && label_op_jump_if_false_greater_equal_ll,
+
+		[OP_INPLACE_ADD_LC] = && label_op_inplace_add_lc,
+		[OP_INPLACE_SUBTRACT_LC] = && label_op_inplace_subtract_lc,
+		[OP_INPLACE_MULTIPLY_LC] = && label_op_inplace_multiply_lc,
+		[OP_INPLACE_DIVIDE_LC] = && label_op_inplace_divide_lc,
+		[OP_INPLACE_ADD_LL] = && label_op_inplace_add_ll,
+		[OP_INPLACE_SUBTRACT_LL] = && label_op_inplace_subtract_ll,
+		[OP_INPLACE_MULTIPLY_LL] = && label_op_inplace_multiply_ll,
+		[OP_INPLACE_DIVIDE_LL] = && label_op_inplace_divide_ll,
+		[OP_INPLACE_ADD_UC] = && label_op_inplace_add_uc,
+		[OP_INPLACE_SUBTRACT_UC] = && label_op_inplace_subtract_uc,
+		[OP_INPLACE_MULTIPLY_UC] = && label_op_inplace_multiply_uc,
+		[OP_INPLACE_DIVIDE_UC] = && label_op_inplace_divide_uc,
+		[OP_INPLACE_ADD_GC] = && label_op_inplace_add_gc,
+		[OP_INPLACE_SUBTRACT_GC] = && label_op_inplace_subtract_gc,
+		[OP_INPLACE_MULTIPLY_GC] = && label_op_inplace_multiply_gc,
+		[OP_INPLACE_DIVIDE_GC] = && label_op_inplace_divide_gc,
+
+		[OP_REG_MOVE] = && label_op_reg_move,
+		[OP_REG_LOAD_CONST] = && label_op_reg_load_const,
+		[OP_REG_NEGATE] = && label_op_reg_negate,
+		[OP_REG_ADD_LL] = && label_op_reg_add_ll,
+		[OP_REG_SUBTRACT_LL] = && label_op_reg_subtract_ll,
+		[OP_REG_MULTIPLY_LL] = && label_op_reg_multiply_ll,
+		[OP_REG_DIVIDE_LL] = && label_op_reg_divide_ll,
+		[OP_REG_MODULUS_LL] = && label_op_reg_modulus_ll,
+		[OP_REG_ADD_LC] = && label_op_reg_add_lc,
+		[OP_REG_SUBTRACT_LC] = && label_op_reg_subtract_lc,
+		[OP_REG_MULTIPLY_LC] = && label_op_reg_multiply_lc,
+		[OP_REG_DIVIDE_LC] = && label_op_reg_divide_lc,
+		[OP_REG_MODULUS_LC] = && label_op_reg_modulus_lc,
+		[OP_JUMP_IF_IN_ARRAY_LL] = && label_op_jump_if_in_array_ll,
+		[OP_GET_ELEMENT_LL] = && label_op_get_element_ll,
+		[OP_SET_ELEMENT_LL] = && label_op_set_element_ll,
+
+		[OP_GET_SUBSCRIPT_ARRAY] = && label_op_get_subscript_array,
+		[OP_GET_SUBSCRIPT_F64] = && label_op_get_subscript_f64,
+		[OP_SET_SUBSCRIPT_ARRAY] = && label_op_set_subscript_array,
+		[OP_SET_SUBSCRIPT_F64] = && label_op_set_subscript_f64,
+		[OP_GET_INDEX_ARRAY] = && label_op_get_index_array,
+		[OP_GET_INDEX_F64] = && label_op_get_index_f64,
+		[OP_SET_INDEX_ARRAY] = && label_op_set_index_array,
+		[OP_SET_INDEX_F64] = && label_op_set_index_f64,
+		[OP_ADD_NUMBER] = && label_op_add_number,
+		[OP_CALL_NATIVE_NUMBER] = && label_op_call_native_number,
+	};
+	//--profile dispatches by this table,every commond is counted before its label
+	static void* label_profile[UINT8_MAX + 1] = {
+		[0 ... UINT8_MAX] = && label_op_profile,
 	};
+	void** dispatch = vm.config.profile ? label_profile : label_instructions;
 #endif
 
 #define READ_BYTE() (*(ip++))
 #define READ_SHORT() (ip += 2, (uint16_t)(ip[-2] | (ip[-1] << 8)))
 #define READ_24bits() (ip += 3, (uint32_t)(ip[-3] | (ip[-2] << 8) | (ip[-1] << 16)))
 #define READ_CONSTANT(index) (vm.constants.values[(index)])
+//spill before anything that may gc or use vm.stackTop,reload after it may change
+#define STORE_STACK_TOP() (vm.stackTop = stackTop)
+#define LOAD_STACK_TOP() (stackTop = vm.stackTop)
+#define PUSH(value) (*stackTop++ = (value))
+#define POP() (*--stackTop)
+//pop without reading the value
+#define DROP() ((void)--stackTop)
+#define REPLACE(value) ((void)(stackTop[-1] = (value)))
+//rewrite the running commond, operandBytes are already read
+#define QUICKEN(operandBytes, op) ((void)(ip[-1 - (operandBytes)] = (op)))
+//guard miss, rewrite back before operands are read
+#define DEQUICKEN(op) ((void)(ip[-1] = (op)))
+//run the top frame by its C code of --emit-c if it has
+#define AOT_ENTER()																	\
+	do {																			\
+		if (vm.config.aot && frame->closure->function->aot != NULL) {				\
+			frame->ip = ip;															\
+			STORE_STACK_TOP();														\
+			if (aot_run(frame) == JIT_ERROR) return INTERPRET_RUNTIME_ERROR;		\
+			frame = &vm.frames[vm.frameCount - 1];									\
+			ip = frame->ip;															\
+			LOAD_STACK_TOP();														\
+		}																			\
+	} while (false)
+//run the top frame by native code if it's compiled,isHot counts the heat for compiling
+#if JIT_AVAILABLE
+#define JIT_ENTER(isHot)															\
+	do {																			\
+		AOT_ENTER();																\
+		if (vm.config.jit && jit_ready(frame->closure->function, isHot)) {			\
+			frame->ip = ip;															\
+			STORE_STACK_TOP();														\
+			if (jit_run(frame) == JIT_ERROR) return INTERPRET_RUNTIME_ERROR;		\
+			frame = &vm.frames[vm.frameCount - 1];									\
+			ip = frame->ip;															\
+			LOAD_STACK_TOP();														\
+		}																			\
+	} while (false)
+#else
+#define JIT_ENTER(isHot) AOT_ENTER()
+#endif
+//run the trace of the loop at ip if it's recorded,backEdge is the jump of OP_LOOP
+#if TRACE_AVAILABLE
+#define TRACE_ENTER(backEdge)														\
+	do {																			\
+		if (vm.config.trace) {														\
+			frame->ip = ip;															\
+			STORE_STACK_TOP();														\
+			if (trace_loop(frame, (backEdge))) {									\
+				ip = frame->ip;														\
+				LOAD_STACK_TOP();													\
+			}																		\
+		}																			\
+	} while (false)
+#else
+#define TRACE_ENTER(backEdge) ((void)0)
+#endif
 
-	// push(pop() op pop())
-#define BINARY_OP(valueType,op)																		\
+	// push(pop() op pop()),op is a compare
+#define BINARY_OP(op)																				\
     do {																							\
 		/* Pop the top two values from the stack */													\
-		if (IS_NUMBER(vm.stackTop[-2]) && IS_NUMBER(vm.stackTop[-1])) {								\
+		if (IS_BOTH_NUMBER(stackTop[-2], stackTop[-1])) {								\
 			/* Perform the operation and push the result back */									\
-			vm.stackTop[-2] = valueType(AS_NUMBER(vm.stackTop[-2]) op AS_NUMBER(vm.stackTop[-1]));	\
-			vm.stackTop--;																			\
+			stackTop[-2] = BOOL_VAL(NUMBER_COMPARE(stackTop[-2], op, stackTop[-1]));	\
+			stackTop--;																			\
 		} else {														                            \
 			runtimeError("Operands must be numbers.");										\
 			return INTERPRET_RUNTIME_ERROR;															\
 		}																							\
 	} while (false)
 
-#define BINARY_OP_WITH_RIGHT(valueType,right,op)											\
+#define BINARY_OP_WITH_RIGHT(right,op)														\
     do {																					\
 		/* Pop the top two values from the stack */											\
-		if (IS_NUMBER(vm.stackTop[-1]) && IS_NUMBER(right)) {								\
+		if (IS_BOTH_NUMBER(stackTop[-1], right)) {								\
 			/* Perform the operation and push the result back */							\
-			vm.stackTop[-1] = valueType(AS_NUMBER(vm.stackTop[-1]) op AS_NUMBER(right));	\
+			stackTop[-1] = BOOL_VAL(NUMBER_COMPARE(stackTop[-1], op, right));	\
 		} else {																			\
 			runtimeError("Operands must be numbers.");								\
 			return INTERPRET_RUNTIME_ERROR;													\
 		}																					\
 	} while (false)
 
+	// push(operation(pop(), pop())),operation is number_xxx of value.h
+#define ARITHMETIC_OP(operation)																	\
+    do {																							\
+		if (IS_BOTH_NUMBER(stackTop[-2], stackTop[-1])) {								\
+			stackTop[-2] = operation(stackTop[-2], stackTop[-1]);							\
+			stackTop--;																			\
+		} else {														                            \
+			runtimeError("Operands must be numbers.");										\
+			return INTERPRET_RUNTIME_ERROR;															\
+		}																							\
+	} while (false)
+
+#define ARITHMETIC_OP_WITH_RIGHT(right,operation)											\
+    do {																					\
+		if (IS_BOTH_NUMBER(stackTop[-1], right)) {								\
+			stackTop[-1] = operation(stackTop[-1], right);							\
+		} else {																			\
+			runtimeError("Operands must be numbers.");								\
+			return INTERPRET_RUNTIME_ERROR;													\
+		}																					\
+	} while (false)
+
+	// slots[dst] = operation(left, right)
+#define REGISTER_OP(dst,left,right,operation)										\
+    do {																			\
+		if (IS_BOTH_NUMBER(left, right)) {									\
+			frame->slots[dst] = operation(left, right);								\
+		} else {																	\
+			runtimeError("Operands must be numbers.");								\
+			return INTERPRET_RUNTIME_ERROR;											\
+		}																			\
+	} while (false)
+
+#define REGISTER_ADD(dst,left,right)												\
+    do {																			\
+		if (IS_BOTH_NUMBER(left, right)) {									\
+			frame->slots[dst] = number_add(left, right);							\
+		} else if (IS_STRING(left) && IS_STRING(right)) {							\
+			/* the temporaries below dst are alive,the operands are pushed above them for gc */	\
+			Value* top = (stackTop > frame->slots + (dst)) ? stackTop : frame->slots + (dst);	\
+			top[0] = left;															\
+			top[1] = right;															\
+			vm.stackTop = top + 2;													\
+			frame->slots[dst] = OBJ_VAL(connectString(AS_STRING(left), AS_STRING(right)));	\
+			STORE_STACK_TOP();														\
+		} else {																	\
+			runtimeError("Operands must be two numbers or two strings.");			\
+			return INTERPRET_RUNTIME_ERROR;											\
+		}																			\
+	} while (false)
+
+	// jump if !(left op right), offset follows the operands
+#define COMPARE_JUMP(left,right,op)													\
+    do {																			\
+		uint16_t offset = READ_SHORT();												\
+		if (IS_BOTH_NUMBER(left, right)) {									\
+			if (!NUMBER_COMPARE(left, op, right)) ip += offset;						\
+		} else {																	\
+			runtimeError("Operands must be numbers.");								\
+			return INTERPRET_RUNTIME_ERROR;											\
+		}																			\
+	} while (false)
+
+#define EQUAL_JUMP(left,right,isEqual)												\
+    do {																			\
+		uint16_t offset = READ_SHORT();												\
+		if (valuesEqual(left, right) != (isEqual)) ip += offset;					\
+	} while (false)
+
+	// *target = operation(*target, right)
+#define INPLACE_OP(target,right,operation)											\
+    do {																			\
+		if (IS_BOTH_NUMBER(*(target), right)) {								\
+			*(target) = operation(*(target), right);								\
+		} else {																	\
+			runtimeError("Operands must be numbers.");								\
+			return INTERPRET_RUNTIME_ERROR;											\
+		}																			\
+	} while (false)
+
+#define INPLACE_ADD(target,right)													\
+    do {																			\
+		if (IS_BOTH_NUMBER(*(target), right)) {								\
+			*(target) = number_add(*(target), right);								\
+		} else if (IS_STRING(*(target)) && IS_STRING(right)) {						\
+			/* operands are rooted by the variable, safe for gc */					\
+			STORE_STACK_TOP();														\
+			*(target) = OBJ_VAL(connectString(AS_STRING(*(target)), AS_STRING(right)));	\
+		} else {																	\
+			runtimeError("Operands must be two numbers or two strings.");			\
+			return INTERPRET_RUNTIME_ERROR;											\
+		}																			\
+	} while (false)
+
 //we need continue/break when debug trace
 #if !COMPUTE_GOTO || DEBUG_TRACE_EXECUTION
 #define NEXT_INSTRUCTION continue
 #else //direct threading code
-#define NEXT_INSTRUCTION goto *label_instructions[READ_BYTE()]
+#define NEXT_INSTRUCTION goto *dispatch[READ_BYTE()]
 #endif
 
+	//the frame may begin in its C code
+	AOT_ENTER();
+
 	while (true) //let it loop
 	{
 #if DEBUG_TRACE_EXECUTION //print in debug mode
 		printf("          ");
-		for (Value* slot = vm.stack; slot < vm.stackTop; slot++) {
+		for (Value* slot = vm.stack; slot < stackTop; slot++) {
 			printf("[ ");
 			printValue(*slot);
 			printf(" ]");
@@ -943,8 +1340,14 @@ static InterpretResult run()
 
 		uint8_t instruction = READ_BYTE();
 #if COMPUTE_GOTO
-		goto* label_instructions[instruction];
+		goto* dispatch[instruction];
 		//jmp direct,no switch
+
+	label_op_profile:
+		profile_commond(frame->closure->function, ip - 1);
+		goto* label_instructions[ip[-1]];
+#else
+		if (vm.config.profile) profile_commond(frame->closure->function, ip - 1);
 #endif
 
 		switch (instruction)
@@ -952,49 +1355,74 @@ static InterpretResult run()
 		case OP_CONSTANT: {
 		label_op_constant:
 			Value constant = READ_CONSTANT(READ_24bits());
-			stack_push(constant);
+			PUSH(constant);
 			NEXT_INSTRUCTION;
 		}
 		case OP_CLOSURE: {
 		label_op_closure:
 			Value constant = READ_CONSTANT(READ_24bits());
 			ObjFunction* function = AS_FUNCTION(constant);
+			//captures nothing,no operands follow
+			if (function->closure != NULL) {
+				PUSH(OBJ_VAL(function->closure));
+				NEXT_INSTRUCTION;
+			}
+
+			STORE_STACK_TOP();
 			ObjClosure* closure = newClosure(function);
-			stack_push(OBJ_VAL(closure));
+			PUSH(OBJ_VAL(closure));
+			STORE_STACK_TOP();//capture may gc
 
+			ObjUpvalue** upvalues = CLOSURE_UPVALUES(closure);
 			for (uint32_t i = 0; i < closure->upvalueCount; i++) {
 				uint8_t isLocal = READ_BYTE();
 				uint16_t index = READ_SHORT();
 				if (isLocal) {
-					closure->upvalues[i] = captureUpvalue(frame->slots + index);
+					upvalues[i] = captureUpvalue(frame->slots + index);
 				}
 				else {
-					closure->upvalues[i] = frame->closure->upvalues[index];
+					upvalues[i] = CLOSURE_UPVALUES(frame->closure)[index];
 				}
 			}
+			//never assigned,the values are copied
+			for (uint32_t i = 0; i < closure->captureCount; i++) {
+				uint8_t isLocal = READ_BYTE();
+				uint16_t index = READ_SHORT();
+				closure->captures[i] = isLocal ? frame->slots[index] : frame->closure->captures[index];
+			}
+			//a capture may have promoted it
+			gc_writeBarrierAll(&closure->obj);
 			NEXT_INSTRUCTION;
 		}
 		case OP_CLASS: {
 		label_op_class:
 			Value constant = READ_CONSTANT(READ_24bits());
 			ObjString* name = AS_STRING(constant);
-			stack_push(OBJ_VAL(newClass(name)));
+			STORE_STACK_TOP();
+			PUSH(OBJ_VAL(newClass(name)));
 			NEXT_INSTRUCTION;
 		}
 		case OP_METHOD: {
 		label_op_method:
 			Value constant = READ_CONSTANT(READ_24bits());
 			ObjString* name = AS_STRING(constant);
+			STORE_STACK_TOP();
 			defineMethod(name);
+			LOAD_STACK_TOP();
 			NEXT_INSTRUCTION;
 		}
 		case OP_INHERIT: {
 		label_op_inherit:
-			Value superclass = vm.stackTop[-2];
+			Value superclass = stackTop[-2];
 			if (IS_CLASS(superclass)) {
-				ObjClass* subclass = AS_CLASS(vm.stackTop[-1]);
+				ObjClass* subclass = AS_CLASS(stackTop[-1]);
+				STORE_STACK_TOP();
+				gc_lockLayout(&subclass->obj);
 				tableAddAll(&AS_CLASS(superclass)->methods, &subclass->methods);
-				stack_pop(); // Subclass.
+				gc_unlockLayout(&subclass->obj);
+				gc_writeBarrierAll(&subclass->obj);
+				vm.methodCacheEpoch++;
+				DROP(); // Subclass.
 			}
 			else {
 				runtimeError("Superclass must be a class.");
@@ -1006,55 +1434,110 @@ static InterpretResult run()
 		label_op_get_super:
 			Value constant = READ_CONSTANT(READ_24bits());
 			ObjString* name = AS_STRING(constant);
-			ObjClass* superclass = AS_CLASS(stack_pop());
+			ObjClass* superclass = AS_CLASS(POP());
+			STORE_STACK_TOP();
 			bindMethod(superclass, name);
 			NEXT_INSTRUCTION;
 		}
 		case OP_GET_PROPERTY: {
 		label_op_get_property:
-			if (!IS_INSTANCE(vm.stackTop[-1])) {
+			if (!IS_INSTANCE(stackTop[-1])) {
 				runtimeError("Only instances have properties.");
 				return INTERPRET_RUNTIME_ERROR;
 			}
 
-			ObjInstance* instance = AS_INSTANCE(vm.stackTop[-1]);
+			ObjInstance* instance = AS_INSTANCE(stackTop[-1]);
 			Value constant = READ_CONSTANT(READ_24bits());
 			ObjString* name = AS_STRING(constant);
+			PropertyCache* cache = &frame->closure->function->propertyCaches[READ_SHORT()];
 
-			Value value;
-			if (tableGet(&instance->fields, name, &value)) {
-				stack_replace(value);
+			//same shape, undefined slot is a deleted field
+			if (cache->shape == instance->shape && !IS_UNDEFINED(instance->slots[cache->slot])) {
+				PROPERTY_CACHE_HIT();
+				REPLACE(instance->slots[cache->slot]);
 				NEXT_INSTRUCTION;
 			}
+			PROPERTY_CACHE_MISS();
+
+			if (!INSTANCE_IS_DICTIONARY(instance)) {
+				uint32_t slot = shapeGetSlot(instance->shape, name);
+				if (slot != SHAPE_INVALID_SLOT && !IS_UNDEFINED(instance->slots[slot])) {
+					cache->shape = instance->shape;
+					cache->transition = NULL;
+					cache->slot = slot;
+					REPLACE(instance->slots[slot]);
+					NEXT_INSTRUCTION;
+				}
+			}
+			else {
+				Value value;
+				if (instanceGet(instance, name, &value)) {
+					REPLACE(value);
+					NEXT_INSTRUCTION;
+				}
+			}
+
 			//don't throw error
 			if (instance->klass != NULL) {
+				STORE_STACK_TOP();
 				bindMethod(instance->klass, name);
 			}
 			NEXT_INSTRUCTION;
 		}
 		case OP_SET_PROPERTY: {
 		label_op_set_property:
-			if (!IS_INSTANCE(vm.stackTop[-2])) {
+			if (!IS_INSTANCE(stackTop[-2])) {
 				runtimeError("Only instances have fields.");
 				return INTERPRET_RUNTIME_ERROR;
 			}
 
-			ObjInstance* instance = AS_INSTANCE(vm.stackTop[-2]);
+			ObjInstance* instance = AS_INSTANCE(stackTop[-2]);
 			Value constant = READ_CONSTANT(READ_24bits());
 			ObjString* name = AS_STRING(constant);
-			if (NOT_NIL(vm.stackTop[-1])) {
-				tableSet(&instance->fields, name, vm.stackTop[-1]);
+			PropertyCache* cache = &frame->closure->function->propertyCaches[READ_SHORT()];
+
+			//set nil is delete, always go the slow way
+			if (cache->shape == instance->shape && NOT_NIL(stackTop[-1])) {
+				PROPERTY_CACHE_HIT();
+				if (cache->transition != NULL) {
+					//add the key as the cached transition
+					STORE_STACK_TOP();
+					instanceReserve(instance, cache->transition->slotCount);
+					gc_lockLayout(&instance->obj);
+					instance->slots[cache->slot] = stackTop[-1];
+					instance->shape = cache->transition;
+					gc_unlockLayout(&instance->obj);
+				}
+				else {
+					instance->slots[cache->slot] = stackTop[-1];
+				}
+				gc_writeBarrier(&instance->obj, stackTop[-1]);
 			}
 			else {
-				tableDelete(&instance->fields, name);
+				PROPERTY_CACHE_MISS();
+				Shape* shape = instance->shape;
+				STORE_STACK_TOP();
+				instanceSet(instance, name, stackTop[-1]);
+
+				//cache the result if still in shape mode
+				if (!INSTANCE_IS_DICTIONARY(instance) && NOT_NIL(stackTop[-1])) {
+					cache->shape = shape;
+					cache->transition = (shape == instance->shape) ? NULL : instance->shape;
+					cache->slot = instance->shape->slotCount - 1;
+
+					if (cache->transition == NULL) {
+						cache->slot = shapeGetSlot(shape, name);
+					}
+				}
 			}
-			Value value = stack_pop();
-			stack_replace(value);
+
+			Value value = POP();
+			REPLACE(value);
 			NEXT_INSTRUCTION;
 		}
 		case OP_GET_INDEX: {
 		label_op_get_index:
-			Value target = vm.stackTop[-1];
+			Value target = stackTop[-1];
 			Value constant = READ_CONSTANT(READ_24bits());
 			double num_index = AS_NUMBER(constant);
 
@@ -1062,16 +1545,23 @@ static InterpretResult run()
 				//get array
 				ObjArray* array = AS_ARRAY(target);
 
+				if (OBJ_IS_TYPE(array, OBJ_ARRAY)) {
+					QUICKEN(3, OP_GET_INDEX_ARRAY);
+				}
+				else if (OBJ_IS_TYPE(array, OBJ_ARRAY_F64)) {
+					QUICKEN(3, OP_GET_INDEX_F64);
+				}
+
 				if (ARRAY_IN_RANGE(array, num_index)) {
 					if (OBJ_IS_TYPE(array, OBJ_ARRAY)) {
-						stack_replace(ARRAY_ELEMENT(array, Value, (uint32_t)num_index));
+						REPLACE(ARRAY_ELEMENT(array, Value, (uint32_t)num_index));
 					}
 					else {
-						stack_replace(getTypedArrayElement(array, (uint32_t)num_index));
+						REPLACE(getTypedArrayElement(array, (uint32_t)num_index));
 					}
 				}
 				else {
-					stack_replace(NIL_VAL);
+					REPLACE(NIL_VAL);
 				}
 				NEXT_INSTRUCTION;
 			}
@@ -1080,10 +1570,10 @@ static InterpretResult run()
 				ObjString* string = AS_STRING(target);
 
 				if (ARRAY_IN_RANGE(string, num_index)) {//return ascii
-					stack_replace(NUMBER_VAL((uint8_t)(string->chars[(uint32_t)num_index])));
+					REPLACE(INT_VAL((uint8_t)(string->chars[(uint32_t)num_index])));
 				}
 				else {
-					stack_replace(NIL_VAL);
+					REPLACE(NIL_VAL);
 				}
 				NEXT_INSTRUCTION;
 			}
@@ -1093,8 +1583,8 @@ static InterpretResult run()
 		}
 		case OP_SET_INDEX: {
 		label_op_set_index:
-			Value target = vm.stackTop[-2];
-			Value value = vm.stackTop[-1];
+			Value target = stackTop[-2];
+			Value value = stackTop[-1];
 
 			Value constant = READ_CONSTANT(READ_24bits());
 			double num_index = AS_NUMBER(constant);
@@ -1103,16 +1593,24 @@ static InterpretResult run()
 				//get array
 				ObjArray* array = AS_ARRAY(target);
 
+				if (OBJ_IS_TYPE(array, OBJ_ARRAY)) {
+					QUICKEN(3, OP_SET_INDEX_ARRAY);
+				}
+				else if (OBJ_IS_TYPE(array, OBJ_ARRAY_F64)) {
+					QUICKEN(3, OP_SET_INDEX_F64);
+				}
+
 				if (ARRAY_IN_RANGE(array, num_index)) {
 					if (OBJ_IS_TYPE(array, OBJ_ARRAY)) {
-						vm.stackTop[-2] = ARRAY_ELEMENT(array, Value, (uint32_t)num_index) = value;
+						stackTop[-2] = ARRAY_ELEMENT(array, Value, (uint32_t)num_index) = value;
+						gc_writeBarrier(&array->obj, value);
 					}
 					else {
 						setTypedArrayElement(array, (uint32_t)num_index, value);
-						vm.stackTop[-2] = value;
+						stackTop[-2] = value;
 					}
 
-					vm.stackTop -= 1;
+					stackTop -= 1;
 					NEXT_INSTRUCTION;
 				}
 				else {
@@ -1126,8 +1624,8 @@ static InterpretResult run()
 		}
 		case OP_GET_SUBSCRIPT: {
 		label_op_get_subscript:
-			Value target = vm.stackTop[-2];
-			Value index = vm.stackTop[-1];
+			Value target = stackTop[-2];
+			Value index = stackTop[-1];
 
 			if (isIndexableArray(target)) {
 				if (IS_NUMBER(index)) {
@@ -1135,17 +1633,24 @@ static InterpretResult run()
 					ObjArray* array = AS_ARRAY(target);
 					double num_index = AS_NUMBER(index);
 
-					vm.stackTop--;//it is number,so pop is allowed
+					if (OBJ_IS_TYPE(array, OBJ_ARRAY)) {
+						QUICKEN(0, OP_GET_SUBSCRIPT_ARRAY);
+					}
+					else if (OBJ_IS_TYPE(array, OBJ_ARRAY_F64)) {
+						QUICKEN(0, OP_GET_SUBSCRIPT_F64);
+					}
+
+					stackTop--;//it is number,so pop is allowed
 					if (ARRAY_IN_RANGE(array, num_index)) {
 						if (OBJ_IS_TYPE(array, OBJ_ARRAY)) {
-							stack_replace(ARRAY_ELEMENT(array, Value, (uint32_t)num_index));
+							REPLACE(ARRAY_ELEMENT(array, Value, (uint32_t)num_index));
 						}
 						else {
-							stack_replace(getTypedArrayElement(array, (uint32_t)num_index));
+							REPLACE(getTypedArrayElement(array, (uint32_t)num_index));
 						}
 					}
 					else {
-						stack_replace(NIL_VAL);
+						REPLACE(NIL_VAL);
 					}
 					NEXT_INSTRUCTION;
 				}
@@ -1160,13 +1665,14 @@ static InterpretResult run()
 					ObjString* name = AS_STRING(index);
 					Value value;
 
-					vm.stackTop--;//it is string,we don't gc string so pop is allowed
-					if (tableGet(&instance->fields, name, &value)) {
-						stack_replace(value);
+					stackTop--;//it is string,we don't gc string so pop is allowed
+					if (instanceGet(instance, name, &value)) {
+						REPLACE(value);
 						NEXT_INSTRUCTION;
 					}
 					//don't throw error
 					if (instance->klass != NULL) {
+						STORE_STACK_TOP();
 						bindMethod(instance->klass, name);
 					}
 					NEXT_INSTRUCTION;
@@ -1182,12 +1688,12 @@ static InterpretResult run()
 					ObjString* string = AS_STRING(target);
 					double num_index = AS_NUMBER(index);
 
-					vm.stackTop--;//it is number,so pop is allowed
+					stackTop--;//it is number,so pop is allowed
 					if (ARRAY_IN_RANGE(string, num_index)) {//return ascii
-						stack_replace(NUMBER_VAL((uint8_t)(string->chars[(uint32_t)num_index])));
+						REPLACE(INT_VAL((uint8_t)(string->chars[(uint32_t)num_index])));
 					}
 					else {
-						stack_replace(NIL_VAL);
+						REPLACE(NIL_VAL);
 					}
 					NEXT_INSTRUCTION;
 				}
@@ -1202,9 +1708,9 @@ static InterpretResult run()
 		}
 		case OP_SET_SUBSCRIPT: {
 		label_op_set_subscript:
-			Value target = vm.stackTop[-3];
-			Value index = vm.stackTop[-2];
-			Value value = vm.stackTop[-1];
+			Value target = stackTop[-3];
+			Value index = stackTop[-2];
+			Value value = stackTop[-1];
 
 			if (isArrayLike(target)) {
 				if (IS_NUMBER(index)) {
@@ -1212,16 +1718,24 @@ static InterpretResult run()
 					ObjArray* array = AS_ARRAY(target);
 					double num_index = AS_NUMBER(index);
 
+					if (OBJ_IS_TYPE(array, OBJ_ARRAY)) {
+						QUICKEN(0, OP_SET_SUBSCRIPT_ARRAY);
+					}
+					else if (OBJ_IS_TYPE(array, OBJ_ARRAY_F64)) {
+						QUICKEN(0, OP_SET_SUBSCRIPT_F64);
+					}
+
 					if (ARRAY_IN_RANGE(array, num_index)) {
 						if (OBJ_IS_TYPE(array, OBJ_ARRAY)) {
-							vm.stackTop[-3] = ARRAY_ELEMENT(array, Value, (uint32_t)num_index) = value;
+							stackTop[-3] = ARRAY_ELEMENT(array, Value, (uint32_t)num_index) = value;
+							gc_writeBarrier(&array->obj, value);
 						}
 						else {
 							setTypedArrayElement(array, (uint32_t)num_index, value);
-							vm.stackTop[-3] = value;
+							stackTop[-3] = value;
 						}
 
-						vm.stackTop -= 2;
+						stackTop -= 2;
 						NEXT_INSTRUCTION;
 					}
 					else {
@@ -1239,15 +1753,11 @@ static InterpretResult run()
 					ObjInstance* instance = AS_INSTANCE(target);
 					ObjString* name = AS_STRING(index);
 
-					if (NOT_NIL(value)) {
-						tableSet(&instance->fields, name, value);
-					}
-					else {
-						tableDelete(&instance->fields, name);
-					}
+					STORE_STACK_TOP();
+					instanceSet(instance, name, value);
 
-					vm.stackTop[-3] = value;
-					vm.stackTop -= 2;
+					stackTop[-3] = value;
+					stackTop -= 2;
 					NEXT_INSTRUCTION;
 				}
 				else {
@@ -1261,178 +1771,163 @@ static InterpretResult run()
 		}
 		case OP_DEFINE_GLOBAL: {
 		label_op_define_global:
-			Value constant = READ_CONSTANT(READ_24bits());
-			ObjString* name = AS_STRING(constant);
-
-			//it's not a new key,no cache
-			tableSet(&vm.globals.fields, name, vm.stackTop[-1]);
-			vm.stackTop--;//can not dec first,because gc will kill it
+			//the slot is given by the compiler
+			uint32_t slot = READ_24bits();
+			vm.globalValues[slot] = POP();
 			NEXT_INSTRUCTION;
 		}
 		case OP_GET_GLOBAL: {
 		label_op_get_global:
-			Value constant = READ_CONSTANT(READ_24bits());
-			ObjString* name = AS_STRING(constant);
-
-			//inline find by cache symbol
-			if ((name->symbol != INVALID_OBJ_STRING_SYMBOL)) {
-				Entry* entry = &vm.globals.fields.entries[name->symbol];
-
-				if (entry->key == name) {
-					// We found the key.
-					stack_push(entry->value);
-					NEXT_INSTRUCTION;
-				}
-			}
-
-			Value value;
-			if (!tableGet(&vm.globals.fields, name, &value)) {
-				runtimeError("Undefined variable '%s'.", name->chars);
+			uint32_t slot = READ_24bits();
+			Value value = vm.globalValues[slot];
+			if (IS_UNDEFINED(value)) {
+				runtimeError("Undefined variable '%s'.", vm.globalNames[slot]->chars);
 				return INTERPRET_RUNTIME_ERROR;
 			}
-			stack_push(value);
+			PUSH(value);
 			NEXT_INSTRUCTION;
 		}
 		case OP_SET_GLOBAL: {
 		label_op_set_global:
-			Value constant = READ_CONSTANT(READ_24bits());
-			ObjString* name = AS_STRING(constant);
-
-			//inline find by cache symbol(if we found it,it's not new key)
-			if ((name->symbol != INVALID_OBJ_STRING_SYMBOL)) {
-				Entry* entry = &vm.globals.fields.entries[name->symbol];
-				if (entry->key == name) {
-					// We found the key.
-					entry->value = vm.stackTop[-1];
-					NEXT_INSTRUCTION;
-				}
-			}
-
-			if (tableSet(&vm.globals.fields, name, vm.stackTop[-1])) {
-				//lox dont allow setting undefined one
-				tableDelete(&vm.globals.fields, name);
-				runtimeError("Undefined variable '%s'.", name->chars);
+			uint32_t slot = READ_24bits();
+			//lox dont allow setting undefined one
+			if (IS_UNDEFINED(vm.globalValues[slot])) {
+				runtimeError("Undefined variable '%s'.", vm.globalNames[slot]->chars);
 				return INTERPRET_RUNTIME_ERROR;
 			}
+			vm.globalValues[slot] = stackTop[-1];
 			NEXT_INSTRUCTION;
 		}
 		case OP_NEW_ARRAY: {
 		label_op_new_array:
 			uint16_t size = READ_SHORT();
+			STORE_STACK_TOP();
 			ObjArray* array = newArray(OBJ_ARRAY);
 			//push to prevent gc
-			stack_push(OBJ_VAL(array));
+			PUSH(OBJ_VAL(array));
+			STORE_STACK_TOP();
 
 			if (size > 0) {
 				reserveArray(array, size);//allocate after push stack
 
 				//init the array
-				memcpy(array->payload, vm.stackTop - size - 1, sizeof(Value) * size);
+				memcpy(array->payload, stackTop - size - 1, sizeof(Value) * size);
 				array->length = size;
 
 				//pop the values and the temp array at top
-				STACK_PEEK(size) = OBJ_VAL(array);
-				vm.stackTop -= size;
+				stackTop[-1 - size] = OBJ_VAL(array);
+				stackTop -= size;
 			}
 			NEXT_INSTRUCTION;
 		}
 		case OP_NEW_OBJECT: {
 		label_op_new_object:
-			stack_push(OBJ_VAL(newInstance(&vm.emptyClass)));
+			STORE_STACK_TOP();
+			PUSH(OBJ_VAL(newInstance(&vm.emptyClass)));
 			NEXT_INSTRUCTION;
 		}
 		case OP_NEW_PROPERTY: {
 		label_op_new_property:
-			ObjInstance* instance = AS_INSTANCE(vm.stackTop[-2]);
+			ObjInstance* instance = AS_INSTANCE(stackTop[-2]);
 			Value constant = READ_CONSTANT(READ_24bits());
 			ObjString* name = AS_STRING(constant);
-			tableSet(&instance->fields, name, vm.stackTop[-1]);
-			stack_pop();
+			STORE_STACK_TOP();
+			instanceDefine(instance, name, stackTop[-1]);
+			DROP();
 			NEXT_INSTRUCTION;
 		}
 		case OP_GET_UPVALUE: {
 		label_op_get_upvalue:
 			uint8_t slot = READ_BYTE();
-			stack_push(*frame->closure->upvalues[slot]->location);
+			PUSH(*CLOSURE_UPVALUES(frame->closure)[slot]->location);
 			NEXT_INSTRUCTION;
 		}
 		case OP_SET_UPVALUE: {
 		label_op_set_upvalue:
-			uint8_t slot = READ_BYTE();
-			*frame->closure->upvalues[slot]->location = vm.stackTop[-1];
+			ObjUpvalue* upvalue = CLOSURE_UPVALUES(frame->closure)[READ_BYTE()];
+			*upvalue->location = stackTop[-1];
+			gc_writeBarrier(&upvalue->obj, stackTop[-1]);
+			NEXT_INSTRUCTION;
+		}
+		case OP_GET_CAPTURE: {
+		label_op_get_capture:
+			PUSH(frame->closure->captures[READ_BYTE()]);
 			NEXT_INSTRUCTION;
 		}
 		case OP_NIL: {
 		label_op_nil:
-			stack_push(NIL_VAL);
+			PUSH(NIL_VAL);
 			NEXT_INSTRUCTION;
 		}
 		case OP_TRUE: {
 		label_op_true:
-			stack_push(BOOL_VAL(true));
+			PUSH(BOOL_VAL(true));
 			NEXT_INSTRUCTION;
 		}
 		case OP_FALSE: {
 		label_op_false:
-			stack_push(BOOL_VAL(false));
+			PUSH(BOOL_VAL(false));
 			NEXT_INSTRUCTION;
 		}
 		case OP_EQUAL: {
 		label_op_equal:
-			vm.stackTop[-2] = BOOL_VAL(valuesEqual(vm.stackTop[-2], vm.stackTop[-1]));
-			vm.stackTop--;
+			stackTop[-2] = BOOL_VAL(valuesEqual(stackTop[-2], stackTop[-1]));
+			stackTop--;
 			NEXT_INSTRUCTION;
 		}
 		case OP_NOT_EQUAL: {
 		label_op_not_equal:
-			vm.stackTop[-2] = BOOL_VAL(!valuesEqual(vm.stackTop[-2], vm.stackTop[-1]));
-			vm.stackTop--;
+			stackTop[-2] = BOOL_VAL(!valuesEqual(stackTop[-2], stackTop[-1]));
+			stackTop--;
 			NEXT_INSTRUCTION;
 		}
 		case OP_GREATER: {
 		label_op_greater:
-			BINARY_OP(BOOL_VAL, > );
+			BINARY_OP(>);
 			NEXT_INSTRUCTION;
 		}
 		case OP_LESS: {
 		label_op_less:
-			BINARY_OP(BOOL_VAL, < );
+			BINARY_OP(<);
 			NEXT_INSTRUCTION;
 		}
 		case OP_GREATER_EQUAL: {
 		label_op_greater_equal:
-			BINARY_OP(BOOL_VAL, >= );
+			BINARY_OP(>=);
 			NEXT_INSTRUCTION;
 		}
 		case OP_LESS_EQUAL: {
 		label_op_less_equal:
-			BINARY_OP(BOOL_VAL, <= );
+			BINARY_OP(<=);
 			NEXT_INSTRUCTION;
 		}
 		case OP_INSTANCE_OF: {
 		label_op_instance_of:
-			bool isInstanceOf = (IS_INSTANCE(vm.stackTop[-2]) && IS_CLASS(vm.stackTop[-1])) && (AS_INSTANCE(vm.stackTop[-2])->klass == AS_CLASS(vm.stackTop[-1]));
-			vm.stackTop[-2] = BOOL_VAL(isInstanceOf);
-			vm.stackTop--;
+			bool isInstanceOf = (IS_INSTANCE(stackTop[-2]) && IS_CLASS(stackTop[-1])) && (AS_INSTANCE(stackTop[-2])->klass == AS_CLASS(stackTop[-1]));
+			stackTop[-2] = BOOL_VAL(isInstanceOf);
+			stackTop--;
 			NEXT_INSTRUCTION;
 		}
 		case OP_TYPE_OF: {
 		label_op_type_of:
+			STORE_STACK_TOP();
 			getTypeof();
 			NEXT_INSTRUCTION;
 		}
 		case OP_ADD: {
 		label_op_add:
 			// might cause gc,so can't decrease first
-			if (IS_NUMBER(vm.stackTop[-2]) && IS_NUMBER(vm.stackTop[-1])) {
-				vm.stackTop[-2] = NUMBER_VAL(AS_NUMBER(vm.stackTop[-2]) + AS_NUMBER(vm.stackTop[-1]));
-				vm.stackTop--;
+			if (IS_BOTH_NUMBER(stackTop[-2], stackTop[-1])) {
+				QUICKEN(0, OP_ADD_NUMBER);
+				stackTop[-2] = number_add(stackTop[-2], stackTop[-1]);
+				stackTop--;
 				NEXT_INSTRUCTION;
 			}
-			else if (IS_STRING(vm.stackTop[-2]) && IS_STRING(vm.stackTop[-1])) {
-				ObjString* result = connectString(AS_STRING(vm.stackTop[-2]), AS_STRING(vm.stackTop[-1]));
-				vm.stackTop[-2] = OBJ_VAL(result);
-				vm.stackTop--;
+			else if (IS_STRING(stackTop[-2]) && IS_STRING(stackTop[-1])) {
+				STORE_STACK_TOP();
+				ObjString* result = connectString(AS_STRING(stackTop[-2]), AS_STRING(stackTop[-1]));
+				stackTop[-2] = OBJ_VAL(result);
+				stackTop--;
 				NEXT_INSTRUCTION;
 			}
 
@@ -1441,26 +1936,26 @@ static InterpretResult run()
 		}
 		case OP_SUBTRACT: {
 		label_op_subtract:
-			BINARY_OP(NUMBER_VAL, -);
+			ARITHMETIC_OP(number_subtract);
 			NEXT_INSTRUCTION;
 		}
 		case OP_MULTIPLY: {
 		label_op_multiply:
-			BINARY_OP(NUMBER_VAL, *);
+			ARITHMETIC_OP(number_multiply);
 			NEXT_INSTRUCTION;
 		}
 		case OP_DIVIDE: {
 		label_op_divide:
-			BINARY_OP(NUMBER_VAL, / );
+			ARITHMETIC_OP(number_divide);
 			NEXT_INSTRUCTION;
 		}
 		case OP_MODULUS: {
 		label_op_modulus:
 			/* Pop the top two values from the stack */
-			if (IS_NUMBER(vm.stackTop[-2]) && IS_NUMBER(vm.stackTop[-1])) {
+			if (IS_BOTH_NUMBER(stackTop[-2], stackTop[-1])) {
 				/* Perform the operation and push the result back */
-				vm.stackTop[-2] = NUMBER_VAL(fmod(AS_NUMBER(vm.stackTop[-2]), AS_NUMBER(vm.stackTop[-1])));
-				vm.stackTop--;
+				stackTop[-2] = number_modulus(stackTop[-2], stackTop[-1]);
+				stackTop--;
 				NEXT_INSTRUCTION;
 			}
 			else {
@@ -1471,14 +1966,14 @@ static InterpretResult run()
 
 		case OP_NOT: {
 		label_op_not:
-			vm.stackTop[-1] = BOOL_VAL(isFalsey(vm.stackTop[-1]));
+			stackTop[-1] = BOOL_VAL(isFalsey(stackTop[-1]));
 			NEXT_INSTRUCTION;
 		}
 
 		case OP_NEGATE: {
 		label_op_negate:
-			if (IS_NUMBER(vm.stackTop[-1])) {
-				vm.stackTop[-1] = NUMBER_VAL(-AS_NUMBER(vm.stackTop[-1]));
+			if (IS_NUMBER(stackTop[-1])) {
+				stackTop[-1] = number_negate(stackTop[-1]);
 				NEXT_INSTRUCTION;
 			}
 			else {
@@ -1490,7 +1985,9 @@ static InterpretResult run()
 		case OP_BITWISE: {
 		label_op_bitwise:
 			uint8_t bitOpType = READ_BYTE();
+			STORE_STACK_TOP();
 			if (bitInstruction(bitOpType)) {
+				LOAD_STACK_TOP();
 				NEXT_INSTRUCTION;
 			}
 			else {
@@ -1504,14 +2001,14 @@ static InterpretResult run()
 #if DEBUG_MODE
 			printf("[print] ");
 #endif
-			printValue(stack_pop());
+			printValue(POP());
 			printf("\n");
 			NEXT_INSTRUCTION;
 		}
 		case OP_THROW: {
 		label_op_throw:
 			//if solved break else error
-			if (throwError(stack_pop(), "An exception was thrown.")) {
+			if (throwError(POP(), "An exception was thrown.")) {
 				NEXT_INSTRUCTION;
 			}
 			return INTERPRET_RUNTIME_ERROR;
@@ -1519,30 +2016,43 @@ static InterpretResult run()
 		case OP_GET_LOCAL: {
 		label_op_get_local:
 			uint32_t index = READ_SHORT();
-			stack_push(frame->slots[index]);
+			PUSH(frame->slots[index]);
 			NEXT_INSTRUCTION;
 		}
 		case OP_SET_LOCAL: {
 		label_op_set_local:
 			uint32_t index = READ_SHORT();
-			frame->slots[index] = vm.stackTop[-1];
+			frame->slots[index] = stackTop[-1];
 			NEXT_INSTRUCTION;
 		}
 		case OP_CLOSE_UPVALUE: {
 		label_op_close_upvalue:
-			closeUpvalues(vm.stackTop - 1);
-			stack_pop();
+			closeUpvalues(stackTop - 1);
+			DROP();
 			NEXT_INSTRUCTION;
 		}
 		case OP_POP: {
 		label_op_pop:
-			stack_pop();
+			DROP();
 			NEXT_INSTRUCTION;
 		}
 		case OP_POP_N: {
 		label_op_pop_n:
 			uint32_t index = READ_SHORT();
-			vm.stackTop -= index;
+			stackTop -= index;
+			NEXT_INSTRUCTION;
+		}
+		case OP_DUP: {
+		label_op_dup:
+			Value top = stackTop[-1];
+			PUSH(top);
+			NEXT_INSTRUCTION;
+		}
+		case OP_DUP2: {
+		label_op_dup2:
+			stackTop[0] = stackTop[-2];
+			stackTop[1] = stackTop[-1];
+			stackTop += 2;
 			NEXT_INSTRUCTION;
 		}
 		case OP_JUMP: {
@@ -1555,38 +2065,98 @@ static InterpretResult run()
 		label_op_loop:
 			uint16_t offset = READ_SHORT();
 			ip -= offset;
+			TRACE_ENTER(offset);
+			JIT_ENTER(true);
 			NEXT_INSTRUCTION;
 		}
 		case OP_JUMP_IF_FALSE: {
 		label_op_jump_if_false:
 			uint16_t offset = READ_SHORT();
-			if (isFalsey(vm.stackTop[-1])) ip += offset;
+			if (isFalsey(stackTop[-1])) ip += offset;
 			NEXT_INSTRUCTION;
 		}
 		case OP_JUMP_IF_FALSE_POP: {
 		label_op_jump_if_false_pop:
 			uint16_t offset = READ_SHORT();
-			if (isFalsey(vm.stackTop[-1])) ip += offset;
-			vm.stackTop--;
+			if (isFalsey(stackTop[-1])) ip += offset;
+			stackTop--;
 			NEXT_INSTRUCTION;
 		}
 		case OP_JUMP_IF_TRUE: {
 		label_op_jump_if_true:
 			uint16_t offset = READ_SHORT();
-			if (isTruthy(vm.stackTop[-1])) ip += offset;
+			if (isTruthy(stackTop[-1])) ip += offset;
 			NEXT_INSTRUCTION;
 		}
 		case OP_CALL: {
 		label_op_call:
 			uint8_t argCount = READ_BYTE();
+			Value callee = stackTop[-1 - argCount];
+
+			if (IS_NATIVE(callee) && AS_NATIVE_OBJ(callee)->fastArity == argCount) {
+				QUICKEN(1, OP_CALL_NATIVE_NUMBER);
+			}
+
 			frame->ip = ip;//change before call
+			STORE_STACK_TOP();
 
-			if (!callValue(STACK_PEEK(argCount), argCount)) {
+			if (!callValue(stackTop[-1 - argCount], argCount)) {
 				return INTERPRET_RUNTIME_ERROR;
 			}
 			//we entered the function
 			frame = &vm.frames[vm.frameCount - 1];
 			ip = frame->ip;//restore after call
+			LOAD_STACK_TOP();
+			JIT_ENTER(true);
+			NEXT_INSTRUCTION;
+		}
+		case OP_TAIL_CALL: {
+		label_op_tail_call:
+			uint8_t argCount = READ_BYTE();
+			Value callee = stackTop[-1 - argCount];
+
+			//only closure can reuse the frame,others are called as usual
+			if (!IS_CLOSURE(callee)) {
+				frame->ip = ip;
+				STORE_STACK_TOP();
+
+				if (!callValue(callee, argCount)) {
+					return INTERPRET_RUNTIME_ERROR;
+				}
+				frame = &vm.frames[vm.frameCount - 1];
+				ip = frame->ip;
+				LOAD_STACK_TOP();
+				JIT_ENTER(true);
+				NEXT_INSTRUCTION;
+			}
+
+			ObjClosure* closure = AS_CLOSURE(callee);
+			if (argCount > closure->function->arity) {
+				runtimeError("Expected %d arguments but got %d.",
+					closure->function->arity, argCount);
+				return INTERPRET_RUNTIME_ERROR;
+			}
+
+			//same as call(),the callee may be deeper than the caller
+			if (stackTop - argCount - 1 + closure->function->maxStack > vm.stackBoundary) {
+				STORE_STACK_TOP();
+				runtimeError("Stack overflow.");
+				return INTERPRET_RUNTIME_ERROR;
+			}
+
+			while (argCount < closure->function->arity) {
+				PUSH(NIL_VAL);
+				++argCount;
+			}
+
+			//the caller is done,move callee and arguments to its base
+			if (frame->closure->function->closesUpvalues) closeUpvalues(frame->slots);
+			memmove(frame->slots, stackTop - argCount - 1, sizeof(Value) * (argCount + 1));
+			stackTop = frame->slots + argCount + 1;
+
+			frame->closure = closure;
+			ip = closure->function->chunk.code;
+			JIT_ENTER(true);
 			NEXT_INSTRUCTION;
 		}
 		case OP_INVOKE: {
@@ -1594,14 +2164,18 @@ static InterpretResult run()
 			Value constant = READ_CONSTANT(READ_24bits());
 			ObjString* method = AS_STRING(constant);
 			uint8_t argCount = READ_BYTE();
+			InvokeCache* cache = &frame->closure->function->invokeCaches[READ_SHORT()];
 
 			frame->ip = ip;//change before call
-			if (!invoke(method, argCount)) {
+			STORE_STACK_TOP();
+			if (!invoke(method, argCount, cache)) {
 				return INTERPRET_RUNTIME_ERROR;
 			}
 			//we entered the function
 			frame = &vm.frames[vm.frameCount - 1];
 			ip = frame->ip;//restore after call
+			LOAD_STACK_TOP();
+			JIT_ENTER(true);
 			NEXT_INSTRUCTION;
 		}
 		case OP_SUPER_INVOKE: {
@@ -1609,45 +2183,53 @@ static InterpretResult run()
 			Value constant = READ_CONSTANT(READ_24bits());
 			ObjString* method = AS_STRING(constant);
 			uint8_t argCount = READ_BYTE();
+			InvokeCache* cache = &frame->closure->function->invokeCaches[READ_SHORT()];
 
-			ObjClass* superclass = AS_CLASS(stack_pop());
+			ObjClass* superclass = AS_CLASS(POP());
+			//fields are skipped by super, any shape is fine
+			ObjClosure* closure = invokeCacheLookup(cache, superclass, &vm.dictionaryShape);
 			frame->ip = ip;//change before call
-			if (!invokeFromClass(superclass, method, argCount)) {
+			STORE_STACK_TOP();
+			if ((closure != NULL) ? !call(closure, argCount) : !invokeFromClass(superclass, method, argCount, cache, &vm.dictionaryShape)) {
 				return INTERPRET_RUNTIME_ERROR;
 			}
 			frame = &vm.frames[vm.frameCount - 1];
 			ip = frame->ip;//restore after call
+			LOAD_STACK_TOP();
+			JIT_ENTER(true);
 			NEXT_INSTRUCTION;
 		}
 		case OP_RETURN: {
 		label_op_return:
-			Value result = stack_pop();
-			//close all remaining upValues of function
-			closeUpvalues(frame->slots);
+			Value result = POP();
+			//close all remaining upValues of function,none if no local is captured boxed
+			if (frame->closure->function->closesUpvalues) closeUpvalues(frame->slots);
 			if (--vm.frameCount == 0) {
-				stack_pop();
+				DROP();
+				STORE_STACK_TOP();
 				return INTERPRET_OK;
 			}
 
-			//vm.stackTop = frame->slots;
-			//stack_push(result);
+			//stackTop = frame->slots;
+			//PUSH(result);
 
 			*frame->slots = result;
-			vm.stackTop = frame->slots + 1;
+			stackTop = frame->slots + 1;
 
 			frame = &vm.frames[vm.frameCount - 1];
 			ip = frame->ip;
+			JIT_ENTER(false);
 			NEXT_INSTRUCTION;
 		}
 		case OP_MODULE_BUILTIN: {
 		label_op_module_builtin:
 			uint8_t moduleIndex = READ_BYTE();
-			stack_push(OBJ_VAL(&vm.builtins[moduleIndex]));
+			PUSH(OBJ_VAL(&vm.builtins[moduleIndex]));
 			NEXT_INSTRUCTION;
 		}
 		case OP_IMPORT: {
 		label_op_import:
-			Value target = vm.stackTop[-1];
+			Value target = stackTop[-1];
 			C_STR path = NULL;
 
 			if (IS_STRING(target)) {
@@ -1663,6 +2245,7 @@ static InterpretResult run()
 				return INTERPRET_RUNTIME_ERROR;
 			}
 
+			STORE_STACK_TOP();
 			STR absolutePath = getAbsolutePath(path);
 
 			if (absolutePath == NULL) {
@@ -1676,7 +2259,7 @@ static InterpretResult run()
 
 			//same as interpret()
 			ObjClosure* closure = newClosure(function);
-			stack_replace(OBJ_VAL(closure));
+			REPLACE(OBJ_VAL(closure));
 
 			//call the module
 			frame->ip = ip;//change before call
@@ -1686,19 +2269,21 @@ static InterpretResult run()
 			//we entered the function
 			frame = &vm.frames[vm.frameCount - 1];
 			ip = frame->ip;//restore after call
+			LOAD_STACK_TOP();
 			NEXT_INSTRUCTION;
 		}
 		case OP_ADD_CONST: {
 		label_op_add_const:
 			Value constant = READ_CONSTANT(READ_24bits());
 			// might cause gc,so can't decrease first
-			if (IS_NUMBER(vm.stackTop[-1]) && IS_NUMBER(constant)) {
-				vm.stackTop[-1] = NUMBER_VAL(AS_NUMBER(vm.stackTop[-1]) + AS_NUMBER(constant));
+			if (IS_BOTH_NUMBER(stackTop[-1], constant)) {
+				stackTop[-1] = number_add(stackTop[-1], constant);
 				NEXT_INSTRUCTION;
 			}
-			else if (IS_STRING(vm.stackTop[-1]) && IS_STRING(constant)) {
-				ObjString* result = connectString(AS_STRING(vm.stackTop[-1]), AS_STRING(constant));
-				vm.stackTop[-1] = OBJ_VAL(result);
+			else if (IS_STRING(stackTop[-1]) && IS_STRING(constant)) {
+				STORE_STACK_TOP();
+				ObjString* result = connectString(AS_STRING(stackTop[-1]), AS_STRING(constant));
+				stackTop[-1] = OBJ_VAL(result);
 				NEXT_INSTRUCTION;
 			}
 
@@ -1708,28 +2293,28 @@ static InterpretResult run()
 		case OP_SUBTRACT_CONST: {
 		label_op_subtract_const:
 			Value constant = READ_CONSTANT(READ_24bits());
-			BINARY_OP_WITH_RIGHT(NUMBER_VAL, constant, -);
+			ARITHMETIC_OP_WITH_RIGHT(constant, number_subtract);
 			NEXT_INSTRUCTION;
 		}
 		case OP_MULTIPLY_CONST: {
 		label_op_multiply_const:
 			Value constant = READ_CONSTANT(READ_24bits());
-			BINARY_OP_WITH_RIGHT(NUMBER_VAL, constant, *);
+			ARITHMETIC_OP_WITH_RIGHT(constant, number_multiply);
 			NEXT_INSTRUCTION;
 		}
 		case OP_DIVIDE_CONST: {
 		label_op_divide_const:
 			Value constant = READ_CONSTANT(READ_24bits());
-			BINARY_OP_WITH_RIGHT(NUMBER_VAL, constant, / );
+			ARITHMETIC_OP_WITH_RIGHT(constant, number_divide);
 			NEXT_INSTRUCTION;
 		}
 		case OP_MODULUS_CONST: {
 		label_op_modulus_const:
 			Value constant = READ_CONSTANT(READ_24bits());
 			/* Pop the top two values from the stack */
-			if (IS_NUMBER(vm.stackTop[-1]) && IS_NUMBER(constant)) {
+			if (IS_BOTH_NUMBER(stackTop[-1], constant)) {
 				/* Perform the operation and push the result back */
-				vm.stackTop[-1] = NUMBER_VAL(fmod(AS_NUMBER(vm.stackTop[-1]), AS_NUMBER(constant)));
+				stackTop[-1] = number_modulus(stackTop[-1], constant);
 				NEXT_INSTRUCTION;
 			}
 			else {
@@ -1740,37 +2325,37 @@ static InterpretResult run()
 		case OP_EQUAL_CONST: {
 		label_op_equal_const:
 			Value constant = READ_CONSTANT(READ_24bits());
-			vm.stackTop[-1] = BOOL_VAL(valuesEqual(vm.stackTop[-1], constant));
+			stackTop[-1] = BOOL_VAL(valuesEqual(stackTop[-1], constant));
 			NEXT_INSTRUCTION;
 		}
 		case OP_NOT_EQUAL_CONST: {
 		label_op_not_equal_const:
 			Value constant = READ_CONSTANT(READ_24bits());
-			vm.stackTop[-1] = BOOL_VAL(!valuesEqual(vm.stackTop[-1], constant));
+			stackTop[-1] = BOOL_VAL(!valuesEqual(stackTop[-1], constant));
 			NEXT_INSTRUCTION;
 		}
 		case OP_GREATER_CONST: {
 		label_op_greater_const:
 			Value constant = READ_CONSTANT(READ_24bits());
-			BINARY_OP_WITH_RIGHT(BOOL_VAL, constant, > );
+			BINARY_OP_WITH_RIGHT(constant, >);
 			NEXT_INSTRUCTION;
 		}
 		case OP_LESS_CONST: {
 		label_op_less_const:
 			Value constant = READ_CONSTANT(READ_24bits());
-			BINARY_OP_WITH_RIGHT(BOOL_VAL, constant, < );
+			BINARY_OP_WITH_RIGHT(constant, <);
 			NEXT_INSTRUCTION;
 		}
 		case OP_GREATER_EQUAL_CONST: {
 		label_op_greater_equal_const:
 			Value constant = READ_CONSTANT(READ_24bits());
-			BINARY_OP_WITH_RIGHT(BOOL_VAL, constant, >= );
+			BINARY_OP_WITH_RIGHT(constant, >=);
 			NEXT_INSTRUCTION;
 		}
 		case OP_LESS_EQUAL_CONST: {
 		label_op_less_equal_const:
 			Value constant = READ_CONSTANT(READ_24bits());
-			BINARY_OP_WITH_RIGHT(BOOL_VAL, constant, <= );
+			BINARY_OP_WITH_RIGHT(constant, <=);
 			NEXT_INSTRUCTION;
 		}
 
@@ -1780,13 +2365,14 @@ static InterpretResult run()
 			Value local = frame->slots[index];
 
 			// might cause gc,so can't decrease first
-			if (IS_NUMBER(vm.stackTop[-1]) && IS_NUMBER(local)) {
-				vm.stackTop[-1] = NUMBER_VAL(AS_NUMBER(vm.stackTop[-1]) + AS_NUMBER(local));
+			if (IS_BOTH_NUMBER(stackTop[-1], local)) {
+				stackTop[-1] = number_add(stackTop[-1], local);
 				NEXT_INSTRUCTION;
 			}
-			else if (IS_STRING(vm.stackTop[-1]) && IS_STRING(local)) {
-				ObjString* result = connectString(AS_STRING(vm.stackTop[-1]), AS_STRING(local));
-				vm.stackTop[-1] = OBJ_VAL(result);
+			else if (IS_STRING(stackTop[-1]) && IS_STRING(local)) {
+				STORE_STACK_TOP();
+				ObjString* result = connectString(AS_STRING(stackTop[-1]), AS_STRING(local));
+				stackTop[-1] = OBJ_VAL(result);
 				NEXT_INSTRUCTION;
 			}
 
@@ -1798,7 +2384,7 @@ static InterpretResult run()
 			uint32_t index = READ_SHORT();
 			Value local = frame->slots[index];
 
-			BINARY_OP_WITH_RIGHT(NUMBER_VAL, local, -);
+			ARITHMETIC_OP_WITH_RIGHT(local, number_subtract);
 			NEXT_INSTRUCTION;
 		}
 		case OP_MULTIPLY_LOCAL: {
@@ -1806,7 +2392,7 @@ static InterpretResult run()
 			uint32_t index = READ_SHORT();
 			Value local = frame->slots[index];
 
-			BINARY_OP_WITH_RIGHT(NUMBER_VAL, local, *);
+			ARITHMETIC_OP_WITH_RIGHT(local, number_multiply);
 			NEXT_INSTRUCTION;
 		}
 		case OP_DIVIDE_LOCAL: {
@@ -1814,7 +2400,7 @@ static InterpretResult run()
 			uint32_t index = READ_SHORT();
 			Value local = frame->slots[index];
 
-			BINARY_OP_WITH_RIGHT(NUMBER_VAL, local, / );
+			ARITHMETIC_OP_WITH_RIGHT(local, number_divide);
 			NEXT_INSTRUCTION;
 		}
 		case OP_MODULUS_LOCAL: {
@@ -1823,9 +2409,9 @@ static InterpretResult run()
 			Value local = frame->slots[index];
 
 			/* Pop the top two values from the stack */
-			if (IS_NUMBER(vm.stackTop[-1]) && IS_NUMBER(local)) {
+			if (IS_BOTH_NUMBER(stackTop[-1], local)) {
 				/* Perform the operation and push the result back */
-				vm.stackTop[-1] = NUMBER_VAL(fmod(AS_NUMBER(vm.stackTop[-1]), AS_NUMBER(local)));
+				stackTop[-1] = number_modulus(stackTop[-1], local);
 				NEXT_INSTRUCTION;
 			}
 			else {
@@ -1837,42 +2423,42 @@ static InterpretResult run()
 		label_op_equal_local:
 			uint32_t index = READ_SHORT();
 			Value local = frame->slots[index];
-			vm.stackTop[-1] = BOOL_VAL(valuesEqual(vm.stackTop[-1], local));
+			stackTop[-1] = BOOL_VAL(valuesEqual(stackTop[-1], local));
 			NEXT_INSTRUCTION;
 		}
 		case OP_NOT_EQUAL_LOCAL: {
 		label_op_not_equal_local:
 			uint32_t index = READ_SHORT();
 			Value local = frame->slots[index];
-			vm.stackTop[-1] = BOOL_VAL(!valuesEqual(vm.stackTop[-1], local));
+			stackTop[-1] = BOOL_VAL(!valuesEqual(stackTop[-1], local));
 			NEXT_INSTRUCTION;
 		}
 		case OP_GREATER_LOCAL: {
 		label_op_greater_local:
 			uint32_t index = READ_SHORT();
 			Value local = frame->slots[index];
-			BINARY_OP_WITH_RIGHT(BOOL_VAL, local, > );
+			BINARY_OP_WITH_RIGHT(local, >);
 			NEXT_INSTRUCTION;
 		}
 		case OP_LESS_LOCAL: {
 		label_op_less_local:
 			uint32_t index = READ_SHORT();
 			Value local = frame->slots[index];
-			BINARY_OP_WITH_RIGHT(BOOL_VAL, local, < );
+			BINARY_OP_WITH_RIGHT(local, <);
 			NEXT_INSTRUCTION;
 		}
 		case OP_GREATER_EQUAL_LOCAL: {
 		label_op_greater_equal_local:
 			uint32_t index = READ_SHORT();
 			Value local = frame->slots[index];
-			BINARY_OP_WITH_RIGHT(BOOL_VAL, local, >= );
+			BINARY_OP_WITH_RIGHT(local, >=);
 			NEXT_INSTRUCTION;
 		}
 		case OP_LESS_EQUAL_LOCAL: {
 		label_op_less_equal_local:
 			uint32_t index = READ_SHORT();
 			Value local = frame->slots[index];
-			BINARY_OP_WITH_RIGHT(BOOL_VAL, local, <= );
+			BINARY_OP_WITH_RIGHT(local, <=);
 			NEXT_INSTRUCTION;
 		}
 
@@ -1881,7 +2467,7 @@ static InterpretResult run()
 			uint32_t index = READ_SHORT();
 			Value local = frame->slots[index];
 
-			stack_push(BOOL_VAL(isFalsey(local)));
+			PUSH(BOOL_VAL(isFalsey(local)));
 			NEXT_INSTRUCTION;
 		}
 		case OP_NEGATE_LOCAL: {
@@ -1890,14 +2476,533 @@ static InterpretResult run()
 			Value local = frame->slots[index];
 
 			if (IS_NUMBER(local)) {
-				stack_push(NUMBER_VAL(-AS_NUMBER(local)));
-				break;
+				PUSH(number_negate(local));
+				NEXT_INSTRUCTION;
 			}
 			else {
 				runtimeError("Operand must be a number.");
 				return INTERPRET_RUNTIME_ERROR;
 			}
 		}
+		case OP_JUMP_IF_FALSE_EQUAL_LC: {
+		label_op_jump_if_false_equal_lc:
+			Value left = frame->slots[READ_SHORT()];
+			Value right = READ_CONSTANT(READ_24bits());
+			EQUAL_JUMP(left, right, true);
+			NEXT_INSTRUCTION;
+		}
+		case OP_JUMP_IF_FALSE_NOT_EQUAL_LC: {
+		label_op_jump_if_false_not_equal_lc:
+			Value left = frame->slots[READ_SHORT()];
+			Value right = READ_CONSTANT(READ_24bits());
+			EQUAL_JUMP(left, right, false);
+			NEXT_INSTRUCTION;
+		}
+		case OP_JUMP_IF_FALSE_GREATER_LC: {
+		label_op_jump_if_false_greater_lc:
+			Value left = frame->slots[READ_SHORT()];
+			Value right = READ_CONSTANT(READ_24bits());
+			COMPARE_JUMP(left, right, >);
+			NEXT_INSTRUCTION;
+		}
+		case OP_JUMP_IF_FALSE_LESS_LC: {
+		label_op_jump_if_false_less_lc:
+			Value left = frame->slots[READ_SHORT()];
+			Value right = READ_CONSTANT(READ_24bits());
+			COMPARE_JUMP(left, right, <);
+			NEXT_INSTRUCTION;
+		}
+		case OP_JUMP_IF_FALSE_GREATER_EQUAL_LC: {
+		label_op_jump_if_false_greater_equal_lc:
+			Value left = frame->slots[READ_SHORT()];
+			Value right = READ_CONSTANT(READ_24bits());
+			COMPARE_JUMP(left, right, >=);
+			NEXT_INSTRUCTION;
+		}
+		case OP_JUMP_IF_FALSE_LESS_EQUAL_LC: {
+		label_op_jump_if_false_less_equal_lc:
+			Value left = frame->slots[READ_SHORT()];
+			Value right = READ_CONSTANT(READ_24bits());
+			COMPARE_JUMP(left, right, <=);
+			NEXT_INSTRUCTION;
+		}
+		case OP_JUMP_IF_FALSE_EQUAL_LL: {
+		label_op_jump_if_false_equal_ll:
+			Value left = frame->slots[READ_SHORT()];
+			Value right = frame->slots[READ_SHORT()];
+			EQUAL_JUMP(left, right, true);
+			NEXT_INSTRUCTION;
+		}
+		case OP_JUMP_IF_FALSE_NOT_EQUAL_LL: {
+		label_op_jump_if_false_not_equal_ll:
+			Value left = frame->slots[READ_SHORT()];
+			Value right = frame->slots[READ_SHORT()];
+			EQUAL_JUMP(left, right, false);
+			NEXT_INSTRUCTION;
+		}
+		case OP_JUMP_IF_FALSE_GREATER_LL: {
+		label_op_jump_if_false_greater_ll:
+			Value left = frame->slots[READ_SHORT()];
+			Value right = frame->slots[READ_SHORT()];
+			COMPARE_JUMP(left, right, >);
+			NEXT_INSTRUCTION;
+		}
+		case OP_JUMP_IF_FALSE_LESS_LL: {
+		label_op_jump_if_false_less_ll:
+			Value left = frame->slots[READ_SHORT()];
+			Value right = frame->slots[READ_SHORT()];
+			COMPARE_JUMP(left, right, <);
+			NEXT_INSTRUCTION;
+		}
+		case OP_JUMP_IF_FALSE_GREATER_EQUAL_LL: {
+		label_op_jump_if_false_greater_equal_ll:
+			Value left = frame->slots[READ_SHORT()];
+			Value right = frame->slots[READ_SHORT()];
+			COMPARE_JUMP(left, right, >=);
+			NEXT_INSTRUCTION;
+		}
+		case OP_JUMP_IF_FALSE_LESS_EQUAL_LL: {
+		label_op_jump_if_false_less_equal_ll:
+			Value left = frame->slots[READ_SHORT()];
+			Value right = frame->slots[READ_SHORT()];
+			COMPARE_JUMP(left, right, <=);
+			NEXT_INSTRUCTION;
+		}
+		case OP_INPLACE_ADD_LC: {
+		label_op_inplace_add_lc:
+			Value* target = &frame->slots[READ_SHORT()];
+			Value right = READ_CONSTANT(READ_24bits());
+			INPLACE_ADD(target, right);
+			NEXT_INSTRUCTION;
+		}
+		case OP_INPLACE_SUBTRACT_LC: {
+		label_op_inplace_subtract_lc:
+			Value* target = &frame->slots[READ_SHORT()];
+			Value right = READ_CONSTANT(READ_24bits());
+			INPLACE_OP(target, right, number_subtract);
+			NEXT_INSTRUCTION;
+		}
+		case OP_INPLACE_MULTIPLY_LC: {
+		label_op_inplace_multiply_lc:
+			Value* target = &frame->slots[READ_SHORT()];
+			Value right = READ_CONSTANT(READ_24bits());
+			INPLACE_OP(target, right, number_multiply);
+			NEXT_INSTRUCTION;
+		}
+		case OP_INPLACE_DIVIDE_LC: {
+		label_op_inplace_divide_lc:
+			Value* target = &frame->slots[READ_SHORT()];
+			Value right = READ_CONSTANT(READ_24bits());
+			INPLACE_OP(target, right, number_divide);
+			NEXT_INSTRUCTION;
+		}
+		case OP_INPLACE_ADD_LL: {
+		label_op_inplace_add_ll:
+			Value* target = &frame->slots[READ_SHORT()];
+			Value right = frame->slots[READ_SHORT()];
+			INPLACE_ADD(target, right);
+			NEXT_INSTRUCTION;
+		}
+		case OP_INPLACE_SUBTRACT_LL: {
+		label_op_inplace_subtract_ll:
+			Value* target = &frame->slots[READ_SHORT()];
+			Value right = frame->slots[READ_SHORT()];
+			INPLACE_OP(target, right, number_subtract);
+			NEXT_INSTRUCTION;
+		}
+		case OP_INPLACE_MULTIPLY_LL: {
+		label_op_inplace_multiply_ll:
+			Value* target = &frame->slots[READ_SHORT()];
+			Value right = frame->slots[READ_SHORT()];
+			INPLACE_OP(target, right, number_multiply);
+			NEXT_INSTRUCTION;
+		}
+		case OP_INPLACE_DIVIDE_LL: {
+		label_op_inplace_divide_ll:
+			Value* target = &frame->slots[READ_SHORT()];
+			Value right = frame->slots[READ_SHORT()];
+			INPLACE_OP(target, right, number_divide);
+			NEXT_INSTRUCTION;
+		}
+		case OP_INPLACE_ADD_UC: {
+		label_op_inplace_add_uc:
+			Value* target = CLOSURE_UPVALUES(frame->closure)[READ_BYTE()]->location;
+			Value right = READ_CONSTANT(READ_24bits());
+			INPLACE_ADD(target, right);
+			NEXT_INSTRUCTION;
+		}
+		case OP_INPLACE_SUBTRACT_UC: {
+		label_op_inplace_subtract_uc:
+			Value* target = CLOSURE_UPVALUES(frame->closure)[READ_BYTE()]->location;
+			Value right = READ_CONSTANT(READ_24bits());
+			INPLACE_OP(target, right, number_subtract);
+			NEXT_INSTRUCTION;
+		}
+		case OP_INPLACE_MULTIPLY_UC: {
+		label_op_inplace_multiply_uc:
+			Value* target = CLOSURE_UPVALUES(frame->closure)[READ_BYTE()]->location;
+			Value right = READ_CONSTANT(READ_24bits());
+			INPLACE_OP(target, right, number_multiply);
+			NEXT_INSTRUCTION;
+		}
+		case OP_INPLACE_DIVIDE_UC: {
+		label_op_inplace_divide_uc:
+			Value* target = CLOSURE_UPVALUES(frame->closure)[READ_BYTE()]->location;
+			Value right = READ_CONSTANT(READ_24bits());
+			INPLACE_OP(target, right, number_divide);
+			NEXT_INSTRUCTION;
+		}
+		case OP_INPLACE_ADD_GC: {
+		label_op_inplace_add_gc:
+			uint32_t slot = READ_24bits();
+			Value* target = getGlobalRef(slot);
+			if (target == NULL) {
+				runtimeError("Undefined variable '%s'.", vm.globalNames[slot]->chars);
+				return INTERPRET_RUNTIME_ERROR;
+			}
+			Value right = READ_CONSTANT(READ_24bits());
+			INPLACE_ADD(target, right);
+			NEXT_INSTRUCTION;
+		}
+		case OP_INPLACE_SUBTRACT_GC: {
+		label_op_inplace_subtract_gc:
+			uint32_t slot = READ_24bits();
+			Value* target = getGlobalRef(slot);
+			if (target == NULL) {
+				runtimeError("Undefined variable '%s'.", vm.globalNames[slot]->chars);
+				return INTERPRET_RUNTIME_ERROR;
+			}
+			Value right = READ_CONSTANT(READ_24bits());
+			INPLACE_OP(target, right, number_subtract);
+			NEXT_INSTRUCTION;
+		}
+		case OP_INPLACE_MULTIPLY_GC: {
+		label_op_inplace_multiply_gc:
+			uint32_t slot = READ_24bits();
+			Value* target = getGlobalRef(slot);
+			if (target == NULL) {
+				runtimeError("Undefined variable '%s'.", vm.globalNames[slot]->chars);
+				return INTERPRET_RUNTIME_ERROR;
+			}
+			Value right = READ_CONSTANT(READ_24bits());
+			INPLACE_OP(target, right, number_multiply);
+			NEXT_INSTRUCTION;
+		}
+		case OP_INPLACE_DIVIDE_GC: {
+		label_op_inplace_divide_gc:
+			uint32_t slot = READ_24bits();
+			Value* target = getGlobalRef(slot);
+			if (target == NULL) {
+				runtimeError("Undefined variable '%s'.", vm.globalNames[slot]->chars);
+				return INTERPRET_RUNTIME_ERROR;
+			}
+			Value right = READ_CONSTANT(READ_24bits());
+			INPLACE_OP(target, right, number_divide);
+			NEXT_INSTRUCTION;
+		}
+		case OP_REG_MOVE: {
+		label_op_reg_move:
+			uint32_t dst = READ_SHORT();
+			frame->slots[dst] = frame->slots[READ_SHORT()];
+			NEXT_INSTRUCTION;
+		}
+		case OP_REG_LOAD_CONST: {
+		label_op_reg_load_const:
+			uint32_t dst = READ_SHORT();
+			frame->slots[dst] = READ_CONSTANT(READ_24bits());
+			NEXT_INSTRUCTION;
+		}
+		case OP_REG_NEGATE: {
+		label_op_reg_negate:
+			uint32_t dst = READ_SHORT();
+			Value value = frame->slots[READ_SHORT()];
+			if (!IS_NUMBER(value)) {
+				runtimeError("Operand must be a number.");
+				return INTERPRET_RUNTIME_ERROR;
+			}
+			frame->slots[dst] = number_negate(value);
+			NEXT_INSTRUCTION;
+		}
+		case OP_REG_ADD_LL: {
+		label_op_reg_add_ll:
+			uint32_t dst = READ_SHORT();
+			Value left = frame->slots[READ_SHORT()];
+			Value right = frame->slots[READ_SHORT()];
+			REGISTER_ADD(dst, left, right);
+			NEXT_INSTRUCTION;
+		}
+		case OP_REG_SUBTRACT_LL: {
+		label_op_reg_subtract_ll:
+			uint32_t dst = READ_SHORT();
+			Value left = frame->slots[READ_SHORT()];
+			Value right = frame->slots[READ_SHORT()];
+			REGISTER_OP(dst, left, right, number_subtract);
+			NEXT_INSTRUCTION;
+		}
+		case OP_REG_MULTIPLY_LL: {
+		label_op_reg_multiply_ll:
+			uint32_t dst = READ_SHORT();
+			Value left = frame->slots[READ_SHORT()];
+			Value right = frame->slots[READ_SHORT()];
+			REGISTER_OP(dst, left, right, number_multiply);
+			NEXT_INSTRUCTION;
+		}
+		case OP_REG_DIVIDE_LL: {
+		label_op_reg_divide_ll:
+			uint32_t dst = READ_SHORT();
+			Value left = frame->slots[READ_SHORT()];
+			Value right = frame->slots[READ_SHORT()];
+			REGISTER_OP(dst, left, right, number_divide);
+			NEXT_INSTRUCTION;
+		}
+		case OP_REG_MODULUS_LL: {
+		label_op_reg_modulus_ll:
+			uint32_t dst = READ_SHORT();
+			Value left = frame->slots[READ_SHORT()];
+			Value right = frame->slots[READ_SHORT()];
+			REGISTER_OP(dst, left, right, number_modulus);
+			NEXT_INSTRUCTION;
+		}
+		case OP_REG_ADD_LC: {
+		label_op_reg_add_lc:
+			uint32_t dst = READ_SHORT();
+			Value left = frame->slots[READ_SHORT()];
+			Value right = READ_CONSTANT(READ_24bits());
+			REGISTER_ADD(dst, left, right);
+			NEXT_INSTRUCTION;
+		}
+		case OP_REG_SUBTRACT_LC: {
+		label_op_reg_subtract_lc:
+			uint32_t dst = READ_SHORT();
+			Value left = frame->slots[READ_SHORT()];
+			Value right = READ_CONSTANT(READ_24bits());
+			REGISTER_OP(dst, left, right, number_subtract);
+			NEXT_INSTRUCTION;
+		}
+		case OP_REG_MULTIPLY_LC: {
+		label_op_reg_multiply_lc:
+			uint32_t dst = READ_SHORT();
+			Value left = frame->slots[READ_SHORT()];
+			Value right = READ_CONSTANT(READ_24bits());
+			REGISTER_OP(dst, left, right, number_multiply);
+			NEXT_INSTRUCTION;
+		}
+		case OP_REG_DIVIDE_LC: {
+		label_op_reg_divide_lc:
+			uint32_t dst = READ_SHORT();
+			Value left = frame->slots[READ_SHORT()];
+			Value right = READ_CONSTANT(READ_24bits());
+			REGISTER_OP(dst, left, right, number_divide);
+			NEXT_INSTRUCTION;
+		}
+		case OP_REG_MODULUS_LC: {
+		label_op_reg_modulus_lc:
+			uint32_t dst = READ_SHORT();
+			Value left = frame->slots[READ_SHORT()];
+			Value right = READ_CONSTANT(READ_24bits());
+			REGISTER_OP(dst, left, right, number_modulus);
+			NEXT_INSTRUCTION;
+		}
+		case OP_JUMP_IF_IN_ARRAY_LL: {
+		label_op_jump_if_in_array_ll:
+			Value index = frame->slots[READ_SHORT()];
+			Value target = frame->slots[READ_SHORT()];
+			uint16_t offset = READ_SHORT();
+
+			//otherwise the condition after it is run as usual
+			if (isArrayLoopIndex(target, index)) ip += offset;
+			NEXT_INSTRUCTION;
+		}
+		case OP_GET_ELEMENT_LL: {
+		label_op_get_element_ll:
+			ObjArray* array = AS_ARRAY(frame->slots[READ_SHORT()]);
+			Value index = frame->slots[READ_SHORT()];
+			uint32_t at = ARRAY_VALUE_INDEX(index);
+
+			PUSH(OBJ_IS_TYPE(array, OBJ_ARRAY) ? ARRAY_ELEMENT(array, Value, at) : NUMBER_VAL(ARRAY_ELEMENT(array, double, at)));
+			NEXT_INSTRUCTION;
+		}
+		case OP_SET_ELEMENT_LL: {
+		label_op_set_element_ll:
+			ObjArray* array = AS_ARRAY(frame->slots[READ_SHORT()]);
+			Value index = frame->slots[READ_SHORT()];
+			uint32_t at = ARRAY_VALUE_INDEX(index);
+
+			if (OBJ_IS_TYPE(array, OBJ_ARRAY)) {
+				ARRAY_ELEMENT(array, Value, at) = stackTop[-1];
+				gc_writeBarrier(&array->obj, stackTop[-1]);
+			}
+			else {
+				setTypedArrayElement(array, at, stackTop[-1]);
+			}
+			NEXT_INSTRUCTION;
+		}
+		case OP_GET_SUBSCRIPT_ARRAY: {
+		label_op_get_subscript_array:
+			Value target = stackTop[-2];
+			Value index = stackTop[-1];
+
+			if (!isObjType(target, OBJ_ARRAY) || !IS_NUMBER(index)) {
+				DEQUICKEN(OP_GET_SUBSCRIPT);
+				goto label_op_get_subscript;
+			}
+
+			ObjArray* array = AS_ARRAY(target);
+			stackTop--;
+			REPLACE(ARRAY_VALUE_IN_RANGE(array, index) ? ARRAY_ELEMENT(array, Value, ARRAY_VALUE_INDEX(index)) : NIL_VAL);
+			NEXT_INSTRUCTION;
+		}
+		case OP_GET_SUBSCRIPT_F64: {
+		label_op_get_subscript_f64:
+			Value target = stackTop[-2];
+			Value index = stackTop[-1];
+
+			if (!isObjType(target, OBJ_ARRAY_F64) || !IS_NUMBER(index)) {
+				DEQUICKEN(OP_GET_SUBSCRIPT);
+				goto label_op_get_subscript;
+			}
+
+			ObjArray* array = AS_ARRAY(target);
+			stackTop--;
+			REPLACE(ARRAY_VALUE_IN_RANGE(array, index) ? NUMBER_VAL(ARRAY_ELEMENT(array, double, ARRAY_VALUE_INDEX(index))) : NIL_VAL);
+			NEXT_INSTRUCTION;
+		}
+		case OP_SET_SUBSCRIPT_ARRAY: {
+		label_op_set_subscript_array:
+			Value target = stackTop[-3];
+			Value index = stackTop[-2];
+			Value value = stackTop[-1];
+
+			//out of range goes the slow way to throw
+			if (!isObjType(target, OBJ_ARRAY) || !IS_NUMBER(index) || !ARRAY_VALUE_IN_RANGE(AS_ARRAY(target), index)) {
+				DEQUICKEN(OP_SET_SUBSCRIPT);
+				goto label_op_set_subscript;
+			}
+
+			ARRAY_ELEMENT(AS_ARRAY(target), Value, ARRAY_VALUE_INDEX(index)) = value;
+			gc_writeBarrier(AS_OBJ(target), value);
+			stackTop[-3] = value;
+			stackTop -= 2;
+			NEXT_INSTRUCTION;
+		}
+		case OP_SET_SUBSCRIPT_F64: {
+		label_op_set_subscript_f64:
+			Value target = stackTop[-3];
+			Value index = stackTop[-2];
+			Value value = stackTop[-1];
+
+			//non-number value is converted by the slow way
+			if (!isObjType(target, OBJ_ARRAY_F64) || !IS_NUMBER(index) || !IS_NUMBER(value) || !ARRAY_VALUE_IN_RANGE(AS_ARRAY(target), index)) {
+				DEQUICKEN(OP_SET_SUBSCRIPT);
+				goto label_op_set_subscript;
+			}
+
+			ARRAY_ELEMENT(AS_ARRAY(target), double, ARRAY_VALUE_INDEX(index)) = AS_NUMBER(value);
+			stackTop[-3] = value;
+			stackTop -= 2;
+			NEXT_INSTRUCTION;
+		}
+		case OP_GET_INDEX_ARRAY: {
+		label_op_get_index_array:
+			Value target = stackTop[-1];
+
+			if (!isObjType(target, OBJ_ARRAY)) {
+				DEQUICKEN(OP_GET_INDEX);
+				goto label_op_get_index;
+			}
+
+			ObjArray* array = AS_ARRAY(target);
+			double num_index = AS_NUMBER(READ_CONSTANT(READ_24bits()));
+			REPLACE(ARRAY_IN_RANGE(array, num_index) ? ARRAY_ELEMENT(array, Value, (uint32_t)num_index) : NIL_VAL);
+			NEXT_INSTRUCTION;
+		}
+		case OP_GET_INDEX_F64: {
+		label_op_get_index_f64:
+			Value target = stackTop[-1];
+
+			if (!isObjType(target, OBJ_ARRAY_F64)) {
+				DEQUICKEN(OP_GET_INDEX);
+				goto label_op_get_index;
+			}
+
+			ObjArray* array = AS_ARRAY(target);
+			double num_index = AS_NUMBER(READ_CONSTANT(READ_24bits()));
+			REPLACE(ARRAY_IN_RANGE(array, num_index) ? NUMBER_VAL(ARRAY_ELEMENT(array, double, (uint32_t)num_index)) : NIL_VAL);
+			NEXT_INSTRUCTION;
+		}
+		case OP_SET_INDEX_ARRAY: {
+		label_op_set_index_array:
+			Value target = stackTop[-2];
+			Value value = stackTop[-1];
+			double num_index = AS_NUMBER(READ_CONSTANT(READ_24bits()));
+
+			//out of range goes the slow way to throw
+			if (!isObjType(target, OBJ_ARRAY) || !ARRAY_IN_RANGE(AS_ARRAY(target), num_index)) {
+				ip -= 3;//unread the index
+				DEQUICKEN(OP_SET_INDEX);
+				goto label_op_set_index;
+			}
+
+			ARRAY_ELEMENT(AS_ARRAY(target), Value, (uint32_t)num_index) = value;
+			gc_writeBarrier(AS_OBJ(target), value);
+			stackTop[-2] = value;
+			stackTop -= 1;
+			NEXT_INSTRUCTION;
+		}
+		case OP_SET_INDEX_F64: {
+		label_op_set_index_f64:
+			Value target = stackTop[-2];
+			Value value = stackTop[-1];
+			double num_index = AS_NUMBER(READ_CONSTANT(READ_24bits()));
+
+			//non-number value is converted by the slow way
+			if (!isObjType(target, OBJ_ARRAY_F64) || !IS_NUMBER(value) || !ARRAY_IN_RANGE(AS_ARRAY(target), num_index)) {
+				ip -= 3;//unread the index
+				DEQUICKEN(OP_SET_INDEX);
+				goto label_op_set_index;
+			}
+
+			ARRAY_ELEMENT(AS_ARRAY(target), double, (uint32_t)num_index) = AS_NUMBER(value);
+			stackTop[-2] = value;
+			stackTop -= 1;
+			NEXT_INSTRUCTION;
+		}
+		case OP_ADD_NUMBER: {
+		label_op_add_number:
+			if (!IS_NUMBER(stackTop[-2]) || !IS_NUMBER(stackTop[-1])) {
+				DEQUICKEN(OP_ADD);
+				goto label_op_add;
+			}
+
+			stackTop[-2] = number_add(stackTop[-2], stackTop[-1]);
+			stackTop--;
+			NEXT_INSTRUCTION;
+		}
+		case OP_CALL_NATIVE_NUMBER: {
+		label_op_call_native_number:
+			uint8_t argCount = READ_BYTE();
+			Value callee = stackTop[-1 - argCount];
+
+			if (IS_NATIVE(callee) && AS_NATIVE_OBJ(callee)->fastArity == argCount) {
+				ObjNative* native = AS_NATIVE_OBJ(callee);
+
+				//no boxing and no frame, result goes to the callee slot
+				if (argCount == 1 && IS_NUMBER(stackTop[-1])) {
+					stackTop[-2] = NUMBER_VAL_FIT(native->unary(AS_NUMBER(stackTop[-1])));
+					stackTop--;
+					NEXT_INSTRUCTION;
+				}
+				if (argCount == 2 && IS_BOTH_NUMBER(stackTop[-2], stackTop[-1])) {
+					stackTop[-3] = NUMBER_VAL_FIT(native->binary(AS_NUMBER(stackTop[-2]), AS_NUMBER(stackTop[-1])));
+					stackTop -= 2;
+					NEXT_INSTRUCTION;
+				}
+			}
+
+			ip--;
+			DEQUICKEN(OP_CALL);
+			goto label_op_call;
+		}
 		}
 	}
 
@@ -1906,8 +3011,27 @@ static InterpretResult run()
 #undef READ_SHORT
 #undef READ_24bits
 #undef READ_CONSTANT
+#undef STORE_STACK_TOP
+#undef LOAD_STACK_TOP
+#undef PUSH
+#undef POP
+#undef DROP
+#undef REPLACE
+#undef QUICKEN
+#undef DEQUICKEN
+#undef AOT_ENTER
+#undef JIT_ENTER
+#undef TRACE_ENTER
 #undef BINARY_OP
 #undef BINARY_OP_WITH_RIGHT
+#undef ARITHMETIC_OP
+#undef ARITHMETIC_OP_WITH_RIGHT
+#undef REGISTER_OP
+#undef REGISTER_ADD
+#undef COMPARE_JUMP
+#undef EQUAL_JUMP
+#undef INPLACE_OP
+#undef INPLACE_ADD
 }
 
 InterpretResult interpret(C_STR source)
@@ -1924,6 +3048,10 @@ InterpretResult interpret(C_STR source)
 	printf("[Log] Finished compiling in %g ms.\n", time_compile_f);
 #endif
 
+	return interpret_function(function);
+}
+
+InterpretResult interpret_function(ObjFunction* function) {
 	//stack_push(OBJ_VAL(function));
 	ObjClosure* closure = newClosure(function);
 	//stack_replace(OBJ_VAL(closure));
@@ -1941,6 +3069,11 @@ InterpretResult interpret(C_STR source)
 	printf("[Log] Finished executing in %g ms.\n", time_run_f);
 #endif
 
+#if LOG_INLINE_CACHE
+	logInlineCache();
+#endif
+
+	if (vm.config.profile) profile_report();
 	return result;
 }
 
@@ -1948,4 +3081,47 @@ InterpretResult interpret_repl(C_STR source) {
 	InterpretResult res = interpret(source);
 	stack_reset();//clean stack after use
 	return res;
-}
\ No newline at end of file
+}
+
+//go on with the callee by native code or C code if it has
+static JitStatus jit_enterCallee(CallFrame* caller) {
+	CallFrame* frame = &vm.frames[vm.frameCount - 1];
+	if (frame == caller) return JIT_OK;//native or class without init,no frame
+
+	ObjFunction* function = frame->closure->function;
+	if (function->aot != NULL) return aot_enter(frame);
+#if JIT_AVAILABLE
+	if (vm.config.jit && jit_ready(function, true)) return jit_enter(frame);
+#endif
+	return JIT_EXIT;
+}
+
+JitStatus jit_call(CallFrame* frame, uint8_t* ip, int argCount) {
+	frame->ip = ip;//change before call
+	*vm.ip_error = ip;
+	if (!callValue(STACK_PEEK(argCount), argCount)) return JIT_ERROR;
+	return jit_enterCallee(frame);
+}
+
+JitStatus jit_invoke(CallFrame* frame, uint8_t* ip, ObjString* name, int argCount, InvokeCache* cache) {
+	frame->ip = ip;//change before call
+	*vm.ip_error = ip;
+	if (!invoke(name, argCount, cache)) return JIT_ERROR;
+	return jit_enterCallee(frame);
+}
+
+void jit_closeUpvalues(Value* last) {
+	closeUpvalues(last);
+}
+
+Value jit_numberFit(double num) {
+	return NUMBER_VAL_FIT(num);
+}
+
+void jit_print(Value value) {
+#if DEBUG_MODE
+	printf("[print] ");
+#endif
+	printValue(value);
+	printf("\n");
+}
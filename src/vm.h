@@ -9,11 +9,32 @@
 #include "table.h"
 #include "object.h"
 #include "nativeBuiltin.h"
+#include "thread.h"
 
 //the depth of call frames
 #define FRAMES_MAX 1024
-//customed vm stack begin size
-#define STACK_INITIAL_SIZE 4096
+//values of the vm stack,reserved up front so it never moves
+#define STACK_MAX UINT24_COUNT
+//values kept free after the deepest frame,for what natives push and the temporaries inside a commond
+#define STACK_SLACK 256
+//global slots,the operand of the global commonds is 24 bits.reserved up front so a slot never moves
+#define GLOBAL_MAX UINT24_COUNT
+
+typedef struct GCBlock GCBlock;
+typedef struct GCWorker GCWorker;
+
+//a part of a list of gc objects,linked by their next pointers
+typedef struct {
+	Obj* first;
+	uint64_t count;
+} ObjSegment;
+
+//the objects split in segments of at most GC_SEGMENT_OBJECTS,the threads of a parallel sweep take one at a time
+typedef struct {
+	uint32_t count;
+	uint32_t capacity;
+	ObjSegment* segments;
+} ObjSegments;
 
 typedef struct {
 	ObjClosure* closure;
@@ -21,11 +42,24 @@ typedef struct {
 	Value* slots; //first avilable slot
 } CallFrame;
 
+//options from command line,set before vm_init and kept by it
+typedef struct {
+	bool registerMode;	//--register,emit register commonds for local arithmetic
+	bool jit;			//--jit,compile hot functions to native code
+	bool trace;			//--trace,compile hot loops to native code by recording
+	bool traceDump;		//--trace-dump,print the recorded traces
+	bool emitC;			//--emit-c,print the script as C instead of running it
+	bool aot;			//set by the program of --emit-c,functions may have C code
+	bool profile;		//--profile,count the commonds run by the interpreter and report them
+	bool gcThread;		//--gc-thread,mark the old objects on a background thread
+	uint32_t gcThreads;	//--gc-threads=N,the threads of a full collection up to the hardware ones,it is parallel when more than 1
+} VMConfig;
+
 typedef struct {
 	//a cache
 	Value* stack;
 	Value* stackTop;
-	//the edge of stack
+	//a frame must end before it,checked once by each call
 	Value* stackBoundary;
 
 	// deduplicated global constant table
@@ -44,12 +78,29 @@ typedef struct {
 	//upvalues
 	ObjUpvalue* openUpvalues;
 
-	//global hash table
+	//shapes of instances
+	Shape* shapes;
+	uint32_t shapeCount;
+	Shape* rootShape;
+	Shape dictionaryShape;
+
+	//the global variables,ObjString.symbol of the name is the index.UNDEFINED_VAL if not defined
+	Value* globalValues;
+	ObjString** globalNames;
+	uint32_t globalCount;
+	uint32_t globalCapacity;	//of globalNames
+	//the view of @object.getGlobal(),it has no fields of its own
 	ObjInstance globals;
 	ObjInstance builtins[BUILTIN_MODULE_COUNT];
 
-	//the root for dynamic objects
-	Obj* objects;
+	//the root for dynamic objects that survived a collection
+	ObjSegments objects;
+	//the dynamic objects allocated after the last collection
+	Obj* youngObjects;
+	//the old and the young objects of the last marking,swept between the allocations from sweepSegment
+	ObjSegments sweepObjects;
+	Obj* sweepYoungObjects;
+	uint32_t sweepSegment;
 	//the root for static objects
 	Obj* objects_no_gc;
 
@@ -58,6 +109,19 @@ typedef struct {
 	uint64_t grayCapacity;
 	Obj** grayStack;
 
+	//old objects that may reference young ones,roots of the minor collections
+	uint64_t rememberedCount;
+	uint64_t rememberedCapacity;
+	Obj** remembered;
+
+	//the blocks of the dynamic objects,the young ones are bump allocated in the free lines
+	GCBlock* blocks;
+	GCBlock* allocBlock;
+	uint32_t allocLine;		//the next line of allocBlock to look for a hole
+	uint8_t* allocCursor;
+	uint8_t* allocLimit;
+	uint64_t youngBytes;	//allocated after the last collection
+
 	//Excludes space used by stacks/constants/compilations
 	uint64_t bytesAllocated_no_gc;
 	uint64_t bytesAllocated;
@@ -66,11 +130,45 @@ typedef struct {
 	uint8_t gcMark;
 	//mark if the gc is running
 	uint8_t gcWorking;
+	//a minor collection is running,the old objects are not marked
+	uint8_t gcMinor;
+	//GC_PHASE_MARKING or GC_PHASE_SWEEPING while a major collection runs between the allocations
+	uint8_t gcPhase;
+	//--gc-thread,the thread may take gray objects.it is only set by the script
+	uint8_t gcThreadActive;
+	//the thread waits and its own gray objects are given back
+	uint8_t gcThreadIdle;
+	uint8_t gcThreadExit;
 	//pad
-	uint8_t padding[6];
+	uint8_t padding[1];
+	//layout changes the script is in,the thread is not started inside one
+	uint32_t gcLockDepth;
+
+	//the marking thread of --gc-thread,gcMutex guards the gray stack and the flags while it runs
+	Thread* gcThread;
+	Mutex* gcMutex;
+	CondVar* gcWork;		//the thread waits for gray objects
+	CondVar* gcIdle;		//the script waits for the thread to stop
+
+	//the workers of a parallel full collection,the first is the script's thread
+	uint32_t gcWorkerCount;
+	GCWorker** gcWorkers;
+	Mutex* gcPoolMutex;
+	CondVar* gcPoolWork;	//the workers wait for the next job
+	CondVar* gcPoolDone;	//the script waits for the workers to finish it
+	uint32_t gcJob;
+	uint32_t gcJobEpoch;	//counts the jobs,a worker runs each one once
+	uint32_t gcBusyWorkers;
+	uint32_t gcIdleWorkers;	//the marking is done when all are idle
+	uint32_t gcSweepNext;	//the next segment to sweep,the young objects are the first
+	bool gcPoolExit;
 
 	uint64_t beginGC;
 	uint64_t nextGC;
+	//the longest slice of the incremental marking and sweep in nanoseconds,0 collects all at once
+	uint64_t gcPauseTarget;
+	//youngBytes of the next slice
+	uint64_t gcStepAt;
 
 	//ip for debug error
 	uint8_t** ip_error;
@@ -81,8 +179,21 @@ typedef struct {
 	ObjString* initString;
 	ObjString* typeStrings[TYPE_STRING_COUNT];
 
+	//command line options
+	VMConfig config;
+
 	//id for compiled functions
 	uint32_t functionID;
+	//changes when any method table changes or class freed,invoke caches check it
+	uint32_t methodCacheEpoch;
+
+#if LOG_INLINE_CACHE
+	//hit rate of inline caches
+	uint64_t propertyCacheHits;
+	uint64_t propertyCacheMisses;
+	uint64_t invokeCacheHits;
+	uint64_t invokeCacheMisses;
+#endif
 
 	//frames
 	uint32_t frameCount;
@@ -111,10 +222,15 @@ uint32_t getConstantSize();
 uint32_t addConstant(Value value);
 
 InterpretResult interpret(C_STR source);
+//run the compiled script
+InterpretResult interpret_function(ObjFunction* function);
 InterpretResult interpret_repl(C_STR source);
 
 //for builtin
 void defineNative_math(C_STR name, NativeFn function);
+//the generic function is kept for other arity or non-number arguments
+void defineNativeUnary_math(C_STR name, NativeFn function, NativeUnaryFn unary);
+void defineNativeBinary_math(C_STR name, NativeFn function, NativeBinaryFn binary);
 void defineNative_array(C_STR name, NativeFn function);
 void defineNative_object(C_STR name, NativeFn function);
 void defineNative_string(C_STR name, NativeFn function);
@@ -122,4 +238,10 @@ void defineNative_time(C_STR name, NativeFn function);
 void defineNative_ctor(C_STR name, NativeFn function);
 void defineNative_system(C_STR name, NativeFn function);
 //for global
-void defineNative_global(C_STR name, NativeFn function);
\ No newline at end of file
+void defineNative_global(C_STR name, NativeFn function);
+
+//the slot of the global variable name,a new one is added undefined
+uint32_t globalSlot(ObjString* name);
+//the view of @object.getGlobal(),set nil means delete like the other dictionaries
+bool globalGet(ObjString* name, Value* value_out);
+void globalSet(ObjString* name, Value value);
\ No newline at end of file
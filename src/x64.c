@@ -0,0 +1,310 @@
+/*
+ * MIT License
+ * Copyright (c) 2025 IMSDcrueoft (https://github.com/IMSDcrueoft)
+ * See LICENSE file in the root directory for full license text.
+*/
+#include "x64.h"
+
+#if X64_AVAILABLE
+#include <sys/mman.h>
+#include <unistd.h>
+#include "memory.h"
+
+void x64_free(X64Code* code) {
+	FREE_ARRAY_NO_GC(uint8_t, code->bytes, code->capacity);
+	code->bytes = NULL;
+	code->count = 0;
+	code->capacity = 0;
+}
+
+uint8_t* x64_map(X64Code* code, uint64_t* size) {
+	uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+	*size = (code->count + pageSize - 1) & ~(pageSize - 1);
+
+	void* memory = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory == MAP_FAILED) return NULL;
+
+	memcpy(memory, code->bytes, code->count);
+	if (mprotect(memory, *size, PROT_READ | PROT_EXEC) != 0) {
+		munmap(memory, *size);
+		return NULL;
+	}
+	return memory;
+}
+
+void x64_unmap(uint8_t* memory, uint64_t size) {
+	munmap(memory, size);
+}
+
+void x64_byte(X64Code* code, uint8_t byte) {
+	if (code->count == code->capacity) {
+		uint32_t oldCapacity = code->capacity;
+		code->capacity = GROW_CAPACITY(oldCapacity);
+		code->bytes = GROW_ARRAY_NO_GC(uint8_t, code->bytes, oldCapacity, code->capacity);
+	}
+	code->bytes[code->count++] = byte;
+}
+
+void x64_int32(X64Code* code, uint32_t value) {
+	for (uint32_t i = 0; i < 4; ++i) {
+		x64_byte(code, (uint8_t)(value >> (i * 8)));
+	}
+}
+
+void x64_int64(X64Code* code, uint64_t value) {
+	for (uint32_t i = 0; i < 8; ++i) {
+		x64_byte(code, (uint8_t)(value >> (i * 8)));
+	}
+}
+
+void x64_patch32(X64Code* code, uint32_t at, uint32_t value) {
+	memcpy(code->bytes + at, &value, sizeof(uint32_t));
+}
+
+void x64_rex(X64Code* code, bool isWide, uint32_t reg, uint32_t index, uint32_t base) {
+	uint8_t rex = 0x40 | (isWide << 3) | (((reg >> 3) & 1) << 2) | (((index >> 3) & 1) << 1) | ((base >> 3) & 1);
+	if (rex != 0x40) x64_byte(code, rex);
+}
+
+void x64_memory(X64Code* code, uint32_t reg, Register base, int32_t disp) {
+	uint8_t mod = (disp == 0 && (base & 7) != RBP) ? 0 : ((disp >= INT8_MIN && disp <= INT8_MAX) ? 1 : 2);
+	x64_byte(code, (uint8_t)((mod << 6) | ((reg & 7) << 3) | (base & 7)));
+	if ((base & 7) == RSP) x64_byte(code, 0x24);//SIB of rsp and r12
+
+	if (mod == 1) x64_byte(code, (uint8_t)disp);
+	else if (mod == 2) x64_int32(code, (uint32_t)disp);
+}
+
+//ModRM and SIB of reg and [base + index * 8],rbp and r13 are not the base
+static void x64_indexed(X64Code* code, uint32_t reg, Register base, Register index) {
+	x64_byte(code, (uint8_t)(((reg & 7) << 3) | 4));
+	x64_byte(code, (uint8_t)((3 << 6) | ((index & 7) << 3) | (base & 7)));
+}
+
+void x64_opMemory(X64Code* code, uint8_t opcode, Register reg, Register base, int32_t disp) {
+	x64_rex(code, true, reg, 0, base);
+	x64_byte(code, opcode);
+	x64_memory(code, reg, base, disp);
+}
+
+void x64_opRegister(X64Code* code, uint8_t opcode, Register dst, Register src) {
+	x64_rex(code, true, src, 0, dst);
+	x64_byte(code, opcode);
+	x64_byte(code, (uint8_t)(0xc0 | ((src & 7) << 3) | (dst & 7)));
+}
+
+void x64_opImmediate(X64Code* code, uint8_t extension, Register dst, int32_t imm) {
+	x64_rex(code, true, 0, 0, dst);
+	if (imm >= INT8_MIN && imm <= INT8_MAX) {
+		x64_byte(code, 0x83);
+		x64_byte(code, (uint8_t)(0xc0 | (extension << 3) | (dst & 7)));
+		x64_byte(code, (uint8_t)imm);
+	}
+	else {
+		x64_byte(code, 0x81);
+		x64_byte(code, (uint8_t)(0xc0 | (extension << 3) | (dst & 7)));
+		x64_int32(code, (uint32_t)imm);
+	}
+}
+
+void x64_movImmediate(X64Code* code, Register dst, uint64_t imm) {
+	if (imm <= UINT32_MAX) {
+		//mov r32 zero extends
+		x64_rex(code, false, 0, 0, dst);
+		x64_byte(code, (uint8_t)(0xb8 + (dst & 7)));
+		x64_int32(code, (uint32_t)imm);
+	}
+	else {
+		x64_rex(code, true, 0, 0, dst);
+		x64_byte(code, (uint8_t)(0xb8 + (dst & 7)));
+		x64_int64(code, imm);
+	}
+}
+
+void x64_load(X64Code* code, Register dst, Register base, int32_t disp) {
+	x64_opMemory(code, X86_MOV_LOAD, dst, base, disp);
+}
+
+void x64_store(X64Code* code, Register base, int32_t disp, Register src) {
+	x64_opMemory(code, X86_MOV_STORE, src, base, disp);
+}
+
+void x64_loadIndexed(X64Code* code, Register dst, Register base, Register index) {
+	x64_rex(code, true, dst, index, base);
+	x64_byte(code, X86_MOV_LOAD);
+	x64_indexed(code, dst, base, index);
+}
+
+void x64_storeIndexed(X64Code* code, Register base, Register index, Register src) {
+	x64_rex(code, true, src, index, base);
+	x64_byte(code, X86_MOV_STORE);
+	x64_indexed(code, src, base, index);
+}
+
+void x64_load32(X64Code* code, Register dst, Register base, int32_t disp) {
+	x64_rex(code, false, dst, 0, base);
+	x64_byte(code, 0x8b);
+	x64_memory(code, dst, base, disp);
+}
+
+void x64_loadByte(X64Code* code, Register dst, Register base, int32_t disp) {
+	x64_rex(code, false, dst, 0, base);
+	x64_byte(code, 0x0f);
+	x64_byte(code, 0xb6);
+	x64_memory(code, dst, base, disp);
+}
+
+void x64_compareMemory32(X64Code* code, Register base, int32_t disp, int8_t imm) {
+	x64_rex(code, false, 0, 0, base);
+	x64_byte(code, 0x83);
+	x64_memory(code, X86_EXT_CMP, base, disp);
+	x64_byte(code, (uint8_t)imm);
+}
+
+void x64_compare32(X64Code* code, Register reg, int8_t imm) {
+	x64_rex(code, false, 0, 0, reg);
+	x64_byte(code, 0x83);
+	x64_byte(code, (uint8_t)(0xc0 | (X86_EXT_CMP << 3) | (reg & 7)));
+	x64_byte(code, (uint8_t)imm);
+}
+
+void x64_shift(X64Code* code, Register reg, bool isLeft, uint8_t bits) {
+	x64_rex(code, true, 0, 0, reg);
+	x64_byte(code, 0xc1);
+	x64_byte(code, (uint8_t)(0xc0 | ((isLeft ? 4 : 5) << 3) | (reg & 7)));
+	x64_byte(code, bits);
+}
+
+void x64_toXmm(X64Code* code, uint32_t xmm, Register src) {
+	x64_byte(code, 0x66);
+	x64_rex(code, true, xmm, 0, src);
+	x64_byte(code, 0x0f);
+	x64_byte(code, 0x6e);
+	x64_byte(code, (uint8_t)(0xc0 | ((xmm & 7) << 3) | (src & 7)));
+}
+
+void x64_fromXmm(X64Code* code, Register dst, uint32_t xmm) {
+	x64_byte(code, 0x66);
+	x64_rex(code, true, xmm, 0, dst);
+	x64_byte(code, 0x0f);
+	x64_byte(code, 0x7e);
+	x64_byte(code, (uint8_t)(0xc0 | ((xmm & 7) << 3) | (dst & 7)));
+}
+
+void x64_sse(X64Code* code, uint8_t prefix, uint8_t opcode, uint32_t dst, uint32_t src) {
+	x64_byte(code, prefix);
+	x64_rex(code, false, dst, 0, src);
+	x64_byte(code, 0x0f);
+	x64_byte(code, opcode);
+	x64_byte(code, (uint8_t)(0xc0 | ((dst & 7) << 3) | (src & 7)));
+}
+
+void x64_sseMemory(X64Code* code, uint8_t prefix, uint8_t opcode, uint32_t xmm, Register base, int32_t disp) {
+	x64_byte(code, prefix);
+	x64_rex(code, false, xmm, 0, base);
+	x64_byte(code, 0x0f);
+	x64_byte(code, opcode);
+	x64_memory(code, xmm, base, disp);
+}
+
+void x64_sseIndexed(X64Code* code, uint8_t prefix, uint8_t opcode, uint32_t xmm, Register base, Register index) {
+	x64_byte(code, prefix);
+	x64_rex(code, false, xmm, index, base);
+	x64_byte(code, 0x0f);
+	x64_byte(code, opcode);
+	x64_indexed(code, xmm, base, index);
+}
+
+uint32_t x64_sseRelative(X64Code* code, uint8_t prefix, uint8_t opcode, uint32_t xmm) {
+	x64_byte(code, prefix);
+	x64_rex(code, false, xmm, 0, 0);
+	x64_byte(code, 0x0f);
+	x64_byte(code, opcode);
+	x64_byte(code, (uint8_t)(((xmm & 7) << 3) | 5));
+	x64_int32(code, 0);
+	return code->count - 4;
+}
+
+void x64_truncate(X64Code* code, Register dst, uint32_t xmm) {
+	x64_byte(code, 0xf2);
+	x64_rex(code, true, dst, 0, xmm);
+	x64_byte(code, 0x0f);
+	x64_byte(code, 0x2c);
+	x64_byte(code, (uint8_t)(0xc0 | ((dst & 7) << 3) | (xmm & 7)));
+}
+
+void x64_intToXmm(X64Code* code, uint32_t xmm, Register src) {
+	x64_byte(code, 0xf2);
+	x64_rex(code, false, xmm, 0, src);
+	x64_byte(code, 0x0f);
+	x64_byte(code, 0x2a);
+	x64_byte(code, (uint8_t)(0xc0 | ((xmm & 7) << 3) | (src & 7)));
+}
+
+void x64_setAl(X64Code* code, Condition cc) {
+	x64_byte(code, 0x0f);
+	x64_byte(code, (uint8_t)(0x90 | cc));
+	x64_byte(code, 0xc0);
+}
+
+void x64_push(X64Code* code, Register reg) {
+	x64_rex(code, false, 0, 0, reg);
+	x64_byte(code, (uint8_t)(0x50 + (reg & 7)));
+}
+
+void x64_pop(X64Code* code, Register reg) {
+	x64_rex(code, false, 0, 0, reg);
+	x64_byte(code, (uint8_t)(0x58 + (reg & 7)));
+}
+
+void x64_call(X64Code* code, uintptr_t function) {
+	x64_movImmediate(code, RAX, function);
+	x64_byte(code, 0xff);//call rax
+	x64_byte(code, 0xd0);
+}
+
+void x64_ret(X64Code* code) {
+	x64_byte(code, 0xc3);
+}
+
+uint32_t x64_jcc(X64Code* code, Condition cc) {
+	x64_byte(code, 0x0f);
+	x64_byte(code, (uint8_t)(0x80 | cc));
+	x64_int32(code, 0);
+	return code->count - 4;
+}
+
+uint32_t x64_jmp(X64Code* code) {
+	x64_byte(code, 0xe9);
+	x64_int32(code, 0);
+	return code->count - 4;
+}
+
+void x64_patchTo(X64Code* code, uint32_t at, uint32_t target) {
+	x64_patch32(code, at, target - (at + 4));
+}
+
+void x64_patchHere(X64Code* code, uint32_t at) {
+	x64_patchTo(code, at, code->count);
+}
+
+uint32_t x64_unboxNumber(X64Code* code, uint32_t xmm, Register src, Register scratch, Register qnan) {
+	x64_opRegister(code, X86_MOV_STORE, scratch, src);
+	x64_opRegister(code, X86_AND_STORE, scratch, qnan);
+	x64_opRegister(code, X86_CMP_STORE, scratch, qnan);
+	uint32_t isDouble = x64_jcc(code, CC_NE);
+
+	//int32 has QNAN | TAG_INT in the high half
+	x64_opRegister(code, X86_MOV_STORE, scratch, src);
+	x64_shift(code, scratch, false, 32);
+	x64_opImmediate(code, X86_EXT_CMP, scratch, (int32_t)((QNAN | TAG_INT) >> 32));
+	uint32_t notNumber = x64_jcc(code, CC_NE);
+	x64_intToXmm(code, xmm, src);
+	uint32_t done = x64_jmp(code);
+
+	x64_patchHere(code, isDouble);
+	x64_toXmm(code, xmm, src);
+	x64_patchHere(code, done);
+	return notNumber;
+}
+#endif
@@ -0,0 +1,155 @@
+/*
+ * MIT License
+ * Copyright (c) 2025 IMSDcrueoft (https://github.com/IMSDcrueoft)
+ * See LICENSE file in the root directory for full license text.
+*/
+#pragma once
+#include "common.h"
+
+//machine code of x86-64 with the System V abi,mapped by mmap.shared by the jit and the trace
+#if NAN_BOXING && defined(__x86_64__) && defined(__linux__)
+#define X64_AVAILABLE 1
+#else
+#define X64_AVAILABLE 0
+#endif
+
+#if X64_AVAILABLE
+typedef enum {
+	RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+	R8, R9, R10, R11, R12, R13, R14, R15,
+} Register;
+
+//xmm registers are numbers,xmm0 and xmm1 are the arguments and result of C functions
+#define XMM0 0
+#define XMM1 1
+
+typedef enum {
+	CC_B = 0x2,
+	CC_AE = 0x3,
+	CC_E = 0x4,
+	CC_NE = 0x5,
+	CC_BE = 0x6,
+	CC_A = 0x7,
+	CC_P = 0xa,
+	CC_NP = 0xb,
+} Condition;
+
+//the opposite condition
+#define CC_NOT(cc) ((Condition)((cc) ^ 1))
+
+//opcode of 'op r/m64, r64' and 'op r64, r/m64'
+#define X86_ADD_STORE	0x01
+#define X86_OR_STORE	0x09
+#define X86_AND_STORE	0x21
+#define X86_SUB_STORE	0x29
+#define X86_XOR_STORE	0x31
+#define X86_CMP_STORE	0x39
+#define X86_ADD_LOAD	0x03
+#define X86_CMP_LOAD	0x3b
+#define X86_TEST		0x85
+#define X86_MOV_STORE	0x89
+#define X86_MOV_LOAD	0x8b
+#define X86_LEA			0x8d
+
+//extension of 'op r/m64, imm'
+#define X86_EXT_ADD	0
+#define X86_EXT_OR	1
+#define X86_EXT_AND	4
+#define X86_EXT_SUB	5
+#define X86_EXT_CMP	7
+
+//scalar double commonds,with the prefix 0xf2
+#define SSE_LOAD	0x10	//movsd xmm, m64
+#define SSE_STORE	0x11	//movsd m64, xmm
+#define SSE_ADD		0x58
+#define SSE_MUL		0x59
+#define SSE_SUB		0x5c
+#define SSE_DIV		0x5e
+#define SSE_MOD		0x00	//fmod is called
+
+//packed double commonds,with the prefix 0x66
+#define SSE_COMPARE	0x2e	//ucomisd
+#define SSE_MOVE	0x28	//movapd
+#define SSE_XOR		0x57	//xorpd
+
+typedef struct {
+	uint32_t count;
+	uint32_t capacity;
+	uint8_t* bytes;
+} X64Code;
+
+void x64_free(X64Code* code);
+//copy the code to executable memory,NULL if failed
+uint8_t* x64_map(X64Code* code, uint64_t* size);
+void x64_unmap(uint8_t* memory, uint64_t size);
+
+void x64_byte(X64Code* code, uint8_t byte);
+void x64_int32(X64Code* code, uint32_t value);
+void x64_int64(X64Code* code, uint64_t value);
+void x64_patch32(X64Code* code, uint32_t at, uint32_t value);
+
+//REX prefix,skipped if nothing to extend
+void x64_rex(X64Code* code, bool isWide, uint32_t reg, uint32_t index, uint32_t base);
+//ModRM of reg and [base + disp]
+void x64_memory(X64Code* code, uint32_t reg, Register base, int32_t disp);
+//op reg, [base + disp] or op [base + disp], reg
+void x64_opMemory(X64Code* code, uint8_t opcode, Register reg, Register base, int32_t disp);
+//op dst, src
+void x64_opRegister(X64Code* code, uint8_t opcode, Register dst, Register src);
+//op dst, imm32 (sign extended)
+void x64_opImmediate(X64Code* code, uint8_t extension, Register dst, int32_t imm);
+void x64_movImmediate(X64Code* code, Register dst, uint64_t imm);
+
+void x64_load(X64Code* code, Register dst, Register base, int32_t disp);
+void x64_store(X64Code* code, Register base, int32_t disp, Register src);
+//mov dst, [base + index * 8]
+void x64_loadIndexed(X64Code* code, Register dst, Register base, Register index);
+//mov [base + index * 8], src
+void x64_storeIndexed(X64Code* code, Register base, Register index, Register src);
+//32bit load,zero extended
+void x64_load32(X64Code* code, Register dst, Register base, int32_t disp);
+//movzx dst, byte [base + disp]
+void x64_loadByte(X64Code* code, Register dst, Register base, int32_t disp);
+//cmp dword [base + disp], imm8
+void x64_compareMemory32(X64Code* code, Register base, int32_t disp, int8_t imm);
+//cmp r32, imm8
+void x64_compare32(X64Code* code, Register reg, int8_t imm);
+//shl or shr r64, imm8
+void x64_shift(X64Code* code, Register reg, bool isLeft, uint8_t bits);
+
+//movq xmm, r64
+void x64_toXmm(X64Code* code, uint32_t xmm, Register src);
+//movq r64, xmm
+void x64_fromXmm(X64Code* code, Register dst, uint32_t xmm);
+//sse commond of two xmm registers
+void x64_sse(X64Code* code, uint8_t prefix, uint8_t opcode, uint32_t dst, uint32_t src);
+//sse commond of xmm and [base + disp]
+void x64_sseMemory(X64Code* code, uint8_t prefix, uint8_t opcode, uint32_t xmm, Register base, int32_t disp);
+//sse commond of xmm and [base + index * 8]
+void x64_sseIndexed(X64Code* code, uint8_t prefix, uint8_t opcode, uint32_t xmm, Register base, Register index);
+//sse commond of xmm and [rip + disp32],returns the place to patch
+uint32_t x64_sseRelative(X64Code* code, uint8_t prefix, uint8_t opcode, uint32_t xmm);
+//cvttsd2si r64, xmm
+void x64_truncate(X64Code* code, Register dst, uint32_t xmm);
+//cvtsi2sd xmm, r32
+void x64_intToXmm(X64Code* code, uint32_t xmm, Register src);
+//setcc al
+void x64_setAl(X64Code* code, Condition cc);
+
+void x64_push(X64Code* code, Register reg);
+void x64_pop(X64Code* code, Register reg);
+//call the C function by rax
+void x64_call(X64Code* code, uintptr_t function);
+void x64_ret(X64Code* code);
+
+//jcc rel32,returns the place to patch
+uint32_t x64_jcc(X64Code* code, Condition cc);
+//jmp rel32,returns the place to patch
+uint32_t x64_jmp(X64Code* code);
+void x64_patchTo(X64Code* code, uint32_t at, uint32_t target);
+void x64_patchHere(X64Code* code, uint32_t at);
+
+//xmm = the number value of src,int32 is converted to double.returns the jump to patch if it is not a number.
+//scratch is clobbered,qnan keeps QNAN
+uint32_t x64_unboxNumber(X64Code* code, uint32_t xmm, Register src, Register scratch, Register qnan);
+#endif
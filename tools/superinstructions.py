@@ -0,0 +1,295 @@
+#!/usr/bin/env python3
+# MIT License
+# Copyright (c) 2025 IMSDcrueoft (https://github.com/IMSDcrueoft)
+# See LICENSE file in the root directory for full license text.
+"""Turn the pairs and triples of a --profile report into superinstructions.
+
+    loxflux --profile script.lfx 2> profile.txt
+    python3 tools/superinstructions.py profile.txt --top 4 > fused.txt
+
+Prints the pieces of each new commond for the files named in the output:
+the OpCode entries, the lengths, the stack effects, the disassembly, the
+profile names, the handlers of run() and the rules of instructionOptimize().
+A handler is the handlers of its commonds spliced in order, so only commonds
+that run straight through are fused. The rules run at the end of
+instructionOptimize() and only see the opStack, so a sequence is fused only
+if the compiler kept it there: the "[Profile] opStack" section of the report
+lists those. Sequences under --min-share of all the commonds run are left.
+The baseline JIT, the trace recorder and --emit-c don't get the new
+commonds, they leave them to the interpreter.
+"""
+import argparse
+import os
+import re
+import sys
+
+ROOT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+SEQUENCE = re.compile(r"^\s*(\d+)\s+[\d.]+%\s+((?:OP_\w+\(\S+\)\s*)+)$")
+COMMOND = re.compile(r"(OP_\w+)\((\d+|\?)\)")
+KEPT = re.compile(r"^\s*\d+\s+((?:OP_\w+\s*)+)$")
+TOTAL = re.compile(r"^\[Profile\] (\d+) commonds run")
+#changes the frame,jumps or rewrites its own bytes,not safe in the middle of a handler
+NOT_SPLICED = re.compile(r"\bframe\s*=|JIT_ENTER|TRACE_ENTER|AOT_ENTER|QUICKEN|\bip\s*[-+]?=[^=]|\bbreak\s*;")
+
+
+def read(path):
+    with open(path, encoding="utf-8") as file:
+        return file.read()
+
+
+def parse_report(text):
+    """the commonds run,the global pairs and triples with the most counted first,
+    and the sequences kept on the opStack,None if the report has no such section"""
+    total = 0
+    sequences = []
+    kept = None
+    section = None
+    for line in text.splitlines():
+        match = TOTAL.match(line)
+        if match:
+            total = int(match.group(1))
+            continue
+        if line.startswith("[Profile]"):
+            section = line.split()[1] if len(line.split()) > 1 else None
+            if section == "opStack":
+                kept = set()
+            continue
+        if section == "opStack":
+            match = KEPT.match(line)
+            if match:
+                kept.add(tuple(match.group(1).split()))
+            continue
+        if section not in ("pairs", "triples"):
+            continue
+        match = SEQUENCE.match(line)
+        if match:
+            commonds = [(name, None if length == "?" else int(length)) for name, length in COMMOND.findall(match.group(2))]
+            sequences.append((int(match.group(1)), commonds))
+    sequences.sort(key=lambda sequence: -sequence[0])
+    return total, sequences, kept
+
+
+def parse_handlers(source):
+    """OP_X -> the body after its label,the braces of the case excluded"""
+    handlers = {}
+    for match in re.finditer(r"case (OP_\w+): \{\n\s*label_op_\w+:\n", source):
+        depth = 1
+        index = match.end()
+        while depth > 0:
+            if source[index] == "{":
+                depth += 1
+            elif source[index] == "}":
+                depth -= 1
+            index += 1
+        handlers[match.group(1)] = source[match.end():index - 1].rstrip() + "\n"
+    return handlers
+
+
+def parse_opstack(source):
+    """commonds that may stay on the opStack,and the ones that may be on its top when
+    instructionOptimize() returns:the checked ones and what its rules fuse them into.
+    only a guess for reports without the opStack section"""
+    fused = set(re.findall(r"(?:fuseOpStack|replaceOpStack)\((OP_\w+)\)", source))
+    pushed = set(re.findall(r"emitOpStack\((OP_\w+),", source)) | fused
+    checked = set(re.findall(r"emitOpStack\((OP_\w+), true\)", source)) | fused
+    return pushed, checked
+
+
+def parse_stack_effects(source):
+    """OP_X -> the values it pushes minus the ones it pops,None if its operands decide"""
+    body = source[source.index("static int32_t commondStackEffect("):]
+    body = body[:body.index("\n}\n")]
+    effects = {}
+    cases = []
+    for line in body.splitlines():
+        line = line.strip()
+        match = re.match(r"case (OP_\w+):\s*(.*)$", line)
+        if match:
+            cases.append(match.group(1))
+            line = match.group(2)
+        match = re.match(r"return (.*);", line)
+        if match and cases:
+            value = match.group(1)
+            for name in cases:
+                effects[name] = int(value) if re.fullmatch(r"-?\d+", value) else None
+            cases = []
+    return effects
+
+
+def stack_effect(names, effects):
+    """the sum of the effects,the others work on the top or on the locals"""
+    if any(name in effects and effects[name] is None for name in names):
+        return None
+    return sum(effects.get(name, 0) for name in names)
+
+
+def fusable(commonds, handlers, pushed, checked, kept, effects):
+    names = [name for name, _ in commonds]
+    if any(length is None for _, length in commonds):
+        return "variable length"
+    missing = [name for name in names if name not in handlers]
+    if missing:
+        return "no handler for %s" % " ".join(missing)
+    crooked = [name for name in names[:-1] if NOT_SPLICED.search(handlers[name])]
+    if crooked:
+        return "%s changes the frame,jumps or rewrites itself" % " ".join(crooked)
+    if "QUICKEN" in handlers[names[-1]]:
+        return "%s rewrites itself" % names[-1]
+    if stack_effect(names, effects) is None:
+        return "the operands decide the stack effect"
+    if kept is not None:
+        if tuple(names) not in kept:
+            return "the compiler never keeps it on the opStack"
+    else:
+        lost = [name for name in names[:-1] if name not in pushed]
+        if lost:
+            return "%s is not kept on the opStack" % " ".join(lost)
+        if names[-1] not in checked:
+            return "%s doesn't run instructionOptimize()" % names[-1]
+    return None
+
+
+def fused_name(names):
+    return "OP_" + "_".join(name[3:] for name in names)
+
+
+def handler(fused, names, handlers):
+    label = "label_" + fused.lower()
+    lines = ["\t\tcase %s: {\n" % fused, "\t\t%s:\n" % label]
+    for i, name in enumerate(names):
+        body = handlers[name]
+        if i + 1 < len(names):
+            body = body.replace("NEXT_INSTRUCTION;", "goto %s_%d;" % (label, i + 1))
+        if i > 0:
+            lines.append("\t\t%s_%d:\n" % (label, i))
+        lines.append("\t\t\t{//%s\n" % name)
+        lines.extend("\t" + line + "\n" if line.strip() else "\n" for line in body.rstrip("\n").split("\n"))
+        lines.append("\t\t\t}\n")
+    lines.append("\t\t}\n")
+    return "".join(lines)
+
+
+def rule(fused, commonds):
+    names = [name for name, _ in commonds]
+    lengths = [length for _, length in commonds]
+    condition = ["code == %s" % names[-1]]
+    for i, name in enumerate(reversed(names[:-1])):
+        condition.append("opStack_peek(opStack, %d) == %s" % (i + 1, name))
+
+    #the opStack may miss a commond the chunk has,the bytes are checked too
+    for i, name in enumerate(names):
+        condition.append("CHUNK_PEEK(%d) == %s" % (sum(lengths[i:]) - 1, name))
+
+    lines = ["\t//%s,from the profile\n" % " ".join(names)]
+    lines.append("\tif (%s) {\n" % " && ".join(condition))
+    #drop the opcodes after the first one,operands are kept in order
+    behind = sum(lengths[1:])
+    operandCount = behind - (len(names) - 1)
+    if operandCount > 0:
+        lines.append("\t\tuint8_t operands[%d];\n" % operandCount)
+        copied = 0
+        for i in range(1, len(names)):
+            if lengths[i] > 1:
+                lines.append("\t\tmemcpy(operands + %d, chunk->code + chunk->count - %d, %d);//%s\n"
+                             % (copied, sum(lengths[i:]) - 1, lengths[i] - 1, names[i]))
+                copied += lengths[i] - 1
+    lines.append("\t\tchunk_fallback(chunk, %d);\n" % behind)
+    if operandCount > 0:
+        lines.append("\t\tfor (uint32_t i = 0; i < %d; ++i) emitByte(operands[i]);\n" % operandCount)
+    lines.append("\t\tCHUNK_PEEK(%d) = %s; //convert command\n" % (sum(lengths) - len(lengths), fused))
+    lines.append("\t\topStack_fallback(opStack, %d);\n" % len(names))
+    lines.append("\t\topStack_push(opStack, %s);\n" % fused)
+    lines.append("\t\treturn;\n\t}\n")
+    return "".join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("report", help="stderr of loxflux --profile")
+    parser.add_argument("--top", type=int, default=4, help="sequences to fuse")
+    parser.add_argument("--min-share", type=float, default=1.0,
+                        help="percent of all the commonds run a sequence needs,1 by default")
+    parser.add_argument("--verbose", action="store_true", help="print why a sequence is skipped")
+    args = parser.parse_args()
+
+    handlers = parse_handlers(read(os.path.join(ROOT, "src", "vm.c")))
+    pushed, checked = parse_opstack(read(os.path.join(ROOT, "src", "compiler.c")))
+    effects = parse_stack_effects(read(os.path.join(ROOT, "src", "chunk.c")))
+    existing = set(re.findall(r"^\s*(OP_\w+),", read(os.path.join(ROOT, "src", "chunk.h")), re.M))
+
+    total, sequences, kept = parse_report(read(args.report))
+    if kept is None:
+        print("//the report has no opStack section,the sequences the compiler keeps are guessed", file=sys.stderr)
+
+    chosen = []
+    skipped = []
+    for count, commonds in sequences:
+        if total > 0 and count * 100.0 < args.min_share * total:
+            break
+        names = [name for name, _ in commonds]
+        fused = fused_name(names)
+        reason = "exists" if fused in existing else fusable(commonds, handlers, pushed, checked, kept, effects)
+        if reason is None and fused not in [name for name, _, _ in chosen]:
+            chosen.append((fused, commonds, count))
+        elif reason is not None:
+            skipped.append("//skip %s (%.2f%%): %s" % (" ".join(names), 100.0 * count / max(total, 1), reason))
+        if len(chosen) == args.top:
+            break
+
+    if args.verbose or not chosen:
+        for line in skipped:
+            print(line, file=sys.stderr)
+    if not chosen:
+        print("//no sequence over %g%% of the commonds can be fused" % args.min_share, file=sys.stderr)
+        return 1
+
+    out = sys.stdout
+    out.write("// ==================== chunk.h,the end of OpCode ====================\n")
+    out.write("\t//superinstructions from the profile\n")
+    for fused, commonds, count in chosen:
+        out.write("\t%s,\t// %s (%d)\n" % (fused, " ".join(name for name, _ in commonds), count))
+
+    out.write("\n// ==================== chunk.c,chunk_commondLength() ====================\n")
+    for fused, commonds, _ in chosen:
+        out.write("\tcase %s:\n\t\treturn %d;\n" % (fused, sum(length for _, length in commonds) - len(commonds) + 1))
+
+    out.write("\n// ==================== chunk.c,commondStackEffect(),chunk_maxStack() sizes the frames by it ====================\n")
+    for fused, commonds, _ in chosen:
+        effect = stack_effect([name for name, _ in commonds], effects)
+        if effect == 0:
+            out.write("\t//%s works on the top,0 is the default\n" % fused)
+        else:
+            out.write("\tcase %s:\n\t\treturn %d;\n" % (fused, effect))
+
+    out.write("\n// ==================== debug.c,disassembleInstruction() ====================\n")
+    for fused, commonds, _ in chosen:
+        length = sum(length for _, length in commonds) - len(commonds) + 1
+        out.write("\tcase %s:\n\t\treturn simpleInstruction(\"%s\", offset) + %d;\n" % (fused, fused, length - 1))
+
+    out.write("\n// ==================== profile.c,commondNames ====================\n")
+    for fused, _, _ in chosen:
+        out.write("\t[%s] = \"%s\",\n" % (fused, fused))
+
+    out.write("\n// ==================== vm.c,label_instructions of run() ====================\n")
+    for fused, _, _ in chosen:
+        out.write("\t\t[%s] = && label_%s,\n" % (fused, fused.lower()))
+
+    out.write("\n// ==================== vm.c,handlers of run() ====================\n")
+    for fused, commonds, _ in chosen:
+        out.write(handler(fused, [name for name, _ in commonds], handlers))
+
+    out.write("\n// ==================== compiler.c,instructionOptimize() before the #undef at its end ====================\n")
+    out.write("\t//the switch may have fused them,peek again\n")
+    out.write("\tcode = opStack_peek(opStack, 0);\n")
+    for fused, commonds, _ in chosen:
+        out.write(rule(fused, commonds))
+
+    out.write("\n// ==================== jit.c,trace.c,aot.c ====================\n")
+    out.write("\t//not generated:the baseline JIT and --emit-c leave %s to the interpreter at the same commond,\n"
+              % " ".join(fused for fused, _, _ in chosen))
+    out.write("\t//a trace that reaches one is aborted.add them by the cases of the commonds they fuse\n")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())